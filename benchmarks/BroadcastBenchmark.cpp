@@ -0,0 +1,154 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/Broadcast.h"
+#include "WinAPI/Channel.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+constexpr size_t notifications = 1000;
+constexpr size_t acknowledgments_capacity = 1 << 16;
+
+// acknowledges each notification of the parent process through a channel
+int run_child(const std::string& prefix)
+{
+  Broadcast broadcast = Broadcast::Open(prefix + ".Broadcast");
+  Channel acknowledgments = Channel::Open(prefix + ".Acknowledgments");
+  uint64_t generation = broadcast.GetGeneration();
+
+  // the parent does not publish before all the subscribers are ready
+  while (!acknowledgments.TrySend("ready")) {
+  }
+
+  for (size_t i(0); i < notifications; ++i)
+  {
+    broadcast.Wait(generation);
+
+    while (!acknowledgments.TrySend("ack")) {
+    }
+  }
+
+  return 0;
+}
+
+#ifdef _WIN32
+
+HANDLE start_child(const std::string& prefix)
+{
+  char exe_path[MAX_PATH];
+  ::GetModuleFileNameA(nullptr, exe_path, MAX_PATH);
+  std::string command_line = "\"" + std::string(exe_path) + "\" " + prefix;
+
+  STARTUPINFOA startup_info = {};
+  startup_info.cb = sizeof(startup_info);
+  PROCESS_INFORMATION process_info = {};
+
+  if (!::CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &process_info)) {
+    std::exit(1);
+  }
+
+  ::CloseHandle(process_info.hThread);
+  return process_info.hProcess;
+}
+
+void wait_child(HANDLE process)
+{
+  ::WaitForSingleObject(process, INFINITE);
+  ::CloseHandle(process);
+}
+
+#else
+
+pid_t start_child(const std::string& prefix)
+{
+  const pid_t pid = ::fork();
+
+  if (pid == 0) {
+    ::_exit(run_child(prefix));
+  }
+
+  return pid;
+}
+
+void wait_child(pid_t pid)
+{
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+#endif // _WIN32
+
+// measures the time needed to wake up all the subscribers, i.e. from
+// Publish() to the last acknowledgment
+void fan_out(const std::string& prefix, size_t subscriber_count)
+{
+  Broadcast broadcast = Broadcast::Create(prefix + ".Broadcast");
+  Channel acknowledgments = Channel::Create(prefix + ".Acknowledgments", acknowledgments_capacity, Channel::MultiProducer);
+
+  std::vector<decltype(start_child(prefix))> children;
+
+  for (size_t i(0); i < subscriber_count; ++i) {
+    children.push_back(start_child(prefix));
+  }
+
+  std::string message;
+
+  for (size_t i(0); i < subscriber_count; ++i) {
+    acknowledgments.Receive(message);
+  }
+
+  const std::string name = "publish to " + std::to_string(subscriber_count) + " processes";
+  Benchmark::Measure(name.c_str(), notifications, [&](size_t) {
+    broadcast.Publish();
+
+    for (size_t i(0); i < subscriber_count; ++i) {
+      acknowledgments.Receive(message);
+    }
+  });
+
+  for (auto child : children) {
+    wait_child(child);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc == 2) {
+    return run_child(argv[1]);
+  }
+
+#ifdef _WIN32
+  const std::string prefix = "WinAPI.Benchmarks.Broadcast." + std::to_string(::GetCurrentProcessId());
+#else
+  const std::string prefix = "WinAPI.Benchmarks.Broadcast." + std::to_string(::getpid());
+#endif
+
+  // the fast path, without any subscriber blocked
+  {
+    Broadcast broadcast = Broadcast::Create(prefix + ".Idle");
+    Benchmark::Measure("publish (no waiter)", 1000000, [&](size_t) {
+      broadcast.Publish();
+    });
+  }
+
+  for (size_t subscriber_count : { 1, 16, 128 }) {
+    fan_out(prefix + "." + std::to_string(subscriber_count), subscriber_count);
+  }
+
+  return 0;
+}
\ No newline at end of file
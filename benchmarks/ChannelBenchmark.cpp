@@ -0,0 +1,174 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/Channel.h"
+
+#include <cstdlib>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+constexpr size_t round_trips = 100000;
+constexpr size_t streamed_messages = 1000000;
+constexpr size_t streamed_message_size = 256;
+constexpr size_t channel_capacity = 1 << 20;
+
+// answers each message of the parent process with the same message
+int run_ping_child(const std::string& prefix)
+{
+  Channel ping = Channel::Open(prefix + ".Ping");
+  Channel pong = Channel::Open(prefix + ".Pong");
+  std::string message;
+
+  // one more for the round trip that waits for the child to start
+  for (size_t i(0); i <= round_trips; ++i)
+  {
+    ping.Receive(message);
+
+    while (!pong.TrySend(message)) {
+    }
+  }
+
+  return 0;
+}
+
+// sends messages to the parent process as fast as it can receive them
+int run_stream_child(const std::string& prefix)
+{
+  Channel stream = Channel::Open(prefix + ".Stream");
+  const std::string message(streamed_message_size, 's');
+
+  for (size_t i(0); i <= streamed_messages; ++i)
+  {
+    while (!stream.TrySend(message)) {
+    }
+  }
+
+  return 0;
+}
+
+int run_child(const std::string& prefix, const std::string& mode)
+{
+  return mode == "Ping" ? run_ping_child(prefix) : run_stream_child(prefix);
+}
+
+#ifdef _WIN32
+
+HANDLE start_child(const std::string& prefix, const std::string& mode)
+{
+  char exe_path[MAX_PATH];
+  ::GetModuleFileNameA(nullptr, exe_path, MAX_PATH);
+  std::string command_line = "\"" + std::string(exe_path) + "\" " + prefix + " " + mode;
+
+  STARTUPINFOA startup_info = {};
+  startup_info.cb = sizeof(startup_info);
+  PROCESS_INFORMATION process_info = {};
+
+  if (!::CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &process_info)) {
+    std::exit(1);
+  }
+
+  ::CloseHandle(process_info.hThread);
+  return process_info.hProcess;
+}
+
+void wait_child(HANDLE process)
+{
+  ::WaitForSingleObject(process, INFINITE);
+  ::CloseHandle(process);
+}
+
+#else
+
+pid_t start_child(const std::string& prefix, const std::string& mode)
+{
+  const pid_t pid = ::fork();
+
+  if (pid == 0) {
+    ::_exit(run_child(prefix, mode));
+  }
+
+  return pid;
+}
+
+void wait_child(pid_t pid)
+{
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+#endif // _WIN32
+
+// measures the latency of a round trip between two processes, i.e. a small
+// message sent through a channel and back through another one
+void ping_pong(const std::string& prefix, int spin_count)
+{
+  Channel ping = Channel::Create(prefix + ".Ping", channel_capacity);
+  Channel pong = Channel::Create(prefix + ".Pong", channel_capacity);
+  pong.SetSpinCount(spin_count);
+
+  auto child = start_child(prefix, "Ping");
+
+  const std::string message = "ping";
+  std::string answer;
+  ping.TrySend(message);
+  pong.Receive(answer);
+
+  const std::string name = "round trip (spin count " + std::to_string(spin_count) + ")";
+  Benchmark::Measure(name.c_str(), round_trips, [&](size_t) {
+    ping.TrySend(message);
+    pong.Receive(answer);
+  });
+
+  wait_child(child);
+}
+
+// measures the throughput of a stream of messages from one process to another
+void stream(const std::string& prefix, int spin_count)
+{
+  Channel stream = Channel::Create(prefix + ".Stream", channel_capacity);
+  stream.SetSpinCount(spin_count);
+
+  auto child = start_child(prefix, "Stream");
+
+  std::string message;
+  stream.Receive(message);
+
+  const std::string name = "stream " + std::to_string(streamed_message_size) + " B (spin count " + std::to_string(spin_count) + ")";
+  Benchmark::MeasureThroughput(name.c_str(), streamed_messages * streamed_message_size, [&]() {
+    for (size_t i(0); i < streamed_messages; ++i) {
+      stream.Receive(message);
+    }
+  });
+
+  wait_child(child);
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc == 3) {
+    return run_child(argv[1], argv[2]);
+  }
+
+#ifdef _WIN32
+  const std::string prefix = "WinAPI.Benchmarks.Channel." + std::to_string(::GetCurrentProcessId());
+#else
+  const std::string prefix = "WinAPI.Benchmarks.Channel." + std::to_string(::getpid());
+#endif
+
+  ping_pong(prefix + ".Blocking", 0);
+  ping_pong(prefix + ".Spinning", 4000);
+  stream(prefix + ".Blocking", 0);
+  stream(prefix + ".Spinning", 4000);
+  return 0;
+}
\ No newline at end of file
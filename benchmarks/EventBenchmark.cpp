@@ -0,0 +1,123 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/Event.h"
+
+#include <cstdlib>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+constexpr size_t round_trips = 100000;
+
+// answers each 'ping' of the parent process with a 'pong'
+int run_child(const std::string& prefix, int spin_count)
+{
+  Event ping = Event::Open(prefix + ".Ping");
+  Event pong = Event::Open(prefix + ".Pong");
+  ping.SetSpinCount(spin_count);
+
+  // one more for the round trip that waits for the child to start
+  for (size_t i(0); i <= round_trips; ++i)
+  {
+    ping.Wait();
+    pong.Set();
+  }
+
+  return 0;
+}
+
+#ifdef _WIN32
+
+HANDLE start_child(const std::string& prefix, int spin_count)
+{
+  char exe_path[MAX_PATH];
+  ::GetModuleFileNameA(nullptr, exe_path, MAX_PATH);
+  std::string command_line = "\"" + std::string(exe_path) + "\" " + prefix + " " + std::to_string(spin_count);
+
+  STARTUPINFOA startup_info = {};
+  startup_info.cb = sizeof(startup_info);
+  PROCESS_INFORMATION process_info = {};
+
+  if (!::CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &process_info)) {
+    std::exit(1);
+  }
+
+  ::CloseHandle(process_info.hThread);
+  return process_info.hProcess;
+}
+
+void wait_child(HANDLE process)
+{
+  ::WaitForSingleObject(process, INFINITE);
+  ::CloseHandle(process);
+}
+
+#else
+
+pid_t start_child(const std::string& prefix, int spin_count)
+{
+  const pid_t pid = ::fork();
+
+  if (pid == 0) {
+    ::_exit(run_child(prefix, spin_count));
+  }
+
+  return pid;
+}
+
+void wait_child(pid_t pid)
+{
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+#endif // _WIN32
+
+// measures the latency of a round trip between two processes, i.e. two
+// Set() and two Wait() on auto-reset events
+void ping_pong(const char* name, const std::string& prefix, int spin_count)
+{
+  Event ping = Event::Create(prefix + ".Ping", Event::AutoReset);
+  Event pong = Event::Create(prefix + ".Pong", Event::AutoReset);
+  pong.SetSpinCount(spin_count);
+
+  auto child = start_child(prefix, spin_count);
+
+  ping.Set();
+  pong.Wait();
+
+  Benchmark::Measure(name, round_trips, [&](size_t) {
+    ping.Set();
+    pong.Wait();
+  });
+
+  wait_child(child);
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc == 3) {
+    return run_child(argv[1], std::atoi(argv[2]));
+  }
+
+#ifdef _WIN32
+  const std::string prefix = "WinAPI.Benchmarks.Event." + std::to_string(::GetCurrentProcessId());
+#else
+  const std::string prefix = "WinAPI.Benchmarks.Event." + std::to_string(::getpid());
+#endif
+
+  ping_pong("round trip (blocking)", prefix + ".Blocking", 0);
+  ping_pong("round trip (spin count 4000)", prefix + ".Spinning", 4000);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/LocalEvent.h"
+
+#include <thread>
+
+using namespace Win32;
+
+constexpr size_t iterations = 10000000;
+constexpr size_t round_trips = 100000;
+
+// measures the latency of a round trip between two threads, i.e. two Set()
+// and two Wait() on auto-reset events, each of which blocks
+void ping_pong()
+{
+  LocalEvent ping{ Event::AutoReset };
+  LocalEvent pong{ Event::AutoReset };
+
+  std::thread thread{ [&]() {
+    for (size_t i(0); i < round_trips; ++i)
+    {
+      ping.Wait();
+      pong.Set();
+    }
+  } };
+
+  Benchmark::Measure("round trip between threads", round_trips, [&](size_t) {
+    ping.Set();
+    pong.Wait();
+  });
+
+  thread.join();
+}
+
+// the fast paths never enter the kernel, as no thread is blocked
+int main()
+{
+  LocalEvent manual{ Event::ManualReset };
+  LocalEvent automatic{ Event::AutoReset };
+
+  Benchmark::Measure("Set() and Reset()", iterations, [&](size_t) {
+    manual.Set();
+    manual.Reset();
+  });
+
+  manual.Set();
+  Benchmark::Measure("Wait() on a set event", iterations, [&](size_t) {
+    manual.Wait();
+  });
+
+  Benchmark::Measure("Set() and Wait() (auto-reset)", iterations, [&](size_t) {
+    automatic.Set();
+    automatic.Wait();
+  });
+
+  ping_pong();
+  return 0;
+}
\ No newline at end of file
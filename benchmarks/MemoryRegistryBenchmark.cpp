@@ -0,0 +1,63 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryValue.h"
+
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+// measures the overhead of the registry layer itself, with the in-memory backend
+int main()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  constexpr size_t key_count = 1000;
+  std::vector<std::string> names;
+
+  for (size_t i(0); i < key_count; ++i) {
+    names.push_back("Software\\Benchmark\\Key" + std::to_string(i));
+  }
+
+  Benchmark::Measure("CreateKey", key_count, [&](size_t i) {
+    Registry::CreateKey(Registry::HKEY_CURRENT_USER, names[i], Registry::Write).SetValue("Value", static_cast<int>(i));
+  });
+
+  Benchmark::Measure("OpenKey", 100000, [&](size_t i) {
+    RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, names[i % key_count], Registry::Read);
+    Benchmark::DoNotOptimize(key);
+  });
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Software\\Benchmark", static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+
+  Benchmark::Measure("SetValue (int)", 1000000, [&](size_t i) {
+    key.SetValue("Int", static_cast<int>(i));
+  });
+
+  Benchmark::Measure("GetIntValue", 1000000, [&](size_t) {
+    Benchmark::DoNotOptimize(key.GetIntValue("Int"));
+  });
+
+  key.SetValue("String", "C:\\Program Files\\WinAPI\\Benchmark");
+  std::string str;
+
+  Benchmark::Measure("GetStringValue (reused buffer)", 1000000, [&](size_t) {
+    key.GetStringValue("String", str);
+  });
+
+  RegistryValue value;
+
+  Benchmark::Measure("GetValue (RegistryValue)", 1000000, [&](size_t) {
+    key.GetValue("String", value);
+  });
+
+  Registry::SetBackend(nullptr);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/Event.h"
+#include "WinAPI/Mutex.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// the number of lock/unlock pairs, shared by the processes
+constexpr size_t total_locks = 400000;
+
+// locks and unlocks the mutex its share of the total number of times, once
+// the parent process has started all the processes
+int run_child(const std::string& prefix, size_t process_count, int spin_count)
+{
+  Mutex mutex = Mutex::Open(prefix + ".Mutex");
+  Event start = Event::Open(prefix + ".Start");
+  mutex.SetSpinCount(spin_count);
+
+  start.Wait();
+
+  for (size_t i(0); i < total_locks / process_count; ++i)
+  {
+    mutex.Lock();
+    mutex.Unlock();
+  }
+
+  return 0;
+}
+
+#ifdef _WIN32
+
+HANDLE start_child(const std::string& prefix, size_t process_count, int spin_count)
+{
+  char exe_path[MAX_PATH];
+  ::GetModuleFileNameA(nullptr, exe_path, MAX_PATH);
+  std::string command_line = "\"" + std::string(exe_path) + "\" " + prefix + " " + std::to_string(process_count) + " " + std::to_string(spin_count);
+
+  STARTUPINFOA startup_info = {};
+  startup_info.cb = sizeof(startup_info);
+  PROCESS_INFORMATION process_info = {};
+
+  if (!::CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &process_info)) {
+    std::exit(1);
+  }
+
+  ::CloseHandle(process_info.hThread);
+  return process_info.hProcess;
+}
+
+void wait_child(HANDLE process)
+{
+  ::WaitForSingleObject(process, INFINITE);
+  ::CloseHandle(process);
+}
+
+#else
+
+pid_t start_child(const std::string& prefix, size_t process_count, int spin_count)
+{
+  const pid_t pid = ::fork();
+
+  if (pid == 0) {
+    ::_exit(run_child(prefix, process_count, spin_count));
+  }
+
+  return pid;
+}
+
+void wait_child(pid_t pid)
+{
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+}
+
+#endif // _WIN32
+
+// measures the average time of a lock/unlock pair while the mutex is
+// contended by several processes
+void contention(const std::string& prefix, size_t process_count, int spin_count)
+{
+  Mutex mutex = Mutex::Create(prefix + ".Mutex");
+  Event start = Event::Create(prefix + ".Start", Event::ManualReset);
+
+  std::vector<decltype(start_child(prefix, process_count, spin_count))> children;
+
+  for (size_t i(0); i < process_count; ++i) {
+    children.push_back(start_child(prefix, process_count, spin_count));
+  }
+
+  const std::string name = std::to_string(process_count) + " processes (spin count " + std::to_string(spin_count) + ")";
+  Benchmark::MeasureItems(name.c_str(), total_locks, [&]() {
+    start.Set();
+
+    for (auto child : children) {
+      wait_child(child);
+    }
+  });
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc == 4) {
+    return run_child(argv[1], std::strtoul(argv[2], nullptr, 10), std::atoi(argv[3]));
+  }
+
+#ifdef _WIN32
+  const std::string prefix = "WinAPI.Benchmarks.Mutex." + std::to_string(::GetCurrentProcessId());
+#else
+  const std::string prefix = "WinAPI.Benchmarks.Mutex." + std::to_string(::getpid());
+#endif
+
+  // the fast path, without contention
+  {
+    Mutex mutex = Mutex::Create(prefix + ".Uncontended");
+    Benchmark::Measure("lock and unlock (uncontended)", 1000000, [&](size_t) {
+      mutex.Lock();
+      mutex.Unlock();
+    });
+  }
+
+  for (size_t process_count : { 2, 4, 8, 16, 32, 64 })
+  {
+    contention(prefix + "." + std::to_string(process_count) + ".Blocking", process_count, 0);
+    contention(prefix + "." + std::to_string(process_count) + ".Spinning", process_count, 4000);
+  }
+
+  return 0;
+}
\ No newline at end of file
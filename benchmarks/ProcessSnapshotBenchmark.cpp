@@ -0,0 +1,39 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/ProcessSnapshot.h"
+
+#include <cstdio>
+
+using namespace Win32;
+
+constexpr size_t refreshes = 100;
+
+int main()
+{
+  ProcessSnapshot snapshot;
+  snapshot.Refresh();
+  const size_t count = snapshot.GetProcesses().size();
+  std::printf("%zu processes\n", count);
+
+  // a new snapshot queries the executable path of every process
+  Benchmark::Measure("Refresh() (new snapshot)", refreshes, [&](size_t) {
+    ProcessSnapshot fresh;
+    fresh.Refresh();
+    Benchmark::DoNotOptimize(fresh);
+  });
+
+  // only the processes started since the last refresh are queried
+  Benchmark::Measure("Refresh() (incremental)", refreshes, [&](size_t) {
+    snapshot.Refresh();
+  });
+
+  Benchmark::Measure("FindByExecutableName()", refreshes * 100, [&](size_t) {
+    Benchmark::DoNotOptimize(snapshot.FindByExecutableName("bash"));
+  });
+
+  return 0;
+}
\ No newline at end of file
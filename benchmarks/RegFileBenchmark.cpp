@@ -0,0 +1,86 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/RegFile.h"
+#include "WinAPI/Registry.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+// creates keys with the usual kinds of values, binary values being the
+// largest part of the files as in exports of real registries
+void create_keys(RegistryKey& root, size_t count)
+{
+  std::vector<unsigned char> binary(256);
+
+  for (size_t i(0); i < binary.size(); ++i) {
+    binary[i] = static_cast<unsigned char>(i * 7);
+  }
+
+  for (size_t i(0); i < count; ++i)
+  {
+    RegistryKey key = Registry::CreateKey(root, "Group" + std::to_string(i / 100) + "\\Key" + std::to_string(i), Registry::Write);
+    key.SetValue("", "Key " + std::to_string(i));
+    key.SetValue("Path", "C:\\Program Files\\WinAPI\\Benchmark\\" + std::to_string(i));
+    key.SetValue("Version", static_cast<int>(i));
+    key.SetQWordValue("Size", uint64_t(i) << 20);
+    key.SetMultiStringValue("Names", { "first", "second", "third" });
+    key.SetBinaryValue("Data", binary.data(), binary.size());
+  }
+}
+
+std::string export_keys(RegFileWriter::Encoding encoding)
+{
+  std::ostringstream output;
+  RegFileWriter writer{ output, encoding };
+  writer.Write(Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Benchmark", Registry::Read), "HKEY_CURRENT_USER\\Benchmark");
+  writer.Flush();
+  return output.str();
+}
+
+// measures the import and export of a .reg file of about 20 MB (in UTF-8)
+// with the in-memory backend, so that mostly the parser and the writer are
+// measured; the target is 100 MB/s
+int main()
+{
+  constexpr size_t key_count = 20000;
+
+  for (RegFileWriter::Encoding encoding : { RegFileWriter::Utf8, RegFileWriter::Utf16 })
+  {
+    const char* suffix = encoding == RegFileWriter::Utf8 ? " (UTF-8)" : " (UTF-16)";
+    std::string content;
+
+    {
+      MemoryRegistry memory;
+      Registry::SetBackend(&memory);
+      RegistryKey root = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Benchmark", Registry::Write);
+      create_keys(root, key_count);
+
+      content = export_keys(encoding);
+      Benchmark::MeasureThroughput((std::string("RegFileWriter::Write") + suffix).c_str(), content.size(), [&]() {
+        const std::string exported = export_keys(encoding);
+        Benchmark::DoNotOptimize(exported);
+      });
+
+      Registry::SetBackend(nullptr);
+    }
+
+    MemoryRegistry memory;
+    RegFileReader reader;
+    reader.SetBackend(&memory);
+
+    Benchmark::MeasureThroughput((std::string("RegFileReader::Import") + suffix).c_str(), content.size(), [&]() {
+      std::istringstream input{ content };
+      reader.Import(input);
+    });
+  }
+
+  return 0;
+}
\ No newline at end of file
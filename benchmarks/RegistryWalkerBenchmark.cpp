@@ -0,0 +1,85 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryWalker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace Win32;
+
+// creates 'fanout' subkeys per key down to 'depth', with a few values per key
+size_t create_tree(RegistryKey& key, int fanout, int depth)
+{
+  key.SetValue("Name", "C:\\Program Files\\WinAPI\\Benchmark");
+  key.SetValue("Version", 1);
+  size_t count = 1;
+
+  if (depth == 0) {
+    return count;
+  }
+
+  for (int i(0); i < fanout; ++i)
+  {
+    RegistryKey child = Registry::CreateKey(key, "Key" + std::to_string(i), Registry::Write);
+    count += create_tree(child, fanout, depth - 1);
+  }
+
+  return count;
+}
+
+// measures the average time per visited key of a walk of an in-memory tree, so that
+// only the overhead of the walker itself is measured
+int main()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey root = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Benchmark", Registry::Write);
+  const size_t wide_tree = create_tree(root, 20, 4);
+
+  // a deep and narrow tree, where the keys are far from the root
+  RegistryKey deep = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Deep", Registry::Write);
+  size_t deep_tree = 0;
+
+  for (int i(0); i < 16; ++i)
+  {
+    RegistryKey branch = Registry::CreateKey(deep, "Branch" + std::to_string(i) + "\\A\\B\\C\\D\\E\\F\\G\\H\\I\\J\\K\\L\\M\\N\\O", Registry::Write);
+    deep_tree += 16 + create_tree(branch, 3, 5);
+  }
+
+  const size_t thread_counts[] = { 1, 2, 4, (std::max)(std::thread::hardware_concurrency(), 1u) };
+
+  for (size_t thread_count : thread_counts)
+  {
+    std::atomic<size_t> values{ 0 };
+    RegistryWalker walker;
+    walker.SetThreadCount(thread_count);
+    walker.SetValueVisitor([&values](const RegistryWalker::Key&, const RegistryWalker::Value&) {
+      values.fetch_add(1, std::memory_order_relaxed);
+      return RegistryWalker::Continue;
+    });
+
+    const std::string threads = std::to_string(thread_count) + (thread_count == 1 ? " thread" : " threads");
+
+    Benchmark::MeasureItems(("Walk, wide tree (" + threads + ")").c_str(), wide_tree, [&]() {
+      walker.Walk(Registry::HKEY_CURRENT_USER, "Benchmark");
+    });
+
+    Benchmark::MeasureItems(("Walk, deep tree (" + threads + ")").c_str(), deep_tree, [&]() {
+      walker.Walk(Registry::HKEY_CURRENT_USER, "Deep");
+    });
+
+    Benchmark::DoNotOptimize(values);
+  }
+
+  Registry::SetBackend(nullptr);
+  return 0;
+}
\ No newline at end of file
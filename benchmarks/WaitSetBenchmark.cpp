@@ -0,0 +1,110 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "benchmark.h"
+
+#include "WinAPI/Event.h"
+#include "WinAPI/Timer.h"
+#include "WinAPI/WaitSet.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+constexpr size_t round_trips = 10000;
+
+// the cost of each operation should not depend on the number of objects
+// in the set
+void measure_events(size_t count)
+{
+  const std::string suffix = " (" + std::to_string(count) + " events)";
+  std::vector<std::unique_ptr<Event>> events;
+
+  for (size_t i(0); i < count; ++i) {
+    events.push_back(std::make_unique<Event>(std::string(), Event::AutoReset));
+  }
+
+  WaitSet set;
+  std::vector<WaitSet::Id> ids;
+
+  Benchmark::MeasureItems(("Add()" + suffix).c_str(), count, [&]() {
+    for (const std::unique_ptr<Event>& ev : events) {
+      ids.push_back(set.Add(*ev));
+    }
+  });
+
+  // a single object is signaled among all the others
+  std::vector<WaitSet::Id> ready;
+
+  Benchmark::Measure(("Set(), Wait(), Rearm()" + suffix).c_str(), round_trips, [&](size_t i) {
+    events[i % count]->Set();
+    set.Wait(ready);
+    set.Rearm(ready.front());
+  });
+
+  // all the objects are signaled and collected in batches
+  Benchmark::MeasureItems(("collect all" + suffix).c_str(), count, [&]() {
+    for (const std::unique_ptr<Event>& ev : events) {
+      ev->Set();
+    }
+
+    size_t collected = 0;
+
+    while (collected < count && set.Wait(ready))
+    {
+      collected += ready.size();
+
+      for (WaitSet::Id id : ready) {
+        set.Rearm(id);
+      }
+    }
+  });
+
+  Benchmark::MeasureItems(("Remove()" + suffix).c_str(), count, [&]() {
+    for (WaitSet::Id id : ids) {
+      set.Remove(id);
+    }
+  });
+}
+
+void measure_timers(size_t count)
+{
+  const std::string suffix = " (" + std::to_string(count) + " timers)";
+  std::vector<Timer> timers(count);
+  WaitSet set;
+
+  for (const Timer& timer : timers) {
+    set.Add(timer);
+  }
+
+  std::vector<WaitSet::Id> ready;
+
+  Benchmark::MeasureItems(("collect all" + suffix).c_str(), count, [&]() {
+    for (Timer& timer : timers) {
+      timer.Start(std::chrono::nanoseconds(0));
+    }
+
+    size_t collected = 0;
+
+    while (collected < count && set.Wait(ready)) {
+      collected += ready.size();
+    }
+  });
+}
+
+int main()
+{
+  for (size_t count : { 16, 256, 4096 }) {
+    measure_events(count);
+  }
+
+  // a timer is a file descriptor on Linux, of which there are usually at most 1024
+  for (size_t count : { 16, 256, 768 }) {
+    measure_timers(count);
+  }
+
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_BENCHMARKS_BENCHMARK_H
+#define WINAPI_BENCHMARKS_BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+
+// A minimal benchmark harness: the benchmarks are programs that print the
+// time taken by each measured operation. They are not run by the tests.
+
+namespace Benchmark
+{
+
+inline const void* volatile sink = nullptr;
+
+// prevents the compiler from optimizing away the computation of a value
+template<typename T>
+void DoNotOptimize(const T& value)
+{
+  sink = &value;
+}
+
+// runs f(i) for i in [0, iterations) and prints the average time of a call
+template<typename F>
+double Measure(const char* name, size_t iterations, F&& f)
+{
+  const auto start = std::chrono::steady_clock::now();
+
+  for (size_t i(0); i < iterations; ++i) {
+    f(i);
+  }
+
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  const double ns = elapsed.count() / static_cast<double>(iterations);
+  std::printf("%-40s %12.1f ns\n", name, ns);
+  return ns;
+}
+
+// runs f() once and prints the average time per item, for operations that
+// process many items at once
+template<typename F>
+double MeasureItems(const char* name, size_t items, F&& f)
+{
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  const double ns = elapsed.count() / static_cast<double>(items);
+  std::printf("%-40s %12.1f ns\n", name, ns);
+  return ns;
+}
+
+// runs f() once and prints the number of bytes processed per second
+template<typename F>
+double MeasureThroughput(const char* name, size_t bytes, F&& f)
+{
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  const double mb_per_second = static_cast<double>(bytes) / elapsed.count() / 1e6;
+  std::printf("%-40s %12.1f MB/s\n", name, mb_per_second);
+  return mb_per_second;
+}
+
+} // namespace Benchmark
+
+#endif // WINAPI_BENCHMARKS_BENCHMARK_H
\ No newline at end of file
@@ -0,0 +1,504 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "Broadcast.h"
+
+#include "sharedmemory_priv.h"
+
+#ifndef _WIN32
+#include "futex_priv.h"
+#endif
+
+#include <algorithm>
+#include <climits>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+// The file mapping only contains this structure. The memory of a new file
+// mapping is zero-initialized, which is a valid initial state.
+struct broadcast_header
+{
+  std::atomic<uint64_t> generation;
+  // number of threads that are about to wait or are waiting on the semaphore
+  // (low half), and the tag under which they registered (high half), i.e.
+  // the low half of the generation that was last published to waiters
+  std::atomic<uint64_t> waiters;
+};
+
+#else
+
+// The shared memory object only contains this structure, zero-initialized
+// when it is created.
+struct broadcast_header
+{
+  std::atomic<uint64_t> generation;
+  // incremented after the generation, the futex on which the subscribers block
+  std::atomic<uint32_t> sequence;
+  // number of threads that are about to block or are blocked on the futex
+  std::atomic<uint32_t> waiters;
+};
+
+#endif // _WIN32
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "atomics in shared memory must be lock-free");
+
+struct BroadcastPriv
+{
+  std::string name;
+  SharedMemory shm;
+  broadcast_header* header = nullptr;
+#ifdef _WIN32
+  HANDLE semaphore = nullptr;
+#endif
+  bool created = false;
+
+  ~BroadcastPriv();
+};
+
+BroadcastPriv::~BroadcastPriv()
+{
+#ifdef _WIN32
+  if (semaphore) {
+    ::CloseHandle(semaphore);
+  }
+#endif
+}
+
+#ifdef _WIN32
+
+std::wstring broadcast_semaphore_name(const std::string& name)
+{
+  return ToUtf16(name + "Semaphore");
+}
+
+// creates or opens the file mapping and the semaphore of a broadcast
+void create_broadcast(BroadcastPriv& b, const std::string& name, bool must_create)
+{
+  b.name = name;
+
+  create_shared_memory(b.shm, name, sizeof(broadcast_header), must_create);
+  b.header = static_cast<broadcast_header*>(b.shm.view);
+  b.created = b.shm.created;
+
+  constexpr LONG initial_count = 0;
+  constexpr LONG maximum_count = LONG_MAX;
+  b.semaphore = ::CreateSemaphoreW(nullptr, initial_count, maximum_count, broadcast_semaphore_name(name).c_str());
+
+  if (!b.semaphore) {
+    throw Exception(GetLastError());
+  }
+}
+
+void open_broadcast(BroadcastPriv& b, const std::string& name)
+{
+  b.name = name;
+
+  open_shared_memory(b.shm, name);
+  b.header = static_cast<broadcast_header*>(b.shm.view);
+
+  constexpr bool inherit_handle = false;
+  constexpr DWORD desired_access = SEMAPHORE_MODIFY_STATE | SYNCHRONIZE;
+  b.semaphore = ::OpenSemaphoreW(desired_access, inherit_handle, broadcast_semaphore_name(name).c_str());
+
+  if (!b.semaphore) {
+    throw Exception(GetLastError());
+  }
+}
+
+constexpr int broadcast_tag_shift = 32;
+
+uint32_t broadcast_tag(uint64_t waiters)
+{
+  return static_cast<uint32_t>(waiters >> broadcast_tag_shift);
+}
+
+uint32_t broadcast_count(uint64_t waiters)
+{
+  return static_cast<uint32_t>(waiters);
+}
+
+void publish_generation(BroadcastPriv& b, uint64_t generation)
+{
+  broadcast_header& h = *b.header;
+  const uint32_t tag = static_cast<uint32_t>(generation);
+  uint64_t waiters = h.waiters.load(std::memory_order_seq_cst);
+
+  // the waiters are released under a new tag, unless a concurrent Publish()
+  // of a later generation has already released them
+  while (broadcast_count(waiters) != 0 && static_cast<int32_t>(tag - broadcast_tag(waiters)) > 0)
+  {
+    if (h.waiters.compare_exchange_weak(waiters, uint64_t(tag) << broadcast_tag_shift, std::memory_order_seq_cst))
+    {
+      ::ReleaseSemaphore(b.semaphore, static_cast<LONG>(broadcast_count(waiters)), nullptr);
+      return;
+    }
+  }
+}
+
+// Each thread that waits on the semaphore is counted in 'waiters', and
+// Publish() turns this count into permits of the semaphore. A thread that
+// stops waiting without consuming a permit must therefore remove itself
+// from the count, or consume the permit released for it, so that permits
+// do not accumulate.
+void cancel_broadcast_wait(BroadcastPriv& b, uint32_t tag)
+{
+  broadcast_header& h = *b.header;
+  uint64_t waiters = h.waiters.load(std::memory_order_seq_cst);
+
+  // the tag changes when the waiters are released, until then this thread
+  // is part of the count
+  while (broadcast_tag(waiters) == tag)
+  {
+    if (h.waiters.compare_exchange_weak(waiters, waiters - 1, std::memory_order_seq_cst)) {
+      return;
+    }
+  }
+
+  // Publish() has already counted this thread, the permit is released
+  // right after the count is reset
+  ::WaitForSingleObject(b.semaphore, INFINITE);
+}
+
+DWORD broadcast_remaining(std::chrono::steady_clock::time_point deadline, bool infinite)
+{
+  if (infinite) {
+    return INFINITE;
+  }
+
+  // INFINITE must not be reached by a finite timeout
+  const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+  return static_cast<DWORD>((std::min)((std::max)(remaining, std::chrono::milliseconds::rep(0)), static_cast<std::chrono::milliseconds::rep>(INFINITE - 1)));
+}
+
+bool wait_generation(BroadcastPriv& b, uint64_t& generation, std::chrono::milliseconds timeout, bool infinite)
+{
+  broadcast_header& h = *b.header;
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  for (;;)
+  {
+    uint64_t current = h.generation.load(std::memory_order_seq_cst);
+
+    if (current != generation) {
+      generation = current;
+      return true;
+    }
+
+    // Publish() increments the generation before reading the number of waiters,
+    // so either it sees us or we see the new generation.
+    const uint32_t tag = broadcast_tag(h.waiters.fetch_add(1, std::memory_order_seq_cst));
+    current = h.generation.load(std::memory_order_seq_cst);
+
+    if (current != generation) {
+      cancel_broadcast_wait(b, tag);
+      generation = current;
+      return true;
+    }
+
+    DWORD result = ::WaitForSingleObject(b.semaphore, broadcast_remaining(deadline, infinite));
+
+    // The permits are not addressed to a thread: one released for a thread
+    // that registered under an earlier tag may be consumed by this thread,
+    // which is still counted as long as the tag has not changed. The permit
+    // is given back to the thread it was released for.
+    while (result == WAIT_OBJECT_0 && broadcast_tag(h.waiters.load(std::memory_order_seq_cst)) == tag)
+    {
+      ::ReleaseSemaphore(b.semaphore, 1, nullptr);
+      ::SwitchToThread();
+      result = ::WaitForSingleObject(b.semaphore, broadcast_remaining(deadline, infinite));
+    }
+
+    if (result == WAIT_FAILED) {
+      cancel_broadcast_wait(b, tag);
+      return false;
+    }
+
+    if (result == WAIT_TIMEOUT)
+    {
+      cancel_broadcast_wait(b, tag);
+      current = h.generation.load(std::memory_order_seq_cst);
+
+      if (current == generation) {
+        return false;
+      }
+
+      generation = current;
+      return true;
+    }
+
+    // a permit was consumed, so this thread is no longer counted; the
+    // generation is checked again at the beginning of the loop
+  }
+}
+
+#else
+
+// creates or opens the shared memory object of a broadcast
+void create_broadcast(BroadcastPriv& b, const std::string& name, bool must_create)
+{
+  b.name = name;
+
+  create_shared_memory(b.shm, name, sizeof(broadcast_header), must_create);
+  b.header = static_cast<broadcast_header*>(b.shm.view);
+  b.created = b.shm.created;
+}
+
+void open_broadcast(BroadcastPriv& b, const std::string& name)
+{
+  b.name = name;
+
+  open_shared_memory(b.shm, name);
+
+  if (b.shm.size < sizeof(broadcast_header)) {
+    throw Exception(ErrorCode(ERROR_INVALID_DATA));
+  }
+
+  b.header = static_cast<broadcast_header*>(b.shm.view);
+}
+
+void publish_generation(BroadcastPriv& b, uint64_t /* generation */)
+{
+  broadcast_header& h = *b.header;
+  h.sequence.fetch_add(1, std::memory_order_seq_cst);
+
+  if (h.waiters.load(std::memory_order_seq_cst) != 0) {
+    futex_wake(h.sequence, INT_MAX);
+  }
+}
+
+// all the subscribers block on the same futex, which is woken as a whole, so
+// that a subscriber cannot take the place of another one
+bool wait_generation(BroadcastPriv& b, uint64_t& generation, std::chrono::milliseconds timeout, bool infinite)
+{
+  broadcast_header& h = *b.header;
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  for (;;)
+  {
+    // the sequence is read first: if the generation is the old one, the
+    // sequence is too
+    const uint32_t sequence = h.sequence.load(std::memory_order_seq_cst);
+    const uint64_t current = h.generation.load(std::memory_order_seq_cst);
+
+    if (current != generation) {
+      generation = current;
+      return true;
+    }
+
+    std::chrono::nanoseconds remaining(0);
+
+    if (!infinite)
+    {
+      remaining = futex_remaining(deadline);
+
+      if (remaining.count() <= 0) {
+        return false;
+      }
+    }
+
+    // Publish() increments the sequence before reading the number of waiters,
+    // so either it wakes us or the futex no longer has the expected value
+    h.waiters.fetch_add(1, std::memory_order_seq_cst);
+    futex_wait(h.sequence, sequence, remaining, infinite);
+    h.waiters.fetch_sub(1, std::memory_order_seq_cst);
+  }
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+Broadcast::Broadcast() noexcept
+  : d(nullptr)
+{
+
+}
+
+Broadcast::Broadcast(Broadcast&&) noexcept = default;
+
+Broadcast::~Broadcast()
+{
+
+}
+
+/**
+ * \brief create or open a broadcast
+ * \param broadcastName  the name of the broadcast
+ * \throw Exception on failure
+ *
+ * Use the Created() function to check whether this constructor actually
+ * created the broadcast or only opened it.
+ */
+Broadcast::Broadcast(const std::string& broadcastName)
+  : d(std::make_unique<Impl::BroadcastPriv>())
+{
+  constexpr bool must_create = false;
+  Impl::create_broadcast(*d, broadcastName, must_create);
+}
+
+Broadcast::Broadcast(std::unique_ptr<Impl::BroadcastPriv> dPtr)
+  : d(std::move(dPtr))
+{
+
+}
+
+/**
+ * \brief open a broadcast
+ * \param broadcastName  the name of the broadcast
+ * \return the opened broadcast
+ * \throw Exception on failure
+ *
+ * This function will fail if the broadcast does not exist.
+ */
+Broadcast Broadcast::Open(const std::string& broadcastName)
+{
+  auto dptr = std::make_unique<Impl::BroadcastPriv>();
+  Impl::open_broadcast(*dptr, broadcastName);
+  return Broadcast{ std::move(dptr) };
+}
+
+/**
+ * \brief create a broadcast
+ * \param broadcastName  the name of the broadcast
+ * \return the created broadcast
+ * \throw Exception on failure
+ *
+ * This function will fail if the broadcast already exists, in which case the
+ * error code of the exception is ERROR_ALREADY_EXISTS.
+ */
+Broadcast Broadcast::Create(const std::string& broadcastName)
+{
+  auto dptr = std::make_unique<Impl::BroadcastPriv>();
+  constexpr bool must_create = true;
+  Impl::create_broadcast(*dptr, broadcastName, must_create);
+  return Broadcast{ std::move(dptr) };
+}
+
+/**
+ * \brief returns whether this object does not represent a valid broadcast
+ */
+bool Broadcast::IsNull() const
+{
+  return !d;
+}
+
+/**
+ * \brief returns whether the broadcast was created by this reference to the broadcast
+ */
+bool Broadcast::Created() const
+{
+  return d && d->created;
+}
+
+/**
+ * \brief returns the name of the broadcast
+ */
+const std::string& Broadcast::GetName() const
+{
+  if (!d) {
+    static const std::string emptyName = "";
+    return emptyName;
+  } else {
+    return d->name;
+  }
+}
+
+/**
+ * \brief notifies the subscribers
+ *
+ * Returns the new generation of the broadcast, or 0 if this object is null.
+ *
+ * The threads that are blocked in Wait() or WaitFor() are released.
+ */
+uint64_t Broadcast::Publish()
+{
+  if (!d) {
+    return 0;
+  }
+
+  const uint64_t generation = d->header->generation.fetch_add(1, std::memory_order_seq_cst) + 1;
+  Impl::publish_generation(*d, generation);
+  return generation;
+}
+
+/**
+ * \brief returns the current generation of the broadcast
+ *
+ * The generation is 0 until the first call to Publish().
+ */
+uint64_t Broadcast::GetGeneration() const
+{
+  return d ? d->header->generation.load(std::memory_order_acquire) : 0;
+}
+
+/**
+ * \brief checks whether a notification was published
+ * \param generation  the last generation seen by the subscriber
+ *
+ * Returns true if the generation of the broadcast is different from
+ * \a generation, in which case \a generation is updated.
+ */
+bool Broadcast::Poll(uint64_t& generation) const
+{
+  const uint64_t current = GetGeneration();
+
+  if (current == generation) {
+    return false;
+  }
+
+  generation = current;
+  return true;
+}
+
+/**
+ * \brief waits until a notification is published
+ * \param generation  the last generation seen by the subscriber
+ *
+ * Returns immediately if the generation of the broadcast is already
+ * different from \a generation.
+ * On return, \a generation is updated to the current generation.
+ *
+ * Returns false if the wait failed.
+ */
+bool Broadcast::Wait(uint64_t& generation)
+{
+  constexpr bool infinite = true;
+  return d && Impl::wait_generation(*d, generation, std::chrono::milliseconds(0), infinite);
+}
+
+/**
+ * \brief waits until a notification is published or a timeout expires
+ * \param generation  the last generation seen by the subscriber
+ * \param timeout     the maximum waiting time
+ *
+ * Returns true if the generation of the broadcast changed before the timeout
+ * expired, in which case \a generation is updated.
+ */
+bool Broadcast::WaitFor(uint64_t& generation, std::chrono::milliseconds timeout)
+{
+  if (!d) {
+    return false;
+  }
+
+  constexpr bool infinite = false;
+  return Impl::wait_generation(*d, generation, (std::max)(timeout, std::chrono::milliseconds(0)), infinite);
+}
+
+/**
+ * \brief closes the broadcast
+ */
+void Broadcast::Close()
+{
+  d.reset();
+}
+
+Broadcast& Broadcast::operator=(Broadcast&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
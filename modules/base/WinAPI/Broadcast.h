@@ -0,0 +1,73 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_BROADCAST_H
+#define WINAPI_BROADCAST_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct BroadcastPriv;
+} // namespace Impl
+
+/**
+ * \brief notifies any number of processes that something changed
+ * 
+ * A broadcast is a named generation counter in shared memory.
+ * Publish() increments the counter and wakes up the threads that are waiting
+ * for it to change.
+ * 
+ * Each subscriber keeps the last generation it has seen and passes it to
+ * Poll(), Wait() or WaitFor(), which update it.
+ * A subscriber therefore never misses a notification, and notifications
+ * published while a subscriber was busy are coalesced into one.
+ * 
+ * Publishing does not enter the kernel if no thread is waiting.
+ */
+class Broadcast
+{
+public:
+  Broadcast() noexcept;
+  Broadcast(const Broadcast&) = delete;
+  Broadcast(Broadcast&&) noexcept;
+  ~Broadcast();
+
+  explicit Broadcast(const std::string& broadcastName);
+
+  static Broadcast Open(const std::string& broadcastName);
+  static Broadcast Create(const std::string& broadcastName);
+
+  bool IsNull() const;
+  bool Created() const;
+  const std::string& GetName() const;
+
+  uint64_t Publish();
+  uint64_t GetGeneration() const;
+
+  bool Poll(uint64_t& generation) const;
+  bool Wait(uint64_t& generation);
+  bool WaitFor(uint64_t& generation, std::chrono::milliseconds timeout);
+
+  void Close();
+
+  Broadcast& operator=(const Broadcast&) = delete;
+  Broadcast& operator=(Broadcast&&) noexcept;
+
+private:
+  explicit Broadcast(std::unique_ptr<Impl::BroadcastPriv> dPtr);
+
+private:
+  std::unique_ptr<Impl::BroadcastPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_BROADCAST_H
\ No newline at end of file
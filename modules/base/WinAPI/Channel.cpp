@@ -0,0 +1,556 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "Channel.h"
+
+#include "Event.h"
+#include "EventImpl.h"
+#include "sharedmemory_priv.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// Layout of the file mapping: a header followed by the ring buffer.
+//
+// The ring buffer contains records made of a 32-bit word followed by the
+// message and aligned on 8 bytes. The word is the size of the message plus one,
+// or channel_padding for a record that fills the end of the buffer when the
+// next message does not fit there.
+//
+// Positions are 64-bit counters that never wrap; the offset of a position in the
+// buffer is given by (position & (capacity - 1)).
+//
+// With a single producer, records are published by advancing write_pos.
+// With several producers, a record is reserved by advancing write_pos and published
+// by storing its (non-zero) word, and the consumer zeroes the records it has read
+// so that the word of a record that is not yet published is always zero.
+
+constexpr uint32_t channel_magic = 0x4C4E4843; // "CHNL"
+constexpr uint32_t channel_padding = 0xFFFFFFFF;
+constexpr uint64_t channel_record_header_size = 8;
+constexpr size_t channel_data_offset = 256;
+constexpr size_t channel_min_capacity = 4096;
+constexpr size_t channel_max_capacity = size_t(1) << 30;
+
+struct channel_header
+{
+  std::atomic<uint32_t> magic;
+  uint32_t producer_mode;
+  uint64_t capacity;
+  alignas(64) std::atomic<uint64_t> write_pos;
+  alignas(64) std::atomic<uint64_t> read_pos;
+  alignas(64) std::atomic<uint32_t> consumer_waiting;
+};
+
+static_assert(sizeof(channel_header) <= channel_data_offset, "channel header is too large");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "atomics in shared memory must be lock-free");
+
+struct ChannelPriv
+{
+  std::string name;
+  SharedMemory shm;
+  channel_header* header = nullptr;
+  unsigned char* data = nullptr;
+  uint64_t capacity = 0;
+  bool multi_producer = false;
+  bool created = false;
+  int spin_count = 0;
+  Event event;
+};
+
+uint64_t channel_record_size(uint64_t message_size)
+{
+  return (channel_record_header_size + message_size + 7) & ~uint64_t(7);
+}
+
+std::atomic<uint32_t>& channel_word(ChannelPriv& ch, uint64_t pos)
+{
+  return *reinterpret_cast<std::atomic<uint32_t>*>(ch.data + (pos & (ch.capacity - 1)));
+}
+
+size_t round_channel_capacity(size_t capacity)
+{
+  size_t result = channel_min_capacity;
+
+  while (result < capacity && result < channel_max_capacity) {
+    result *= 2;
+  }
+
+  return result;
+}
+
+bool is_valid_channel_capacity(uint64_t capacity, size_t mapping_size)
+{
+  // the ring buffer is indexed with (position & (capacity - 1))
+  const bool power_of_two = capacity != 0 && (capacity & (capacity - 1)) == 0;
+  return power_of_two && capacity >= channel_min_capacity && capacity <= channel_max_capacity
+    && capacity <= mapping_size - channel_data_offset;
+}
+
+// waits for the creator of the channel to initialize it
+void attach_channel(ChannelPriv& ch)
+{
+  if (ch.shm.size < channel_data_offset) {
+    throw Exception(ErrorCode(ERROR_INVALID_DATA));
+  }
+
+  ch.header = static_cast<channel_header*>(ch.shm.view);
+  ch.data = static_cast<unsigned char*>(ch.shm.view) + channel_data_offset;
+
+  wait_shared_memory_initialized(ch.header->magic, channel_magic);
+
+  // the header may have been written by another program that uses the same
+  // name, it is checked before the ring buffer is accessed
+  const uint64_t capacity = ch.header->capacity;
+  const uint32_t producer_mode = ch.header->producer_mode;
+
+  if (!is_valid_channel_capacity(capacity, ch.shm.size)) {
+    throw Exception(ErrorCode(ERROR_INVALID_DATA));
+  }
+
+  if (producer_mode != Channel::SingleProducer && producer_mode != Channel::MultiProducer) {
+    throw Exception(ErrorCode(ERROR_INVALID_DATA));
+  }
+
+  ch.capacity = capacity;
+  ch.multi_producer = producer_mode == Channel::MultiProducer;
+}
+
+void initialize_channel(ChannelPriv& ch, size_t capacity, Channel::ProducerMode mode)
+{
+  ch.header = static_cast<channel_header*>(ch.shm.view);
+  ch.data = static_cast<unsigned char*>(ch.shm.view) + channel_data_offset;
+  ch.capacity = capacity;
+  ch.multi_producer = (mode == Channel::MultiProducer);
+
+  ch.header->producer_mode = static_cast<uint32_t>(mode);
+  ch.header->capacity = capacity;
+  ch.header->magic.store(channel_magic, std::memory_order_release);
+}
+
+// creates or opens the file mapping and the event of a channel
+void create_channel(ChannelPriv& ch, const std::string& name, size_t capacity, Channel::ProducerMode mode, bool must_create)
+{
+  ch.name = name;
+
+  // the event is created first, so that it exists when the channel is initialized
+  ch.event = Event{ name + "Signal", Event::AutoReset };
+
+  capacity = round_channel_capacity(capacity);
+  create_shared_memory(ch.shm, name, channel_data_offset + capacity, must_create);
+  ch.created = ch.shm.created;
+
+  if (ch.created) {
+    initialize_channel(ch, capacity, mode);
+  } else {
+    attach_channel(ch);
+  }
+}
+
+bool try_send(ChannelPriv& ch, const void* data, size_t size)
+{
+  channel_header& h = *ch.header;
+  const uint64_t record_size = channel_record_size(size);
+  uint64_t pos = h.write_pos.load(std::memory_order_relaxed);
+  uint64_t needed = 0;
+
+  for (;;)
+  {
+    const uint64_t offset = pos & (ch.capacity - 1);
+    // a record is never split, the end of the buffer is skipped if needed
+    needed = offset + record_size > ch.capacity ? (ch.capacity - offset) + record_size : record_size;
+
+    if (pos + needed - h.read_pos.load(std::memory_order_acquire) > ch.capacity) {
+      // full
+      return false;
+    }
+
+    if (!ch.multi_producer) {
+      break;
+    }
+
+    if (h.write_pos.compare_exchange_weak(pos, pos + needed, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  const uint64_t record_pos = pos + needed - record_size;
+  std::memcpy(ch.data + (record_pos & (ch.capacity - 1)) + channel_record_header_size, data, size);
+
+  const auto word = static_cast<uint32_t>(size + 1);
+
+  if (!ch.multi_producer)
+  {
+    channel_word(ch, record_pos).store(word, std::memory_order_relaxed);
+
+    if (record_pos != pos) {
+      channel_word(ch, pos).store(channel_padding, std::memory_order_relaxed);
+    }
+
+    h.write_pos.store(pos + needed, std::memory_order_seq_cst);
+  }
+  else if (record_pos != pos)
+  {
+    // the padding is published last so that the consumer, which reads it first,
+    // never sees it before the message
+    channel_word(ch, record_pos).store(word, std::memory_order_release);
+    channel_word(ch, pos).store(channel_padding, std::memory_order_seq_cst);
+  }
+  else
+  {
+    channel_word(ch, record_pos).store(word, std::memory_order_seq_cst);
+  }
+
+  // the consumer sets this flag before checking one last time that the channel
+  // is empty; either it sees the message or we see the flag
+  if (h.consumer_waiting.load(std::memory_order_seq_cst) && h.consumer_waiting.exchange(0, std::memory_order_seq_cst)) {
+    ch.event.Set();
+  }
+
+  return true;
+}
+
+bool try_receive(ChannelPriv& ch, std::string& message)
+{
+  channel_header& h = *ch.header;
+  uint64_t pos = h.read_pos.load(std::memory_order_relaxed);
+
+  for (;;)
+  {
+    if (!ch.multi_producer && h.write_pos.load(std::memory_order_seq_cst) == pos) {
+      return false;
+    }
+
+    const uint32_t word = channel_word(ch, pos).load(ch.multi_producer ? std::memory_order_seq_cst : std::memory_order_relaxed);
+
+    if (word == 0) {
+      // multi-producer channel: empty, or the next message is not yet published
+      return false;
+    }
+
+    unsigned char* record = ch.data + (pos & (ch.capacity - 1));
+
+    if (word == channel_padding)
+    {
+      const uint64_t padding_size = ch.capacity - (pos & (ch.capacity - 1));
+
+      if (ch.multi_producer) {
+        std::memset(record, 0, static_cast<size_t>(padding_size));
+      }
+
+      pos += padding_size;
+      continue;
+    }
+
+    const size_t size = word - 1;
+    message.assign(reinterpret_cast<const char*>(record + channel_record_header_size), size);
+
+    const uint64_t record_size = channel_record_size(size);
+
+    if (ch.multi_producer) {
+      std::memset(record, 0, static_cast<size_t>(record_size));
+    }
+
+    h.read_pos.store(pos + record_size, std::memory_order_seq_cst);
+    return true;
+  }
+}
+
+bool receive(ChannelPriv& ch, std::string& message, std::chrono::milliseconds timeout, bool infinite)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  for (;;)
+  {
+    for (int i(0); i <= ch.spin_count; ++i)
+    {
+      if (try_receive(ch, message)) {
+        return true;
+      }
+
+      pause_processor();
+    }
+
+    ch.header->consumer_waiting.store(1, std::memory_order_seq_cst);
+
+    if (try_receive(ch, message)) {
+      ch.header->consumer_waiting.store(0, std::memory_order_relaxed);
+      return true;
+    }
+
+    bool signaled = false;
+
+    if (infinite)
+    {
+      signaled = ch.event.Wait();
+    }
+    else
+    {
+      const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+      signaled = remaining.count() > 0 && ch.event.WaitFor(remaining);
+    }
+
+    if (!signaled)
+    {
+      ch.header->consumer_waiting.store(0, std::memory_order_relaxed);
+      return try_receive(ch, message);
+    }
+
+    // the event may have been set for a message that was already received,
+    // in which case we wait again
+  }
+}
+
+} // namespace Impl
+
+Channel::Channel() noexcept
+  : d(nullptr)
+{
+
+}
+
+Channel::Channel(Channel&&) noexcept = default;
+
+Channel::~Channel()
+{
+
+}
+
+/**
+ * \brief create or open a channel
+ * \param channelName  the name of the channel
+ * \param capacity     the size of the ring buffer, in bytes
+ * \param mode         whether the channel accepts concurrent producers
+ * \throw Exception on failure
+ *
+ * \a capacity and \a mode are only used if the channel is created, in which
+ * case \a capacity is rounded up to a power of two (of at least 4096 bytes).
+ *
+ * Use the Created() function to check whether this constructor actually
+ * created the channel or only opened it.
+ */
+Channel::Channel(const std::string& channelName, size_t capacity, ProducerMode mode)
+  : d(std::make_unique<Impl::ChannelPriv>())
+{
+  constexpr bool must_create = false;
+  Impl::create_channel(*d, channelName, capacity, mode, must_create);
+}
+
+Channel::Channel(std::unique_ptr<Impl::ChannelPriv> dPtr)
+  : d(std::move(dPtr))
+{
+
+}
+
+/**
+ * \brief open a channel
+ * \param channelName  the name of the channel
+ * \return the opened channel
+ * \throw Exception on failure
+ *
+ * This function will fail if the channel does not exist.
+ */
+Channel Channel::Open(const std::string& channelName)
+{
+  auto dptr = std::make_unique<Impl::ChannelPriv>();
+  dptr->name = channelName;
+
+  Impl::open_shared_memory(dptr->shm, channelName);
+  Impl::attach_channel(*dptr);
+  dptr->event = Event::Open(channelName + "Signal");
+
+  return Channel{ std::move(dptr) };
+}
+
+/**
+ * \brief create a channel
+ * \param channelName  the name of the channel
+ * \param capacity     the size of the ring buffer, in bytes
+ * \param mode         whether the channel accepts concurrent producers
+ * \return the created channel
+ * \throw Exception on failure
+ *
+ * \a capacity is rounded up to a power of two (of at least 4096 bytes).
+ *
+ * This function will fail if the channel already exists, in which case the
+ * error code of the exception is ERROR_ALREADY_EXISTS.
+ */
+Channel Channel::Create(const std::string& channelName, size_t capacity, ProducerMode mode)
+{
+  auto dptr = std::make_unique<Impl::ChannelPriv>();
+  constexpr bool must_create = true;
+  Impl::create_channel(*dptr, channelName, capacity, mode, must_create);
+  return Channel{ std::move(dptr) };
+}
+
+/**
+ * \brief returns whether this object does not represent a valid channel
+ */
+bool Channel::IsNull() const
+{
+  return !d;
+}
+
+/**
+ * \brief returns whether the channel was created by this reference to the channel
+ */
+bool Channel::Created() const
+{
+  return d && d->created;
+}
+
+/**
+ * \brief returns the name of the channel
+ */
+const std::string& Channel::GetName() const
+{
+  if (!d) {
+    static const std::string emptyName = "";
+    return emptyName;
+  } else {
+    return d->name;
+  }
+}
+
+/**
+ * \brief returns the size of the ring buffer, in bytes
+ */
+size_t Channel::GetCapacity() const
+{
+  return d ? static_cast<size_t>(d->capacity) : 0;
+}
+
+/**
+ * \brief returns the size of the largest message that can be sent
+ *
+ * This is a bit less than half the capacity of the channel, so that
+ * a message always fits in an empty channel.
+ */
+size_t Channel::GetMaxMessageSize() const
+{
+  return d ? static_cast<size_t>(d->capacity / 2 - Impl::channel_record_header_size) : 0;
+}
+
+/**
+ * \brief returns whether the channel accepts concurrent producers
+ */
+Channel::ProducerMode Channel::GetProducerMode() const
+{
+  return d && d->multi_producer ? MultiProducer : SingleProducer;
+}
+
+/**
+ * \brief sends a message if there is enough room in the channel
+ * \param data  pointer to the content of the message
+ * \param size  the size of the message, in bytes
+ * \throw Exception if the message is larger than GetMaxMessageSize()
+ *
+ * Returns false if the channel is full.
+ *
+ * The consumer is only woken up, with a system call, if it is blocked in Receive()
+ * or ReceiveFor().
+ */
+bool Channel::TrySend(const void* data, size_t size)
+{
+  if (!d) {
+    return false;
+  }
+
+  if (size > GetMaxMessageSize()) {
+    throw Exception(ErrorCode(ERROR_INSUFFICIENT_BUFFER));
+  }
+
+  return Impl::try_send(*d, data, size);
+}
+
+/**
+ * \brief sends a message if there is enough room in the channel
+ * \param message  the message
+ * \throw Exception if the message is larger than GetMaxMessageSize()
+ *
+ * Returns false if the channel is full.
+ */
+bool Channel::TrySend(const std::string& message)
+{
+  return TrySend(message.data(), message.size());
+}
+
+/**
+ * \brief receives a message if the channel is not empty
+ * \param message  receives the message
+ *
+ * Returns false if the channel is empty.
+ *
+ * The storage of \a message is reused, so that receiving messages in the same
+ * string does not allocate memory.
+ */
+bool Channel::TryReceive(std::string& message)
+{
+  return d && Impl::try_receive(*d, message);
+}
+
+/**
+ * \brief waits for a message and receives it
+ * \param message  receives the message
+ *
+ * Returns false if the wait failed.
+ *
+ * \sa SetSpinCount().
+ */
+bool Channel::Receive(std::string& message)
+{
+  return d && Impl::receive(*d, message, std::chrono::milliseconds(0), true);
+}
+
+/**
+ * \brief waits for a message for a limited time and receives it
+ * \param message  receives the message
+ * \param timeout  the maximum waiting time
+ *
+ * Returns false if no message was received before the timeout expired.
+ */
+bool Channel::ReceiveFor(std::string& message, std::chrono::milliseconds timeout)
+{
+  if (!d) {
+    return false;
+  }
+
+  return Impl::receive(*d, message, (std::max)(timeout, std::chrono::milliseconds(0)), false);
+}
+
+/**
+ * \brief enables polling the channel before blocking in Receive() and ReceiveFor()
+ * \param spinCount  the number of times the channel is polled
+ *
+ * When messages are sent at a high rate, polling the channel avoids
+ * putting the consumer to sleep and having the producer wake it up.
+ *
+ * By default, the channel is polled only once.
+ */
+void Channel::SetSpinCount(int spinCount)
+{
+  if (d) {
+    d->spin_count = (std::max)(spinCount, 0);
+  }
+}
+
+/**
+ * \brief closes the channel
+ *
+ * The channel is destroyed when all the processes have closed it.
+ */
+void Channel::Close()
+{
+  d.reset();
+}
+
+Channel& Channel::operator=(Channel&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,87 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_CHANNEL_H
+#define WINAPI_CHANNEL_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct ChannelPriv;
+} // namespace Impl
+
+/**
+ * \brief a named message queue in shared memory
+ *
+ * A channel transfers messages (sequences of bytes) from one or several
+ * producers to a single consumer, possibly in different processes.
+ *
+ * Messages are stored in a ring buffer in a named file mapping (a POSIX
+ * shared memory object on Linux).
+ * Sending and receiving a message does not require any system call:
+ * the consumer is only woken up through an event when it is blocked
+ * in Receive() on an empty channel.
+ *
+ * A channel created in SingleProducer mode must only be written to by
+ * one thread at a time; a MultiProducer channel can be written to
+ * concurrently.
+ * In both modes, a single thread at a time may read from the channel.
+ */
+class Channel
+{
+public:
+  enum ProducerMode
+  {
+    SingleProducer,
+    MultiProducer,
+  };
+
+public:
+  Channel() noexcept;
+  Channel(const Channel&) = delete;
+  Channel(Channel&&) noexcept;
+  ~Channel();
+
+  Channel(const std::string& channelName, size_t capacity, ProducerMode mode = SingleProducer);
+
+  static Channel Open(const std::string& channelName);
+  static Channel Create(const std::string& channelName, size_t capacity, ProducerMode mode = SingleProducer);
+
+  bool IsNull() const;
+  bool Created() const;
+  const std::string& GetName() const;
+  size_t GetCapacity() const;
+  size_t GetMaxMessageSize() const;
+  ProducerMode GetProducerMode() const;
+
+  bool TrySend(const void* data, size_t size);
+  bool TrySend(const std::string& message);
+
+  bool TryReceive(std::string& message);
+  bool Receive(std::string& message);
+  bool ReceiveFor(std::string& message, std::chrono::milliseconds timeout);
+
+  void SetSpinCount(int spinCount);
+
+  void Close();
+
+  Channel& operator=(const Channel&) = delete;
+  Channel& operator=(Channel&&) noexcept;
+
+private:
+  explicit Channel(std::unique_ptr<Impl::ChannelPriv> dPtr);
+
+private:
+  std::unique_ptr<Impl::ChannelPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_CHANNEL_H
\ No newline at end of file
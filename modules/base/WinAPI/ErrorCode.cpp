@@ -6,7 +6,9 @@
 
 #include "ErrorMessage.h"
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 namespace Win32
 {
@@ -19,6 +21,8 @@ std::string ErrorCode::Message() const
   return GetErrorMessage(Value());
 }
 
+#ifdef _WIN32
+
 /**
  * \brief returns the last error
  * 
@@ -29,4 +33,6 @@ ErrorCode GetLastError()
   return ErrorCode(::GetLastError());
 }
 
+#endif // _WIN32
+
 } // namespace Win32
\ No newline at end of file
@@ -4,15 +4,18 @@
 
 #include "ErrorMessage.h"
 
+#ifdef _WIN32
 #include "String.h"
 
 #include <Windows.h>
+#endif
 
 namespace Win32
 {
 
 std::string GetErrorMessage(int errorCode)
 {
+#ifdef _WIN32
   constexpr LPCVOID source = nullptr;
   constexpr DWORD langid = 0;
   constexpr DWORD size = 0;
@@ -34,6 +37,10 @@ std::string GetErrorMessage(int errorCode)
   ::LocalFree(buffer);
 
   return ToUtf8(str);
+#else
+  // the system messages are only available on Windows
+  return "error " + std::to_string(errorCode);
+#endif
 }
 
 } // namespace Win32
\ No newline at end of file
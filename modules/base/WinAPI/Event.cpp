@@ -6,17 +6,595 @@
 #include "EventImpl.h"
 
 #include "Exception.h"
+
+#ifdef _WIN32
 #include "String.h"
+#else
+#include "futex_priv.h"
+#include "sharedmemory_priv.h"
+#endif
+
+#include <algorithm>
 
 namespace Win32
 {
 
+namespace Impl
+{
+
+enum event_state_bits : uint32_t
+{
+  event_set_bit = 1,
+  event_waiters_bit = 2,
+  event_generation_increment = 4,
+};
+
+#ifdef _WIN32
+
+// maps the state word of the event, created with the event if it does not exist
+ErrorCode map_event_state(EventPriv& ev)
+{
+  // an unnamed event has an unnamed state
+  const std::wstring name = ev.name.empty() ? std::wstring() : ToUtf16(ev.name + "State");
+  constexpr DWORD maximum_size_high = 0;
+
+  ev.state_mapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, maximum_size_high, sizeof(event_header), name.empty() ? nullptr : name.c_str());
+
+  if (!ev.state_mapping) {
+    return Win32::GetLastError();
+  }
+
+  constexpr DWORD offset_high = 0;
+  constexpr DWORD offset_low = 0;
+  void* view = ::MapViewOfFile(ev.state_mapping, FILE_MAP_READ | FILE_MAP_WRITE, offset_high, offset_low, sizeof(event_header));
+
+  if (!view) {
+    return Win32::GetLastError();
+  }
+
+  ev.header = static_cast<event_header*>(view);
+  return ErrorCode();
+}
+
+void close_event(EventPriv& ev)
+{
+  if (ev.header) {
+    ::UnmapViewOfFile(ev.header);
+  }
+
+  if (ev.state_mapping) {
+    ::CloseHandle(ev.state_mapping);
+  }
+
+  ::CloseHandle(ev.handle);
+}
+
+ErrorCode create_event(EventPriv& ev, Event::ResetMode mode, bool must_create)
+{
+  const bool manual_reset = (mode == Event::ManualReset);
+  constexpr bool initial_state = false;
+
+  ev.handle = ::CreateEventW(nullptr, manual_reset, initial_state, ToUtf16(ev.name).c_str());
+
+  if (!ev.handle) {
+    return Win32::GetLastError();
+  }
+
+  ev.created = ::GetLastError() != ERROR_ALREADY_EXISTS;
+
+  if (must_create && !ev.created) {
+    // the last error cannot be used here as CloseHandle() may overwrite it
+    close_event(ev);
+    return ErrorCode(ERROR_ALREADY_EXISTS);
+  }
+
+  ErrorCode err = map_event_state(ev);
+
+  if (err) {
+    close_event(ev);
+    return err;
+  }
+
+  if (ev.created) {
+    ev.header->mode = static_cast<uint32_t>(mode);
+  }
+
+  return ErrorCode();
+}
+
+ErrorCode open_event(EventPriv& ev)
+{
+  // same rights as a handle returned by CreateEventW(), so that an opened
+  // event can be used exactly like a created one
+  constexpr DWORD desired_access = EVENT_MODIFY_STATE | SYNCHRONIZE;
+  constexpr bool inherit_handle = false;
+
+  ev.handle = ::OpenEventW(desired_access, inherit_handle, ToUtf16(ev.name).c_str());
+
+  if (!ev.handle) {
+    return Win32::GetLastError();
+  }
+
+  // the state is created if the event was not created by this class,
+  // its mode is then unknown and the state word is never cleared by a wait
+  ErrorCode err = map_event_state(ev);
+
+  if (err) {
+    close_event(ev);
+  }
+
+  return err;
+}
+
+bool is_manual_reset(const EventPriv& ev)
+{
+  return ev.header->mode == static_cast<uint32_t>(Event::ManualReset);
+}
+
+// the state word and the kernel event are not updated atomically: the bit is
+// set before the event and cleared after it, so that concurrent calls can only
+// leave the bit clear while the event is set (a spinning thread then blocks in
+// the kernel and returns at once); a bit left set while the event is reset is
+// cleared by try_wait_event()
+bool set_event(EventPriv& ev)
+{
+  ev.header->state.fetch_or(event_set_bit, std::memory_order_release);
+  return ::SetEvent(ev.handle) != FALSE;
+}
+
+bool reset_event(EventPriv& ev)
+{
+  const bool reset = ::ResetEvent(ev.handle) != FALSE;
+  ev.header->state.fetch_and(~uint32_t(event_set_bit), std::memory_order_relaxed);
+  return reset;
+}
+
+bool pulse_event(EventPriv& ev)
+{
+  // the event is left reset, so the state word does not change
+  return ::PulseEvent(ev.handle) != FALSE;
+}
+
+// records that a wait consumed the signal of an auto-reset event; this may
+// clear the bit of a concurrent Set(), which only shortens a spin phase
+void event_consumed(EventPriv& ev)
+{
+  if (!is_manual_reset(ev)) {
+    ev.header->state.fetch_and(~uint32_t(event_set_bit), std::memory_order_relaxed);
+  }
+}
+
+// returns whether the event is set, without blocking; an auto-reset event is reset
+bool try_wait_event(EventPriv& ev)
+{
+  if (::WaitForSingleObject(ev.handle, 0) != WAIT_OBJECT_0)
+  {
+    // the event is reset, the bit must not make other threads spin on it
+    ev.header->state.fetch_and(~uint32_t(event_set_bit), std::memory_order_relaxed);
+    return false;
+  }
+
+  event_consumed(ev);
+  return true;
+}
+
+bool wait_event(EventPriv& ev, std::chrono::milliseconds timeout, bool infinite)
+{
+  DWORD milliseconds = INFINITE;
+
+  if (!infinite) {
+    // INFINITE must not be reached by a finite timeout
+    milliseconds = static_cast<DWORD>((std::min)(timeout.count(), static_cast<std::chrono::milliseconds::rep>(INFINITE - 1)));
+  }
+
+  if (::WaitForSingleObject(ev.handle, milliseconds) != WAIT_OBJECT_0) {
+    return false;
+  }
+
+  event_consumed(ev);
+  return true;
+}
+
+void pause_processor()
+{
+  YieldProcessor();
+}
+
+#else
+
+// A named event is a shared memory object that contains an event_header;
+// blocked threads wait on its state word with a (non-private) futex.
+//
+// The lifetime of the object is that of a named file mapping (see
+// sharedmemory_priv.h), but the header is initialized while the init
+// byte is locked, so that a process never sees it uninitialized.
+
+std::string get_event_shm_name(const std::string& name)
+{
+  return get_shared_memory_object_name("Event." + name);
+}
+
+// maps the event, the init byte of fd must be locked
+ErrorCode attach_event(EventPriv& ev, int fd, const std::string& shm_name, bool create, Event::ResetMode mode, bool must_create)
+{
+  bool created = false;
+
+  if (lock_shared_memory_byte(fd, shared_memory_users_lock, F_WRLCK, false))
+  {
+    if (!create) {
+      ::shm_unlink(shm_name.c_str());
+      return ErrorCode(ERROR_FILE_NOT_FOUND);
+    }
+
+    // truncating to 0 first clears the state left by terminated processes
+    if (::ftruncate(fd, 0) == -1 || ::ftruncate(fd, sizeof(event_header)) == -1) {
+      return file_error_from_errno(errno, ERROR_NOT_ENOUGH_MEMORY);
+    }
+
+    created = true;
+  }
+  else if (must_create)
+  {
+    return ErrorCode(ERROR_ALREADY_EXISTS);
+  }
+
+  struct stat st;
+
+  if (::fstat(fd, &st) == -1) {
+    return file_error_from_errno(errno, ERROR_OPEN_FAILED);
+  }
+
+  if (st.st_size < static_cast<off_t>(sizeof(event_header))) {
+    // not created by this class
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  void* address = ::mmap(nullptr, sizeof(event_header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (address == MAP_FAILED) {
+    return ErrorCode(ERROR_NOT_ENOUGH_MEMORY);
+  }
+
+  ev.header = static_cast<event_header*>(address);
+
+  if (created) {
+    ev.header->mode = static_cast<uint32_t>(mode);
+  }
+
+  // registers this process as a user of the event, this converts the
+  // exclusive lock taken above if the event was created
+  lock_shared_memory_byte(fd, shared_memory_users_lock, F_RDLCK, false);
+  ev.created = created;
+  return ErrorCode();
+}
+
+ErrorCode attach_event(EventPriv& ev, bool create, Event::ResetMode mode, bool must_create)
+{
+  if (ev.name.empty())
+  {
+    if (!create) {
+      return ErrorCode(ERROR_INVALID_PARAMETER);
+    }
+
+    // an unnamed event can only be shared with child processes
+    void* address = ::mmap(nullptr, sizeof(event_header), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (address == MAP_FAILED) {
+      return ErrorCode(ERROR_NOT_ENOUGH_MEMORY);
+    }
+
+    ev.header = static_cast<event_header*>(address);
+    ev.header->mode = static_cast<uint32_t>(mode);
+    ev.created = true;
+    return ErrorCode();
+  }
+
+  const std::string shm_name = get_event_shm_name(ev.name);
+  ErrorCode err;
+  const int fd = open_shared_memory_object(shm_name, create, err);
+
+  if (fd == -1) {
+    return err;
+  }
+
+  err = attach_event(ev, fd, shm_name, create, mode, must_create);
+  lock_shared_memory_byte(fd, shared_memory_init_lock, F_UNLCK, false);
+
+  if (err) {
+    // also releases the lock taken by attach_event() on failure
+    ::close(fd);
+  } else {
+    ev.fd = fd;
+  }
+
+  return err;
+}
+
+ErrorCode create_event(EventPriv& ev, Event::ResetMode mode, bool must_create)
+{
+  constexpr bool create = true;
+  return attach_event(ev, create, mode, must_create);
+}
+
+ErrorCode open_event(EventPriv& ev)
+{
+  constexpr bool create = false;
+  constexpr bool must_create = false;
+  return attach_event(ev, create, Event::ManualReset, must_create);
+}
+
+void close_event(EventPriv& ev)
+{
+  ::munmap(ev.header, sizeof(event_header));
+
+  if (ev.fd == -1) {
+    return;
+  }
+
+  lock_shared_memory_byte(ev.fd, shared_memory_init_lock, F_WRLCK, true);
+  release_shared_memory_object(ev.fd, get_event_shm_name(ev.name));
+}
+
+bool is_manual_reset(const EventPriv& ev)
+{
+  return ev.header->mode == static_cast<uint32_t>(Event::ManualReset);
+}
+
+void wake_event_waiters(EventPriv& ev, int count)
+{
+  futex_wake(ev.header->state, count);
+}
+
+bool set_event(EventPriv& ev)
+{
+  const bool manual_reset = is_manual_reset(ev);
+  uint32_t state = ev.header->state.load(std::memory_order_relaxed);
+  uint32_t new_state;
+
+  do
+  {
+    if (state & event_set_bit) {
+      return true;
+    }
+
+    new_state = (state | event_set_bit) & ~uint32_t(event_waiters_bit);
+
+    if (manual_reset) {
+      new_state += event_generation_increment;
+    }
+  } while (!ev.header->state.compare_exchange_weak(state, new_state, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  if (state & event_waiters_bit) {
+    wake_event_waiters(ev, manual_reset ? INT_MAX : 1);
+  }
+
+  return true;
+}
+
+bool reset_event(EventPriv& ev)
+{
+  ev.header->state.fetch_and(~uint32_t(event_set_bit), std::memory_order_relaxed);
+  return true;
+}
+
+bool pulse_event(EventPriv& ev)
+{
+  if (!is_manual_reset(ev))
+  {
+    // releases a single waiting thread, if any
+    if (ev.header->state.load(std::memory_order_relaxed) & event_waiters_bit) {
+      return set_event(ev);
+    }
+
+    return true;
+  }
+
+  // the blocked threads see that the generation changed
+  uint32_t state = ev.header->state.load(std::memory_order_relaxed);
+  uint32_t new_state;
+
+  do
+  {
+    new_state = (state & ~uint32_t(event_set_bit | event_waiters_bit)) + event_generation_increment;
+  } while (!ev.header->state.compare_exchange_weak(state, new_state, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  if (state & event_waiters_bit) {
+    wake_event_waiters(ev, INT_MAX);
+  }
+
+  return true;
+}
+
+// returns whether the event is set, without blocking; an auto-reset event is reset
+bool try_wait_event(EventPriv& ev)
+{
+  uint32_t state = ev.header->state.load(std::memory_order_acquire);
+
+  while (state & event_set_bit)
+  {
+    if (is_manual_reset(ev)) {
+      return true;
+    }
+
+    if (ev.header->state.compare_exchange_weak(state, state & ~uint32_t(event_set_bit), std::memory_order_acquire, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// same algorithm as LocalEvent::wait(), with a futex instead of WaitOnAddress()
+bool wait_event(EventPriv& ev, std::chrono::milliseconds timeout, bool infinite)
+{
+  constexpr uint32_t generation_mask = ~uint32_t(event_set_bit | event_waiters_bit);
+  const bool manual_reset = is_manual_reset(ev);
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  uint32_t state = ev.header->state.load(std::memory_order_acquire);
+  bool blocked = false;
+
+  for (;;)
+  {
+    if (state & event_set_bit)
+    {
+      if (manual_reset) {
+        return true;
+      }
+
+      // consume the signal; a thread that has blocked keeps the waiters bit
+      // as other threads may still be blocked on the event
+      uint32_t new_state = state & ~uint32_t(event_set_bit);
+
+      if (blocked) {
+        new_state |= event_waiters_bit;
+      }
+
+      if (ev.header->state.compare_exchange_weak(state, new_state, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return true;
+      }
+
+      continue;
+    }
+
+    std::chrono::nanoseconds remaining(0);
+
+    if (!infinite)
+    {
+      remaining = futex_remaining(deadline);
+
+      if (remaining.count() <= 0) {
+        return false;
+      }
+    }
+
+    if (!(state & event_waiters_bit))
+    {
+      // Set() must know that it has to wake us
+      if (!ev.header->state.compare_exchange_weak(state, state | event_waiters_bit, std::memory_order_relaxed, std::memory_order_relaxed)) {
+        continue;
+      }
+
+      state |= event_waiters_bit;
+    }
+
+    // returns immediately if the state is no longer the expected one
+    futex_wait(ev.header->state, state, remaining, infinite);
+    blocked = true;
+
+    const uint32_t current = ev.header->state.load(std::memory_order_acquire);
+
+    if (manual_reset && (current & generation_mask) != (state & generation_mask)) {
+      // the event was set while we were blocked, even if it was reset since then
+      return true;
+    }
+
+    state = current;
+  }
+}
+
+// consumes the signal of the event like wait_event() does, or sets the waiters
+// bit and returns false with the value of the state word on which the caller
+// may block together with other words (see WaitSet); when called again after
+// blocking, a manual-reset event is signaled if its generation changed
+bool prepare_event_wait(event_header& header, uint32_t& expected, bool blocked)
+{
+  constexpr uint32_t generation_mask = ~uint32_t(event_set_bit | event_waiters_bit);
+  const bool manual_reset = header.mode == static_cast<uint32_t>(Event::ManualReset);
+  uint32_t state = header.state.load(std::memory_order_acquire);
+
+  if (blocked && manual_reset && (state & generation_mask) != (expected & generation_mask)) {
+    return true;
+  }
+
+  for (;;)
+  {
+    if (state & event_set_bit)
+    {
+      if (manual_reset) {
+        return true;
+      }
+
+      // other threads may be blocked on the event
+      if (header.state.compare_exchange_weak(state, (state & ~uint32_t(event_set_bit)) | event_waiters_bit, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return true;
+      }
+
+      continue;
+    }
+
+    if (!(state & event_waiters_bit))
+    {
+      if (!header.state.compare_exchange_weak(state, state | event_waiters_bit, std::memory_order_relaxed, std::memory_order_relaxed)) {
+        continue;
+      }
+
+      state |= event_waiters_bit;
+    }
+
+    expected = state;
+    return false;
+  }
+}
+
+void pause_processor()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+#endif // _WIN32
+
+// the spin estimate is stored in fixed point, so that its moving average
+// does not lose its fractional part
+constexpr int spin_estimate_scale = 16;
+
+// polls the state of the event; returns true if the event was set
+// during the spin phase
+bool spin_wait(EventPriv& ev)
+{
+  // never spin less than this, so that the estimate can recover after a
+  // sequence of failures
+  constexpr int min_spin = 16;
+  // the estimate is only a hint, concurrent updates may be lost
+  const int estimate = ev.spin_estimate.load(std::memory_order_relaxed);
+  const int limit = (std::min)(ev.spin_count, (std::max)(2 * (estimate / spin_estimate_scale), min_spin));
+
+  for (int i(0); i < limit; ++i)
+  {
+    // only the state word is polled, the kernel is entered once it says
+    // that the event is set
+    if (ev.header->state.load(std::memory_order_acquire) & event_set_bit)
+    {
+      if (!try_wait_event(ev)) {
+        // another thread consumed the signal (or the state word was stale),
+        // which says nothing about the waiting time
+        return false;
+      }
+
+      // moving average of the number of iterations needed
+      ev.spin_estimate.store(estimate + (i * spin_estimate_scale - estimate) / 8, std::memory_order_relaxed);
+      return true;
+    }
+
+    pause_processor();
+  }
+
+  ev.spin_estimate.store(estimate - estimate / 8, std::memory_order_relaxed);
+  return false;
+}
+
+} // namespace Impl
+
 Event::Event() noexcept
-  : d(nullptr)
 {
 
 }
 
+Event::Event(Event&&) noexcept = default;
+
 Event::~Event()
 {
   Close();
@@ -26,33 +604,28 @@ Event::~Event()
 /**
  * \brief create or open an event
  * \param eventName  the name of the event
+ * \param mode       the reset mode, used only if the event is created
  * \throw Exception on failure
  * 
  * Use the Created() function to check whether this constructor actually 
  * created the event or only opened it.
  */
-Event::Event(const std::string& eventName)
-  : d(std::make_unique<Impl::EventPriv>())
+Event::Event(const std::string& eventName, ResetMode mode)
 {
+  d.emplace();
   d->name = eventName;
-  std::wstring weventName = ToUtf16(eventName);
 
-  constexpr bool manual_reset = true;
-  constexpr bool initial_state = false;
+  constexpr bool must_create = false;
+  ErrorCode err = Impl::create_event(*d, mode, must_create);
 
-  d->handle = ::CreateEventW(nullptr, manual_reset, initial_state, weventName.c_str());
-
-  if (!d->handle) {
-    throw Exception(GetLastError());
+  if (err) {
+    throw Exception(err);
   }
-
-  d->created = ::GetLastError() != ERROR_ALREADY_EXISTS;
 }
 
-Event::Event(std::unique_ptr<Impl::EventPriv> dPtr)
-  : d(std::move(dPtr))
+Event::Event(Impl::EventPriv&& priv)
 {
-
+  d.emplace(std::move(priv));
 }
 
 /**
@@ -70,59 +643,47 @@ bool Event::IsNull() const
  * \throw Exception on failure
  * 
  * This function will fail if the event does not exist.
+ * 
+ * The returned event can be used in the same way as an event returned
+ * by Create().
  */
 Event Event::Open(const std::string& eventName)
 {
-  auto dptr = std::make_unique<Impl::EventPriv>();
-  dptr->name = eventName;
-  std::wstring weventName = ToUtf16(eventName);
+  Impl::EventPriv priv;
+  priv.name = eventName;
 
-  constexpr DWORD desired_access = EVENT_MODIFY_STATE;
-  constexpr bool inherit_handle = false;
-
-  Impl::EventPriv data;
-
-  dptr->handle = ::OpenEventW(desired_access, inherit_handle, weventName.c_str());
+  ErrorCode err = Impl::open_event(priv);
 
-  if (!dptr->handle) {
-    throw Exception(Win32::GetLastError());
+  if (err) {
+    throw Exception(err);
   }
 
-  return Event{ std::move(dptr) };
+  return Event{ std::move(priv) };
 }
 
 /**
  * \brief create an event
  * \param eventName  the name of the event
+ * \param mode       whether the event is reset manually or automatically
  * \return the created event
  * \throw Exception on failure
  * 
- * This function will fail if the event already exists.
+ * This function will fail if the event already exists, in which case the 
+ * error code of the exception is ERROR_ALREADY_EXISTS.
  */
-Event Event::Create(const std::string& eventName)
+Event Event::Create(const std::string& eventName, ResetMode mode)
 {
-  auto dptr = std::make_unique<Impl::EventPriv>();
-  dptr->name = eventName;
-  std::wstring weventName = ToUtf16(eventName);
-
-  constexpr bool manual_reset = true;
-  constexpr bool initial_state = false;
+  Impl::EventPriv priv;
+  priv.name = eventName;
 
-  dptr->handle = ::CreateEventW(nullptr, manual_reset, initial_state, weventName.c_str());
-
-  if (dptr->handle) {
-    dptr->created = ::GetLastError() != ERROR_ALREADY_EXISTS;
-  }
-
-  if (!dptr->handle || !dptr->created) {
-    if (dptr->handle) {
-      ::CloseHandle(dptr->handle);
-    }
+  constexpr bool must_create = true;
+  ErrorCode err = Impl::create_event(priv, mode, must_create);
 
-    throw Exception(Win32::GetLastError());
+  if (err) {
+    throw Exception(err);
   }
 
-  return Event{ std::move(dptr) };
+  return Event{ std::move(priv) };
 }
 
 /**
@@ -151,7 +712,111 @@ const std::string& Event::GetName() const
  */
 bool Event::Set()
 {
-  return d && ::SetEvent(d->handle);
+  return d && Impl::set_event(*d);
+}
+
+/**
+ * \brief sets the event to its 'reset' state
+ */
+bool Event::Reset()
+{
+  return d && Impl::reset_event(*d);
+}
+
+/**
+ * \brief sets the event and resets it after releasing the waiting threads
+ * 
+ * A thread that is not waiting at the exact moment the event is pulsed
+ * misses the notification, and the system may fail to release a thread
+ * that is temporarily removed from the wait (e.g. by a kernel APC).
+ * Prefer Set() and Reset() when possible.
+ */
+bool Event::Pulse()
+{
+  return d && Impl::pulse_event(*d);
+}
+
+/**
+ * \brief waits until the event is set
+ * 
+ * For an auto-reset event, the event is reset when this function returns.
+ * 
+ * Returns false if the wait failed.
+ * 
+ * \sa SetSpinCount().
+ */
+bool Event::Wait()
+{
+  if (!d) {
+    return false;
+  }
+
+  if (d->spin_count > 0 && Impl::spin_wait(*d)) {
+    return true;
+  }
+
+  constexpr bool infinite = true;
+  return Impl::wait_event(*d, std::chrono::milliseconds(0), infinite);
+}
+
+/**
+ * \brief waits until the event is set or a timeout expires
+ * \param timeout  the maximum waiting time
+ * 
+ * Returns true if the event was set before the timeout expired.
+ * 
+ * \sa Wait().
+ */
+bool Event::WaitFor(std::chrono::milliseconds timeout)
+{
+  if (!d) {
+    return false;
+  }
+
+  if (timeout.count() <= 0) {
+    return Impl::try_wait_event(*d);
+  }
+
+  if (d->spin_count > 0)
+  {
+    auto start = std::chrono::steady_clock::now();
+
+    if (Impl::spin_wait(*d)) {
+      return true;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    timeout = (std::max)(timeout - elapsed, std::chrono::milliseconds(0));
+  }
+
+  constexpr bool infinite = false;
+  return Impl::wait_event(*d, timeout, infinite);
+}
+
+/**
+ * \brief enables spinning before blocking in Wait() and WaitFor()
+ * \param spinCount  the maximum number of times the state of the event is polled
+ * 
+ * When the event is expected to be set very shortly, polling its state for 
+ * a short while is cheaper than putting the thread to sleep and waking it up
+ * again, which takes several microseconds.
+ * Spinning only reads a state word in shared memory and does not
+ * enter the kernel until the event is set.
+ * 
+ * The duration of the spin phase adapts to the observed waiting times:
+ * it grows when spinning succeeds and shrinks when the event is
+ * usually set after the thread has blocked, up to \a spinCount.
+ * 
+ * A spin count of 0 (the default) disables spinning.
+ */
+void Event::SetSpinCount(int spinCount)
+{
+  if (d) {
+    // the fixed-point estimate must not overflow
+    constexpr int max_spin_count = 1 << 24;
+    d->spin_count = (std::min)((std::max)(spinCount, 0), max_spin_count);
+    d->spin_estimate.store(d->spin_count / 2 * Impl::spin_estimate_scale, std::memory_order_relaxed);
+  }
 }
 
 /**
@@ -160,19 +825,19 @@ bool Event::Set()
 void Event::Close()
 {
   if (d) {
-    ::CloseHandle(d->handle);
+    Impl::close_event(*d);
     d.reset();
   }
 }
 
 Event& Event::operator=(Event&& other)
 {
-  if (d && d != other.d) {
+  if (this != &other)
+  {
     Close();
+    d = std::move(other.d);
   }
 
-  d = std::move(other.d);
-
   return *this;
 }
 
@@ -181,9 +846,13 @@ Impl::EventPriv* Event::GetImpl() const
   return d.get();
 }
 
+#ifdef _WIN32
+
 HANDLE GetHANDLE(const Event& e)
 {
   return e.GetImpl() ? e.GetImpl()->handle : nullptr;
 }
 
+#endif // _WIN32
+
 } // namespace Win32
\ No newline at end of file
@@ -5,7 +5,9 @@
 #ifndef WINAPI_EVENT_H
 #define WINAPI_EVENT_H
 
-#include <memory>
+#include "FastPimpl.h"
+
+#include <chrono>
 #include <string>
 
 namespace Win32
@@ -20,28 +22,51 @@ struct EventPriv;
  * \brief represents an event
  * 
  * Events provide a mean of communication between processes.
+ * 
+ * A manual-reset event stays set until Reset() is called and releases all
+ * the waiting threads, while an auto-reset event is reset automatically 
+ * when it releases a single waiting thread.
+ * 
+ * On Linux, a named event is a shared memory object and waiting threads
+ * block on a futex. As on Windows, the event is destroyed when the last 
+ * process that uses it closes it or terminates.
  */
 class Event
 {
+public:
+  enum ResetMode
+  {
+    ManualReset,
+    AutoReset,
+  };
+
 public:
   Event() noexcept;
   Event(const Event&) = delete;
-  Event(Event&&) noexcept = default;
+  Event(Event&&) noexcept;
   ~Event();
 
-  explicit Event(const std::string& eventName);
+  explicit Event(const std::string& eventName, ResetMode mode = ManualReset);
 
-  explicit Event(std::unique_ptr<Impl::EventPriv> dPtr);
+  explicit Event(Impl::EventPriv&& priv);
 
   bool IsNull() const;
 
   static Event Open(const std::string& eventName);
-  static Event Create(const std::string& eventName);
+  static Event Create(const std::string& eventName, ResetMode mode = ManualReset);
 
   bool Created() const;
   const std::string& GetName() const;
   
   bool Set();
+  bool Reset();
+  bool Pulse();
+
+  bool Wait();
+  bool WaitFor(std::chrono::milliseconds timeout);
+
+  void SetSpinCount(int spinCount);
+
   void Close();
 
   Event& operator=(const Event&) = delete;
@@ -50,7 +75,7 @@ public:
   Impl::EventPriv* GetImpl() const;
 
 private:
-  std::unique_ptr<Impl::EventPriv> d;
+  Impl::FastPimpl<Impl::EventPriv, 80> d;
 };
 
 } // namespace Win32
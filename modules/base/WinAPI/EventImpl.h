@@ -5,7 +5,14 @@
 #ifndef WINAPI_EVENTIMPL_H
 #define WINAPI_EVENTIMPL_H
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
 
 namespace Win32
 {
@@ -13,19 +20,72 @@ namespace Win32
 namespace Impl
 {
 
+// the state of an event, in shared memory
+//
+// On Windows, the kernel event is the actual state of the event, as it can be
+// waited on through its handle. The state word only mirrors its set bit
+// so that spinning does not enter the kernel.
+struct event_header
+{
+  // bit 0: the event is set
+  // bit 1: at least one thread may be blocked on the event (Linux)
+  // bits 2-31: number of times a manual-reset event was set (Linux, wraps around)
+  std::atomic<uint32_t> state;
+  uint32_t mode;
+};
+
 struct EventPriv
 {
   std::string name;
+#ifdef _WIN32
   HANDLE handle = nullptr;
+  HANDLE state_mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+  event_header* header = nullptr;
   bool created = false;
+  int spin_count = 0;
+  // average number of polls that succeeded, in fixed point (see spin_wait())
+  std::atomic<int> spin_estimate{ 0 };
+
+  EventPriv() = default;
+  EventPriv(EventPriv&& other) noexcept;
 };
 
+inline EventPriv::EventPriv(EventPriv&& other) noexcept
+  : name(std::move(other.name)),
+#ifdef _WIN32
+    handle(std::exchange(other.handle, nullptr)),
+    state_mapping(std::exchange(other.state_mapping, nullptr)),
+#else
+    fd(std::exchange(other.fd, -1)),
+#endif
+    header(std::exchange(other.header, nullptr)),
+    created(other.created),
+    spin_count(other.spin_count),
+    spin_estimate(other.spin_estimate.load(std::memory_order_relaxed))
+{
+
+}
+
+// hints the processor that the thread is spinning
+void pause_processor();
+
+#ifndef _WIN32
+bool prepare_event_wait(event_header& header, uint32_t& expected, bool blocked);
+#endif // !_WIN32
+
 } // namespace Impl
 
+#ifdef _WIN32
+
 class Event;
 
 HANDLE GetHANDLE(const Event& e);
 
+#endif // _WIN32
+
 } // namespace Win32
 
 #endif // WINAPI_EVENTIMPL_H
\ No newline at end of file
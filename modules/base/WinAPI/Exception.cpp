@@ -8,7 +8,8 @@ namespace Win32
 {
 
 Exception::Exception(const ErrorCode& err) 
-  : std::runtime_error(err.Message())
+  : std::runtime_error(err.Message()),
+    m_err(err)
 {
 
 }
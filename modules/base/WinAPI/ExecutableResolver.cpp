@@ -0,0 +1,415 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "ExecutableResolver.h"
+
+#include "processpriv.h"
+#include "String.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifndef REG_NOTIFY_THREAD_AGNOSTIC
+#define REG_NOTIFY_THREAD_AGNOSTIC 0x10000000L
+#endif
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// lowercase names of the files in a directory
+struct DirectoryIndex
+{
+  HANDLE change_notification = INVALID_HANDLE_VALUE;
+  std::unordered_set<std::wstring> files;
+};
+
+struct AppPathsKey
+{
+  HKEY hkey = nullptr;
+  HANDLE event = nullptr;
+};
+
+struct ExecutableResolverPriv
+{
+  std::mutex mutex;
+  std::wstring path_variable;
+  std::vector<std::wstring> path_directories;
+  std::unordered_map<std::wstring, DirectoryIndex> directories;
+  bool app_paths_opened = false;
+  AppPathsKey app_paths_keys[2];
+  std::unordered_map<std::wstring, std::wstring> app_paths;
+
+  ~ExecutableResolverPriv();
+};
+
+void close_directory_index(DirectoryIndex& index)
+{
+  if (index.change_notification != INVALID_HANDLE_VALUE) {
+    ::FindCloseChangeNotification(index.change_notification);
+    index.change_notification = INVALID_HANDLE_VALUE;
+  }
+}
+
+ExecutableResolverPriv::~ExecutableResolverPriv()
+{
+  for (auto& entry : directories) {
+    close_directory_index(entry.second);
+  }
+
+  for (AppPathsKey& key : app_paths_keys)
+  {
+    if (key.hkey) {
+      ::RegCloseKey(key.hkey);
+    }
+
+    if (key.event) {
+      ::CloseHandle(key.event);
+    }
+  }
+}
+
+ExecutableResolverPriv& executable_resolver()
+{
+  static ExecutableResolverPriv resolver;
+  return resolver;
+}
+
+std::wstring join_path(const std::wstring& dir, const std::wstring& name)
+{
+  return dir + L'\\' + name;
+}
+
+std::vector<std::wstring> split_path_variable(const std::wstring& path)
+{
+  std::vector<std::wstring> result;
+  size_t begin = 0;
+
+  while (begin <= path.size())
+  {
+    size_t end = path.find(L';', begin);
+
+    if (end == std::wstring::npos) {
+      end = path.size();
+    }
+
+    std::wstring dir = path.substr(begin, end - begin);
+    dir.erase(std::remove(dir.begin(), dir.end(), L'"'), dir.end());
+
+    while (!dir.empty() && (dir.back() == L'\\' || dir.back() == L'/')) {
+      dir.pop_back();
+    }
+
+    if (!dir.empty()) {
+      result.push_back(std::move(dir));
+    }
+
+    begin = end + 1;
+  }
+
+  return result;
+}
+
+void update_path_directories(ExecutableResolverPriv& resolver)
+{
+  // reading an environment variable does not involve a system call
+  DWORD size = ::GetEnvironmentVariableW(L"PATH", nullptr, 0);
+  auto path = std::wstring(size, wchar_t(0));
+
+  if (size > 0) {
+    size = ::GetEnvironmentVariableW(L"PATH", path.data(), size);
+    path.resize(size);
+  }
+
+  if (path != resolver.path_variable)
+  {
+    resolver.path_directories = split_path_variable(path);
+    resolver.path_variable = std::move(path);
+  }
+}
+
+DirectoryIndex& get_directory_index(ExecutableResolverPriv& resolver, const std::wstring& dir)
+{
+  auto it = resolver.directories.find(ToLower(dir));
+
+  if (it != resolver.directories.end()) {
+    return it->second;
+  }
+
+  DirectoryIndex& index = resolver.directories[ToLower(dir)];
+
+  // the notification is requested before listing the directory so that
+  // no change can be missed
+  constexpr bool watch_subtree = false;
+  index.change_notification = ::FindFirstChangeNotificationW(dir.c_str(), watch_subtree, FILE_NOTIFY_CHANGE_FILE_NAME);
+
+  WIN32_FIND_DATAW data;
+  const std::wstring pattern = join_path(dir, L"*");
+  HANDLE find = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+
+  if (find != INVALID_HANDLE_VALUE)
+  {
+    do
+    {
+      if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        index.files.insert(ToLower(data.cFileName));
+      }
+    } while (::FindNextFileW(find, &data));
+
+    ::FindClose(find);
+  }
+
+  return index;
+}
+
+void watch_app_paths_key(AppPathsKey& key)
+{
+  constexpr bool watch_subtree = true;
+  constexpr bool asynchronous = true;
+  ::RegNotifyChangeKeyValue(
+    key.hkey,
+    watch_subtree,
+    REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC,
+    key.event,
+    asynchronous);
+}
+
+void open_app_paths_keys(ExecutableResolverPriv& resolver)
+{
+  const HKEY roots[] = { HKEY_CURRENT_USER, HKEY_LOCAL_MACHINE };
+
+  for (size_t i(0); i < 2; ++i)
+  {
+    AppPathsKey& key = resolver.app_paths_keys[i];
+    constexpr DWORD options = 0;
+    LSTATUS status = ::RegOpenKeyExW(
+      roots[i],
+      L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\App Paths",
+      options,
+      KEY_READ,
+      &key.hkey);
+
+    if (status != ERROR_SUCCESS) {
+      key.hkey = nullptr;
+      continue;
+    }
+
+    constexpr bool manual_reset = false;
+    constexpr bool initial_state = false;
+    key.event = ::CreateEventW(nullptr, manual_reset, initial_state, nullptr);
+
+    if (key.event) {
+      watch_app_paths_key(key);
+    }
+  }
+
+  resolver.app_paths_opened = true;
+}
+
+std::wstring read_app_path(const AppPathsKey& key, const std::wstring& exename)
+{
+  if (!key.hkey) {
+    return {};
+  }
+
+  auto value = std::wstring(MAX_PATH, wchar_t(0));
+
+  for (;;)
+  {
+    DWORD size = static_cast<DWORD>(value.size() * sizeof(wchar_t));
+
+    // reads the default value of the subkey, REG_EXPAND_SZ values are expanded
+    LSTATUS status = ::RegGetValueW(key.hkey, exename.c_str(), nullptr, RRF_RT_REG_SZ, nullptr, value.data(), &size);
+
+    if (status == ERROR_MORE_DATA) {
+      value.resize(size / sizeof(wchar_t) + 1);
+      continue;
+    }
+
+    if (status != ERROR_SUCCESS || size < sizeof(wchar_t)) {
+      return {};
+    }
+
+    value.resize(size / sizeof(wchar_t) - 1);
+    value.erase(std::remove(value.begin(), value.end(), L'"'), value.end());
+    return value;
+  }
+}
+
+const std::wstring& find_app_path(ExecutableResolverPriv& resolver, const std::wstring& exename)
+{
+  auto it = resolver.app_paths.find(exename);
+
+  if (it != resolver.app_paths.end()) {
+    return it->second;
+  }
+
+  std::wstring path = read_app_path(resolver.app_paths_keys[0], exename);
+
+  if (path.empty()) {
+    path = read_app_path(resolver.app_paths_keys[1], exename);
+  }
+
+  return resolver.app_paths[exename] = std::move(path);
+}
+
+// a handle that is signaled when a cached piece of information is outdated
+struct ChangeWatch
+{
+  HANDLE handle;
+  std::wstring directory;
+  AppPathsKey* app_paths_key = nullptr;
+};
+
+// discards the information that changed since the last call;
+// this costs one system call for every 64 watched directories
+void process_change_notifications(ExecutableResolverPriv& resolver)
+{
+  std::vector<HANDLE> handles;
+  std::vector<ChangeWatch> watches;
+
+  for (const auto& entry : resolver.directories)
+  {
+    if (entry.second.change_notification != INVALID_HANDLE_VALUE) {
+      handles.push_back(entry.second.change_notification);
+      watches.push_back({ entry.second.change_notification, entry.first, nullptr });
+    }
+  }
+
+  for (AppPathsKey& key : resolver.app_paths_keys)
+  {
+    if (key.event) {
+      handles.push_back(key.event);
+      watches.push_back({ key.event, {}, &key });
+    }
+  }
+
+  for (size_t offset(0); offset < handles.size(); offset += MAXIMUM_WAIT_OBJECTS)
+  {
+    auto count = static_cast<DWORD>(std::min<size_t>(MAXIMUM_WAIT_OBJECTS, handles.size() - offset));
+
+    while (count > 0)
+    {
+      constexpr bool wait_all = false;
+      constexpr DWORD timeout = 0;
+      DWORD result = ::WaitForMultipleObjects(count, handles.data() + offset, wait_all, timeout);
+
+      if (result >= WAIT_OBJECT_0 + count) {
+        // WAIT_TIMEOUT: nothing else changed
+        break;
+      }
+
+      const size_t i = offset + (result - WAIT_OBJECT_0);
+      ChangeWatch& watch = watches[i];
+
+      if (watch.app_paths_key)
+      {
+        resolver.app_paths.clear();
+        watch_app_paths_key(*watch.app_paths_key);
+      }
+      else
+      {
+        auto it = resolver.directories.find(watch.directory);
+        close_directory_index(it->second);
+        resolver.directories.erase(it);
+      }
+
+      // removes the handle from the wait
+      --count;
+      std::swap(handles[i], handles[offset + count]);
+      std::swap(watches[i], watches[offset + count]);
+    }
+  }
+}
+
+} // namespace Impl
+
+/**
+ * \brief finds an executable
+ * \param exename  the name of the executable
+ *
+ * If \a exename has no extension, ".exe" is appended.
+ * If \a exename contains a path separator, it is returned unchanged.
+ *
+ * Returns the full path of the executable, or an empty string if the
+ * executable could not be found.
+ *
+ * This function is thread-safe.
+ */
+std::string ExecutableResolver::Resolve(const std::string& exename)
+{
+  std::wstring name = ToUtf16(exename);
+
+  if (name.empty() || name.find_first_of(L"\\/") != std::wstring::npos) {
+    return exename;
+  }
+
+  if (name.find(L'.') == std::wstring::npos) {
+    name += L".exe";
+  }
+
+  const std::wstring lower_name = ToLower(name);
+
+  Impl::ExecutableResolverPriv& resolver = Impl::executable_resolver();
+  std::lock_guard<std::mutex> lock{ resolver.mutex };
+
+  if (!resolver.app_paths_opened) {
+    Impl::open_app_paths_keys(resolver);
+  }
+
+  Impl::process_change_notifications(resolver);
+  Impl::update_path_directories(resolver);
+
+  const std::wstring& app_dir = Impl::executable_directory();
+
+  if (Impl::get_directory_index(resolver, app_dir).files.count(lower_name)) {
+    return ToUtf8(Impl::join_path(app_dir, name));
+  }
+
+  const std::wstring& app_path = Impl::find_app_path(resolver, lower_name);
+
+  if (!app_path.empty()) {
+    return ToUtf8(app_path);
+  }
+
+  for (const std::wstring& dir : resolver.path_directories)
+  {
+    if (Impl::get_directory_index(resolver, dir).files.count(lower_name)) {
+      return ToUtf8(Impl::join_path(dir, name));
+    }
+  }
+
+  return {};
+}
+
+/**
+ * \brief discards all the cached information
+ *
+ * This is usually not needed as the cache is updated automatically, but
+ * directories that did not exist when they were first looked up are only
+ * listed again after a call to this function.
+ */
+void ExecutableResolver::Clear()
+{
+  Impl::ExecutableResolverPriv& resolver = Impl::executable_resolver();
+  std::lock_guard<std::mutex> lock{ resolver.mutex };
+
+  for (auto& entry : resolver.directories) {
+    Impl::close_directory_index(entry.second);
+  }
+
+  resolver.directories.clear();
+  resolver.app_paths.clear();
+  resolver.path_variable.clear();
+  resolver.path_directories.clear();
+}
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,36 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_EXECUTABLERESOLVER_H
+#define WINAPI_EXECUTABLERESOLVER_H
+
+#include <string>
+
+namespace Win32
+{
+
+/**
+ * \brief locates executables given their name
+ *
+ * Executables are searched, in this order:
+ * - in the directory of the executable of the current process;
+ * - in the "App Paths" registry keys (current user, then local machine);
+ * - in the directories listed in the PATH environment variable.
+ *
+ * The content of each directory is listed once and kept in a process-wide
+ * index. The index of a directory is discarded when the system reports a
+ * change in the directory, and entries read from the "App Paths" keys
+ * are discarded when the keys are modified.
+ * Resolving a name therefore usually does not touch the file system.
+ */
+class ExecutableResolver
+{
+public:
+  static std::string Resolve(const std::string& exename);
+  static void Clear();
+};
+
+} // namespace Win32
+
+#endif // WINAPI_EXECUTABLERESOLVER_H
\ No newline at end of file
@@ -0,0 +1,151 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_FASTPIMPL_H
+#define WINAPI_FASTPIMPL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+/**
+ * \brief holds a private implementation in a fixed-size inline buffer
+ * 
+ * This class is used like a std::unique_ptr (moving it transfers the object and 
+ * leaves the source empty) but never allocates memory.
+ * 
+ * As with std::unique_ptr, \a T can be an incomplete type where the class is
+ * declared; the functions that construct, move or destroy the object must
+ * be instantiated where \a T is complete (i.e., the special member functions 
+ * of the owning class must be defined out-of-line). 
+ * The size and alignment of \a T are checked at that point.
+ */
+template<typename T, size_t Size, size_t Align = alignof(std::max_align_t)>
+class FastPimpl
+{
+public:
+  FastPimpl() noexcept = default;
+  FastPimpl(const FastPimpl&) = delete;
+  FastPimpl(FastPimpl&& other) noexcept;
+  ~FastPimpl();
+
+  template<typename... Args>
+  T& emplace(Args&&... args);
+  void reset() noexcept;
+
+  T* get() const noexcept;
+  T* operator->() const noexcept;
+  T& operator*() const noexcept;
+  explicit operator bool() const noexcept;
+
+  FastPimpl& operator=(const FastPimpl&) = delete;
+  FastPimpl& operator=(FastPimpl&& other) noexcept;
+
+private:
+  alignas(Align) mutable unsigned char m_storage[Size];
+  bool m_constructed = false;
+};
+
+template<typename T, size_t Size, size_t Align>
+inline FastPimpl<T, Size, Align>::FastPimpl(FastPimpl&& other) noexcept
+{
+  if (other.m_constructed)
+  {
+    new (m_storage) T(std::move(*other));
+    m_constructed = true;
+    other.reset();
+  }
+}
+
+template<typename T, size_t Size, size_t Align>
+inline FastPimpl<T, Size, Align>::~FastPimpl()
+{
+  static_assert(sizeof(T) <= Size, "FastPimpl: the buffer is too small, increase Size");
+  static_assert(Align % alignof(T) == 0, "FastPimpl: the buffer is not suitably aligned, increase Align");
+
+  reset();
+}
+
+/**
+ * \brief constructs the object, destroying the previous one if any
+ */
+template<typename T, size_t Size, size_t Align>
+template<typename... Args>
+inline T& FastPimpl<T, Size, Align>::emplace(Args&&... args)
+{
+  reset();
+  T* object = new (m_storage) T(std::forward<Args>(args)...);
+  m_constructed = true;
+  return *object;
+}
+
+/**
+ * \brief destroys the object, if any
+ */
+template<typename T, size_t Size, size_t Align>
+inline void FastPimpl<T, Size, Align>::reset() noexcept
+{
+  if (m_constructed)
+  {
+    get()->~T();
+    m_constructed = false;
+  }
+}
+
+/**
+ * \brief returns a pointer to the object, or nullptr if there is none
+ */
+template<typename T, size_t Size, size_t Align>
+inline T* FastPimpl<T, Size, Align>::get() const noexcept
+{
+  return m_constructed ? std::launder(reinterpret_cast<T*>(m_storage)) : nullptr;
+}
+
+template<typename T, size_t Size, size_t Align>
+inline T* FastPimpl<T, Size, Align>::operator->() const noexcept
+{
+  return get();
+}
+
+template<typename T, size_t Size, size_t Align>
+inline T& FastPimpl<T, Size, Align>::operator*() const noexcept
+{
+  return *get();
+}
+
+template<typename T, size_t Size, size_t Align>
+inline FastPimpl<T, Size, Align>::operator bool() const noexcept
+{
+  return m_constructed;
+}
+
+template<typename T, size_t Size, size_t Align>
+inline FastPimpl<T, Size, Align>& FastPimpl<T, Size, Align>::operator=(FastPimpl&& other) noexcept
+{
+  if (this != &other)
+  {
+    reset();
+
+    if (other.m_constructed)
+    {
+      new (m_storage) T(std::move(*other));
+      m_constructed = true;
+      other.reset();
+    }
+  }
+
+  return *this;
+}
+
+} // namespace Impl
+
+} // namespace Win32
+
+#endif // WINAPI_FASTPIMPL_H
\ No newline at end of file
@@ -0,0 +1,1061 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "HiveRegistry.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+#include "filemapping_priv.h"
+#include "utf16_priv.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// Layout of the regf format.
+// The file starts with a base block, followed by hive bins that contain the
+// cells; cells are referenced by their offset from the first hive bin and
+// start with their size, which is negative if the cell is allocated.
+
+constexpr size_t hive_base_block_size = 0x1000;
+constexpr size_t hive_root_cell_field = 0x24;
+constexpr uint32_t hive_no_cell = 0xFFFFFFFF;
+
+// "nk" cells, the keys
+constexpr size_t hive_key_flags = 0x02;
+constexpr size_t hive_key_parent = 0x10;
+constexpr size_t hive_key_subkey_count = 0x14;
+constexpr size_t hive_key_subkey_list = 0x1C;
+constexpr size_t hive_key_value_count = 0x24;
+constexpr size_t hive_key_value_list = 0x28;
+constexpr size_t hive_key_max_subkey_name = 0x34;
+constexpr size_t hive_key_name_length = 0x48;
+constexpr size_t hive_key_name = 0x4C;
+constexpr uint16_t hive_key_compressed_name = 0x0020;
+
+// "vk" cells, the values
+constexpr size_t hive_value_name_length = 0x02;
+constexpr size_t hive_value_data_size = 0x04;
+constexpr size_t hive_value_data = 0x08;
+constexpr size_t hive_value_type = 0x0C;
+constexpr size_t hive_value_flags = 0x10;
+constexpr size_t hive_value_name = 0x14;
+constexpr uint16_t hive_value_compressed_name = 0x0001;
+// the data (at most 4 bytes) is stored in place of its offset
+constexpr uint32_t hive_value_inline_data = 0x80000000;
+
+// "db" cells, the data of large values split in segments
+constexpr size_t hive_big_data_segment_count = 0x02;
+constexpr size_t hive_big_data_segment_list = 0x04;
+constexpr size_t hive_big_data_segment_size = 16344;
+
+struct HiveRegistryPriv
+{
+  MappedFile file;
+  const unsigned char* root = nullptr;
+};
+
+inline uint16_t read_hive_u16(const unsigned char* p)
+{
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t read_hive_u32(const unsigned char* p)
+{
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline bool has_hive_signature(const unsigned char* cell, const char* signature)
+{
+  return cell[0] == static_cast<unsigned char>(signature[0]) && cell[1] == static_cast<unsigned char>(signature[1]);
+}
+
+// returns the data of a cell, or nullptr if the cell is not in the file or
+// is smaller than min_size; free cells are accepted, so that damaged hives
+// can still be read
+const unsigned char* get_hive_cell(const HiveRegistryPriv& hive, uint32_t offset, size_t min_size, size_t* cell_size = nullptr)
+{
+  const MappedFile& file = hive.file;
+
+  if (offset == hive_no_cell || offset % 8 != 0 || file.size < hive_base_block_size + 4 || offset > file.size - hive_base_block_size - 4) {
+    return nullptr;
+  }
+
+  const size_t position = hive_base_block_size + offset;
+  const auto raw_size = static_cast<int32_t>(read_hive_u32(file.data + position));
+  const size_t size = raw_size < 0 ? static_cast<size_t>(-static_cast<int64_t>(raw_size)) : static_cast<size_t>(raw_size);
+
+  if (size < 4 + min_size || size > file.size - position) {
+    return nullptr;
+  }
+
+  if (cell_size) {
+    *cell_size = size - 4;
+  }
+
+  return file.data + position + 4;
+}
+
+const unsigned char* get_hive_key(const HiveRegistryPriv& hive, uint32_t offset)
+{
+  size_t size = 0;
+  const unsigned char* cell = get_hive_cell(hive, offset, hive_key_name, &size);
+
+  if (!cell || !has_hive_signature(cell, "nk") || hive_key_name + read_hive_u16(cell + hive_key_name_length) > size) {
+    return nullptr;
+  }
+
+  return cell;
+}
+
+const unsigned char* get_hive_value(const HiveRegistryPriv& hive, uint32_t offset)
+{
+  size_t size = 0;
+  const unsigned char* cell = get_hive_cell(hive, offset, hive_value_name, &size);
+
+  if (!cell || !has_hive_signature(cell, "vk") || hive_value_name + read_hive_u16(cell + hive_value_name_length) > size) {
+    return nullptr;
+  }
+
+  return cell;
+}
+
+// returns a subkey of a key, the subkey must refer to the key as its parent
+// so that a damaged hive cannot contain cycles
+const unsigned char* get_hive_subkey_cell(const HiveRegistryPriv& hive, uint32_t offset, const unsigned char* parent)
+{
+  const unsigned char* key = get_hive_key(hive, offset);
+  const auto parent_offset = static_cast<uint32_t>(parent - hive.file.data - hive_base_block_size - 4);
+
+  if (!key || read_hive_u32(key + hive_key_parent) != parent_offset) {
+    return nullptr;
+  }
+
+  return key;
+}
+
+inline RegistryBackend::KeyHandle make_hive_key_handle(const unsigned char* key)
+{
+  return const_cast<unsigned char*>(key);
+}
+
+inline const unsigned char* get_hive_key_cell(RegistryBackend::KeyHandle handle)
+{
+  return static_cast<const unsigned char*>(handle);
+}
+
+// the name of a key or value, stored either in UTF-16LE or with one byte
+// per character (Latin-1)
+struct hive_name
+{
+  const unsigned char* data;
+  size_t length;
+  bool compressed;
+
+  char16_t operator[](size_t i) const
+  {
+    return compressed ? static_cast<char16_t>(data[i]) : static_cast<char16_t>(read_hive_u16(data + 2 * i));
+  }
+};
+
+hive_name get_hive_key_name(const unsigned char* key)
+{
+  const bool compressed = read_hive_u16(key + hive_key_flags) & hive_key_compressed_name;
+  const size_t size = read_hive_u16(key + hive_key_name_length);
+  return hive_name{ key + hive_key_name, compressed ? size : size / 2, compressed };
+}
+
+hive_name get_hive_value_name(const unsigned char* value)
+{
+  const bool compressed = read_hive_u16(value + hive_value_flags) & hive_value_compressed_name;
+  const size_t size = read_hive_u16(value + hive_value_name_length);
+  return hive_name{ value + hive_value_name, compressed ? size : size / 2, compressed };
+}
+
+inline char16_t hive_name_tolower(char16_t c)
+{
+  return (c >= u'A' && c <= u'Z') ? static_cast<char16_t>(c - u'A' + u'a') : c;
+}
+
+bool hive_name_equal(const hive_name& name, std::u16string_view other)
+{
+  if (name.length != other.size()) {
+    return false;
+  }
+
+  for (size_t i(0); i < other.size(); ++i)
+  {
+    if (hive_name_tolower(name[i]) != hive_name_tolower(other[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void copy_hive_name(const hive_name& name, char16_t* out)
+{
+  for (size_t i(0); i < name.length; ++i) {
+    out[i] = name[i];
+  }
+
+  out[name.length] = u'\0';
+}
+
+// a list of subkeys: "lf" and "lh" lists store the offset of each subkey
+// followed by a hash of its name, "li" lists only store the offsets, and "ri"
+// lists store the offsets of other lists
+struct hive_subkey_list
+{
+  const unsigned char* entries = nullptr;
+  size_t count = 0;
+  size_t entry_size = 0;
+  bool index_root = false;
+  bool hashed = false;
+};
+
+ErrorCode read_hive_subkey_list(const HiveRegistryPriv& hive, uint32_t offset, hive_subkey_list& list)
+{
+  size_t size = 0;
+  const unsigned char* cell = get_hive_cell(hive, offset, 4, &size);
+
+  if (!cell) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  list.entries = cell + 4;
+  list.count = read_hive_u16(cell + 2);
+  list.index_root = has_hive_signature(cell, "ri");
+  list.hashed = has_hive_signature(cell, "lh");
+
+  if (has_hive_signature(cell, "lf") || has_hive_signature(cell, "lh")) {
+    list.entry_size = 8;
+  } else if (has_hive_signature(cell, "li") || list.index_root) {
+    list.entry_size = 4;
+  } else {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  if (4 + list.count * list.entry_size > size) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  return ErrorCode();
+}
+
+// finds the subkey at an index in a list; if the index is past the end of
+// the list, result is nullptr and the number of subkeys in the list is
+// subtracted from the index
+ErrorCode get_hive_subkey(const HiveRegistryPriv& hive, const unsigned char* parent, uint32_t offset, size_t& index, const unsigned char*& result, bool nested = false)
+{
+  result = nullptr;
+  hive_subkey_list list;
+  ErrorCode err = read_hive_subkey_list(hive, offset, list);
+
+  if (err) {
+    return err;
+  }
+
+  if (!list.index_root)
+  {
+    if (index >= list.count)
+    {
+      index -= list.count;
+      return ErrorCode();
+    }
+
+    result = get_hive_subkey_cell(hive, read_hive_u32(list.entries + index * list.entry_size), parent);
+    return ErrorCode(result ? ERROR_SUCCESS : ERROR_BADDB);
+  }
+
+  // an index root only references leaves
+  if (nested) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  for (size_t i(0); i < list.count && !result; ++i)
+  {
+    constexpr bool nested_list = true;
+    err = get_hive_subkey(hive, parent, read_hive_u32(list.entries + i * list.entry_size), index, result, nested_list);
+
+    if (err) {
+      return err;
+    }
+  }
+
+  return ErrorCode();
+}
+
+ErrorCode count_hive_subkeys(const HiveRegistryPriv& hive, uint32_t offset, size_t& count, bool nested = false)
+{
+  hive_subkey_list list;
+  ErrorCode err = read_hive_subkey_list(hive, offset, list);
+
+  if (err) {
+    return err;
+  }
+
+  if (!list.index_root)
+  {
+    count += list.count;
+    return ErrorCode();
+  }
+
+  if (nested) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  for (size_t i(0); i < list.count; ++i)
+  {
+    constexpr bool nested_list = true;
+    err = count_hive_subkeys(hive, read_hive_u32(list.entries + i * list.entry_size), count, nested_list);
+
+    if (err) {
+      return err;
+    }
+  }
+
+  return ErrorCode();
+}
+
+// subkey lists are sorted by the uppercase names of the subkeys; only ASCII
+// letters are converted, so the order is the one of Windows for ASCII names
+inline char16_t hive_name_toupper(char16_t c)
+{
+  return (c >= u'a' && c <= u'z') ? static_cast<char16_t>(c - u'a' + u'A') : c;
+}
+
+int compare_hive_name(const hive_name& name, std::u16string_view other)
+{
+  const size_t length = (std::min)(name.length, other.size());
+
+  for (size_t i(0); i < length; ++i)
+  {
+    const char16_t a = hive_name_toupper(name[i]);
+    const char16_t b = hive_name_toupper(other[i]);
+
+    if (a != b) {
+      return a < b ? -1 : 1;
+    }
+  }
+
+  return name.length == other.size() ? 0 : (name.length < other.size() ? -1 : 1);
+}
+
+bool is_ascii_hive_name(std::u16string_view name)
+{
+  return std::all_of(name.begin(), name.end(), [](char16_t c) { return c < 0x80; });
+}
+
+// the hash stored in "lh" lists
+uint32_t hive_name_hash(std::u16string_view name)
+{
+  uint32_t hash = 0;
+
+  for (char16_t c : name) {
+    hash = hash * 37 + hive_name_toupper(c);
+  }
+
+  return hash;
+}
+
+ErrorCode get_hive_subkey_entry(const HiveRegistryPriv& hive, const unsigned char* parent, const hive_subkey_list& list, size_t index, const unsigned char*& key)
+{
+  key = get_hive_subkey_cell(hive, read_hive_u32(list.entries + index * list.entry_size), parent);
+  return ErrorCode(key ? ERROR_SUCCESS : ERROR_BADDB);
+}
+
+// binary search in a sorted leaf, the name must be in ASCII
+ErrorCode search_hive_subkey(const HiveRegistryPriv& hive, const unsigned char* parent, const hive_subkey_list& list, std::u16string_view name, const unsigned char*& result)
+{
+  size_t begin = 0;
+  size_t end = list.count;
+
+  while (begin < end)
+  {
+    const size_t middle = begin + (end - begin) / 2;
+    const unsigned char* key = nullptr;
+    ErrorCode err = get_hive_subkey_entry(hive, parent, list, middle, key);
+
+    if (err) {
+      return err;
+    }
+
+    const int comparison = compare_hive_name(get_hive_key_name(key), name);
+
+    if (comparison == 0)
+    {
+      result = key;
+      return ErrorCode();
+    }
+
+    if (comparison < 0) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+
+  return ErrorCode();
+}
+
+// linear search in a leaf, for names that are not in ASCII and for leaves
+// that are not sorted; the hashes of "lh" lists are compared first so that
+// the other subkeys are not read
+ErrorCode scan_hive_subkeys(const HiveRegistryPriv& hive, const unsigned char* parent, const hive_subkey_list& list, std::u16string_view name, bool use_hash, uint32_t hash, const unsigned char*& result)
+{
+  for (size_t i(0); i < list.count; ++i)
+  {
+    if (use_hash && list.hashed && read_hive_u32(list.entries + i * list.entry_size + 4) != hash) {
+      continue;
+    }
+
+    const unsigned char* key = nullptr;
+    ErrorCode err = get_hive_subkey_entry(hive, parent, list, i, key);
+
+    if (err) {
+      return err;
+    }
+
+    if (hive_name_equal(get_hive_key_name(key), name))
+    {
+      result = key;
+      return ErrorCode();
+    }
+  }
+
+  return ErrorCode();
+}
+
+// reads a leaf referenced by an index root
+ErrorCode read_hive_subkey_leaf(const HiveRegistryPriv& hive, const hive_subkey_list& root, size_t index, hive_subkey_list& leaf)
+{
+  ErrorCode err = read_hive_subkey_list(hive, read_hive_u32(root.entries + index * root.entry_size), leaf);
+  return err ? err : ErrorCode(leaf.index_root ? ERROR_BADDB : ERROR_SUCCESS);
+}
+
+// finds a subkey by name, result is nullptr if there is no such subkey
+//
+// ASCII names are found with a binary search, in the leaves and in the
+// index root with the last subkey of each leaf; if the search fails, the
+// leaves are scanned in case they are not sorted, which only reads the
+// hashes of "lh" lists.
+// Windows sorts the other names by converting them with its own table,
+// they are always found by a scan.
+ErrorCode find_hive_subkey(const HiveRegistryPriv& hive, const unsigned char* parent, uint32_t offset, std::u16string_view name, const unsigned char*& result)
+{
+  result = nullptr;
+  hive_subkey_list list;
+  ErrorCode err = read_hive_subkey_list(hive, offset, list);
+
+  if (err) {
+    return err;
+  }
+
+  const bool sorted_search = is_ascii_hive_name(name);
+  const uint32_t hash = hive_name_hash(name);
+
+  if (!list.index_root)
+  {
+    if (sorted_search)
+    {
+      err = search_hive_subkey(hive, parent, list, name, result);
+
+      if (err || result) {
+        return err;
+      }
+    }
+
+    return scan_hive_subkeys(hive, parent, list, name, sorted_search, hash, result);
+  }
+
+  hive_subkey_list leaf;
+
+  if (sorted_search)
+  {
+    // the first leaf whose last subkey is not before the name
+    size_t begin = 0;
+    size_t end = list.count;
+
+    while (begin < end)
+    {
+      const size_t middle = begin + (end - begin) / 2;
+      err = read_hive_subkey_leaf(hive, list, middle, leaf);
+
+      if (err) {
+        return err;
+      }
+
+      int comparison = -1;
+
+      if (leaf.count > 0)
+      {
+        const unsigned char* last = nullptr;
+        err = get_hive_subkey_entry(hive, parent, leaf, leaf.count - 1, last);
+
+        if (err) {
+          return err;
+        }
+
+        comparison = compare_hive_name(get_hive_key_name(last), name);
+      }
+
+      if (comparison < 0) {
+        begin = middle + 1;
+      } else {
+        end = middle;
+      }
+    }
+
+    if (begin < list.count)
+    {
+      err = read_hive_subkey_leaf(hive, list, begin, leaf);
+
+      if (!err) {
+        err = search_hive_subkey(hive, parent, leaf, name, result);
+      }
+
+      if (err || result) {
+        return err;
+      }
+    }
+  }
+
+  for (size_t i(0); i < list.count && !result; ++i)
+  {
+    err = read_hive_subkey_leaf(hive, list, i, leaf);
+
+    if (!err) {
+      err = scan_hive_subkeys(hive, parent, leaf, name, sorted_search, hash, result);
+    }
+
+    if (err) {
+      return err;
+    }
+  }
+
+  return ErrorCode();
+}
+
+ErrorCode find_hive_key(const HiveRegistryPriv& hive, const unsigned char* key, const std::string& path, const unsigned char*& result)
+{
+  result = key;
+  size_t begin = 0;
+
+  while (begin < path.size())
+  {
+    size_t end = path.find('\\', begin);
+
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+
+    if (end > begin)
+    {
+      if (read_hive_u32(result + hive_key_subkey_count) == 0) {
+        return ErrorCode(ERROR_FILE_NOT_FOUND);
+      }
+
+      const std::u16string name = utf8_to_utf16(path.data() + begin, end - begin);
+      ErrorCode err = find_hive_subkey(hive, result, read_hive_u32(result + hive_key_subkey_list), name, result);
+
+      if (err) {
+        return err;
+      }
+
+      if (!result) {
+        return ErrorCode(ERROR_FILE_NOT_FOUND);
+      }
+    }
+
+    begin = end + 1;
+  }
+
+  return ErrorCode();
+}
+
+ErrorCode get_hive_value_at(const HiveRegistryPriv& hive, const unsigned char* key, size_t index, const unsigned char*& result)
+{
+  result = nullptr;
+  const size_t count = read_hive_u32(key + hive_key_value_count);
+
+  if (index >= count) {
+    return ErrorCode(ERROR_NO_MORE_ITEMS);
+  }
+
+  const unsigned char* list = get_hive_cell(hive, read_hive_u32(key + hive_key_value_list), count * 4);
+
+  if (!list) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  result = get_hive_value(hive, read_hive_u32(list + index * 4));
+  return ErrorCode(result ? ERROR_SUCCESS : ERROR_BADDB);
+}
+
+ErrorCode find_hive_value(const HiveRegistryPriv& hive, const unsigned char* key, const std::string& name, const unsigned char*& result)
+{
+  result = nullptr;
+  const size_t count = read_hive_u32(key + hive_key_value_count);
+
+  if (count == 0) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  }
+
+  const unsigned char* list = get_hive_cell(hive, read_hive_u32(key + hive_key_value_list), count * 4);
+
+  if (!list) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  const std::u16string wide_name = utf8_to_utf16(name);
+
+  for (size_t i(0); i < count; ++i)
+  {
+    const unsigned char* value = get_hive_value(hive, read_hive_u32(list + i * 4));
+
+    if (!value) {
+      return ErrorCode(ERROR_BADDB);
+    }
+
+    if (hive_name_equal(get_hive_value_name(value), wide_name))
+    {
+      result = value;
+      return ErrorCode();
+    }
+  }
+
+  return ErrorCode(ERROR_FILE_NOT_FOUND);
+}
+
+// the size is checked against the size of the file, so that a damaged value
+// does not cause a large allocation
+ErrorCode get_hive_value_size(const HiveRegistryPriv& hive, const unsigned char* value, size_t& size)
+{
+  const uint32_t raw_size = read_hive_u32(value + hive_value_data_size);
+  size = raw_size & ~hive_value_inline_data;
+
+  if (size > ((raw_size & hive_value_inline_data) ? 4 : hive.file.size)) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  return ErrorCode();
+}
+
+// copies the data of a value, the buffer must be large enough
+ErrorCode copy_hive_value_data(const HiveRegistryPriv& hive, const unsigned char* value, void* data)
+{
+  const uint32_t raw_size = read_hive_u32(value + hive_value_data_size);
+  const size_t size = raw_size & ~hive_value_inline_data;
+  const uint32_t offset = read_hive_u32(value + hive_value_data);
+
+  if (size == 0) {
+    return ErrorCode();
+  }
+
+  if (raw_size & hive_value_inline_data)
+  {
+    if (size > 4) {
+      return ErrorCode(ERROR_BADDB);
+    }
+
+    std::memcpy(data, value + hive_value_data, size);
+    return ErrorCode();
+  }
+
+  const unsigned char* cell = get_hive_cell(hive, offset, 0);
+
+  if (!cell) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  if (size <= hive_big_data_segment_size || !has_hive_signature(cell, "db"))
+  {
+    cell = get_hive_cell(hive, offset, size);
+
+    if (!cell) {
+      return ErrorCode(ERROR_BADDB);
+    }
+
+    std::memcpy(data, cell, size);
+    return ErrorCode();
+  }
+
+  cell = get_hive_cell(hive, offset, hive_big_data_segment_list + 4);
+
+  if (!cell) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  const size_t segment_count = read_hive_u16(cell + hive_big_data_segment_count);
+  const unsigned char* segments = get_hive_cell(hive, read_hive_u32(cell + hive_big_data_segment_list), segment_count * 4);
+
+  if (!segments || segment_count * hive_big_data_segment_size < size) {
+    return ErrorCode(ERROR_BADDB);
+  }
+
+  auto* out = static_cast<unsigned char*>(data);
+  size_t copied = 0;
+
+  for (size_t i(0); i < segment_count && copied < size; ++i)
+  {
+    const size_t segment_size = (std::min)(size - copied, hive_big_data_segment_size);
+    const unsigned char* segment = get_hive_cell(hive, read_hive_u32(segments + i * 4), segment_size);
+
+    if (!segment) {
+      return ErrorCode(ERROR_BADDB);
+    }
+
+    std::memcpy(out + copied, segment, segment_size);
+    copied += segment_size;
+  }
+
+  return ErrorCode();
+}
+
+} // namespace Impl
+
+/**
+ * \brief opens a hive file
+ * \param path  the path of the file, in UTF-8
+ * \throw Exception on failure
+ *
+ * The file is mapped in memory and its header is checked; the error code of
+ * the exception is ERROR_BADDB if the file is not a hive.
+ */
+HiveRegistry::HiveRegistry(const std::string& path)
+  : d(std::make_unique<Impl::HiveRegistryPriv>())
+{
+  ErrorCode err = Impl::map_file(d->file, path);
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  if (d->file.size < Impl::hive_base_block_size || std::memcmp(d->file.data, "regf", 4) != 0) {
+    throw Exception(ErrorCode(ERROR_BADDB));
+  }
+
+  d->root = Impl::get_hive_key(*d, Impl::read_hive_u32(d->file.data + Impl::hive_root_cell_field));
+
+  if (!d->root) {
+    throw Exception(ErrorCode(ERROR_BADDB));
+  }
+}
+
+HiveRegistry::~HiveRegistry()
+{
+
+}
+
+/**
+ * \brief returns the root key of the hive
+ */
+RegistryKey HiveRegistry::GetRootKey()
+{
+  Impl::RegistryKeyPriv rk;
+  rk.backend = this;
+  rk.handle = Impl::make_hive_key_handle(d->root);
+  return RegistryKey(rk);
+}
+
+/**
+ * \brief returns the root key of the hive
+ *
+ * All the predefined keys are the root key.
+ */
+RegistryBackend::KeyHandle HiveRegistry::GetPredefinedKey(PredefinedKey key)
+{
+  if (key < ClassesRoot || key > Users) {
+    return nullptr;
+  }
+
+  return Impl::make_hive_key_handle(d->root);
+}
+
+/**
+ * \brief opens a key
+ *
+ * The handle is the address of the key in the mapping, the key is not
+ * otherwise read.
+ */
+ErrorCode HiveRegistry::OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights /* accessRights */, KeyHandle& result)
+{
+  result = nullptr;
+
+  if (!parent) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  const unsigned char* key = nullptr;
+  ErrorCode err = Impl::find_hive_key(*d, Impl::get_hive_key_cell(parent), subKey, key);
+
+  if (!err) {
+    result = Impl::make_hive_key_handle(key);
+  }
+
+  return err;
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, hives are read-only
+ */
+ErrorCode HiveRegistry::CreateKey(KeyHandle /* parent */, const std::string& /* subKey */, Registry::AccessRights /* accessRights */, KeyHandle& result, bool& created)
+{
+  result = nullptr;
+  created = false;
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, hives are read-only
+ */
+ErrorCode HiveRegistry::DeleteKey(KeyHandle /* parent */, const std::string& /* subKey */)
+{
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief does nothing, the keys of a hive do not need to be closed
+ */
+void HiveRegistry::CloseKey(KeyHandle /* key */)
+{
+
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, hives are read-only
+ */
+ErrorCode HiveRegistry::SetValue(KeyHandle /* key */, const std::string& /* name */, Registry::ValueType /* type */, const void* /* data */, size_t /* size */)
+{
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, hives are read-only
+ */
+ErrorCode HiveRegistry::DeleteValue(KeyHandle /* key */, const std::string& /* name */)
+{
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief reads a value
+ *
+ * The data of the value is copied from the mapping.
+ */
+ErrorCode HiveRegistry::GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (data && !size) {
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+
+  const unsigned char* value = nullptr;
+  ErrorCode err = Impl::find_hive_value(*d, Impl::get_hive_key_cell(key), name, value);
+
+  if (err) {
+    return err;
+  }
+
+  if (type) {
+    *type = static_cast<Registry::ValueType>(Impl::read_hive_u32(value + Impl::hive_value_type));
+  }
+
+  size_t value_size = 0;
+  err = Impl::get_hive_value_size(*d, value, value_size);
+
+  if (err) {
+    return err;
+  }
+
+  if (data && *size < value_size)
+  {
+    *size = value_size;
+    return ErrorCode(ERROR_MORE_DATA);
+  }
+
+  if (size) {
+    *size = value_size;
+  }
+
+  return data ? Impl::copy_hive_value_data(*d, value, data) : ErrorCode();
+}
+
+/**
+ * \brief returns the number of subkeys and values of a key
+ *
+ * The counts and the lengths of the values are computed from the lists of
+ * the key rather than read from the key, which may be damaged.
+ */
+ErrorCode HiveRegistry::QueryKeyInfo(KeyHandle key, KeyInfo& info)
+{
+  info = KeyInfo();
+
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  const unsigned char* cell = Impl::get_hive_key_cell(key);
+
+  if (Impl::read_hive_u32(cell + Impl::hive_key_subkey_count) > 0)
+  {
+    ErrorCode err = Impl::count_hive_subkeys(*d, Impl::read_hive_u32(cell + Impl::hive_key_subkey_list), info.subKeyCount);
+
+    if (err) {
+      return err;
+    }
+
+    // in bytes, the upper bits store other flags
+    info.maxSubKeyNameLength = (Impl::read_hive_u32(cell + Impl::hive_key_max_subkey_name) & 0xFFFF) / 2;
+  }
+
+  for (size_t index = 0;; ++index)
+  {
+    const unsigned char* value = nullptr;
+    ErrorCode err = Impl::get_hive_value_at(*d, cell, index, value);
+
+    if (err.Value() == ERROR_NO_MORE_ITEMS) {
+      break;
+    }
+
+    size_t value_size = 0;
+
+    if (!err) {
+      err = Impl::get_hive_value_size(*d, value, value_size);
+    }
+
+    if (err) {
+      return err;
+    }
+
+    info.valueCount = index + 1;
+    info.maxValueNameLength = (std::max)(info.maxValueNameLength, Impl::get_hive_value_name(value).length);
+    info.maxValueSize = (std::max)(info.maxValueSize, value_size);
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief returns the name of a subkey
+ *
+ * \a nameLength is the size of the buffer, including the null terminator,
+ * and receives the length of the name.
+ */
+ErrorCode HiveRegistry::EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  const unsigned char* cell = Impl::get_hive_key_cell(key);
+
+  if (Impl::read_hive_u32(cell + Impl::hive_key_subkey_count) == 0) {
+    return ErrorCode(ERROR_NO_MORE_ITEMS);
+  }
+
+  // the number of subkeys is the number of subkeys in the lists, as in QueryKeyInfo()
+  const unsigned char* subkey = nullptr;
+  ErrorCode err = Impl::get_hive_subkey(*d, cell, Impl::read_hive_u32(cell + Impl::hive_key_subkey_list), index, subkey);
+
+  if (err) {
+    return err;
+  }
+
+  if (!subkey) {
+    return ErrorCode(ERROR_NO_MORE_ITEMS);
+  }
+
+  const Impl::hive_name subkey_name = Impl::get_hive_key_name(subkey);
+
+  if (nameLength <= subkey_name.length) {
+    return ErrorCode(ERROR_MORE_DATA);
+  }
+
+  Impl::copy_hive_name(subkey_name, name);
+  nameLength = subkey_name.length;
+  return ErrorCode();
+}
+
+/**
+ * \brief returns the name, and optionally the data, of a value
+ *
+ * \a nameLength is the size of the buffer, including the null terminator,
+ * and receives the length of the name.
+ * The data is returned as with GetValue().
+ */
+ErrorCode HiveRegistry::EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (data && !size) {
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+
+  const unsigned char* value = nullptr;
+  ErrorCode err = Impl::get_hive_value_at(*d, Impl::get_hive_key_cell(key), index, value);
+
+  if (err) {
+    return err;
+  }
+
+  if (type) {
+    *type = static_cast<Registry::ValueType>(Impl::read_hive_u32(value + Impl::hive_value_type));
+  }
+
+  size_t value_size = 0;
+  err = Impl::get_hive_value_size(*d, value, value_size);
+
+  if (err) {
+    return err;
+  }
+
+  const Impl::hive_name value_name = Impl::get_hive_value_name(value);
+  const bool name_fits = nameLength > value_name.length;
+  const bool data_fits = !data || *size >= value_size;
+
+  if (size) {
+    *size = value_size;
+  }
+
+  if (!name_fits || !data_fits) {
+    return ErrorCode(ERROR_MORE_DATA);
+  }
+
+  Impl::copy_hive_name(value_name, name);
+  nameLength = value_name.length;
+  return data ? Impl::copy_hive_value_data(*d, value, data) : ErrorCode();
+}
+
+/**
+ * \brief accepts the watch, the callback is never called since hives are read-only
+ */
+ErrorCode HiveRegistry::WatchKey(KeyHandle key, std::function<void()> /* callback */, WatchHandle& result)
+{
+  result = key;
+  return ErrorCode(key ? ERROR_SUCCESS : ERROR_INVALID_HANDLE);
+}
+
+/**
+ * \brief does nothing
+ */
+void HiveRegistry::UnwatchKey(WatchHandle /* watch */)
+{
+
+}
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,80 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_HIVEREGISTRY_H
+#define WINAPI_HIVEREGISTRY_H
+
+#include "RegistryBackend.h"
+
+#include <memory>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct HiveRegistryPriv;
+} // namespace Impl
+
+/**
+ * \brief read-only registry backend that reads a registry hive file
+ *
+ * Hive files (e.g., NTUSER.DAT or the SOFTWARE hive) store a part of the
+ * Windows Registry on disk in the "regf" format.
+ * This backend maps the file in memory and reads its cells when they are
+ * accessed, so that even very large hives can be read without loading them;
+ * it does not depend on the Windows API and can be used on any platform:
+ *
+ * \code
+ * HiveRegistry hive{ "NTUSER.DAT" };
+ * RegistryKey key = Registry::OpenKey(hive.GetRootKey(), "Software\\Microsoft", Registry::Read);
+ * std::string value = key.GetStringValue("Name");
+ * \endcode
+ *
+ * All the predefined keys are the root key of the hive.
+ * Names are compared without regard to the case of ASCII letters.
+ * The keys do not need to be closed and the functions that modify the
+ * registry fail with ERROR_ACCESS_DENIED; a hive is never modified, so
+ * watched keys are never notified.
+ * Functions fail with ERROR_BADDB when they read a cell that is not valid.
+ * The transaction logs of the hive are not applied.
+ *
+ * The backend must outlive the keys opened with it.
+ */
+class HiveRegistry : public RegistryBackend
+{
+public:
+  explicit HiveRegistry(const std::string& path);
+  HiveRegistry(const HiveRegistry&) = delete;
+  ~HiveRegistry();
+
+  RegistryKey GetRootKey();
+
+  KeyHandle GetPredefinedKey(PredefinedKey key) override;
+
+  ErrorCode OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result) override;
+  ErrorCode CreateKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result, bool& created) override;
+  ErrorCode DeleteKey(KeyHandle parent, const std::string& subKey) override;
+  void CloseKey(KeyHandle key) override;
+
+  ErrorCode SetValue(KeyHandle key, const std::string& name, Registry::ValueType type, const void* data, size_t size) override;
+  ErrorCode DeleteValue(KeyHandle key, const std::string& name) override;
+  ErrorCode GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size) override;
+
+  ErrorCode QueryKeyInfo(KeyHandle key, KeyInfo& info) override;
+  ErrorCode EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength) override;
+  ErrorCode EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size) override;
+
+  ErrorCode WatchKey(KeyHandle key, std::function<void()> callback, WatchHandle& result) override;
+  void UnwatchKey(WatchHandle watch) override;
+
+  HiveRegistry& operator=(const HiveRegistry&) = delete;
+
+private:
+  std::unique_ptr<Impl::HiveRegistryPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_HIVEREGISTRY_H
\ No newline at end of file
@@ -0,0 +1,944 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "JobObject.h"
+#include "jobobject_priv.h"
+
+#include "Exception.h"
+#include "Process.h"
+#include "processpriv.h"
+
+#ifndef _WIN32
+#include "winerror_priv.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <utility>
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+#endif
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+// completion keys used on the job's completion port
+constexpr ULONG_PTR job_completion_key = 1;
+constexpr ULONG_PTR stop_completion_key = 2;
+
+void create_job(JobObjectPriv& job)
+{
+  job.handle = ::CreateJobObjectW(nullptr, nullptr);
+
+  if (!job.handle) {
+    throw Exception(GetLastError());
+  }
+}
+
+void update_extended_limits(JobObjectPriv& job)
+{
+  BOOL ok = ::SetInformationJobObject(
+    job.handle,
+    JobObjectExtendedLimitInformation,
+    &job.limits,
+    sizeof(job.limits));
+
+  if (!ok) {
+    throw Exception(GetLastError());
+  }
+}
+
+void set_process_memory_limit(JobObjectPriv& job, size_t bytes)
+{
+  job.limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_PROCESS_MEMORY;
+  job.limits.ProcessMemoryLimit = bytes;
+  update_extended_limits(job);
+}
+
+void set_job_memory_limit(JobObjectPriv& job, size_t bytes)
+{
+  job.limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+  job.limits.JobMemoryLimit = bytes;
+  update_extended_limits(job);
+}
+
+void set_active_process_limit(JobObjectPriv& job, int count)
+{
+  job.limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_ACTIVE_PROCESS;
+  job.limits.BasicLimitInformation.ActiveProcessLimit = static_cast<DWORD>(count);
+  update_extended_limits(job);
+}
+
+void set_process_time_limit(JobObjectPriv& job, std::chrono::milliseconds time)
+{
+  job.limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_PROCESS_TIME;
+  // the limit is expressed in 100-nanosecond ticks
+  job.limits.BasicLimitInformation.PerProcessUserTimeLimit.QuadPart = time.count() * 10000;
+  update_extended_limits(job);
+}
+
+void set_cpu_rate_limit(JobObjectPriv& job, int percent)
+{
+  JOBOBJECT_CPU_RATE_CONTROL_INFORMATION info = {};
+  info.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+  // the rate is expressed in hundredths of a percent
+  info.CpuRate = static_cast<DWORD>(percent) * 100;
+
+  if (!::SetInformationJobObject(job.handle, JobObjectCpuRateControlInformation, &info, sizeof(info))) {
+    throw Exception(GetLastError());
+  }
+}
+
+void set_kill_on_close(JobObjectPriv& job, bool on)
+{
+  if (on) {
+    job.limits.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+  } else {
+    job.limits.BasicLimitInformation.LimitFlags &= ~JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+  }
+
+  update_extended_limits(job);
+}
+
+void assign_process(JobObjectPriv& job, const ProcessPriv& pd)
+{
+  if (!::AssignProcessToJobObject(job.handle, pd.handle)) {
+    throw Exception(GetLastError());
+  }
+}
+
+bool terminate_job(JobObjectPriv& job, int exit_code)
+{
+  return ::TerminateJobObject(job.handle, static_cast<UINT>(exit_code));
+}
+
+void listen_job_notifications(JobObjectPriv* job)
+{
+  for (;;)
+  {
+    DWORD message = 0;
+    ULONG_PTR key = 0;
+    LPOVERLAPPED overlapped = nullptr;
+
+    BOOL ok = ::GetQueuedCompletionStatus(job->completion_port, &message, &key, &overlapped, INFINITE);
+
+    if (!ok || key == stop_completion_key) {
+      return;
+    }
+
+    JobObject::Notification notification;
+    notification.type = static_cast<JobObject::NotificationType>(message);
+    // for job notifications, the 'overlapped' parameter carries the process id
+    notification.processId = static_cast<unsigned long>(reinterpret_cast<ULONG_PTR>(overlapped));
+
+    // the callback is called without the lock, so that it can replace
+    // itself or close the job
+    JobObject::NotificationCallback callback;
+
+    {
+      std::lock_guard<std::mutex> lock{ job->callback_mutex };
+      callback = job->callback;
+    }
+
+    if (callback) {
+      callback(notification);
+    }
+
+    // the job was closed by the callback, the listener owns it now
+    if (job->closed_by_listener)
+    {
+      ::CloseHandle(job->completion_port);
+      delete job;
+      return;
+    }
+  }
+}
+
+void start_listener(JobObjectPriv& job)
+{
+  constexpr DWORD nb_concurrent_threads = 1;
+  job.completion_port = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, nb_concurrent_threads);
+
+  if (!job.completion_port) {
+    throw Exception(GetLastError());
+  }
+
+  JOBOBJECT_ASSOCIATE_COMPLETION_PORT info = {};
+  info.CompletionKey = reinterpret_cast<PVOID>(job_completion_key);
+  info.CompletionPort = job.completion_port;
+
+  if (!::SetInformationJobObject(job.handle, JobObjectAssociateCompletionPortInformation, &info, sizeof(info))) {
+    ErrorCode err = GetLastError();
+    ::CloseHandle(job.completion_port);
+    job.completion_port = nullptr;
+    throw Exception(err);
+  }
+
+  job.listener = std::thread(listen_job_notifications, &job);
+}
+
+void stop_listener(JobObjectPriv& job)
+{
+  if (job.completion_port)
+  {
+    ::PostQueuedCompletionStatus(job.completion_port, 0, stop_completion_key, nullptr);
+    job.listener.join();
+    ::CloseHandle(job.completion_port);
+  }
+}
+
+// the processes are terminated by the system if the job is kill-on-close
+void release_job(JobObjectPriv& job)
+{
+  ::CloseHandle(job.handle);
+}
+
+#else
+
+// the type of the resources in prlimit(), an enum with glibc
+using resource_t = decltype(RLIMIT_AS);
+
+JobObjectPriv::~JobObjectPriv()
+{
+  for (const JobProcess& process : processes) {
+    ::close(process.pidfd);
+  }
+
+  if (wakeup_fd != -1) {
+    ::close(wakeup_fd);
+  }
+
+  if (epoll_fd != -1) {
+    ::close(epoll_fd);
+  }
+}
+
+ErrorCode job_error_from_errno(int err)
+{
+  switch (err)
+  {
+  case EPERM:
+    // raising a hard limit requires CAP_SYS_RESOURCE
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  case ESRCH:
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  case EMFILE:
+  case ENFILE:
+    return ErrorCode(ERROR_TOO_MANY_OPEN_FILES);
+  case ENOMEM:
+  case ENOSPC:
+    return ErrorCode(ERROR_NOT_ENOUGH_MEMORY);
+  default:
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+}
+
+// the limit cannot be raised again by the process, as in a job
+struct rlimit resource_limit(rlim_t value)
+{
+  struct rlimit limit = {};
+  limit.rlim_cur = value;
+  limit.rlim_max = value;
+  return limit;
+}
+
+// the process receives SIGXCPU when it reaches the soft limit, and SIGKILL
+// a second later if it handles the signal
+struct rlimit cpu_time_limit(rlim_t seconds)
+{
+  struct rlimit limit = resource_limit(seconds);
+
+  if (seconds != RLIM_INFINITY) {
+    limit.rlim_max = seconds + 1;
+  }
+
+  return limit;
+}
+
+// the pidfd of a process that exited is readable
+bool has_exited(const JobProcess& process)
+{
+  struct pollfd pidfd = {};
+  pidfd.fd = process.pidfd;
+  pidfd.events = POLLIN;
+  return ::poll(&pidfd, 1, 0) == 1;
+}
+
+void create_job(JobObjectPriv& /* job */)
+{
+  static const bool supported = []() {
+    const int pidfd = open_pidfd(::getpid());
+
+    if (pidfd == -1) {
+      return errno != ENOSYS;
+    }
+
+    ::close(pidfd);
+    return true;
+  }();
+
+  if (!supported) {
+    throw Exception(ErrorCode(ERROR_NOT_SUPPORTED));
+  }
+}
+
+// queues a notification for the listener; must be called with the mutex held
+void post_notification(JobObjectPriv& job, JobObject::NotificationType type, pid_t pid)
+{
+  if (job.epoll_fd == -1) {
+    return;
+  }
+
+  JobObject::Notification notification;
+  notification.type = type;
+  notification.processId = static_cast<unsigned long>(pid);
+  job.notifications.push_back(notification);
+
+  const uint64_t one = 1;
+  while (::write(job.wakeup_fd, &one, sizeof(one)) == -1 && errno == EINTR);
+}
+
+// the exits are detected by the listener, without it the processes that
+// exited are removed when the job is used; must be called with the mutex held
+void remove_exited_processes(JobObjectPriv& job)
+{
+  if (job.epoll_fd != -1) {
+    return;
+  }
+
+  auto it = std::remove_if(job.processes.begin(), job.processes.end(), [](const JobProcess& process) {
+    if (!has_exited(process)) {
+      return false;
+    }
+
+    ::close(process.pidfd);
+    return true;
+    });
+
+  job.processes.erase(it, job.processes.end());
+}
+
+// applies a new limit to the processes of the job; must be called with the mutex held
+void limit_running_processes(JobObjectPriv& job, resource_t resource, const struct rlimit& limit)
+{
+  remove_exited_processes(job);
+
+  for (const JobProcess& process : job.processes)
+  {
+    if (!has_exited(process) && ::prlimit(process.pid, resource, &limit, nullptr) == -1 && errno != ESRCH) {
+      throw Exception(job_error_from_errno(errno));
+    }
+  }
+}
+
+// takes ownership of the pidfd; must be called with the mutex held
+bool add_job_process(JobObjectPriv& job, pid_t pid, int pidfd)
+{
+  if (job.epoll_fd != -1)
+  {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = pidfd;
+
+    if (::epoll_ctl(job.epoll_fd, EPOLL_CTL_ADD, pidfd, &event) == -1)
+    {
+      const int err = errno;
+      ::close(pidfd);
+      errno = err;
+      return false;
+    }
+  }
+
+  JobProcess process;
+  process.pid = pid;
+  process.pidfd = pidfd;
+  job.processes.push_back(process);
+  post_notification(job, JobObject::NewProcess, pid);
+  return true;
+}
+
+// must be called with the mutex held
+void kill_job_processes(JobObjectPriv& job)
+{
+  for (const JobProcess& process : job.processes) {
+    signal_pidfd(process.pidfd, SIGKILL);
+  }
+}
+
+// reserves a place for a process that is about to be started in the job,
+// and returns the limits to apply to it; fails if the job is full
+bool reserve_job_process(JobObjectPriv& job, JobLimits& limits)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  remove_exited_processes(job);
+
+  const size_t count = job.processes.size() + static_cast<size_t>(job.starting);
+
+  if (job.active_process_limit > 0 && count >= static_cast<size_t>(job.active_process_limit))
+  {
+    // the process is not started, so that there is no process id
+    post_notification(job, JobObject::ActiveProcessLimit, 0);
+    return false;
+  }
+
+  ++job.starting;
+  limits = job.limits;
+  return true;
+}
+
+// ends a reservation made by reserve_job_process(): a pid of -1 means that
+// the process failed to start; returns whether the process is in the job
+bool add_reserved_process(JobObjectPriv& job, pid_t pid, int pidfd)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  --job.starting;
+
+  if (pid == -1 || pidfd == -1) {
+    return false;
+  }
+
+  const int job_pidfd = ::fcntl(pidfd, F_DUPFD_CLOEXEC, 0);
+  return job_pidfd != -1 && add_job_process(job, pid, job_pidfd);
+}
+
+// called in the child, between fork() and execve(), where only
+// async-signal-safe functions can be used
+bool apply_job_limits(const JobLimits& limits, pid_t parent)
+{
+  if (limits.process_memory != RLIM_INFINITY)
+  {
+    const struct rlimit limit = resource_limit(limits.process_memory);
+
+    if (::setrlimit(RLIMIT_AS, &limit) == -1) {
+      return false;
+    }
+  }
+
+  if (limits.process_time != RLIM_INFINITY)
+  {
+    const struct rlimit limit = cpu_time_limit(limits.process_time);
+
+    if (::setrlimit(RLIMIT_CPU, &limit) == -1) {
+      return false;
+    }
+  }
+
+  if (limits.file_descriptors != RLIM_INFINITY)
+  {
+    const struct rlimit limit = resource_limit(limits.file_descriptors);
+
+    if (::setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+      return false;
+    }
+  }
+
+  if (limits.kill_on_close)
+  {
+    if (::prctl(PR_SET_PDEATHSIG, SIGKILL) == -1) {
+      return false;
+    }
+
+    // the parent exited before the signal was requested
+    if (::getppid() != parent) {
+      ::raise(SIGKILL);
+    }
+  }
+
+  return true;
+}
+
+void set_process_memory_limit(JobObjectPriv& job, size_t bytes)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  job.limits.process_memory = static_cast<rlim_t>(bytes);
+  limit_running_processes(job, RLIMIT_AS, resource_limit(job.limits.process_memory));
+}
+
+void set_job_memory_limit(JobObjectPriv& /* job */, size_t /* bytes */)
+{
+  throw Exception(ErrorCode(ERROR_NOT_SUPPORTED));
+}
+
+void set_active_process_limit(JobObjectPriv& job, int count)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  job.active_process_limit = count;
+}
+
+void set_process_time_limit(JobObjectPriv& job, std::chrono::milliseconds time)
+{
+  // the limit is expressed in seconds, of at least one second
+  const std::chrono::seconds seconds = (std::max)(std::chrono::ceil<std::chrono::seconds>(time), std::chrono::seconds(1));
+
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  job.limits.process_time = static_cast<rlim_t>(seconds.count());
+  limit_running_processes(job, RLIMIT_CPU, cpu_time_limit(job.limits.process_time));
+}
+
+void set_cpu_rate_limit(JobObjectPriv& /* job */, int /* percent */)
+{
+  throw Exception(ErrorCode(ERROR_NOT_SUPPORTED));
+}
+
+void set_kill_on_close(JobObjectPriv& job, bool on)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  job.limits.kill_on_close = on;
+}
+
+void set_file_descriptor_limit(JobObjectPriv& job, int count)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  job.limits.file_descriptors = static_cast<rlim_t>(count);
+  limit_running_processes(job, RLIMIT_NOFILE, resource_limit(job.limits.file_descriptors));
+}
+
+void assign_process(JobObjectPriv& job, const ProcessPriv& pd)
+{
+  if (pd.pid == -1 || pd.reaped) {
+    throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+  }
+
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  const JobLimits& limits = job.limits;
+
+  const std::pair<resource_t, struct rlimit> process_limits[] = {
+    { RLIMIT_AS, resource_limit(limits.process_memory) },
+    { RLIMIT_CPU, cpu_time_limit(limits.process_time) },
+    { RLIMIT_NOFILE, resource_limit(limits.file_descriptors) },
+  };
+
+  for (const auto& limit : process_limits)
+  {
+    if (limit.second.rlim_cur != RLIM_INFINITY && ::prlimit(pd.pid, limit.first, &limit.second, nullptr) == -1) {
+      throw Exception(job_error_from_errno(errno));
+    }
+  }
+
+  const int pidfd = ::fcntl(pd.pidfd, F_DUPFD_CLOEXEC, 0);
+
+  if (pidfd == -1 || !add_job_process(job, pd.pid, pidfd)) {
+    throw Exception(job_error_from_errno(errno));
+  }
+}
+
+bool terminate_job(JobObjectPriv& job, int /* exit_code */)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+  kill_job_processes(job);
+  return true;
+}
+
+// the exit status is read without reaping the process, which is left to
+// Process; if it was already reaped, the exit is reported as normal
+JobObject::Notification exit_notification(const JobProcess& process)
+{
+  JobObject::Notification notification;
+  notification.type = JobObject::ExitProcess;
+  notification.processId = static_cast<unsigned long>(process.pid);
+
+  siginfo_t info = {};
+
+  if (::waitid(static_cast<idtype_t>(P_PIDFD), static_cast<id_t>(process.pidfd), &info, WEXITED | WNOHANG | WNOWAIT) == 0
+    && info.si_pid == process.pid && info.si_code != CLD_EXITED)
+  {
+    notification.type = info.si_status == SIGXCPU ? JobObject::EndOfProcessTime : JobObject::AbnormalExitProcess;
+  }
+
+  return notification;
+}
+
+void listen_job_notifications(JobObjectPriv* job)
+{
+  for (;;)
+  {
+    constexpr int max_events = 16;
+    struct epoll_event events[max_events];
+    const int count = ::epoll_wait(job->epoll_fd, events, max_events, -1);
+    const int err = errno;
+
+    std::vector<JobObject::Notification> notifications;
+
+    {
+      std::lock_guard<std::mutex> lock{ job->mutex };
+
+      if (job->stop || (count == -1 && err != EINTR)) {
+        return;
+      }
+
+      bool exited = false;
+
+      for (int i(0); i < count; ++i)
+      {
+        const int fd = events[i].data.fd;
+
+        if (fd == job->wakeup_fd)
+        {
+          uint64_t value = 0;
+          while (::read(job->wakeup_fd, &value, sizeof(value)) == -1 && errno == EINTR);
+          continue;
+        }
+
+        auto it = std::find_if(job->processes.begin(), job->processes.end(), [fd](const JobProcess& process) {
+          return process.pidfd == fd;
+          });
+
+        if (it != job->processes.end())
+        {
+          // after the notifications queued before the exit, e.g. NewProcess
+          job->notifications.push_back(exit_notification(*it));
+          ::epoll_ctl(job->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+          ::close(fd);
+          job->processes.erase(it);
+          exited = true;
+        }
+      }
+
+      notifications.swap(job->notifications);
+
+      if (exited && job->processes.empty() && job->starting == 0) {
+        notifications.push_back(JobObject::Notification{ JobObject::ActiveProcessZero, 0 });
+      }
+    }
+
+    for (const JobObject::Notification& notification : notifications)
+    {
+      // the callback is called without the lock, so that it can replace
+      // itself or close the job
+      JobObject::NotificationCallback callback;
+
+      {
+        std::lock_guard<std::mutex> lock{ job->callback_mutex };
+        callback = job->callback;
+      }
+
+      if (callback) {
+        callback(notification);
+      }
+
+      // the job was closed by the callback, the listener owns it now
+      if (job->closed_by_listener)
+      {
+        delete job;
+        return;
+      }
+    }
+  }
+}
+
+void start_listener(JobObjectPriv& job)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+
+  job.epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  job.wakeup_fd = job.epoll_fd == -1 ? -1 : ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  bool ok = job.wakeup_fd != -1;
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = job.wakeup_fd;
+  ok = ok && ::epoll_ctl(job.epoll_fd, EPOLL_CTL_ADD, job.wakeup_fd, &event) == 0;
+
+  for (size_t i(0); ok && i < job.processes.size(); ++i)
+  {
+    event.data.fd = job.processes[i].pidfd;
+    ok = ::epoll_ctl(job.epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event) == 0;
+  }
+
+  if (!ok)
+  {
+    const int err = errno;
+
+    if (job.wakeup_fd != -1) {
+      ::close(job.wakeup_fd);
+    }
+
+    if (job.epoll_fd != -1) {
+      ::close(job.epoll_fd);
+    }
+
+    job.wakeup_fd = -1;
+    job.epoll_fd = -1;
+    throw Exception(job_error_from_errno(err));
+  }
+
+  job.listener = std::thread(listen_job_notifications, &job);
+}
+
+void stop_listener(JobObjectPriv& job)
+{
+  if (!job.listener.joinable()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{ job.mutex };
+    job.stop = true;
+    const uint64_t one = 1;
+    while (::write(job.wakeup_fd, &one, sizeof(one)) == -1 && errno == EINTR);
+  }
+
+  job.listener.join();
+}
+
+void release_job(JobObjectPriv& job)
+{
+  std::lock_guard<std::mutex> lock{ job.mutex };
+
+  if (job.limits.kill_on_close) {
+    kill_job_processes(job);
+  }
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+/**
+ * \brief creates an unnamed job object with no limits
+ * \throw Exception on failure
+ *
+ * On Linux, jobs require pidfds (Linux 5.3).
+ */
+JobObject::JobObject()
+  : d(std::make_unique<Impl::JobObjectPriv>())
+{
+  Impl::create_job(*d);
+}
+
+JobObject::JobObject(JobObject&&) noexcept = default;
+
+/**
+ * \brief destroys the job object
+ *
+ * If SetKillOnClose() was called, all the processes in the job are terminated.
+ */
+JobObject::~JobObject()
+{
+  Close();
+}
+
+/**
+ * \brief returns whether this object does not represent a valid job
+ */
+bool JobObject::IsNull() const
+{
+  return !d;
+}
+
+/**
+ * \brief limits the memory that each process in the job can commit
+ * \param bytes  the maximum committed memory, in bytes
+ * \throw Exception on failure
+ *
+ * A process that exceeds the limit fails to allocate more memory and a
+ * ProcessMemoryLimit notification is emitted.
+ * On Linux, the limit is the size of the address space of the process
+ * (RLIMIT_AS) and no notification is emitted.
+ */
+void JobObject::SetProcessMemoryLimit(size_t bytes)
+{
+  Impl::set_process_memory_limit(*d, bytes);
+}
+
+/**
+ * \brief limits the memory that all processes in the job can commit together
+ * \param bytes  the maximum committed memory, in bytes
+ * \throw Exception on failure, and with ERROR_NOT_SUPPORTED on Linux
+ */
+void JobObject::SetJobMemoryLimit(size_t bytes)
+{
+  Impl::set_job_memory_limit(*d, bytes);
+}
+
+/**
+ * \brief limits the number of processes that can be active at the same time in the job
+ * \param count  the maximum number of processes
+ * \throw Exception on failure
+ *
+ * A process that would exceed the limit is not started and an ActiveProcessLimit
+ * notification is emitted.
+ */
+void JobObject::SetActiveProcessLimit(int count)
+{
+  Impl::set_active_process_limit(*d, count);
+}
+
+/**
+ * \brief limits the cpu time that each process in the job can use
+ * \param time  the maximum cpu time
+ * \throw Exception on failure
+ *
+ * A process that exceeds the limit is terminated and an EndOfProcessTime
+ * notification is emitted.
+ * On Windows only the time spent in user mode is counted. On Linux the limit
+ * is rounded up to whole seconds (RLIMIT_CPU).
+ */
+void JobObject::SetProcessTimeLimit(std::chrono::milliseconds time)
+{
+  Impl::set_process_time_limit(*d, time);
+}
+
+/**
+ * \brief caps the cpu usage of the job
+ * \param percent  the maximum share of the total cpu time, between 1 and 100
+ * \throw Exception on failure, and with ERROR_NOT_SUPPORTED on Linux
+ *
+ * The cap is a hard limit: the processes of the job are not scheduled once the
+ * cap is reached, even if the system is otherwise idle.
+ */
+void JobObject::SetCpuRateLimit(int percent)
+{
+  Impl::set_cpu_rate_limit(*d, percent);
+}
+
+/**
+ * \brief specifies whether the processes of the job are terminated when the job is closed
+ * \throw Exception on failure
+ *
+ * Because the job is also closed when the current process exits, this ensures that
+ * no child process outlives its parent.
+ * On Linux, the processes started in the job while this option is set are
+ * killed when the thread that started them exits (PR_SET_PDEATHSIG); the
+ * other processes of the job are only killed by Close().
+ */
+void JobObject::SetKillOnClose(bool on)
+{
+  Impl::set_kill_on_close(*d, on);
+}
+
+#ifndef _WIN32
+
+/**
+ * \brief limits the number of files that each process in the job can open
+ * \param count  the maximum number of file descriptors
+ * \throw Exception on failure
+ *
+ * Windows jobs have no limit on the number of handles.
+ */
+void JobObject::SetFileDescriptorLimit(int count)
+{
+  Impl::set_file_descriptor_limit(*d, count);
+}
+
+#endif // !_WIN32
+
+/**
+ * \brief adds a running process to the job
+ * \param process  the process
+ * \throw Exception on failure
+ *
+ * Processes created by \a process before this call are not added to the job.
+ * Use Process::SetJobObject() to add a process to the job before it starts.
+ */
+void JobObject::AssignProcess(const Process& process)
+{
+  Impl::assign_process(*d, *process.GetImpl());
+}
+
+/**
+ * \brief terminates all the processes in the job
+ * \param exitCode  the exit code used by the processes
+ *
+ * On Linux, the processes are killed with SIGKILL and \a exitCode is ignored.
+ */
+bool JobObject::Terminate(int exitCode)
+{
+  return d && Impl::terminate_job(*d, exitCode);
+}
+
+/**
+ * \brief sets the function called when the job emits a notification
+ * \param callback  the callback
+ * \throw Exception on failure
+ *
+ * Notifications include limit violations and the creation and termination
+ * of processes in the job.
+ * The callback is invoked from a thread owned by the job object, which blocks
+ * until the system posts a notification.
+ * The callback may call SetNotificationCallback() or Close(); a callback that
+ * is replaced may still be running when this function returns.
+ *
+ * On Linux, the thread waits for the exit of the processes of the job:
+ * a process killed by a signal emits AbnormalExitProcess, or EndOfProcessTime
+ * if it exceeded its cpu time limit.
+ */
+void JobObject::SetNotificationCallback(NotificationCallback callback)
+{
+  {
+    std::lock_guard<std::mutex> lock{ d->callback_mutex };
+    d->callback = std::move(callback);
+  }
+
+  if (!d->listener.joinable()) {
+    Impl::start_listener(*d);
+  }
+}
+
+/**
+ * \brief closes the job object
+ *
+ * \sa SetKillOnClose().
+ */
+void JobObject::Close()
+{
+  if (!d) {
+    return;
+  }
+
+  if (d->listener.get_id() == std::this_thread::get_id())
+  {
+    // called from the callback: the listener cannot be joined, it frees the
+    // job once the callback returns
+    Impl::JobObjectPriv* job = d.release();
+    Impl::release_job(*job);
+    job->listener.detach();
+    job->closed_by_listener = true;
+    return;
+  }
+
+  Impl::stop_listener(*d);
+  Impl::release_job(*d);
+  d.reset();
+}
+
+JobObject& JobObject::operator=(JobObject&& other) noexcept
+{
+  if (d != other.d) {
+    Close();
+    d = std::move(other.d);
+  }
+
+  return *this;
+}
+
+Impl::JobObjectPriv* JobObject::GetImpl() const
+{
+  return d.get();
+}
+
+#ifdef _WIN32
+
+HANDLE GetHANDLE(const JobObject& job)
+{
+  return job.GetImpl() ? job.GetImpl()->handle : nullptr;
+}
+
+#endif // _WIN32
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,102 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_JOBOBJECT_H
+#define WINAPI_JOBOBJECT_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace Win32
+{
+
+class Process;
+
+namespace Impl
+{
+struct JobObjectPriv;
+} // namespace Impl
+
+/**
+ * \brief groups processes under a common set of resource limits
+ *
+ * Processes can be added to a job either by calling Process::SetJobObject()
+ * before the process is started, or by calling AssignProcess() on a
+ * running process.
+ * The limits apply to every process in the job, including the processes
+ * that they create.
+ *
+ * Limit violations are reported through the callback set with
+ * SetNotificationCallback().
+ *
+ * On Linux, the job is implemented by the library rather than by the kernel:
+ * the limits are resource limits (see setrlimit()) applied to each process of
+ * the job, and only the processes started in the job or assigned to it
+ * belong to it. The processes that they create inherit the limits but are
+ * not counted, notified or terminated with the job.
+ * A job-wide memory limit and a cpu rate limit would require cgroups and
+ * are not supported.
+ */
+class JobObject
+{
+public:
+  JobObject();
+  JobObject(const JobObject&) = delete;
+  JobObject(JobObject&&) noexcept;
+  ~JobObject();
+
+  enum NotificationType
+  {
+    EndOfJobTime = 1,
+    EndOfProcessTime = 2,
+    ActiveProcessLimit = 3,
+    ActiveProcessZero = 4,
+    NewProcess = 6,
+    ExitProcess = 7,
+    AbnormalExitProcess = 8,
+    ProcessMemoryLimit = 9,
+    JobMemoryLimit = 10,
+  };
+
+  struct Notification
+  {
+    NotificationType type;
+    unsigned long processId;
+  };
+
+  using NotificationCallback = std::function<void(const Notification&)>;
+
+  bool IsNull() const;
+
+  void SetProcessMemoryLimit(size_t bytes);
+  void SetJobMemoryLimit(size_t bytes);
+  void SetActiveProcessLimit(int count);
+  void SetProcessTimeLimit(std::chrono::milliseconds time);
+  void SetCpuRateLimit(int percent);
+  void SetKillOnClose(bool on = true);
+#ifndef _WIN32
+  void SetFileDescriptorLimit(int count);
+#endif // !_WIN32
+
+  void AssignProcess(const Process& process);
+  bool Terminate(int exitCode);
+
+  void SetNotificationCallback(NotificationCallback callback);
+
+  void Close();
+
+  JobObject& operator=(const JobObject&) = delete;
+  JobObject& operator=(JobObject&&) noexcept;
+
+  Impl::JobObjectPriv* GetImpl() const;
+
+private:
+  std::unique_ptr<Impl::JobObjectPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_JOBOBJECT_H
\ No newline at end of file
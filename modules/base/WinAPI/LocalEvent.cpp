@@ -0,0 +1,147 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "LocalEvent.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+void wake_by_address_all(void* address)
+{
+  ::WakeByAddressAll(address);
+}
+
+void wake_by_address_single(void* address)
+{
+  ::WakeByAddressSingle(address);
+}
+
+// blocks while the word at address is equal to expected, at most for the
+// given time; may return spuriously
+void wait_on_address(std::atomic<uint32_t>& address, uint32_t expected, std::chrono::milliseconds timeout, bool infinite)
+{
+  DWORD milliseconds = INFINITE;
+
+  if (!infinite) {
+    // INFINITE must not be reached by a finite timeout
+    milliseconds = static_cast<DWORD>((std::min)(timeout.count(), static_cast<std::chrono::milliseconds::rep>(INFINITE - 1)));
+  }
+
+  ::WaitOnAddress(&address, &expected, sizeof(expected), milliseconds);
+}
+
+#else
+
+// the event is not shared with other processes, so the private futex
+// operations are used, which do not look up the memory mapping
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+  "the state of an event must be usable as a futex");
+
+void wake_by_address_all(void* address)
+{
+  ::syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void wake_by_address_single(void* address)
+{
+  ::syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void wait_on_address(std::atomic<uint32_t>& address, uint32_t expected, std::chrono::milliseconds timeout, bool infinite)
+{
+  struct timespec relative = {};
+  relative.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  relative.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+
+  // EINTR, EAGAIN and ETIMEDOUT are handled by the caller, which reads the state again
+  ::syscall(SYS_futex, &address, FUTEX_WAIT_PRIVATE, expected, infinite ? nullptr : &relative, nullptr, 0);
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+// slow path of Wait() and WaitFor(), blocks on the state word with
+// WaitOnAddress() or a futex
+bool LocalEvent::wait(std::chrono::milliseconds timeout, bool infinite)
+{
+  constexpr uint32_t generation_mask = ~uint32_t(SetBit | WaitersBit);
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  uint32_t state = m_state.load(std::memory_order_acquire);
+  bool blocked = false;
+
+  for (;;)
+  {
+    if (state & SetBit)
+    {
+      if (m_mode == Event::ManualReset) {
+        return true;
+      }
+
+      // consume the signal; a thread that has blocked keeps the waiters bit
+      // as other threads may still be blocked on the event
+      uint32_t new_state = state & ~uint32_t(SetBit);
+
+      if (blocked) {
+        new_state |= WaitersBit;
+      }
+
+      if (m_state.compare_exchange_weak(state, new_state, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return true;
+      }
+
+      continue;
+    }
+
+    std::chrono::milliseconds remaining(0);
+
+    if (!infinite)
+    {
+      remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+
+      if (remaining.count() <= 0) {
+        return false;
+      }
+    }
+
+    if (!(state & WaitersBit))
+    {
+      // Set() must know that it has to wake us
+      if (!m_state.compare_exchange_weak(state, state | WaitersBit, std::memory_order_relaxed, std::memory_order_relaxed)) {
+        continue;
+      }
+
+      state |= WaitersBit;
+    }
+
+    Impl::wait_on_address(m_state, state, remaining, infinite);
+    blocked = true;
+
+    const uint32_t current = m_state.load(std::memory_order_acquire);
+
+    if (m_mode == Event::ManualReset && (current & generation_mask) != (state & generation_mask)) {
+      // the event was set while we were blocked, even if it was reset since then
+      return true;
+    }
+
+    state = current;
+  }
+}
+
+} // namespace Win32
\ No newline at end of file
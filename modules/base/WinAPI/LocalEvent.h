@@ -0,0 +1,173 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_LOCALEVENT_H
+#define WINAPI_LOCALEVENT_H
+
+#include "Event.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Win32
+{
+
+namespace Impl
+{
+void wake_by_address_all(void* address);
+void wake_by_address_single(void* address);
+} // namespace Impl
+
+/**
+ * \brief an unnamed event for synchronizing the threads of a process
+ *
+ * This class provides the same set/wait semantics as Event but does not use
+ * a kernel object: its state is a single 32-bit word.
+ * Setting, resetting and testing the event never enter the kernel, unless
+ * a thread is actually blocked in Wait() (in which case Set() has to wake it).
+ *
+ * Blocking is implemented with WaitOnAddress(), or a futex on Linux.
+ */
+class LocalEvent
+{
+public:
+  explicit LocalEvent(Event::ResetMode mode = Event::ManualReset, bool initialState = false);
+  LocalEvent(const LocalEvent&) = delete;
+  ~LocalEvent() = default;
+
+  Event::ResetMode GetResetMode() const;
+
+  bool IsSet() const;
+
+  void Set();
+  void Reset();
+
+  void Wait();
+  bool WaitFor(std::chrono::milliseconds timeout);
+
+  LocalEvent& operator=(const LocalEvent&) = delete;
+
+private:
+  bool wait(std::chrono::milliseconds timeout, bool infinite);
+
+private:
+  // bit 0: the event is set
+  // bit 1: at least one thread may be blocked on the event
+  // bits 2-31: number of times a manual-reset event was set (wraps around)
+  enum StateBits : uint32_t
+  {
+    SetBit = 1,
+    WaitersBit = 2,
+    GenerationIncrement = 4,
+  };
+
+  std::atomic<uint32_t> m_state;
+  Event::ResetMode m_mode;
+};
+
+/**
+ * \brief constructs an event
+ * \param mode          whether the event is reset manually or automatically
+ * \param initialState  whether the event is initially set
+ */
+inline LocalEvent::LocalEvent(Event::ResetMode mode, bool initialState)
+  : m_state(initialState ? uint32_t(SetBit) : 0),
+    m_mode(mode)
+{
+
+}
+
+/**
+ * \brief returns whether the event is reset manually or automatically
+ */
+inline Event::ResetMode LocalEvent::GetResetMode() const
+{
+  return m_mode;
+}
+
+/**
+ * \brief returns whether the event is set
+ */
+inline bool LocalEvent::IsSet() const
+{
+  return m_state.load(std::memory_order_acquire) & SetBit;
+}
+
+/**
+ * \brief sets the event
+ *
+ * For a manual-reset event, all the waiting threads are released.
+ * For an auto-reset event, a single waiting thread is released.
+ *
+ * This does not enter the kernel if no thread is blocked on the event.
+ */
+inline void LocalEvent::Set()
+{
+  uint32_t state = m_state.load(std::memory_order_relaxed);
+  uint32_t new_state;
+
+  do
+  {
+    if (state & SetBit) {
+      return;
+    }
+
+    new_state = (state | SetBit) & ~uint32_t(WaitersBit);
+
+    if (m_mode == Event::ManualReset) {
+      new_state += GenerationIncrement;
+    }
+  } while (!m_state.compare_exchange_weak(state, new_state, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  if (state & WaitersBit)
+  {
+    if (m_mode == Event::ManualReset) {
+      Impl::wake_by_address_all(&m_state);
+    } else {
+      Impl::wake_by_address_single(&m_state);
+    }
+  }
+}
+
+/**
+ * \brief resets the event
+ */
+inline void LocalEvent::Reset()
+{
+  m_state.fetch_and(~uint32_t(SetBit), std::memory_order_relaxed);
+}
+
+/**
+ * \brief waits until the event is set
+ *
+ * For an auto-reset event, the event is reset when this function returns.
+ */
+inline void LocalEvent::Wait()
+{
+  if (m_mode == Event::ManualReset && IsSet()) {
+    return;
+  }
+
+  wait(std::chrono::milliseconds(0), true);
+}
+
+/**
+ * \brief waits until the event is set or a timeout expires
+ * \param timeout  the maximum waiting time
+ *
+ * Returns true if the event was set before the timeout expired.
+ */
+inline bool LocalEvent::WaitFor(std::chrono::milliseconds timeout)
+{
+  if (m_mode == Event::ManualReset && IsSet()) {
+    return true;
+  }
+
+  return wait(timeout, false);
+}
+
+} // namespace Win32
+
+#endif // WINAPI_LOCALEVENT_H
\ No newline at end of file
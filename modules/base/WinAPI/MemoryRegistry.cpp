@@ -0,0 +1,1049 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "MemoryRegistry.h"
+#include "registry_priv.h"
+
+#include "utf16_priv.h"
+
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+struct memory_registry_value
+{
+  std::string name;
+  // the name returned by EnumValue()
+  std::u16string wide_name;
+  Registry::ValueType type = Registry::None;
+  std::vector<unsigned char> data;
+};
+
+struct memory_registry_node;
+
+// A watch is owned by its handle; the node of a key that is destroyed while
+// it is watched is reset.
+struct memory_registry_watch
+{
+  memory_registry_node* node = nullptr;
+  std::function<void()> callback;
+  // number of calls of the callback that are about to start or running
+  std::atomic<uint32_t> running{ 0 };
+};
+
+// The keys of the hash tables are views on the names stored in the
+// subkeys and values, which are never moved.
+// The subkeys and values are also listed in creation order, for the
+// enumeration functions.
+struct memory_registry_node
+{
+  std::string name;
+  std::u16string wide_name;
+  memory_registry_node* parent = nullptr;
+  std::unordered_map<std::string_view, std::unique_ptr<memory_registry_node>, registry_name_hash, registry_name_equal> subkeys;
+  std::unordered_map<std::string_view, std::unique_ptr<memory_registry_value>, registry_name_hash, registry_name_equal> values;
+  std::vector<memory_registry_node*> subkey_list;
+  std::vector<memory_registry_value*> value_list;
+  std::vector<memory_registry_watch*> watches;
+  // number of open handles to the key
+  std::atomic<uint32_t> handles{ 0 };
+  bool deleted = false;
+
+  ~memory_registry_node();
+};
+
+// called with the exclusive lock
+memory_registry_node::~memory_registry_node()
+{
+  for (memory_registry_watch* w : watches) {
+    w->node = nullptr;
+  }
+}
+
+struct MemoryRegistryPriv
+{
+  std::shared_mutex mutex;
+  memory_registry_node roots[RegistryBackend::Users + 1];
+  // deleted keys that still have open handles
+  std::unordered_map<memory_registry_node*, std::unique_ptr<memory_registry_node>> deleted_keys;
+  // signaled when a callback returns, see UnwatchKey()
+  std::mutex callback_mutex;
+  std::condition_variable callback_done;
+};
+
+// Calls the callbacks of the watches of the modified keys when it is
+// destroyed, which must happen once the lock of the registry is released
+// so that the callbacks can use the registry.
+class memory_registry_notifier
+{
+public:
+  explicit memory_registry_notifier(MemoryRegistryPriv& registry);
+  memory_registry_notifier(const memory_registry_notifier&) = delete;
+  ~memory_registry_notifier();
+
+  void add(const memory_registry_node& node);
+
+  memory_registry_notifier& operator=(const memory_registry_notifier&) = delete;
+
+private:
+  MemoryRegistryPriv& m_registry;
+  std::vector<memory_registry_watch*> m_watches;
+};
+
+memory_registry_notifier::memory_registry_notifier(MemoryRegistryPriv& registry)
+  : m_registry(registry)
+{
+
+}
+
+memory_registry_notifier::~memory_registry_notifier()
+{
+  for (memory_registry_watch* w : m_watches)
+  {
+    w->callback();
+
+    if (w->running.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      std::lock_guard<std::mutex> lock{ m_registry.callback_mutex };
+      m_registry.callback_done.notify_all();
+    }
+  }
+}
+
+// called with the exclusive lock, which prevents UnwatchKey() from
+// removing the watches before they are marked as running
+void memory_registry_notifier::add(const memory_registry_node& node)
+{
+  for (memory_registry_watch* w : node.watches)
+  {
+    w->running.fetch_add(1, std::memory_order_relaxed);
+    m_watches.push_back(w);
+  }
+}
+
+// A handle is the address of a node, whose lowest bits store the access
+// rights of the handle.
+constexpr uintptr_t memory_key_query_value = 1;
+constexpr uintptr_t memory_key_set_value = 2;
+constexpr uintptr_t memory_key_access_mask = memory_key_query_value | memory_key_set_value;
+
+static_assert(alignof(memory_registry_node) > memory_key_access_mask, "the lowest bits of the address of a node must be 0");
+
+uintptr_t get_memory_key_access(Registry::AccessRights accessRights)
+{
+  // KEY_QUERY_VALUE and KEY_SET_VALUE
+  uintptr_t access = 0;
+
+  if (accessRights & 0x0001) {
+    access |= memory_key_query_value;
+  }
+
+  if (accessRights & 0x0002) {
+    access |= memory_key_set_value;
+  }
+
+  return access;
+}
+
+RegistryBackend::KeyHandle make_memory_key_handle(memory_registry_node* node, uintptr_t access)
+{
+  return reinterpret_cast<RegistryBackend::KeyHandle>(reinterpret_cast<uintptr_t>(node) | access);
+}
+
+memory_registry_node* get_memory_key_node(RegistryBackend::KeyHandle handle)
+{
+  return reinterpret_cast<memory_registry_node*>(reinterpret_cast<uintptr_t>(handle) & ~memory_key_access_mask);
+}
+
+bool has_memory_key_access(RegistryBackend::KeyHandle handle, uintptr_t access)
+{
+  return (reinterpret_cast<uintptr_t>(handle) & access) == access;
+}
+
+// calls f on each non-empty component of a backslash-separated path,
+// until f returns false
+template<typename F>
+void for_each_registry_path_component(std::string_view path, F&& f)
+{
+  while (!path.empty())
+  {
+    const size_t separator = path.find('\\');
+    std::string_view component = path.substr(0, separator);
+
+    if (!component.empty() && !f(component)) {
+      return;
+    }
+
+    if (separator == std::string_view::npos) {
+      return;
+    }
+
+    path.remove_prefix(separator + 1);
+  }
+}
+
+memory_registry_node* find_memory_key(memory_registry_node* node, std::string_view path)
+{
+  for_each_registry_path_component(path, [&node](std::string_view name) {
+    auto it = node->subkeys.find(name);
+    node = (it != node->subkeys.end()) ? it->second.get() : nullptr;
+    return node != nullptr;
+  });
+
+  return node;
+}
+
+// creates the missing keys of a path; the keys that are created are appended
+// to created_keys if it is not null
+memory_registry_node* create_memory_key(memory_registry_node* node, std::string_view path, bool& created, std::vector<memory_registry_node*>* created_keys)
+{
+  created = false;
+
+  for_each_registry_path_component(path, [&](std::string_view name) {
+    auto it = node->subkeys.find(name);
+
+    if (it != node->subkeys.end())
+    {
+      node = it->second.get();
+      created = false;
+    }
+    else
+    {
+      auto child = std::make_unique<memory_registry_node>();
+      child->name = std::string(name);
+      child->wide_name = utf8_to_utf16(child->name);
+      child->parent = node;
+      memory_registry_node* child_ptr = child.get();
+      node->subkeys.emplace(std::string_view(child_ptr->name), std::move(child));
+      node->subkey_list.push_back(child_ptr);
+      node = child_ptr;
+      created = true;
+
+      if (created_keys) {
+        created_keys->push_back(child_ptr);
+      }
+    }
+
+    return true;
+  });
+
+  return node;
+}
+
+// removes a key from its parent, returns its position in the list of subkeys of the parent
+std::unique_ptr<memory_registry_node> unlink_memory_key(memory_registry_node* node, size_t& position)
+{
+  memory_registry_node* parent_node = node->parent;
+  auto it = parent_node->subkeys.find(node->name);
+  std::unique_ptr<memory_registry_node> owned = std::move(it->second);
+  parent_node->subkeys.erase(it);
+  auto list_it = std::find(parent_node->subkey_list.begin(), parent_node->subkey_list.end(), node);
+  position = static_cast<size_t>(list_it - parent_node->subkey_list.begin());
+  parent_node->subkey_list.erase(list_it);
+  node->parent = nullptr;
+  return owned;
+}
+
+// checks that a key exists and can be deleted
+ErrorCode check_memory_key_deletion(const memory_registry_node* node)
+{
+  if (!node) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  }
+
+  if (!node->parent || !node->subkeys.empty()) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  }
+
+  return ErrorCode();
+}
+
+// called once a key has been unlinked; the key is kept until its handles are closed
+void retire_memory_key(MemoryRegistryPriv& registry, std::unique_ptr<memory_registry_node> owned, memory_registry_notifier& notifier)
+{
+  memory_registry_node* node = owned.get();
+  notifier.add(*node);
+
+  if (node->handles.load(std::memory_order_relaxed) > 0)
+  {
+    node->deleted = true;
+    registry.deleted_keys.emplace(node, std::move(owned));
+  }
+}
+
+memory_registry_value* find_or_create_memory_value(memory_registry_node* node, const std::string& name, bool& created)
+{
+  auto it = node->values.find(name);
+  created = (it == node->values.end());
+
+  if (created)
+  {
+    auto value = std::make_unique<memory_registry_value>();
+    value->name = name;
+    value->wide_name = utf8_to_utf16(name);
+    memory_registry_value* value_ptr = value.get();
+    it = node->values.emplace(std::string_view(value_ptr->name), std::move(value)).first;
+    node->value_list.push_back(value_ptr);
+  }
+
+  return it->second.get();
+}
+
+void remove_memory_value(memory_registry_node* node, memory_registry_value* value)
+{
+  node->value_list.erase(std::find(node->value_list.begin(), node->value_list.end(), value));
+  node->values.erase(value->name);
+}
+
+// removes a value from its key without destroying it, position receives
+// its index in the enumeration order
+std::unique_ptr<memory_registry_value> unlink_memory_value(memory_registry_node* node, memory_registry_value* value, size_t& position)
+{
+  auto list_it = std::find(node->value_list.begin(), node->value_list.end(), value);
+  position = static_cast<size_t>(list_it - node->value_list.begin());
+  node->value_list.erase(list_it);
+
+  auto it = node->values.find(value->name);
+  std::unique_ptr<memory_registry_value> result = std::move(it->second);
+  node->values.erase(it);
+  return result;
+}
+
+// how to revert a modification made by ApplyBatch()
+struct memory_registry_undo
+{
+  enum Kind
+  {
+    CreatedKey,
+    DeletedKey,
+    AddedValue,
+    ReplacedValue,
+    DeletedValue,
+  };
+
+  Kind kind;
+  memory_registry_node* node = nullptr;
+  // DeletedKey
+  memory_registry_node* parent = nullptr;
+  std::unique_ptr<memory_registry_node> deleted_key;
+  // DeletedKey and DeletedValue
+  size_t position = 0;
+  // AddedValue and ReplacedValue
+  memory_registry_value* value = nullptr;
+  Registry::ValueType type = Registry::None;
+  std::vector<unsigned char> data;
+  // DeletedValue
+  std::unique_ptr<memory_registry_value> deleted_value;
+};
+
+void undo_memory_registry_modification(memory_registry_undo& undo)
+{
+  switch (undo.kind)
+  {
+  case memory_registry_undo::CreatedKey:
+  {
+    // the subkeys and values of the key have been removed before
+    size_t position = 0;
+    unlink_memory_key(undo.node, position);
+    break;
+  }
+  case memory_registry_undo::DeletedKey:
+  {
+    memory_registry_node* node = undo.deleted_key.get();
+    node->parent = undo.parent;
+    undo.parent->subkeys.emplace(std::string_view(node->name), std::move(undo.deleted_key));
+    undo.parent->subkey_list.insert(undo.parent->subkey_list.begin() + undo.position, node);
+    break;
+  }
+  case memory_registry_undo::AddedValue:
+    remove_memory_value(undo.node, undo.value);
+    break;
+  case memory_registry_undo::ReplacedValue:
+    undo.value->type = undo.type;
+    undo.value->data.swap(undo.data);
+    break;
+  case memory_registry_undo::DeletedValue:
+  {
+    memory_registry_value* value = undo.deleted_value.get();
+    undo.node->values.emplace(std::string_view(value->name), std::move(undo.deleted_value));
+    undo.node->value_list.insert(undo.node->value_list.begin() + undo.position, value);
+    break;
+  }
+  }
+}
+
+} // namespace Impl
+
+/**
+ * \brief constructs an empty registry
+ */
+MemoryRegistry::MemoryRegistry()
+  : d(std::make_unique<Impl::MemoryRegistryPriv>())
+{
+  d->roots[ClassesRoot].name = "HKEY_CLASSES_ROOT";
+  d->roots[CurrentConfig].name = "HKEY_CURRENT_CONFIG";
+  d->roots[CurrentUser].name = "HKEY_CURRENT_USER";
+  d->roots[LocalMachine].name = "HKEY_LOCAL_MACHINE";
+  d->roots[Users].name = "HKEY_USERS";
+
+  for (Impl::memory_registry_node& root : d->roots) {
+    root.wide_name = Impl::utf8_to_utf16(root.name);
+  }
+}
+
+MemoryRegistry::~MemoryRegistry()
+{
+
+}
+
+/**
+ * \brief returns a handle to one of the root keys
+ * 
+ * The handle does not need to be closed.
+ */
+RegistryBackend::KeyHandle MemoryRegistry::GetPredefinedKey(PredefinedKey key)
+{
+  if (key < ClassesRoot || key > Users) {
+    return nullptr;
+  }
+
+  return Impl::make_memory_key_handle(&d->roots[key], Impl::memory_key_access_mask);
+}
+
+/**
+ * \brief opens a key
+ */
+ErrorCode MemoryRegistry::OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result)
+{
+  result = nullptr;
+
+  if (!parent) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  std::shared_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(parent);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  node = Impl::find_memory_key(node, subKey);
+
+  if (!node) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  }
+
+  // keys are only deleted with an exclusive lock, which cannot happen concurrently
+  node->handles.fetch_add(1, std::memory_order_relaxed);
+  result = Impl::make_memory_key_handle(node, Impl::get_memory_key_access(accessRights));
+  return ErrorCode();
+}
+
+/**
+ * \brief creates a key and its missing parents, or opens the key if it exists
+ */
+ErrorCode MemoryRegistry::CreateKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result, bool& created)
+{
+  result = nullptr;
+  created = false;
+
+  if (!parent) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  std::unique_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(parent);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  constexpr std::vector<Impl::memory_registry_node*>* created_keys = nullptr;
+  node = Impl::create_memory_key(node, subKey, created, created_keys);
+  node->handles.fetch_add(1, std::memory_order_relaxed);
+  result = Impl::make_memory_key_handle(node, Impl::get_memory_key_access(accessRights));
+  return ErrorCode();
+}
+
+/**
+ * \brief deletes a key that has no subkeys
+ * 
+ * The open handles to the key remain valid, but most operations on them
+ * fail with ERROR_KEY_DELETED.
+ */
+ErrorCode MemoryRegistry::DeleteKey(KeyHandle parent, const std::string& subKey)
+{
+  if (!parent) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  Impl::memory_registry_notifier notifier{ *d };
+  std::unique_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(parent);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  node = Impl::find_memory_key(node, subKey);
+  ErrorCode err = Impl::check_memory_key_deletion(node);
+
+  if (err) {
+    return err;
+  }
+
+  size_t position = 0;
+  Impl::retire_memory_key(*d, Impl::unlink_memory_key(node, position), notifier);
+  return ErrorCode();
+}
+
+/**
+ * \brief closes a key
+ */
+void MemoryRegistry::CloseKey(KeyHandle key)
+{
+  if (!key) {
+    return;
+  }
+
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  {
+    std::shared_lock<std::shared_mutex> lock{ d->mutex };
+
+    if (node->handles.fetch_sub(1, std::memory_order_acq_rel) != 1 || !node->deleted) {
+      return;
+    }
+  }
+
+  // this was the last handle to a deleted key, which cannot be opened again
+  std::unique_lock<std::shared_mutex> lock{ d->mutex };
+  d->deleted_keys.erase(node);
+}
+
+/**
+ * \brief writes a value
+ * 
+ * The key must have been opened with write access.
+ */
+ErrorCode MemoryRegistry::SetValue(KeyHandle key, const std::string& name, Registry::ValueType type, const void* data, size_t size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (!Impl::has_memory_key_access(key, Impl::memory_key_set_value)) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  }
+
+  const auto* bytes = static_cast<const unsigned char*>(data);
+
+  Impl::memory_registry_notifier notifier{ *d };
+  std::unique_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  bool created = false;
+  Impl::memory_registry_value* value = Impl::find_or_create_memory_value(node, name, created);
+  value->type = type;
+  value->data.assign(bytes, bytes + size);
+  notifier.add(*node);
+  return ErrorCode();
+}
+
+/**
+ * \brief removes a value
+ *
+ * The key must have been opened with write access.
+ */
+ErrorCode MemoryRegistry::DeleteValue(KeyHandle key, const std::string& name)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (!Impl::has_memory_key_access(key, Impl::memory_key_set_value)) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  }
+
+  Impl::memory_registry_notifier notifier{ *d };
+  std::unique_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  auto it = node->values.find(name);
+
+  if (it == node->values.end()) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  }
+
+  Impl::remove_memory_value(node, it->second.get());
+  notifier.add(*node);
+  return ErrorCode();
+}
+
+/**
+ * \brief reads a value
+ * 
+ * If \a data is not nullptr, \a size must be the size of the buffer and the
+ * function fails with ERROR_MORE_DATA if the buffer is too small.
+ * In all cases, \a size receives the size of the value.
+ * 
+ * The key must have been opened with read access.
+ */
+ErrorCode MemoryRegistry::GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (!Impl::has_memory_key_access(key, Impl::memory_key_query_value)) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  }
+
+  if (data && !size) {
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+
+  std::shared_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  auto it = node->values.find(name);
+
+  if (it == node->values.end()) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  }
+
+  const Impl::memory_registry_value& value = *it->second;
+
+  if (type) {
+    *type = value.type;
+  }
+
+  if (data)
+  {
+    if (*size < value.data.size())
+    {
+      *size = value.data.size();
+      return ErrorCode(ERROR_MORE_DATA);
+    }
+
+    if (!value.data.empty()) {
+      std::memcpy(data, value.data.data(), value.data.size());
+    }
+  }
+
+  if (size) {
+    *size = value.data.size();
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief applies a list of modifications atomically
+ * 
+ * The modifications are applied with the exclusive lock and are reverted if
+ * one of them fails, so that either all of them or none of them are visible.
+ * The watches are notified once all the modifications succeeded.
+ * 
+ * The key must have been opened with write access.
+ */
+ErrorCode MemoryRegistry::ApplyBatch(KeyHandle key, const WriteOperation* operations, size_t count)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (!Impl::has_memory_key_access(key, Impl::memory_key_set_value)) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  }
+
+  Impl::memory_registry_notifier notifier{ *d };
+  std::unique_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* root = Impl::get_memory_key_node(key);
+
+  if (root->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  std::vector<Impl::memory_registry_undo> undo_log;
+  std::vector<Impl::memory_registry_node*> modified_keys;
+  std::vector<Impl::memory_registry_node*> created_keys;
+  ErrorCode err;
+
+  for (size_t i(0); i < count && !err; ++i)
+  {
+    const WriteOperation& op = operations[i];
+
+    if (op.kind == WriteOperation::CreateKeyOperation)
+    {
+      bool created = false;
+      created_keys.clear();
+      Impl::create_memory_key(root, *op.subKey, created, &created_keys);
+
+      for (Impl::memory_registry_node* node : created_keys)
+      {
+        Impl::memory_registry_undo& undo = undo_log.emplace_back();
+        undo.kind = Impl::memory_registry_undo::CreatedKey;
+        undo.node = node;
+      }
+    }
+    else if (op.kind == WriteOperation::DeleteKeyOperation)
+    {
+      Impl::memory_registry_node* node = Impl::find_memory_key(root, *op.subKey);
+      err = Impl::check_memory_key_deletion(node);
+
+      if (!err)
+      {
+        Impl::memory_registry_undo& undo = undo_log.emplace_back();
+        undo.kind = Impl::memory_registry_undo::DeletedKey;
+        undo.parent = node->parent;
+        undo.deleted_key = Impl::unlink_memory_key(node, undo.position);
+      }
+    }
+    else if (op.kind == WriteOperation::DeleteValueOperation)
+    {
+      Impl::memory_registry_node* node = Impl::find_memory_key(root, *op.subKey);
+
+      if (!node)
+      {
+        err = ErrorCode(ERROR_FILE_NOT_FOUND);
+        break;
+      }
+
+      auto it = node->values.find(*op.name);
+
+      if (it == node->values.end())
+      {
+        err = ErrorCode(ERROR_FILE_NOT_FOUND);
+        break;
+      }
+
+      Impl::memory_registry_undo& undo = undo_log.emplace_back();
+      undo.kind = Impl::memory_registry_undo::DeletedValue;
+      undo.node = node;
+      undo.deleted_value = Impl::unlink_memory_value(node, it->second.get(), undo.position);
+      modified_keys.push_back(node);
+    }
+    else
+    {
+      Impl::memory_registry_node* node = Impl::find_memory_key(root, *op.subKey);
+
+      if (!node)
+      {
+        err = ErrorCode(ERROR_FILE_NOT_FOUND);
+        break;
+      }
+
+      bool created = false;
+      Impl::memory_registry_value* value = Impl::find_or_create_memory_value(node, *op.name, created);
+      Impl::memory_registry_undo& undo = undo_log.emplace_back();
+      undo.kind = created ? Impl::memory_registry_undo::AddedValue : Impl::memory_registry_undo::ReplacedValue;
+      undo.node = node;
+      undo.value = value;
+      undo.type = value->type;
+      undo.data.swap(value->data);
+
+      const auto* bytes = static_cast<const unsigned char*>(op.data);
+      value->type = op.type;
+      value->data.assign(bytes, bytes + op.size);
+      modified_keys.push_back(node);
+    }
+  }
+
+  if (err)
+  {
+    for (auto it = undo_log.rbegin(); it != undo_log.rend(); ++it) {
+      Impl::undo_memory_registry_modification(*it);
+    }
+
+    return err;
+  }
+
+  // the modified keys are notified before the deleted keys are destroyed
+  for (Impl::memory_registry_node* node : modified_keys) {
+    notifier.add(*node);
+  }
+
+  for (Impl::memory_registry_undo& undo : undo_log)
+  {
+    if (undo.kind == Impl::memory_registry_undo::DeletedKey) {
+      Impl::retire_memory_key(*d, std::move(undo.deleted_key), notifier);
+    }
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief reads several values of a key at once
+ * 
+ * The values are read atomically with respect to the modifications of the registry.
+ */
+ErrorCode MemoryRegistry::GetValues(KeyHandle key, ValueQuery* values, size_t count, void* buffer, size_t& size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (!Impl::has_memory_key_access(key, Impl::memory_key_query_value)) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  }
+
+  std::shared_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  const size_t capacity = buffer ? size : 0;
+  size_t offset = 0;
+
+  for (size_t i(0); i < count; ++i)
+  {
+    ValueQuery& query = values[i];
+    auto it = node->values.find(*query.name);
+    query.offset = offset;
+
+    if (it == node->values.end())
+    {
+      query.found = false;
+      query.type = Registry::None;
+      query.size = 0;
+      continue;
+    }
+
+    const Impl::memory_registry_value& value = *it->second;
+    query.found = true;
+    query.type = value.type;
+    query.size = value.data.size();
+
+    if (offset + value.data.size() <= capacity && !value.data.empty()) {
+      std::memcpy(static_cast<unsigned char*>(buffer) + offset, value.data.data(), value.data.size());
+    }
+
+    offset += value.data.size();
+  }
+
+  size = offset;
+  return ErrorCode(offset > capacity ? ERROR_MORE_DATA : ERROR_SUCCESS);
+}
+
+/**
+ * \brief returns the number of subkeys and values of a key
+ */
+ErrorCode MemoryRegistry::QueryKeyInfo(KeyHandle key, KeyInfo& info)
+{
+  info = KeyInfo();
+
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  std::shared_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  info.subKeyCount = node->subkey_list.size();
+  info.valueCount = node->value_list.size();
+
+  for (const Impl::memory_registry_node* subkey : node->subkey_list) {
+    info.maxSubKeyNameLength = (std::max)(info.maxSubKeyNameLength, subkey->wide_name.size());
+  }
+
+  for (const Impl::memory_registry_value* value : node->value_list)
+  {
+    info.maxValueNameLength = (std::max)(info.maxValueNameLength, value->wide_name.size());
+    info.maxValueSize = (std::max)(info.maxValueSize, value->data.size());
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief returns the name of a subkey
+ * 
+ * \a nameLength is the size of the buffer, including the null terminator,
+ * and receives the length of the name.
+ */
+ErrorCode MemoryRegistry::EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  std::shared_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  if (index >= node->subkey_list.size()) {
+    return ErrorCode(ERROR_NO_MORE_ITEMS);
+  }
+
+  const std::u16string& wide_name = node->subkey_list[index]->wide_name;
+
+  if (nameLength <= wide_name.size()) {
+    return ErrorCode(ERROR_MORE_DATA);
+  }
+
+  std::copy(wide_name.begin(), wide_name.end(), name);
+  name[wide_name.size()] = u'\0';
+  nameLength = wide_name.size();
+  return ErrorCode();
+}
+
+/**
+ * \brief returns the name, and optionally the data, of a value
+ * 
+ * \a nameLength is the size of the buffer, including the null terminator,
+ * and receives the length of the name.
+ * The data is returned as with GetValue().
+ */
+ErrorCode MemoryRegistry::EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (!Impl::has_memory_key_access(key, Impl::memory_key_query_value)) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  }
+
+  if (data && !size) {
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+
+  std::shared_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  if (index >= node->value_list.size()) {
+    return ErrorCode(ERROR_NO_MORE_ITEMS);
+  }
+
+  const Impl::memory_registry_value& value = *node->value_list[index];
+
+  if (type) {
+    *type = value.type;
+  }
+
+  const bool name_fits = nameLength > value.wide_name.size();
+  const bool data_fits = !data || *size >= value.data.size();
+
+  if (size) {
+    *size = value.data.size();
+  }
+
+  if (!name_fits || !data_fits) {
+    return ErrorCode(ERROR_MORE_DATA);
+  }
+
+  std::copy(value.wide_name.begin(), value.wide_name.end(), name);
+  name[value.wide_name.size()] = u'\0';
+  nameLength = value.wide_name.size();
+
+  if (data && !value.data.empty()) {
+    std::memcpy(data, value.data.data(), value.data.size());
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief calls a function when the values of a key change
+ * 
+ * The callback is called by the thread that modifies the key, before the
+ * function that modified it returns but after the registry is unlocked, so
+ * the callback can use the registry.
+ */
+ErrorCode MemoryRegistry::WatchKey(KeyHandle key, std::function<void()> callback, WatchHandle& result)
+{
+  result = nullptr;
+
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  std::unique_lock<std::shared_mutex> lock{ d->mutex };
+  Impl::memory_registry_node* node = Impl::get_memory_key_node(key);
+
+  if (node->deleted) {
+    return ErrorCode(ERROR_KEY_DELETED);
+  }
+
+  auto w = std::make_unique<Impl::memory_registry_watch>();
+  w->node = node;
+  w->callback = std::move(callback);
+  node->watches.push_back(w.get());
+  result = w.release();
+  return ErrorCode();
+}
+
+/**
+ * \brief stops watching a key
+ * 
+ * This function waits for the callback if it is running, so it must not be
+ * called by the callback itself.
+ */
+void MemoryRegistry::UnwatchKey(WatchHandle watch)
+{
+  auto* w = static_cast<Impl::memory_registry_watch*>(watch);
+
+  if (!w) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::shared_mutex> lock{ d->mutex };
+
+    // the node is reset if the key was deleted and all its handles closed
+    if (w->node)
+    {
+      std::vector<Impl::memory_registry_watch*>& watches = w->node->watches;
+      watches.erase(std::find(watches.begin(), watches.end(), w));
+    }
+  }
+
+  std::unique_lock<std::mutex> lock{ d->callback_mutex };
+  d->callback_done.wait(lock, [w]() { return w->running.load(std::memory_order_acquire) == 0; });
+  lock.unlock();
+  delete w;
+}
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,81 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_MEMORYREGISTRY_H
+#define WINAPI_MEMORYREGISTRY_H
+
+#include "RegistryBackend.h"
+
+#include <memory>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct MemoryRegistryPriv;
+} // namespace Impl
+
+/**
+ * \brief registry backend that stores the keys and values in memory
+ *
+ * Each instance is an independent registry whose predefined keys are initially empty.
+ * This backend does not depend on the Windows API and is the default backend on
+ * other platforms; it can also be used to test code that writes to the registry
+ * without modifying the Windows Registry:
+ * 
+ * \code
+ * MemoryRegistry memory;
+ * Registry::SetBackend(&memory);
+ * WindowsErrorReporting::Enable("app.exe");
+ * assert(WindowsErrorReporting::IsEnabled("app.exe"));
+ * Registry::SetBackend(nullptr);
+ * \endcode
+ *
+ * Keys are stored in a tree whose nodes index their subkeys and values in
+ * hash tables.
+ * As in the Windows Registry, names are case-insensitive; only ASCII letters
+ * are compared without regard to case.
+ * A key that has subkeys cannot be deleted, and a key opened with 
+ * Registry::Read access cannot be written to.
+ *
+ * The backend must outlive the keys opened with it.
+ */
+class MemoryRegistry : public RegistryBackend
+{
+public:
+  MemoryRegistry();
+  MemoryRegistry(const MemoryRegistry&) = delete;
+  ~MemoryRegistry();
+
+  KeyHandle GetPredefinedKey(PredefinedKey key) override;
+
+  ErrorCode OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result) override;
+  ErrorCode CreateKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result, bool& created) override;
+  ErrorCode DeleteKey(KeyHandle parent, const std::string& subKey) override;
+  void CloseKey(KeyHandle key) override;
+
+  ErrorCode SetValue(KeyHandle key, const std::string& name, Registry::ValueType type, const void* data, size_t size) override;
+  ErrorCode DeleteValue(KeyHandle key, const std::string& name) override;
+  ErrorCode GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size) override;
+  ErrorCode GetValues(KeyHandle key, ValueQuery* values, size_t count, void* buffer, size_t& size) override;
+
+  ErrorCode ApplyBatch(KeyHandle key, const WriteOperation* operations, size_t count) override;
+
+  ErrorCode QueryKeyInfo(KeyHandle key, KeyInfo& info) override;
+  ErrorCode EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength) override;
+  ErrorCode EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size) override;
+
+  ErrorCode WatchKey(KeyHandle key, std::function<void()> callback, WatchHandle& result) override;
+  void UnwatchKey(WatchHandle watch) override;
+
+  MemoryRegistry& operator=(const MemoryRegistry&) = delete;
+
+private:
+  std::unique_ptr<Impl::MemoryRegistryPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_MEMORYREGISTRY_H
\ No newline at end of file
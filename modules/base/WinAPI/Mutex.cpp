@@ -0,0 +1,671 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "Mutex.h"
+
+#include "sharedmemory_priv.h"
+
+#ifndef _WIN32
+#include "EventImpl.h"
+
+#include <cerrno>
+#include <ctime>
+#include <pthread.h>
+#endif
+
+#include <algorithm>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+// The file mapping only contains this structure. The memory of a new file
+// mapping is zero-initialized, which is the state of an unlocked mutex.
+struct mutex_header
+{
+  // identity of the owner thread (see current_thread_identity()), 0 if the
+  // mutex is not locked
+  std::atomic<uint64_t> owner;
+  // number of times the owner locked the mutex again, only accessed by the owner
+  uint32_t recursion;
+  // number of threads blocked (or about to block) on the event
+  std::atomic<uint32_t> waiters;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "atomics in shared memory must be lock-free");
+
+struct MutexPriv
+{
+  std::string name;
+  SharedMemory shm;
+  mutex_header* header = nullptr;
+  // auto-reset event, set when the mutex is unlocked while there are waiters
+  HANDLE event = nullptr;
+  bool created = false;
+  int spin_count = 0;
+
+  ~MutexPriv();
+};
+
+MutexPriv::~MutexPriv()
+{
+  if (event) {
+    ::CloseHandle(event);
+  }
+}
+
+std::wstring mutex_event_name(const std::string& name)
+{
+  return ToUtf16(name + "Event");
+}
+
+// creates or opens the file mapping and the event of a mutex
+void create_mutex(MutexPriv& m, const std::string& name, bool must_create)
+{
+  m.name = name;
+
+  create_shared_memory(m.shm, name, sizeof(mutex_header), must_create);
+  m.header = static_cast<mutex_header*>(m.shm.view);
+  m.created = m.shm.created;
+
+  constexpr bool manual_reset = false;
+  constexpr bool initial_state = false;
+  m.event = ::CreateEventW(nullptr, manual_reset, initial_state, mutex_event_name(name).c_str());
+
+  if (!m.event) {
+    throw Exception(GetLastError());
+  }
+}
+
+// The id of a thread is reused by the system once the thread has terminated,
+// so the owner of a mutex is identified by its id along with the low part
+// of its creation time, which tells apart the threads that had the same id.
+// A thread that finds its own identity in the owner word is therefore
+// the owner, and not a thread that reused the id of a terminated owner.
+uint64_t make_thread_identity(DWORD tid, const FILETIME& creation_time)
+{
+  return (static_cast<uint64_t>(creation_time.dwLowDateTime) << 32) | tid;
+}
+
+DWORD get_thread_id(uint64_t identity)
+{
+  return static_cast<DWORD>(identity & 0xFFFFFFFF);
+}
+
+uint64_t current_thread_identity()
+{
+  thread_local const uint64_t identity = []() {
+    FILETIME creation_time = {};
+    FILETIME exit_time, kernel_time, user_time;
+    ::GetThreadTimes(::GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time);
+    return make_thread_identity(::GetCurrentThreadId(), creation_time);
+  }();
+
+  return identity;
+}
+
+// opens the owner thread of a mutex so that its termination can be waited for;
+// returns nullptr if it cannot be opened, in which case 'terminated' tells
+// whether the owner no longer exists
+HANDLE open_owner_thread(uint64_t owner, bool& terminated)
+{
+  constexpr bool inherit_handle = false;
+  HANDLE thread = ::OpenThread(SYNCHRONIZE | THREAD_QUERY_LIMITED_INFORMATION, inherit_handle, get_thread_id(owner));
+
+  if (!thread) {
+    // no such thread
+    terminated = ::GetLastError() == ERROR_INVALID_PARAMETER;
+    return nullptr;
+  }
+
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+
+  if (::GetThreadTimes(thread, &creation_time, &exit_time, &kernel_time, &user_time)
+    && make_thread_identity(get_thread_id(owner), creation_time) != owner)
+  {
+    // the id of the owner was reused by another thread
+    ::CloseHandle(thread);
+    terminated = true;
+    return nullptr;
+  }
+
+  terminated = false;
+  return thread;
+}
+
+bool try_lock_mutex(mutex_header& h, uint64_t self)
+{
+  uint64_t expected = 0;
+  return h.owner.compare_exchange_strong(expected, self, std::memory_order_seq_cst);
+}
+
+// takes the ownership of a mutex whose owner terminated; fails if another
+// thread took it first
+bool take_abandoned_mutex(mutex_header& h, uint64_t owner, uint64_t self)
+{
+  if (!h.owner.compare_exchange_strong(owner, self, std::memory_order_seq_cst)) {
+    return false;
+  }
+
+  h.recursion = 0;
+  return true;
+}
+
+Mutex::LockResult lock_mutex(MutexPriv& m, std::chrono::milliseconds timeout, bool infinite)
+{
+  mutex_header& h = *m.header;
+  const uint64_t self = current_thread_identity();
+
+  if (h.owner.load(std::memory_order_relaxed) == self) {
+    ++h.recursion;
+    return Mutex::Acquired;
+  }
+
+  for (int i(0); i <= m.spin_count; ++i)
+  {
+    if (try_lock_mutex(h, self)) {
+      return Mutex::Acquired;
+    }
+
+    YieldProcessor();
+  }
+
+  if (!infinite && timeout.count() <= 0) {
+    return Mutex::TimedOut;
+  }
+
+  // INFINITE must not be reached by a finite timeout
+  const DWORD ms = infinite ? INFINITE : static_cast<DWORD>((std::min)(timeout.count(), static_cast<std::chrono::milliseconds::rep>(INFINITE - 1)));
+  const ULONGLONG deadline = ::GetTickCount64() + ms;
+  Mutex::LockResult result = Mutex::Failed;
+
+  // Unlock() clears the owner before reading the number of waiters,
+  // so either it sees us or we see the mutex unlocked
+  h.waiters.fetch_add(1, std::memory_order_seq_cst);
+
+  for (;;)
+  {
+    if (try_lock_mutex(h, self)) {
+      result = Mutex::Acquired;
+      break;
+    }
+
+    const uint64_t owner = h.owner.load(std::memory_order_seq_cst);
+
+    if (owner == 0) {
+      continue;
+    }
+
+    // the owner thread is waited for along with the event, so that we are woken up
+    // if it terminates without unlocking the mutex
+    bool owner_terminated = false;
+    HANDLE owner_thread = open_owner_thread(owner, owner_terminated);
+
+    if (owner_terminated)
+    {
+      if (take_abandoned_mutex(h, owner, self)) {
+        result = Mutex::Abandoned;
+        break;
+      }
+
+      continue;
+    }
+
+    DWORD remaining = ms;
+
+    if (!infinite)
+    {
+      const ULONGLONG now = ::GetTickCount64();
+      remaining = now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+    }
+
+    // if the owner thread cannot be opened (e.g., it belongs to another user),
+    // abandonment is not detected
+    const HANDLE handles[] = { m.event, owner_thread };
+    const DWORD count = owner_thread ? 2 : 1;
+    constexpr bool wait_all = false;
+    DWORD wait_result = ::WaitForMultipleObjects(count, handles, wait_all, remaining);
+
+    if (owner_thread) {
+      ::CloseHandle(owner_thread);
+    }
+
+    if (wait_result == WAIT_OBJECT_0 + 1)
+    {
+      if (take_abandoned_mutex(h, owner, self)) {
+        result = Mutex::Abandoned;
+        break;
+      }
+    }
+    else if (wait_result == WAIT_TIMEOUT)
+    {
+      result = try_lock_mutex(h, self) ? Mutex::Acquired : Mutex::TimedOut;
+      break;
+    }
+    else if (wait_result != WAIT_OBJECT_0)
+    {
+      result = Mutex::Failed;
+      break;
+    }
+  }
+
+  h.waiters.fetch_sub(1, std::memory_order_seq_cst);
+  return result;
+}
+
+void open_mutex(MutexPriv& m, const std::string& name)
+{
+  m.name = name;
+
+  open_shared_memory(m.shm, name);
+  m.header = static_cast<mutex_header*>(m.shm.view);
+
+  constexpr DWORD desired_access = EVENT_MODIFY_STATE | SYNCHRONIZE;
+  constexpr bool inherit_handle = false;
+  m.event = ::OpenEventW(desired_access, inherit_handle, mutex_event_name(name).c_str());
+
+  if (!m.event) {
+    throw Exception(GetLastError());
+  }
+}
+
+// does not detect abandoned mutexes
+bool try_lock_mutex(MutexPriv& m)
+{
+  const uint64_t self = current_thread_identity();
+
+  if (m.header->owner.load(std::memory_order_relaxed) == self) {
+    ++m.header->recursion;
+    return true;
+  }
+
+  return try_lock_mutex(*m.header, self);
+}
+
+bool unlock_mutex(MutexPriv& m)
+{
+  mutex_header& h = *m.header;
+
+  if (h.owner.load(std::memory_order_relaxed) != current_thread_identity()) {
+    return false;
+  }
+
+  if (h.recursion > 0) {
+    --h.recursion;
+    return true;
+  }
+
+  h.owner.store(0, std::memory_order_seq_cst);
+
+  if (h.waiters.load(std::memory_order_seq_cst) > 0) {
+    ::SetEvent(m.event);
+  }
+
+  return true;
+}
+
+#else
+
+constexpr uint32_t mutex_magic = 0x5854554D; // "MUTX"
+
+// The shared memory object contains a robust, error-checking and
+// process-shared pthread mutex: the system marks it as abandoned when its
+// owner thread terminates, and blocks on its futex when it is contended.
+// Locking it again fails with EDEADLK, which tells its owner apart from
+// the other threads.
+struct mutex_header
+{
+  std::atomic<uint32_t> magic;
+  // number of times the owner locked the mutex again, only accessed by the owner
+  uint32_t recursion;
+  pthread_mutex_t mutex;
+};
+
+struct MutexPriv
+{
+  std::string name;
+  SharedMemory shm;
+  mutex_header* header = nullptr;
+  bool created = false;
+  int spin_count = 0;
+};
+
+void initialize_mutex(MutexPriv& m)
+{
+  m.header = static_cast<mutex_header*>(m.shm.view);
+  m.created = m.shm.created;
+
+  if (!m.created) {
+    wait_shared_memory_initialized(m.header->magic, mutex_magic);
+    return;
+  }
+
+  pthread_mutexattr_t attributes;
+  ::pthread_mutexattr_init(&attributes);
+  ::pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+  ::pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+  ::pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_ERRORCHECK);
+  const int error = ::pthread_mutex_init(&m.header->mutex, &attributes);
+  ::pthread_mutexattr_destroy(&attributes);
+
+  if (error != 0) {
+    throw Exception(ErrorCode(ERROR_INVALID_PARAMETER));
+  }
+
+  m.header->magic.store(mutex_magic, std::memory_order_release);
+}
+
+// creates or opens the shared memory object of a mutex
+void create_mutex(MutexPriv& m, const std::string& name, bool must_create)
+{
+  m.name = name;
+
+  create_shared_memory(m.shm, name, sizeof(mutex_header), must_create);
+  initialize_mutex(m);
+}
+
+void open_mutex(MutexPriv& m, const std::string& name)
+{
+  m.name = name;
+
+  open_shared_memory(m.shm, name);
+
+  if (m.shm.size < sizeof(mutex_header)) {
+    throw Exception(ErrorCode(ERROR_INVALID_DATA));
+  }
+
+  initialize_mutex(m);
+}
+
+// converts the result of a pthread lock function
+Mutex::LockResult get_lock_result(mutex_header& h, int error)
+{
+  switch (error)
+  {
+  case 0:
+    return Mutex::Acquired;
+  case EDEADLK:
+    // the calling thread is the owner
+    ++h.recursion;
+    return Mutex::Acquired;
+  case EOWNERDEAD:
+    // the owner terminated, the mutex is usable again once it is marked as
+    // consistent
+    ::pthread_mutex_consistent(&h.mutex);
+    h.recursion = 0;
+    return Mutex::Abandoned;
+  case EBUSY:
+  case ETIMEDOUT:
+    return Mutex::TimedOut;
+  default:
+    // including ENOTRECOVERABLE, for a mutex whose previous owner also
+    // terminated before it was marked as consistent
+    return Mutex::Failed;
+  }
+}
+
+Mutex::LockResult lock_mutex(MutexPriv& m, std::chrono::milliseconds timeout, bool infinite)
+{
+  mutex_header& h = *m.header;
+
+  for (int i(0); i <= m.spin_count; ++i)
+  {
+    const Mutex::LockResult result = get_lock_result(h, ::pthread_mutex_trylock(&h.mutex));
+
+    if (result != Mutex::TimedOut) {
+      return result;
+    }
+
+    pause_processor();
+  }
+
+  if (infinite) {
+    return get_lock_result(h, ::pthread_mutex_lock(&h.mutex));
+  }
+
+  if (timeout.count() <= 0) {
+    return Mutex::TimedOut;
+  }
+
+  // pthread_mutex_timedlock() measures the timeout with the system clock
+  struct timespec deadline = {};
+  ::clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += static_cast<time_t>(timeout.count() / 1000);
+  deadline.tv_nsec += static_cast<long>(timeout.count() % 1000) * 1000000;
+
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec += 1;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  return get_lock_result(h, ::pthread_mutex_timedlock(&h.mutex, &deadline));
+}
+
+// an abandoned mutex is locked as well, as nothing tells the caller that
+// the data it protects may be inconsistent
+bool try_lock_mutex(MutexPriv& m)
+{
+  const Mutex::LockResult result = get_lock_result(*m.header, ::pthread_mutex_trylock(&m.header->mutex));
+  return result == Mutex::Acquired || result == Mutex::Abandoned;
+}
+
+bool unlock_mutex(MutexPriv& m)
+{
+  mutex_header& h = *m.header;
+  const int error = ::pthread_mutex_trylock(&h.mutex);
+
+  if (error != EDEADLK)
+  {
+    // the calling thread is not the owner; if the mutex was free, it was
+    // just locked by the test
+    if (error == 0 || error == EOWNERDEAD) {
+      get_lock_result(h, error);
+      ::pthread_mutex_unlock(&h.mutex);
+    }
+
+    return false;
+  }
+
+  if (h.recursion > 0) {
+    --h.recursion;
+    return true;
+  }
+
+  return ::pthread_mutex_unlock(&h.mutex) == 0;
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+Mutex::Mutex() noexcept
+  : d(nullptr)
+{
+
+}
+
+Mutex::Mutex(Mutex&&) noexcept = default;
+
+Mutex::~Mutex()
+{
+
+}
+
+/**
+ * \brief create or open a mutex
+ * \param mutexName  the name of the mutex
+ * \throw Exception on failure
+ *
+ * Use the Created() function to check whether this constructor actually
+ * created the mutex or only opened it.
+ */
+Mutex::Mutex(const std::string& mutexName)
+  : d(std::make_unique<Impl::MutexPriv>())
+{
+  constexpr bool must_create = false;
+  Impl::create_mutex(*d, mutexName, must_create);
+}
+
+Mutex::Mutex(std::unique_ptr<Impl::MutexPriv> dPtr)
+  : d(std::move(dPtr))
+{
+
+}
+
+/**
+ * \brief open a mutex
+ * \param mutexName  the name of the mutex
+ * \return the opened mutex
+ * \throw Exception on failure
+ *
+ * This function will fail if the mutex does not exist.
+ */
+Mutex Mutex::Open(const std::string& mutexName)
+{
+  auto dptr = std::make_unique<Impl::MutexPriv>();
+  Impl::open_mutex(*dptr, mutexName);
+  return Mutex{ std::move(dptr) };
+}
+
+/**
+ * \brief create a mutex
+ * \param mutexName  the name of the mutex
+ * \return the created mutex
+ * \throw Exception on failure
+ *
+ * This function will fail if the mutex already exists, in which case the
+ * error code of the exception is ERROR_ALREADY_EXISTS.
+ */
+Mutex Mutex::Create(const std::string& mutexName)
+{
+  auto dptr = std::make_unique<Impl::MutexPriv>();
+  constexpr bool must_create = true;
+  Impl::create_mutex(*dptr, mutexName, must_create);
+  return Mutex{ std::move(dptr) };
+}
+
+/**
+ * \brief returns whether this object does not represent a valid mutex
+ */
+bool Mutex::IsNull() const
+{
+  return !d;
+}
+
+/**
+ * \brief returns whether the mutex was created by this reference to the mutex
+ */
+bool Mutex::Created() const
+{
+  return d && d->created;
+}
+
+/**
+ * \brief returns the name of the mutex
+ */
+const std::string& Mutex::GetName() const
+{
+  if (!d) {
+    static const std::string emptyName = "";
+    return emptyName;
+  } else {
+    return d->name;
+  }
+}
+
+/**
+ * \brief waits until the mutex can be locked and locks it
+ *
+ * Returns Abandoned if the previous owner terminated without unlocking
+ * the mutex; the mutex is then owned by the calling thread, but the data
+ * it protects may be in an inconsistent state.
+ *
+ * \sa SetSpinCount().
+ */
+Mutex::LockResult Mutex::Lock()
+{
+  constexpr bool infinite = true;
+  return d ? Impl::lock_mutex(*d, std::chrono::milliseconds(0), infinite) : Failed;
+}
+
+/**
+ * \brief waits until the mutex can be locked or a timeout expires
+ * \param timeout  the maximum waiting time
+ *
+ * Returns TimedOut if the mutex could not be locked before the timeout expired.
+ *
+ * \sa Lock().
+ */
+Mutex::LockResult Mutex::LockFor(std::chrono::milliseconds timeout)
+{
+  if (!d) {
+    return Failed;
+  }
+
+  constexpr bool infinite = false;
+  return Impl::lock_mutex(*d, (std::max)(timeout, std::chrono::milliseconds(0)), infinite);
+}
+
+/**
+ * \brief locks the mutex if it is not locked by another thread
+ *
+ * On Windows, this function never enters the kernel and does not detect
+ * abandoned mutexes; on Linux, an abandoned mutex is locked.
+ */
+bool Mutex::TryLock()
+{
+  if (!d) {
+    return false;
+  }
+
+  return Impl::try_lock_mutex(*d);
+}
+
+/**
+ * \brief unlocks the mutex
+ *
+ * The mutex must be unlocked as many times as it was locked.
+ *
+ * Returns false if the mutex is not owned by the calling thread.
+ */
+bool Mutex::Unlock()
+{
+  if (!d) {
+    return false;
+  }
+
+  return Impl::unlock_mutex(*d);
+}
+
+/**
+ * \brief enables spinning before blocking in Lock() and LockFor()
+ * \param spinCount  the number of times the mutex is tested
+ *
+ * When the mutex is only held for short periods of time, spinning
+ * avoids putting the thread to sleep and having the owner wake it up.
+ */
+void Mutex::SetSpinCount(int spinCount)
+{
+  if (d) {
+    d->spin_count = (std::max)(spinCount, 0);
+  }
+}
+
+/**
+ * \brief closes the mutex
+ *
+ * The mutex should not be owned by the calling thread.
+ */
+void Mutex::Close()
+{
+  d.reset();
+}
+
+Mutex& Mutex::operator=(Mutex&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,78 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_MUTEX_H
+#define WINAPI_MUTEX_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct MutexPriv;
+} // namespace Impl
+
+/**
+ * \brief represents a named mutex
+ * 
+ * Like a mutex object of the system, this mutex can be used by several 
+ * processes, is owned by a thread, can be locked recursively by its owner
+ * and is abandoned when its owner terminates without unlocking it.
+ * 
+ * The state of the mutex is a word in shared memory: locking and unlocking
+ * a mutex that is not contended does not enter the kernel.
+ * On Linux, it is a robust pthread mutex shared by the processes.
+ */
+class Mutex
+{
+public:
+  enum LockResult
+  {
+    Acquired,
+    Abandoned,
+    TimedOut,
+    Failed,
+  };
+
+public:
+  Mutex() noexcept;
+  Mutex(const Mutex&) = delete;
+  Mutex(Mutex&&) noexcept;
+  ~Mutex();
+
+  explicit Mutex(const std::string& mutexName);
+
+  static Mutex Open(const std::string& mutexName);
+  static Mutex Create(const std::string& mutexName);
+
+  bool IsNull() const;
+  bool Created() const;
+  const std::string& GetName() const;
+
+  LockResult Lock();
+  LockResult LockFor(std::chrono::milliseconds timeout);
+  bool TryLock();
+  bool Unlock();
+
+  void SetSpinCount(int spinCount);
+
+  void Close();
+
+  Mutex& operator=(const Mutex&) = delete;
+  Mutex& operator=(Mutex&&) noexcept;
+
+private:
+  explicit Mutex(std::unique_ptr<Impl::MutexPriv> dPtr);
+
+private:
+  std::unique_ptr<Impl::MutexPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_MUTEX_H
\ No newline at end of file
@@ -0,0 +1,652 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "NativeRegistry.h"
+
+#include "WindowsRegistry.h"
+#include "registry_priv.h"
+
+#include "String.h"
+
+#include <ktmw32.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifndef REG_NOTIFY_THREAD_AGNOSTIC
+#define REG_NOTIFY_THREAD_AGNOSTIC 0x10000000L
+#endif
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// converts a name to a null-terminated UTF-16 string, in a buffer on the stack
+// if it is short enough, which is the case of most names
+class registry_wide_name
+{
+public:
+  explicit registry_wide_name(const std::string& name);
+  registry_wide_name(const registry_wide_name&) = delete;
+
+  const wchar_t* c_str() const;
+
+  registry_wide_name& operator=(const registry_wide_name&) = delete;
+
+private:
+  wchar_t m_buffer[128];
+  std::wstring m_heap;
+  const wchar_t* m_str = m_buffer;
+};
+
+registry_wide_name::registry_wide_name(const std::string& name)
+{
+  constexpr DWORD flags = 0;
+  int chars_written = 0;
+
+  if (!name.empty())
+  {
+    chars_written = ::MultiByteToWideChar(
+      CP_UTF8,
+      flags,
+      name.data(),
+      static_cast<int>(name.size()),
+      m_buffer,
+      static_cast<int>(std::size(m_buffer) - 1));
+
+    if (chars_written == 0)
+    {
+      m_heap = ToUtf16(name);
+      m_str = m_heap.c_str();
+      return;
+    }
+  }
+
+  m_buffer[chars_written] = L'\0';
+}
+
+const wchar_t* registry_wide_name::c_str() const
+{
+  return m_str;
+}
+
+struct native_registry_watch
+{
+  HKEY hkey = nullptr;
+  // auto-reset event signaled by RegNotifyChangeKeyValue()
+  HANDLE event = nullptr;
+  PTP_WAIT wait = nullptr;
+  std::function<void()> callback;
+  std::atomic<bool> stopping{ false };
+};
+
+LSTATUS request_registry_change_notification(native_registry_watch& w)
+{
+  constexpr bool watch_subtree = false;
+  constexpr bool asynchronous = true;
+
+  // with REG_NOTIFY_THREAD_AGNOSTIC, the notification does not end with the
+  // thread that requested it, which is a thread of the thread pool
+  LSTATUS status = ::RegNotifyChangeKeyValue(w.hkey, watch_subtree, REG_NOTIFY_CHANGE_LAST_SET | REG_NOTIFY_THREAD_AGNOSTIC, w.event, asynchronous);
+
+  if (status == ERROR_INVALID_PARAMETER)
+  {
+    // the flag is not supported before Windows 8; the event is then also signaled
+    // when the thread exits, which only causes a spurious notification
+    status = ::RegNotifyChangeKeyValue(w.hkey, watch_subtree, REG_NOTIFY_CHANGE_LAST_SET, w.event, asynchronous);
+  }
+
+  return status;
+}
+
+void CALLBACK registry_watch_callback(PTP_CALLBACK_INSTANCE /* instance */, PVOID context, PTP_WAIT wait, TP_WAIT_RESULT /* result */)
+{
+  auto* w = static_cast<native_registry_watch*>(context);
+
+  // notifications are one-shot: a new one is requested before calling the
+  // callback, so that no change is missed; changes that happened in the
+  // meantime are coalesced into this call.
+  // This fails if the key was deleted, in which case no more notification
+  // is received.
+  if (!w->stopping.load() && request_registry_change_notification(*w) == ERROR_SUCCESS) {
+    ::SetThreadpoolWait(wait, w->event, nullptr);
+  }
+
+  w->callback();
+}
+
+} // namespace Impl
+
+NativeRegistry::NativeRegistry()
+{
+
+}
+
+NativeRegistry::~NativeRegistry()
+{
+
+}
+
+/**
+ * \brief returns the HKEY of a predefined key
+ */
+RegistryBackend::KeyHandle NativeRegistry::GetPredefinedKey(PredefinedKey key)
+{
+  switch (key)
+  {
+  case ClassesRoot:
+    return HKEY_CLASSES_ROOT;
+  case CurrentConfig:
+    return HKEY_CURRENT_CONFIG;
+  case CurrentUser:
+    return HKEY_CURRENT_USER;
+  case LocalMachine:
+    return HKEY_LOCAL_MACHINE;
+  case Users:
+    return HKEY_USERS;
+  default:
+    return nullptr;
+  }
+}
+
+/**
+ * \brief opens a key with RegOpenKeyExW()
+ */
+ErrorCode NativeRegistry::OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result)
+{
+  constexpr DWORD options = 0;
+  Impl::registry_wide_name wsubKey{ subKey };
+  HKEY hkey = nullptr;
+
+  LSTATUS status = ::RegOpenKeyExW(
+    static_cast<HKEY>(parent),
+    wsubKey.c_str(),
+    options,
+    static_cast<REGSAM>(accessRights),
+    &hkey);
+
+  result = hkey;
+  return ErrorCode(status);
+}
+
+/**
+ * \brief creates or opens a key with RegCreateKeyExW()
+ */
+ErrorCode NativeRegistry::CreateKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result, bool& created)
+{
+  constexpr DWORD reserved = 0;
+  Impl::registry_wide_name wsubKey{ subKey };
+  constexpr LPWSTR kclass = nullptr;
+  DWORD options = 0;
+  SECURITY_ATTRIBUTES* secattrs = nullptr;
+  HKEY hkey = nullptr;
+  DWORD disposition = 0;
+
+  LSTATUS status = ::RegCreateKeyExW(
+    static_cast<HKEY>(parent),
+    wsubKey.c_str(),
+    reserved,
+    kclass,
+    options,
+    static_cast<REGSAM>(accessRights),
+    secattrs,
+    &hkey,
+    &disposition);
+
+  result = hkey;
+  created = (disposition == REG_CREATED_NEW_KEY);
+  return ErrorCode(status);
+}
+
+/**
+ * \brief deletes a key with RegDeleteKeyW()
+ */
+ErrorCode NativeRegistry::DeleteKey(KeyHandle parent, const std::string& subKey)
+{
+  Impl::registry_wide_name wsubKey{ subKey };
+  return ErrorCode(::RegDeleteKeyW(static_cast<HKEY>(parent), wsubKey.c_str()));
+}
+
+/**
+ * \brief closes a key with RegCloseKey()
+ */
+void NativeRegistry::CloseKey(KeyHandle key)
+{
+  ::RegCloseKey(static_cast<HKEY>(key));
+}
+
+/**
+ * \brief writes a value with RegSetValueExW()
+ */
+ErrorCode NativeRegistry::SetValue(KeyHandle key, const std::string& name, Registry::ValueType type, const void* data, size_t size)
+{
+  if (size > (std::numeric_limits<DWORD>::max)()) {
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+
+  Impl::registry_wide_name wname{ name };
+  constexpr DWORD reserved = 0;
+
+  LSTATUS status = ::RegSetValueExW(
+    static_cast<HKEY>(key),
+    wname.c_str(),
+    reserved,
+    static_cast<DWORD>(type),
+    static_cast<const BYTE*>(data),
+    static_cast<DWORD>(size));
+
+  return ErrorCode(status);
+}
+
+/**
+ * \brief removes a value with RegDeleteValueW()
+ */
+ErrorCode NativeRegistry::DeleteValue(KeyHandle key, const std::string& name)
+{
+  Impl::registry_wide_name wname{ name };
+  return ErrorCode(::RegDeleteValueW(static_cast<HKEY>(key), wname.c_str()));
+}
+
+/**
+ * \brief reads a value with RegQueryValueExW()
+ */
+ErrorCode NativeRegistry::GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size)
+{
+  Impl::registry_wide_name wname{ name };
+  constexpr LPDWORD reserved = nullptr;
+  DWORD value_type = REG_NONE;
+  DWORD value_size = size ? static_cast<DWORD>((std::min)(*size, static_cast<size_t>((std::numeric_limits<DWORD>::max)()))) : 0;
+
+  LSTATUS status = ::RegQueryValueExW(
+    static_cast<HKEY>(key),
+    wname.c_str(),
+    reserved,
+    &value_type,
+    static_cast<BYTE*>(data),
+    size ? &value_size : nullptr);
+
+  if (type) {
+    *type = static_cast<Registry::ValueType>(value_type);
+  }
+
+  if (size) {
+    *size = value_size;
+  }
+
+  return ErrorCode(status);
+}
+
+/**
+ * \brief reads several values of a key at once with RegQueryMultipleValuesW()
+ * 
+ * RegQueryMultipleValuesW() fails if one of the values does not exist or if
+ * the values are larger than one megabyte, in which case the values are 
+ * read one at a time.
+ */
+ErrorCode NativeRegistry::GetValues(KeyHandle key, ValueQuery* values, size_t count, void* buffer, size_t& size)
+{
+  if (count == 0)
+  {
+    size = 0;
+    return ErrorCode();
+  }
+
+  size_t names_size = 0;
+
+  for (size_t i(0); i < count; ++i) {
+    names_size += values[i].name->size() + 1;
+  }
+
+  // a name never has more UTF-16 code units than UTF-8 bytes
+  std::vector<wchar_t> names(names_size);
+  std::vector<VALENTW> entries(count);
+  size_t names_pos = 0;
+
+  for (size_t i(0); i < count; ++i)
+  {
+    const std::string& name = *values[i].name;
+    constexpr DWORD flags = 0;
+    int chars_written = 0;
+
+    if (!name.empty()) {
+      chars_written = ::MultiByteToWideChar(CP_UTF8, flags, name.data(), static_cast<int>(name.size()), names.data() + names_pos, static_cast<int>(name.size()));
+    }
+
+    names[names_pos + chars_written] = L'\0';
+    entries[i].ve_valuename = names.data() + names_pos;
+    names_pos += chars_written + 1;
+  }
+
+  DWORD total_size = buffer ? static_cast<DWORD>((std::min)(size, static_cast<size_t>((std::numeric_limits<DWORD>::max)()))) : 0;
+
+  LSTATUS status = ::RegQueryMultipleValuesW(
+    static_cast<HKEY>(key),
+    entries.data(),
+    static_cast<DWORD>(count),
+    static_cast<LPWSTR>(buffer),
+    &total_size);
+
+  if (status == ERROR_FILE_NOT_FOUND || status == ERROR_TRANSFER_TOO_LONG) {
+    return RegistryBackend::GetValues(key, values, count, buffer, size);
+  }
+
+  size = total_size;
+
+  // the function succeeds without a buffer, returning the required size
+  if (!status && !buffer && total_size > 0) {
+    return ErrorCode(ERROR_MORE_DATA);
+  } else if (status) {
+    return ErrorCode(status);
+  }
+
+  for (size_t i(0); i < count; ++i)
+  {
+    values[i].found = true;
+    values[i].type = static_cast<Registry::ValueType>(entries[i].ve_type);
+    values[i].offset = static_cast<size_t>(entries[i].ve_valueptr - reinterpret_cast<DWORD_PTR>(buffer));
+    values[i].size = entries[i].ve_valuelen;
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief applies a list of modifications in a transaction
+ * 
+ * The operations are performed in a transaction of the Kernel Transaction
+ * Manager (see CreateTransaction()) with RegCreateKeyTransactedW(), 
+ * RegOpenKeyTransactedW() and RegDeleteKeyTransactedW(), so that either
+ * all of them or none of them are applied.
+ * If transactions are not available, the operations are applied one at a time.
+ */
+ErrorCode NativeRegistry::ApplyBatch(KeyHandle key, const WriteOperation* operations, size_t count)
+{
+  constexpr LPSECURITY_ATTRIBUTES transaction_attributes = nullptr;
+  constexpr LPGUID uow = nullptr;
+  constexpr DWORD create_options = 0;
+  constexpr DWORD isolation_level = 0;
+  constexpr DWORD isolation_flags = 0;
+  constexpr DWORD timeout = 0;
+  constexpr LPWSTR description = nullptr;
+  HANDLE transaction = ::CreateTransaction(transaction_attributes, uow, create_options, isolation_level, isolation_flags, timeout, description);
+
+  if (transaction == INVALID_HANDLE_VALUE) {
+    return RegistryBackend::ApplyBatch(key, operations, count);
+  }
+
+  constexpr DWORD reserved = 0;
+  constexpr PVOID extended_parameter = nullptr;
+  HKEY current = nullptr;
+  const std::string* current_key = nullptr;
+  LSTATUS status = ERROR_SUCCESS;
+
+  auto close_current = [&current, &current_key]() {
+    if (current)
+    {
+      ::RegCloseKey(current);
+      current = nullptr;
+      current_key = nullptr;
+    }
+  };
+
+  for (size_t i(0); i < count && status == ERROR_SUCCESS; ++i)
+  {
+    const WriteOperation& op = operations[i];
+
+    if (op.kind == WriteOperation::CreateKeyOperation)
+    {
+      close_current();
+      Impl::registry_wide_name wsubKey{ *op.subKey };
+      constexpr LPWSTR kclass = nullptr;
+      constexpr DWORD options = 0;
+      constexpr LPSECURITY_ATTRIBUTES secattrs = nullptr;
+      constexpr LPDWORD disposition = nullptr;
+
+      status = ::RegCreateKeyTransactedW(
+        static_cast<HKEY>(key),
+        wsubKey.c_str(),
+        reserved,
+        kclass,
+        options,
+        KEY_WRITE,
+        secattrs,
+        &current,
+        disposition,
+        transaction,
+        extended_parameter);
+
+      current_key = current ? op.subKey : nullptr;
+    }
+    else if (op.kind == WriteOperation::DeleteKeyOperation)
+    {
+      close_current();
+      Impl::registry_wide_name wsubKey{ *op.subKey };
+      constexpr REGSAM view = 0;
+      status = ::RegDeleteKeyTransactedW(static_cast<HKEY>(key), wsubKey.c_str(), view, reserved, transaction, extended_parameter);
+    }
+    else
+    {
+      if (!current_key || !Impl::registry_name_equal()(*current_key, *op.subKey))
+      {
+        close_current();
+        Impl::registry_wide_name wsubKey{ *op.subKey };
+        constexpr DWORD options = 0;
+        status = ::RegOpenKeyTransactedW(static_cast<HKEY>(key), wsubKey.c_str(), options, KEY_SET_VALUE, &current, transaction, extended_parameter);
+        current_key = current ? op.subKey : nullptr;
+      }
+
+      if (status == ERROR_SUCCESS)
+      {
+        // the key was opened in the transaction, which thus includes
+        // the modifications of its values
+        Impl::registry_wide_name wname{ *op.name };
+
+        if (op.kind == WriteOperation::DeleteValueOperation) {
+          status = ::RegDeleteValueW(current, wname.c_str());
+        } else {
+          status = ::RegSetValueExW(current, wname.c_str(), reserved, static_cast<DWORD>(op.type), static_cast<const BYTE*>(op.data), static_cast<DWORD>(op.size));
+        }
+      }
+    }
+  }
+
+  close_current();
+
+  if (status == ERROR_SUCCESS && !::CommitTransaction(transaction)) {
+    status = static_cast<LSTATUS>(::GetLastError());
+  }
+
+  // a transaction that is not committed is rolled back when its handle is closed
+  ::CloseHandle(transaction);
+  return ErrorCode(status);
+}
+
+/**
+ * \brief returns the number of subkeys and values of a key with RegQueryInfoKeyW()
+ */
+ErrorCode NativeRegistry::QueryKeyInfo(KeyHandle key, KeyInfo& info)
+{
+  constexpr LPWSTR kclass = nullptr;
+  constexpr LPDWORD class_length = nullptr;
+  constexpr LPDWORD reserved = nullptr;
+  constexpr LPDWORD max_class_length = nullptr;
+  constexpr LPDWORD security_descriptor_size = nullptr;
+  constexpr PFILETIME last_write_time = nullptr;
+  DWORD subkey_count = 0;
+  DWORD max_subkey_length = 0;
+  DWORD value_count = 0;
+  DWORD max_value_name_length = 0;
+  DWORD max_value_size = 0;
+
+  LSTATUS status = ::RegQueryInfoKeyW(
+    static_cast<HKEY>(key),
+    kclass,
+    class_length,
+    reserved,
+    &subkey_count,
+    &max_subkey_length,
+    max_class_length,
+    &value_count,
+    &max_value_name_length,
+    &max_value_size,
+    security_descriptor_size,
+    last_write_time);
+
+  info.subKeyCount = subkey_count;
+  info.maxSubKeyNameLength = max_subkey_length;
+  info.valueCount = value_count;
+  info.maxValueNameLength = max_value_name_length;
+  info.maxValueSize = max_value_size;
+  return ErrorCode(status);
+}
+
+/**
+ * \brief returns the name of a subkey with RegEnumKeyExW()
+ */
+ErrorCode NativeRegistry::EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength)
+{
+  static_assert(sizeof(char16_t) == sizeof(wchar_t), "wchar_t must be a UTF-16 code unit");
+
+  constexpr LPDWORD reserved = nullptr;
+  constexpr LPWSTR kclass = nullptr;
+  constexpr LPDWORD class_length = nullptr;
+  constexpr PFILETIME last_write_time = nullptr;
+  auto name_length = static_cast<DWORD>((std::min)(nameLength, static_cast<size_t>((std::numeric_limits<DWORD>::max)())));
+
+  LSTATUS status = ::RegEnumKeyExW(
+    static_cast<HKEY>(key),
+    static_cast<DWORD>(index),
+    reinterpret_cast<LPWSTR>(name),
+    &name_length,
+    reserved,
+    kclass,
+    class_length,
+    last_write_time);
+
+  nameLength = name_length;
+  return ErrorCode(status);
+}
+
+/**
+ * \brief returns the name, and optionally the data, of a value with RegEnumValueW()
+ */
+ErrorCode NativeRegistry::EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size)
+{
+  constexpr LPDWORD reserved = nullptr;
+  auto name_length = static_cast<DWORD>((std::min)(nameLength, static_cast<size_t>((std::numeric_limits<DWORD>::max)())));
+  DWORD value_type = REG_NONE;
+  DWORD value_size = size ? static_cast<DWORD>((std::min)(*size, static_cast<size_t>((std::numeric_limits<DWORD>::max)()))) : 0;
+
+  LSTATUS status = ::RegEnumValueW(
+    static_cast<HKEY>(key),
+    static_cast<DWORD>(index),
+    reinterpret_cast<LPWSTR>(name),
+    &name_length,
+    reserved,
+    &value_type,
+    static_cast<BYTE*>(data),
+    size ? &value_size : nullptr);
+
+  nameLength = name_length;
+
+  if (type) {
+    *type = static_cast<Registry::ValueType>(value_type);
+  }
+
+  if (size) {
+    *size = value_size;
+  }
+
+  return ErrorCode(status);
+}
+
+/**
+ * \brief calls a function when the values of a key change
+ * 
+ * This uses RegNotifyChangeKeyValue() and the callback is called from the thread pool.
+ * The key must have been opened with KEY_NOTIFY access (which is part of Registry::Read).
+ */
+ErrorCode NativeRegistry::WatchKey(KeyHandle key, std::function<void()> callback, WatchHandle& result)
+{
+  result = nullptr;
+
+  auto w = std::make_unique<Impl::native_registry_watch>();
+  w->hkey = static_cast<HKEY>(key);
+  w->callback = std::move(callback);
+
+  constexpr bool manual_reset = false;
+  constexpr bool initial_state = false;
+  w->event = ::CreateEventW(nullptr, manual_reset, initial_state, nullptr);
+
+  if (!w->event) {
+    return GetLastError();
+  }
+
+  LSTATUS status = Impl::request_registry_change_notification(*w);
+
+  if (status == ERROR_SUCCESS)
+  {
+    w->wait = ::CreateThreadpoolWait(Impl::registry_watch_callback, w.get(), nullptr);
+
+    if (!w->wait) {
+      status = static_cast<LSTATUS>(::GetLastError());
+    }
+  }
+
+  if (status != ERROR_SUCCESS)
+  {
+    ::CloseHandle(w->event);
+    return ErrorCode(status);
+  }
+
+  ::SetThreadpoolWait(w->wait, w->event, nullptr);
+  result = w.release();
+  return ErrorCode();
+}
+
+/**
+ * \brief stops watching a key
+ * 
+ * This function waits for the callback if it is running.
+ */
+void NativeRegistry::UnwatchKey(WatchHandle watch)
+{
+  auto* w = static_cast<Impl::native_registry_watch*>(watch);
+
+  if (!w) {
+    return;
+  }
+
+  constexpr bool cancel_pending_callbacks = true;
+
+  // a running callback may re-arm the wait before it sees the flag,
+  // so the wait is only cancelled once it has returned
+  w->stopping.store(true);
+  ::WaitForThreadpoolWaitCallbacks(w->wait, cancel_pending_callbacks);
+  ::SetThreadpoolWait(w->wait, nullptr, nullptr);
+  ::WaitForThreadpoolWaitCallbacks(w->wait, cancel_pending_callbacks);
+  ::CloseThreadpoolWait(w->wait);
+  ::CloseHandle(w->event);
+  delete w;
+}
+
+/**
+ * \brief returns the HKEY of a registry key
+ *
+ * Returns nullptr if the key is null or was not opened with a NativeRegistry.
+ */
+HKEY GetHKEY(const RegistryKey& rk)
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(rk, handle);
+  return dynamic_cast<NativeRegistry*>(backend) ? static_cast<HKEY>(handle) : nullptr;
+}
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,53 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_NATIVEREGISTRY_H
+#define WINAPI_NATIVEREGISTRY_H
+
+#include "RegistryBackend.h"
+
+namespace Win32
+{
+
+/**
+ * \brief registry backend that accesses the Windows Registry
+ *
+ * The handles of this backend are HKEYs.
+ *
+ * This is the default backend on Windows and is not available on other platforms.
+ */
+class NativeRegistry : public RegistryBackend
+{
+public:
+  NativeRegistry();
+  NativeRegistry(const NativeRegistry&) = delete;
+  ~NativeRegistry();
+
+  KeyHandle GetPredefinedKey(PredefinedKey key) override;
+
+  ErrorCode OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result) override;
+  ErrorCode CreateKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result, bool& created) override;
+  ErrorCode DeleteKey(KeyHandle parent, const std::string& subKey) override;
+  void CloseKey(KeyHandle key) override;
+
+  ErrorCode SetValue(KeyHandle key, const std::string& name, Registry::ValueType type, const void* data, size_t size) override;
+  ErrorCode DeleteValue(KeyHandle key, const std::string& name) override;
+  ErrorCode GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size) override;
+  ErrorCode GetValues(KeyHandle key, ValueQuery* values, size_t count, void* buffer, size_t& size) override;
+
+  ErrorCode ApplyBatch(KeyHandle key, const WriteOperation* operations, size_t count) override;
+
+  ErrorCode QueryKeyInfo(KeyHandle key, KeyInfo& info) override;
+  ErrorCode EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength) override;
+  ErrorCode EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size) override;
+
+  ErrorCode WatchKey(KeyHandle key, std::function<void()> callback, WatchHandle& result) override;
+  void UnwatchKey(WatchHandle watch) override;
+
+  NativeRegistry& operator=(const NativeRegistry&) = delete;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_NATIVEREGISTRY_H
\ No newline at end of file
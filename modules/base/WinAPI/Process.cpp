@@ -5,11 +5,27 @@
 #include "Process.h"
 #include "processpriv.h"
 
+#include "Exception.h"
+#include "jobobject_priv.h"
+
+#ifdef _WIN32
 #include "String.h"
 
-#include <shlwapi.h>
+#include <Windows.h>
+#else
+#include "filemapping_priv.h"
+#include "winerror_priv.h"
+
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <fcntl.h>
+#include <linux/close_range.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
-#include <iostream>
 #include <numeric>
 #include <optional>
 #include <vector>
@@ -17,68 +33,241 @@
 namespace Win32
 {
 
-Process::Process()
-  : d(std::make_unique<Impl::ProcessPriv>())
+namespace Impl
+{
+
+bool redirects_stdio(const ProcessPriv& pd)
 {
+  return pd.stdin_redirect.GetKind() != StdioRedirect::Inherit
+    || pd.stdout_redirect.GetKind() != StdioRedirect::Inherit
+    || pd.stderr_redirect.GetKind() != StdioRedirect::Inherit;
+}
 
+// stdout and stderr redirected to the same file must share the handle,
+// otherwise they would overwrite each other
+bool shares_output_file(const ProcessPriv& pd)
+{
+  const StdioRedirect& out = pd.stdout_redirect;
+  const StdioRedirect& err = pd.stderr_redirect;
+  return out.GetKind() == StdioRedirect::File && err.GetKind() == StdioRedirect::File
+    && out.GetPath() == err.GetPath() && out.IsAppend() == err.IsAppend();
 }
 
-Process::Process(std::unique_ptr<Impl::ProcessPriv> pd)
-  : d(std::move(pd))
+#ifdef _WIN32
+
+std::wstring query_module_file_name()
 {
+  auto path = std::wstring(MAX_PATH, wchar_t(0));
+
+  for (;;)
+  {
+    DWORD charsWritten = ::GetModuleFileNameW(NULL, path.data(), static_cast<DWORD>(path.size()));
 
+    if (charsWritten == 0) {
+      return {};
+    }
+
+    // the path was truncated if the buffer is full
+    if (charsWritten < path.size()) {
+      path.resize(charsWritten);
+      return path;
+    }
+
+    path.resize(path.size() * 2);
+  }
 }
 
-Process::~Process()
+const std::wstring& executable_path()
 {
+  static const std::wstring path = query_module_file_name();
+  return path;
+}
 
+const std::wstring& executable_directory()
+{
+  static const std::wstring dir = executable_path().substr(0, executable_path().find_last_of(L"\\/"));
+  return dir;
 }
 
-/**
- * \brief sets the executable path
- * \param exePath  path to the executable
- */
-void Process::SetExecutablePath(std::string exePath)
+HANDLE duplicate_inheritable(HANDLE handle)
 {
-  d->executable_path = std::move(exePath);
+  if (!handle || handle == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+
+  constexpr DWORD desired_access = 0;
+  constexpr bool inherit_handle = true;
+  HANDLE result = nullptr;
+
+  ::DuplicateHandle(::GetCurrentProcess(), handle, ::GetCurrentProcess(), &result,
+    desired_access, inherit_handle, DUPLICATE_SAME_ACCESS);
+
+  return result;
 }
 
-/**
- * \brief sets the environment variables for the process
- * \param penv  the environment variables
- * 
- * Setting a ProcessEnvironment is optional. 
- * If none is set, the new process will use the environment of its parent.
- */
-void Process::SetProcessEnvironment(ProcessEnvironment penv)
+HANDLE open_inheritable(const std::wstring& path, DWORD access, DWORD disposition)
 {
-  d->environment = std::move(penv);
+  SECURITY_ATTRIBUTES secattrs = { 0 };
+  secattrs.nLength = sizeof(secattrs);
+  secattrs.bInheritHandle = true;
+
+  HANDLE handle = ::CreateFileW(
+    path.c_str(),
+    access,
+    FILE_SHARE_READ | FILE_SHARE_WRITE,
+    &secattrs,
+    disposition,
+    FILE_ATTRIBUTE_NORMAL,
+    nullptr);
+
+  if (handle == INVALID_HANDLE_VALUE) {
+    throw Exception(GetLastError());
+  }
+
+  return handle;
 }
 
-/**
- * \brief stats the process
- */
-void Process::Start()
+HANDLE open_redirect(const StdioRedirect& redirect, DWORD stdHandle)
 {
-  if (d->executable_path.empty())
-    return;
+  const bool input = stdHandle == STD_INPUT_HANDLE;
+
+  switch (redirect.GetKind())
+  {
+  case StdioRedirect::Null:
+    return open_inheritable(L"NUL", input ? GENERIC_READ : GENERIC_WRITE, OPEN_EXISTING);
+  case StdioRedirect::File:
+    if (input) {
+      return open_inheritable(ToUtf16(redirect.GetPath()), GENERIC_READ, OPEN_EXISTING);
+    } else if (redirect.IsAppend()) {
+      return open_inheritable(ToUtf16(redirect.GetPath()), FILE_APPEND_DATA | SYNCHRONIZE, OPEN_ALWAYS);
+    } else {
+      return open_inheritable(ToUtf16(redirect.GetPath()), GENERIC_WRITE, CREATE_ALWAYS);
+    }
+  case StdioRedirect::Handle:
+    return duplicate_inheritable(redirect.GetHandle());
+  case StdioRedirect::Inherit:
+  default:
+    return duplicate_inheritable(::GetStdHandle(stdHandle));
+  }
+}
+
+// Holds the inheritable handles used as the standard streams of a child process.
+// Only these handles are inherited: they are passed to CreateProcess() through
+// a PROC_THREAD_ATTRIBUTE_HANDLE_LIST.
+class StdioHandles
+{
+public:
+  StdioHandles() = default;
+  StdioHandles(const StdioHandles&) = delete;
+
+  ~StdioHandles()
+  {
+    if (m_attributes) {
+      ::DeleteProcThreadAttributeList(m_attributes);
+    }
+
+    for (HANDLE h : m_owned) {
+      ::CloseHandle(h);
+    }
+  }
+
+  void Open(const ProcessPriv& pd)
+  {
+    m_handles[0] = add(open_redirect(pd.stdin_redirect, STD_INPUT_HANDLE));
+    m_handles[1] = add(open_redirect(pd.stdout_redirect, STD_OUTPUT_HANDLE));
+
+    if (shares_output_file(pd)) {
+      m_handles[2] = m_handles[1];
+    } else {
+      m_handles[2] = add(open_redirect(pd.stderr_redirect, STD_ERROR_HANDLE));
+    }
+  }
 
-  TCHAR szCurrentFolder[MAX_PATH] = { 0 };
-  GetModuleFileName(NULL, szCurrentFolder, MAX_PATH);
-  PathRemoveFileSpec(szCurrentFolder);
+  void Apply(STARTUPINFOEXW& si, DWORD& creationFlags)
+  {
+    si.StartupInfo.dwFlags |= STARTF_USESTDHANDLES;
+    si.StartupInfo.hStdInput = m_handles[0];
+    si.StartupInfo.hStdOutput = m_handles[1];
+    si.StartupInfo.hStdError = m_handles[2];
+
+    if (m_owned.empty()) {
+      return;
+    }
+
+    constexpr DWORD attribute_count = 1;
+    constexpr DWORD flags = 0;
+    SIZE_T size = 0;
+    ::InitializeProcThreadAttributeList(nullptr, attribute_count, flags, &size);
+    m_attributes_data.resize(size);
+    auto* attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(m_attributes_data.data());
+
+    if (!::InitializeProcThreadAttributeList(attributes, attribute_count, flags, &size)) {
+      throw Exception(GetLastError());
+    }
+
+    m_attributes = attributes;
+
+    if (!::UpdateProcThreadAttribute(attributes, flags, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+      m_owned.data(), m_owned.size() * sizeof(HANDLE), nullptr, nullptr)) {
+      throw Exception(GetLastError());
+    }
+
+    si.StartupInfo.cb = sizeof(si);
+    si.lpAttributeList = attributes;
+    creationFlags |= EXTENDED_STARTUPINFO_PRESENT;
+  }
+
+  bool InheritsHandles() const
+  {
+    return !m_owned.empty();
+  }
+
+private:
+  HANDLE add(HANDLE handle)
+  {
+    if (handle) {
+      m_owned.push_back(handle);
+    }
+
+    return handle;
+  }
+
+private:
+  HANDLE m_handles[3] = { nullptr, nullptr, nullptr };
+  std::vector<HANDLE> m_owned;
+  std::vector<char> m_attributes_data;
+  LPPROC_THREAD_ATTRIBUTE_LIST m_attributes = nullptr;
+};
+
+void start_process(ProcessPriv& pd)
+{
+  if (pd.executable_path.empty())
+    return;
 
   // start the application
-  STARTUPINFO si = { 0 };
-  si.cb = sizeof(si);
+  STARTUPINFOEXW si = { 0 };
+  si.StartupInfo.cb = sizeof(si.StartupInfo);
   PROCESS_INFORMATION pi = { 0 };
-  constexpr bool inherit_handles = false;
-  constexpr DWORD creation_flags = 0;
+  bool inherit_handles = false;
+  DWORD creation_flags = 0;
+
+  if (pd.job) {
+    creation_flags |= CREATE_SUSPENDED;
+  }
+
+  StdioHandles stdio;
+  if (redirects_stdio(pd))
+  {
+    stdio.Open(pd);
+    stdio.Apply(si, creation_flags);
+    inherit_handles = stdio.InheritsHandles();
+  }
 
   std::vector<char> envdata;
   LPVOID environment = nullptr;
-  if (d->environment.has_value())
+  if (pd.environment.has_value())
   {
-    const ProcessEnvironment& penv = d->environment.value();
+    const ProcessEnvironment& penv = pd.environment.value();
     std::vector<std::string> variables = penv.ToStringList();
     size_t nbchars = std::accumulate(variables.begin(), variables.end(), size_t(0), [](size_t n, const std::string& str) -> size_t {
       return n + str.size() + 1;
@@ -93,9 +282,432 @@ void Process::Start()
     environment = envdata.data();
   }
   
-  CreateProcess(d->executable_path.c_str(), NULL, NULL, NULL, inherit_handles, creation_flags, environment, szCurrentFolder, &si, &pi);
+  const std::wstring wexecutable_path = ToUtf16(pd.executable_path);
+  const std::wstring& current_folder = executable_directory();
 
-  d->handle = pi.hProcess;
+  if (!CreateProcessW(wexecutable_path.c_str(), NULL, NULL, NULL, inherit_handles, creation_flags, environment, current_folder.c_str(), &si.StartupInfo, &pi)) {
+    return;
+  }
+
+  if (pd.job)
+  {
+    if (!::AssignProcessToJobObject(GetHANDLE(*pd.job), pi.hProcess))
+    {
+      ::TerminateProcess(pi.hProcess, 1);
+      ::CloseHandle(pi.hThread);
+      ::CloseHandle(pi.hProcess);
+      return;
+    }
+
+    ::ResumeThread(pi.hThread);
+  }
+
+  ::CloseHandle(pi.hThread);
+  pd.handle = pi.hProcess;
+}
+
+// returns the exit code of the process, STILL_ACTIVE if it is running
+int reap_process(ProcessPriv& pd, bool block)
+{
+  if (block) {
+    ::WaitForSingleObject(pd.handle, INFINITE);
+  }
+
+  DWORD val = 0;
+  ::GetExitCodeProcess(pd.handle, &val);
+  return val;
+}
+
+#else
+std::string query_executable_path()
+{
+  std::string path(PATH_MAX, '\0');
+
+  for (;;)
+  {
+    const ssize_t length = ::readlink("/proc/self/exe", path.data(), path.size());
+
+    if (length == -1) {
+      return {};
+    }
+
+    // the path was truncated if the buffer is full
+    if (static_cast<size_t>(length) < path.size()) {
+      path.resize(static_cast<size_t>(length));
+      return path;
+    }
+
+    path.resize(path.size() * 2);
+  }
+}
+
+const std::string& executable_path()
+{
+  static const std::string path = query_executable_path();
+  return path;
+}
+
+const std::string& executable_directory()
+{
+  static const std::string dir = executable_path().substr(0, executable_path().find_last_of('/'));
+  return dir;
+}
+
+// the standard streams are moved above 2, so that dup2() in the child always
+// clears their close-on-exec flag
+int move_above_stdio(int fd)
+{
+  if (fd == -1 || fd > STDERR_FILENO) {
+    return fd;
+  }
+
+  const int result = ::fcntl(fd, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+  const int err = errno;
+  ::close(fd);
+  errno = err;
+  return result;
+}
+
+// returns -1 if the stream is inherited
+int open_redirect(const StdioRedirect& redirect, int stdio_fd)
+{
+  const bool input = stdio_fd == STDIN_FILENO;
+  int fd = -1;
+
+  switch (redirect.GetKind())
+  {
+  case StdioRedirect::Null:
+    fd = ::open("/dev/null", (input ? O_RDONLY : O_WRONLY) | O_CLOEXEC);
+    break;
+  case StdioRedirect::File:
+    if (input) {
+      fd = ::open(redirect.GetPath().c_str(), O_RDONLY | O_CLOEXEC);
+    } else if (redirect.IsAppend()) {
+      fd = ::open(redirect.GetPath().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    } else {
+      fd = ::open(redirect.GetPath().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    }
+    break;
+  case StdioRedirect::Handle:
+    fd = ::fcntl(redirect.GetFileDescriptor(), F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+
+    if (fd == -1) {
+      throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+    }
+    break;
+  case StdioRedirect::Inherit:
+  default:
+    return -1;
+  }
+
+  fd = move_above_stdio(fd);
+
+  if (fd == -1) {
+    throw Exception(file_error_from_errno(errno, ERROR_OPEN_FAILED));
+  }
+
+  return fd;
+}
+
+// Holds the file descriptors that become the standard streams of a child
+// process, opened by the parent so that failures are reported by Start().
+// All the other file descriptors are closed when the child executes its
+// program, as only the handles in the PROC_THREAD_ATTRIBUTE_HANDLE_LIST are
+// inherited on Windows.
+class StdioFiles
+{
+public:
+  StdioFiles() = default;
+  StdioFiles(const StdioFiles&) = delete;
+
+  ~StdioFiles()
+  {
+    for (int i(0); i < 3; ++i)
+    {
+      if (m_fds[i] != -1 && (i != 2 || m_fds[2] != m_fds[1])) {
+        ::close(m_fds[i]);
+      }
+    }
+  }
+
+  void Open(const ProcessPriv& pd)
+  {
+    m_fds[0] = open_redirect(pd.stdin_redirect, STDIN_FILENO);
+    m_fds[1] = open_redirect(pd.stdout_redirect, STDOUT_FILENO);
+
+    if (shares_output_file(pd)) {
+      m_fds[2] = m_fds[1];
+    } else {
+      m_fds[2] = open_redirect(pd.stderr_redirect, STDERR_FILENO);
+    }
+  }
+
+  // called in the child, between fork() and execve(), where only
+  // async-signal-safe functions can be used
+  bool Apply() const
+  {
+    for (int i(0); i < 3; ++i)
+    {
+      if (m_fds[i] != -1 && ::dup2(m_fds[i], i) == -1) {
+        return false;
+      }
+    }
+
+#ifdef SYS_close_range
+    // not supported before Linux 5.11, the descriptors are then inherited
+    ::syscall(SYS_close_range, STDERR_FILENO + 1, ~0U, CLOSE_RANGE_CLOEXEC);
+#endif
+
+    return true;
+  }
+
+private:
+  int m_fds[3] = { -1, -1, -1 };
+};
+
+// runs in the child: errors are reported to the parent through the pipe,
+// which is closed by a successful execve()
+[[noreturn]] void exec_child(const StdioFiles& stdio, const JobLimits* limits, pid_t parent, const char* path, char* const* argv, char* const* envp, const char* directory, int error_pipe)
+{
+  int err = 0;
+
+  if (!stdio.Apply() || (limits && !apply_job_limits(*limits, parent)) || ::chdir(directory) == -1) {
+    err = errno;
+  } else {
+    ::execve(path, argv, envp);
+    err = errno;
+  }
+
+  while (::write(error_pipe, &err, sizeof(err)) == -1 && errno == EINTR);
+  ::_exit(127);
+}
+
+// returns the errno of the child if it failed to execute its program, 0 otherwise
+int read_child_error(int error_pipe)
+{
+  int err = 0;
+  ssize_t count = 0;
+
+  do
+  {
+    count = ::read(error_pipe, &err, sizeof(err));
+  } while (count == -1 && errno == EINTR);
+
+  return count == sizeof(err) ? err : 0;
+}
+
+void start_process(ProcessPriv& pd)
+{
+  if (pd.executable_path.empty())
+    return;
+
+  StdioFiles stdio;
+  if (redirects_stdio(pd)) {
+    stdio.Open(pd);
+  }
+
+  // everything the child needs is prepared before fork()
+  std::vector<std::string> variables;
+  std::vector<char*> envp;
+  char* const* environment = environ;
+  if (pd.environment.has_value())
+  {
+    variables = pd.environment->ToStringList();
+    for (std::string& str : variables) {
+      envp.push_back(str.data());
+    }
+    envp.push_back(nullptr);
+
+    environment = envp.data();
+  }
+
+  std::string argv0 = pd.executable_path;
+  char* const argv[] = { argv0.data(), nullptr };
+  const std::string& current_folder = executable_directory();
+
+  // the limits of the job are applied by the child, so that they cover
+  // the program from its start
+  JobObjectPriv* job = pd.job ? pd.job->GetImpl() : nullptr;
+  JobLimits limits;
+
+  if (job && !reserve_job_process(*job, limits)) {
+    return;
+  }
+
+  pid_t pid = -1;
+  int error_pipe[2];
+
+  if (::pipe2(error_pipe, O_CLOEXEC) == 0)
+  {
+    const pid_t parent = ::getpid();
+    pid = ::fork();
+
+    if (pid == 0) {
+      exec_child(stdio, job ? &limits : nullptr, parent, pd.executable_path.c_str(), argv, environment, current_folder.c_str(), error_pipe[1]);
+    }
+
+    ::close(error_pipe[1]);
+    const int child_error = pid == -1 ? 0 : read_child_error(error_pipe[0]);
+    ::close(error_pipe[0]);
+
+    if (child_error)
+    {
+      // as if CreateProcess() failed
+      while (::waitpid(pid, nullptr, 0) == -1 && errno == EINTR);
+      pid = -1;
+    }
+  }
+
+  const int pidfd = pid == -1 ? -1 : open_pidfd(pid);
+
+  if (job && !add_reserved_process(*job, pid, pidfd) && pid != -1)
+  {
+    // as on Windows, a process that cannot be added to its job is terminated
+    ::kill(pid, SIGKILL);
+    while (::waitpid(pid, nullptr, 0) == -1 && errno == EINTR);
+    ::close(pidfd);
+    return;
+  }
+
+  if (pid == -1) {
+    return;
+  }
+
+  pd.pid = pid;
+  pd.pidfd = pidfd;
+  pd.exit_code = still_active;
+  pd.reaped = false;
+}
+
+// returns the exit code of the process, still_active if it is running;
+// a process terminated by a signal has the exit code 128 + the signal,
+// as in a shell
+int reap_process(ProcessPriv& pd, bool block)
+{
+  if (pd.pid == -1 || pd.reaped) {
+    return pd.pid == -1 && !pd.reaped ? 0 : pd.exit_code;
+  }
+
+  int status = 0;
+  pid_t result = 0;
+
+  do
+  {
+    result = ::waitpid(pd.pid, &status, block ? 0 : WNOHANG);
+  } while (result == -1 && errno == EINTR);
+
+  if (result != pd.pid) {
+    return still_active;
+  }
+
+  pd.reaped = true;
+  pd.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  return pd.exit_code;
+}
+#endif // _WIN32
+
+} // namespace Impl
+
+Process::Process()
+{
+  d.emplace();
+}
+
+Process::Process(Impl::ProcessPriv&& pd)
+{
+  d.emplace(std::move(pd));
+}
+
+Process::Process(Process&&) noexcept = default;
+
+Process::~Process()
+{
+
+}
+
+/**
+ * \brief sets the executable path
+ * \param exePath  path to the executable
+ */
+void Process::SetExecutablePath(std::string exePath)
+{
+  d->executable_path = std::move(exePath);
+}
+
+/**
+ * \brief sets the environment variables for the process
+ * \param penv  the environment variables
+ * 
+ * Setting a ProcessEnvironment is optional. 
+ * If none is set, the new process will use the environment of its parent.
+ */
+void Process::SetProcessEnvironment(ProcessEnvironment penv)
+{
+  d->environment = std::move(penv);
+}
+
+/**
+ * \brief sets the job object the process is added to
+ * \param job  the job object (can be nullptr)
+ *
+ * The process is started suspended and added to the job before it can
+ * execute any code, so that the limits of the job also apply to the
+ * processes it creates.
+ * On Linux, the limits are applied by the child before it executes its
+ * program.
+ *
+ * The job object must outlive the call to Start().
+ */
+void Process::SetJobObject(JobObject* job)
+{
+  d->job = job;
+}
+
+/**
+ * \brief sets the standard input of the process
+ * \param redirect  where the standard input is read from
+ */
+void Process::SetStandardInput(StdioRedirect redirect)
+{
+  d->stdin_redirect = std::move(redirect);
+}
+
+/**
+ * \brief sets the standard output of the process
+ * \param redirect  where the standard output is written
+ * 
+ * Use StdioRedirect::ToFile() to write the output of the process to a log file.
+ * The default, StdioRedirect::Inherit, forwards the output to the standard output 
+ * of the current process.
+ */
+void Process::SetStandardOutput(StdioRedirect redirect)
+{
+  d->stdout_redirect = std::move(redirect);
+}
+
+/**
+ * \brief sets the standard error of the process
+ * \param redirect  where the standard error is written
+ * 
+ * If the standard output and the standard error are redirected to the 
+ * same file, they share the same file handle.
+ */
+void Process::SetStandardError(StdioRedirect redirect)
+{
+  d->stderr_redirect = std::move(redirect);
+}
+
+/**
+ * \brief stats the process
+ * \throw Exception if a standard stream cannot be redirected
+ *
+ * If the process cannot be added to its job object (see SetJobObject()),
+ * it is terminated and this function behaves as if the process failed
+ * to start.
+ */
+void Process::Start()
+{
+  Impl::start_process(*d);
 }
 
 /**
@@ -103,7 +715,8 @@ void Process::Start()
  */
 void Process::WaitForFinished()
 {
-  WaitForSingleObject(d->handle, INFINITE);
+  constexpr bool block = true;
+  Impl::reap_process(*d, block);
 }
 
 /**
@@ -111,54 +724,77 @@ void Process::WaitForFinished()
  */
 int Process::GetExitCode() const
 {
-  DWORD val = 0;
-  GetExitCodeProcess(d->handle, &val);
-  return val;
+  constexpr bool block = false;
+  return Impl::reap_process(*d, block);
 }
 
 /**
  * \brief returns the path of the executable of the current process
+ * 
+ * The path is retrieved once and cached for the lifetime of the process.
  */
 std::string Process::GetExecutablePath()
 {
-  auto wpath = std::wstring(1024, wchar_t(0));
-  DWORD charsWritten = ::GetModuleFileNameW(
-    NULL,
-    wpath.data(),
-    static_cast<DWORD>(wpath.size()));
-  wpath.resize(charsWritten);
-  return ToUtf8(wpath);
+#ifdef _WIN32
+  static const std::string path = ToUtf8(Impl::executable_path());
+  return path;
+#else
+  return Impl::executable_path();
+#endif // _WIN32
 }
 
+Process& Process::operator=(Process&&) noexcept = default;
+
 Impl::ProcessPriv* Process::GetImpl() const
 {
   return d.get();
 }
 
+#ifdef _WIN32
+
 Process LaunchProcess(const std::string& executable_path)
 {
-  TCHAR szCurrentFolder[MAX_PATH] = { 0 };
-  GetModuleFileName(NULL, szCurrentFolder, MAX_PATH);
-  PathRemoveFileSpec(szCurrentFolder);
-
-  // add the application name to the path
-  //TCHAR szApplicationPath[MAX_PATH];
-  //PathCombine(szApplicationPath, szCurrentFolder, executable_path.c_str());
+  const std::wstring& current_folder = Impl::executable_directory();
 
   // start the application
-  STARTUPINFO si = { 0 };
+  STARTUPINFOW si = { 0 };
   si.cb = sizeof(si);
   PROCESS_INFORMATION pi = { 0 };
   //CreateProcess(szApplicationPath, NULL, NULL, NULL, FALSE, 0, NULL, szCurrentFolder, &si, &pi);
   constexpr bool inherit_handles = false;
   constexpr DWORD creation_flags = 0;
   LPVOID environment = nullptr;
-  CreateProcess(executable_path.c_str(), NULL, NULL, NULL, inherit_handles, creation_flags, environment, szCurrentFolder, &si, &pi);
+  const std::wstring wexecutable_path = ToUtf16(executable_path);
+  CreateProcessW(wexecutable_path.c_str(), NULL, NULL, NULL, inherit_handles, creation_flags, environment, current_folder.c_str(), &si, &pi);
+  ::CloseHandle(pi.hThread);
 
   Impl::ProcessPriv pd;
   pd.handle = pi.hProcess;
   pd.executable_path = executable_path;
-  return Process(std::make_unique<Impl::ProcessPriv>(pd));
+  return Process(std::move(pd));
+}
+
+#else
+
+Process LaunchProcess(const std::string& executable_path)
+{
+  Process process;
+  process.SetExecutablePath(executable_path);
+  process.Start();
+  return process;
 }
 
+/**
+ * \brief returns a pidfd that is readable once the process has exited
+ *
+ * Returns -1 if the process was not started or if the system does not
+ * support pidfds (Linux 5.3).
+ */
+int GetFileDescriptor(const Process& process)
+{
+  return process.GetImpl() ? process.GetImpl()->pidfd : -1;
+}
+
+#endif // _WIN32
+
 } // namespace Win32
\ No newline at end of file
@@ -5,12 +5,14 @@
 #ifndef WINAPI_PROCESS_H
 #define WINAPI_PROCESS_H
 
-#include <memory>
+#include "FastPimpl.h"
+
 #include <string>
 
 namespace Win32
 {
 
+class JobObject;
 class ProcessEnvironment;
 
 namespace Impl
@@ -18,6 +20,56 @@ namespace Impl
 struct ProcessPriv;
 } // namespace Impl
 
+/**
+ * \brief describes where a standard stream of a process is connected
+ * 
+ * By default, a standard stream is inherited from the parent process.
+ * 
+ * Redirections are performed by the system: the child process reads or
+ * writes the file or handle directly and no data goes through the parent.
+ * On Linux, the files are opened by the parent and become the standard
+ * streams of the child before it executes its program.
+ */
+class StdioRedirect
+{
+public:
+  enum Kind
+  {
+    Inherit,
+    Null,
+    File,
+    Handle,
+  };
+
+  StdioRedirect() = default;
+  StdioRedirect(const StdioRedirect&) = default;
+  ~StdioRedirect() = default;
+
+  static StdioRedirect ToNull();
+  static StdioRedirect ToFile(std::string path, bool append = false);
+  static StdioRedirect ToHandle(void* handle);
+#ifndef _WIN32
+  static StdioRedirect ToFileDescriptor(int fd);
+#endif // !_WIN32
+
+  Kind GetKind() const;
+  const std::string& GetPath() const;
+  bool IsAppend() const;
+  void* GetHandle() const;
+#ifndef _WIN32
+  int GetFileDescriptor() const;
+#endif // !_WIN32
+
+  StdioRedirect& operator=(const StdioRedirect&) = default;
+
+private:
+  Kind m_kind = Inherit;
+  std::string m_path;
+  bool m_append = false;
+  void* m_handle = nullptr;
+  int m_fd = -1;
+};
+
 /**
  * \brief represents a process
  */
@@ -26,13 +78,18 @@ class Process
 public:
   Process();
   Process(const Process&) = delete;
-  Process(Process&&) = default;
+  Process(Process&&) noexcept;
   ~Process();
 
-  explicit Process(std::unique_ptr<Impl::ProcessPriv> pd);
+  explicit Process(Impl::ProcessPriv&& pd);
 
   void SetExecutablePath(std::string exe_path);
   void SetProcessEnvironment(ProcessEnvironment penv);
+  void SetJobObject(JobObject* job);
+
+  void SetStandardInput(StdioRedirect redirect);
+  void SetStandardOutput(StdioRedirect redirect);
+  void SetStandardError(StdioRedirect redirect);
 
   void Start();
 
@@ -42,14 +99,126 @@ public:
 
   static std::string GetExecutablePath();
 
+  Process& operator=(const Process&) = delete;
+  Process& operator=(Process&&) noexcept;
+
   Impl::ProcessPriv* GetImpl() const;
 
 private:
-  std::unique_ptr<Impl::ProcessPriv> d;
+  Impl::FastPimpl<Impl::ProcessPriv, 320> d;
 };
 
 Process LaunchProcess(const std::string& executable_path);
 
+/**
+ * \brief returns a redirection to the null device
+ * 
+ * Reading from the null device returns end-of-file and everything that 
+ * is written to it is discarded.
+ */
+inline StdioRedirect StdioRedirect::ToNull()
+{
+  StdioRedirect r;
+  r.m_kind = Null;
+  return r;
+}
+
+/**
+ * \brief returns a redirection to a file
+ * \param path    path of the file
+ * \param append  whether output should be appended to the file
+ * 
+ * When used for an output stream, the file is created if it does not exist
+ * and truncated unless \a append is true.
+ * When used for the standard input, the file must exist.
+ */
+inline StdioRedirect StdioRedirect::ToFile(std::string path, bool append)
+{
+  StdioRedirect r;
+  r.m_kind = File;
+  r.m_path = std::move(path);
+  r.m_append = append;
+  return r;
+}
+
+/**
+ * \brief returns a redirection to an existing handle
+ * \param handle  a file, pipe or console HANDLE
+ * 
+ * The handle is duplicated when the process starts, it is not required to
+ * be inheritable and may be closed afterwards.
+ */
+inline StdioRedirect StdioRedirect::ToHandle(void* handle)
+{
+  StdioRedirect r;
+  r.m_kind = Handle;
+  r.m_handle = handle;
+  return r;
+}
+
+#ifndef _WIN32
+
+/**
+ * \brief returns a redirection to an existing file descriptor
+ * \param fd  a file, pipe or terminal file descriptor
+ * 
+ * This is the Handle redirection of Linux: the file descriptor is duplicated
+ * when the process starts and may be closed afterwards.
+ */
+inline StdioRedirect StdioRedirect::ToFileDescriptor(int fd)
+{
+  StdioRedirect r;
+  r.m_kind = Handle;
+  r.m_fd = fd;
+  return r;
+}
+
+#endif // !_WIN32
+
+/**
+ * \brief returns the kind of redirection
+ */
+inline StdioRedirect::Kind StdioRedirect::GetKind() const
+{
+  return m_kind;
+}
+
+/**
+ * \brief returns the path of the file for a File redirection
+ */
+inline const std::string& StdioRedirect::GetPath() const
+{
+  return m_path;
+}
+
+/**
+ * \brief returns whether output is appended to the file for a File redirection
+ */
+inline bool StdioRedirect::IsAppend() const
+{
+  return m_append;
+}
+
+/**
+ * \brief returns the handle for a Handle redirection
+ */
+inline void* StdioRedirect::GetHandle() const
+{
+  return m_handle;
+}
+
+#ifndef _WIN32
+
+/**
+ * \brief returns the file descriptor for a Handle redirection
+ */
+inline int StdioRedirect::GetFileDescriptor() const
+{
+  return m_fd;
+}
+
+#endif // !_WIN32
+
 } // namespace Win32
 
 #endif // WINAPI_PROCESS_H
\ No newline at end of file
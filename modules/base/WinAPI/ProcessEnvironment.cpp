@@ -2,9 +2,15 @@
 // This file is part of the WinAPI project.
 // For conditions of distribution and use, see copyright notice in LICENSE.
 
-#include "processenvironment.h"
+#include "ProcessEnvironment.h"
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
 
 namespace Win32
 {
@@ -16,6 +22,7 @@ ProcessEnvironment ProcessEnvironment::GetSystemEnvironment()
 {
   ProcessEnvironment r;
 
+#ifdef _WIN32
   // format for 'data' is "Var1=Value1\0Var2=Value2\0VarN=ValueN\0\0"
   char* data = GetEnvironmentStrings();
 
@@ -37,6 +44,18 @@ ProcessEnvironment ProcessEnvironment::GetSystemEnvironment()
   }
 
   FreeEnvironmentStrings(data);
+#else
+  for (char** variable = environ; *variable; ++variable)
+  {
+    const char* begin = *variable;
+    const char* end = begin + std::char_traits<char>::length(begin);
+    const char* eq = std::find(begin, end, '=');
+
+    if (eq != end) {
+      r.Insert(std::string(begin, eq), std::string(eq + 1, end));
+    }
+  }
+#endif // _WIN32
 
   return r;
 }
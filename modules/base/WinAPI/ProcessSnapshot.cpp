@@ -0,0 +1,535 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "ProcessSnapshot.h"
+
+#include "Exception.h"
+
+#ifdef _WIN32
+#include "String.h"
+
+#include <Windows.h>
+#else
+#include "filemapping_priv.h"
+#include "winerror_priv.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+// lowercase, as file names are case-insensitive
+using name_key = std::wstring;
+#else
+using name_key = std::string;
+#endif // _WIN32
+
+// data kept alongside each ProcessInfo to speed up refreshes and lookups
+struct ProcessEntry
+{
+  // identifies the process along with its id, which can be reused
+  unsigned long long start_time = 0;
+  name_key name;
+#ifndef _WIN32
+  // the inode of the directory of the process in /proc
+  ino_t inode = 0;
+#endif // !_WIN32
+};
+
+struct ProcessSnapshotPriv
+{
+  std::vector<ProcessInfo> processes;
+  std::vector<ProcessEntry> entries;
+  std::unordered_map<unsigned long, size_t> by_pid;
+  // the names point into the entries
+  std::unordered_multimap<std::basic_string_view<name_key::value_type>, size_t> by_name;
+#ifdef _WIN32
+  std::vector<unsigned char> buffer;
+  std::vector<wchar_t> path_buffer;
+#else
+  std::vector<char> path_buffer;
+  std::chrono::system_clock::time_point boot_time;
+#endif // _WIN32
+};
+
+// the processes listed by a refresh
+struct ProcessList
+{
+  std::vector<ProcessInfo> processes;
+  std::vector<ProcessEntry> entries;
+  std::unordered_map<unsigned long, size_t> by_pid;
+
+  explicit ProcessList(size_t capacity)
+  {
+    processes.reserve(capacity);
+    entries.reserve(capacity);
+    by_pid.reserve(capacity);
+  }
+};
+
+void add_process(ProcessList& list, ProcessInfo info, ProcessEntry entry)
+{
+  const unsigned long pid = info.processId;
+  list.processes.push_back(std::move(info));
+  list.entries.push_back(std::move(entry));
+  list.by_pid[pid] = list.processes.size() - 1;
+}
+
+// moves a process of the previous snapshot to the list if it is the same
+// process, i.e. if it has the same id and start time
+bool keep_process(ProcessSnapshotPriv& snapshot, ProcessList& list, unsigned long pid, unsigned long long start_time)
+{
+  auto it = snapshot.by_pid.find(pid);
+
+  if (it == snapshot.by_pid.end() || snapshot.entries[it->second].start_time != start_time) {
+    return false;
+  }
+
+  add_process(list, std::move(snapshot.processes[it->second]), std::move(snapshot.entries[it->second]));
+  return true;
+}
+
+#ifdef _WIN32
+
+// The following definitions are those of the ntdll.dll API.
+// The SYSTEM_PROCESS_INFORMATION structure from <winternl.h> hides most of the
+// fields we are interested in, so we use our own (truncated) definition.
+
+struct unicode_string
+{
+  USHORT Length;
+  USHORT MaximumLength;
+  PWSTR Buffer;
+};
+
+struct system_process_information
+{
+  ULONG NextEntryOffset;
+  ULONG NumberOfThreads;
+  LARGE_INTEGER WorkingSetPrivateSize;
+  ULONG HardFaultCount;
+  ULONG NumberOfThreadsHighWatermark;
+  ULONGLONG CycleTime;
+  LARGE_INTEGER CreateTime;
+  LARGE_INTEGER UserTime;
+  LARGE_INTEGER KernelTime;
+  unicode_string ImageName;
+  LONG BasePriority;
+  HANDLE UniqueProcessId;
+  HANDLE InheritedFromUniqueProcessId;
+};
+
+using NtQuerySystemInformationPtr = LONG(NTAPI*)(ULONG, PVOID, ULONG, PULONG);
+using RtlNtStatusToDosErrorPtr = ULONG(NTAPI*)(LONG);
+
+constexpr ULONG system_process_information_class = 5;
+constexpr LONG status_info_length_mismatch = static_cast<LONG>(0xC0000004);
+
+NtQuerySystemInformationPtr get_NtQuerySystemInformation()
+{
+  static const auto fn = reinterpret_cast<NtQuerySystemInformationPtr>(
+    ::GetProcAddress(::GetModuleHandleW(L"ntdll.dll"), "NtQuerySystemInformation"));
+  return fn;
+}
+
+ErrorCode to_error_code(LONG status)
+{
+  static const auto fn = reinterpret_cast<RtlNtStatusToDosErrorPtr>(
+    ::GetProcAddress(::GetModuleHandleW(L"ntdll.dll"), "RtlNtStatusToDosError"));
+  return ErrorCode(fn ? static_cast<long>(fn(status)) : ERROR_GEN_FAILURE);
+}
+
+std::chrono::system_clock::time_point to_time_point(ULONGLONG filetime)
+{
+  // number of 100-nanosecond intervals between 1601-01-01 and 1970-01-01
+  constexpr ULONGLONG epoch_difference = 116444736000000000ULL;
+
+  if (filetime < epoch_difference) {
+    return {};
+  }
+
+  using filetime_duration = std::chrono::duration<long long, std::ratio<1, 10000000>>;
+  auto d = filetime_duration(static_cast<long long>(filetime - epoch_difference));
+  return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(d));
+}
+
+// fills the buffer with the SYSTEM_PROCESS_INFORMATION list, in a single system call
+// unless the buffer needs to grow
+void query_system_processes(ProcessSnapshotPriv& snapshot)
+{
+  NtQuerySystemInformationPtr query = get_NtQuerySystemInformation();
+
+  if (!query) {
+    throw Exception(GetLastError());
+  }
+
+  if (snapshot.buffer.empty()) {
+    snapshot.buffer.resize(512 * 1024);
+  }
+
+  for (;;)
+  {
+    ULONG required = 0;
+    LONG status = query(
+      system_process_information_class,
+      snapshot.buffer.data(),
+      static_cast<ULONG>(snapshot.buffer.size()),
+      &required);
+
+    if (status == status_info_length_mismatch) {
+      // processes may be created between two calls, leave some room
+      snapshot.buffer.resize(required + required / 4);
+    } else if (status < 0) {
+      throw Exception(to_error_code(status));
+    } else {
+      return;
+    }
+  }
+}
+
+std::string query_executable_path(ProcessSnapshotPriv& snapshot, unsigned long pid)
+{
+  constexpr bool inherit_handle = false;
+  HANDLE process = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, inherit_handle, pid);
+
+  if (!process) {
+    return {};
+  }
+
+  // large enough for long paths, allocated once and never cleared
+  if (snapshot.path_buffer.empty()) {
+    snapshot.path_buffer.resize(32768);
+  }
+
+  DWORD size = static_cast<DWORD>(snapshot.path_buffer.size());
+  constexpr DWORD flags = 0;
+  BOOL ok = ::QueryFullProcessImageNameW(process, flags, snapshot.path_buffer.data(), &size);
+  ::CloseHandle(process);
+
+  if (!ok) {
+    return {};
+  }
+
+  return ToUtf8(std::wstring(snapshot.path_buffer.data(), size));
+}
+
+ProcessList list_processes(ProcessSnapshotPriv& snapshot)
+{
+  query_system_processes(snapshot);
+
+  ProcessList list{ snapshot.processes.size() + 16 };
+  const unsigned char* ptr = snapshot.buffer.data();
+
+  for (;;)
+  {
+    const auto* spi = reinterpret_cast<const system_process_information*>(ptr);
+    const auto pid = static_cast<unsigned long>(reinterpret_cast<ULONG_PTR>(spi->UniqueProcessId));
+    const auto create_time = static_cast<ULONGLONG>(spi->CreateTime.QuadPart);
+
+    if (!keep_process(snapshot, list, pid, create_time))
+    {
+      std::wstring wname;
+      if (spi->ImageName.Buffer) {
+        wname.assign(spi->ImageName.Buffer, spi->ImageName.Length / sizeof(wchar_t));
+      }
+
+      ProcessInfo info;
+      info.processId = pid;
+      info.parentProcessId = static_cast<unsigned long>(reinterpret_cast<ULONG_PTR>(spi->InheritedFromUniqueProcessId));
+      info.executableName = ToUtf8(wname);
+      info.executablePath = query_executable_path(snapshot, pid);
+      info.startTime = to_time_point(create_time);
+
+      ProcessEntry entry;
+      entry.start_time = create_time;
+      entry.name = ToLower(std::move(wname));
+      add_process(list, std::move(info), std::move(entry));
+    }
+
+    if (spi->NextEntryOffset == 0) {
+      break;
+    }
+
+    ptr += spi->NextEntryOffset;
+  }
+
+  return list;
+}
+
+name_key to_name_key(const std::string& exename)
+{
+  return ToLower(ToUtf16(exename));
+}
+
+#else
+
+// the fields of /proc/<pid>/stat that are used
+struct ProcessStat
+{
+  std::string command;
+  unsigned long parent_id = 0;
+  // in clock ticks since boot
+  unsigned long long start_time = 0;
+};
+
+// the time at which the system booted, in the system clock
+std::chrono::system_clock::time_point query_boot_time()
+{
+  struct timespec uptime = {};
+  ::clock_gettime(CLOCK_BOOTTIME, &uptime);
+  return std::chrono::system_clock::now() - std::chrono::seconds(uptime.tv_sec) - std::chrono::nanoseconds(uptime.tv_nsec);
+}
+
+// reads the stat file of a process, in a single read(); fails if the process
+// exited since /proc was listed
+bool read_process_stat(int proc_fd, const char* pid, ProcessStat& stat)
+{
+  char path[64];
+  std::snprintf(path, sizeof(path), "%s/stat", pid);
+  const int fd = ::openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1) {
+    return false;
+  }
+
+  char buffer[1024];
+  const ssize_t size = ::read(fd, buffer, sizeof(buffer) - 1);
+  ::close(fd);
+
+  if (size <= 0) {
+    return false;
+  }
+
+  buffer[size] = '\0';
+
+  // the command is in parentheses and may itself contain any character
+  const char* begin = std::strchr(buffer, '(');
+  const char* end = std::strrchr(buffer, ')');
+
+  if (!begin || !end || end < begin) {
+    return false;
+  }
+
+  stat.command.assign(begin + 1, end);
+
+  // the state, the parent id, 17 fields and the start time (fields 3, 4 and 22)
+  return std::sscanf(end + 1, " %*c %lu %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %llu",
+    &stat.parent_id, &stat.start_time) == 2;
+}
+
+// the link cannot be read for the processes of other users
+std::string query_executable_path(ProcessSnapshotPriv& snapshot, int proc_fd, const char* pid)
+{
+  if (snapshot.path_buffer.empty()) {
+    snapshot.path_buffer.resize(PATH_MAX);
+  }
+
+  char path[64];
+  std::snprintf(path, sizeof(path), "%s/exe", pid);
+  const ssize_t size = ::readlinkat(proc_fd, path, snapshot.path_buffer.data(), snapshot.path_buffer.size());
+
+  if (size <= 0 || static_cast<size_t>(size) == snapshot.path_buffer.size()) {
+    return {};
+  }
+
+  return std::string(snapshot.path_buffer.data(), static_cast<size_t>(size));
+}
+
+ProcessList list_processes(ProcessSnapshotPriv& snapshot)
+{
+  std::unique_ptr<DIR, int(*)(DIR*)> proc{ ::opendir("/proc"), ::closedir };
+
+  if (!proc) {
+    throw Exception(file_error_from_errno(errno, ERROR_OPEN_FAILED));
+  }
+
+  if (snapshot.boot_time == std::chrono::system_clock::time_point()) {
+    snapshot.boot_time = query_boot_time();
+  }
+
+  const long ticks_per_second = ::sysconf(_SC_CLK_TCK);
+  const int proc_fd = ::dirfd(proc.get());
+  ProcessList list{ snapshot.processes.size() + 16 };
+  ProcessStat stat;
+
+  while (const struct dirent* dir_entry = ::readdir(proc.get()))
+  {
+    // the other entries of /proc are not processes
+    const char* name = dir_entry->d_name;
+    char* name_end = nullptr;
+    const unsigned long pid = std::strtoul(name, &name_end, 10);
+
+    if (name[0] < '0' || name[0] > '9' || *name_end != '\0') {
+      continue;
+    }
+
+    // the directory of a process gets a new inode if its id is reused, so
+    // that the processes already known are kept without reading their stat
+    // file; the inode may also change if the directory was evicted from the
+    // cache, the start time is then compared
+    auto it = snapshot.by_pid.find(pid);
+
+    if (it != snapshot.by_pid.end() && snapshot.entries[it->second].inode == dir_entry->d_ino)
+    {
+      add_process(list, std::move(snapshot.processes[it->second]), std::move(snapshot.entries[it->second]));
+      continue;
+    }
+
+    if (!read_process_stat(proc_fd, name, stat)) {
+      continue;
+    }
+
+    if (keep_process(snapshot, list, pid, stat.start_time))
+    {
+      list.entries.back().inode = dir_entry->d_ino;
+      continue;
+    }
+
+    ProcessInfo info;
+    info.processId = pid;
+    info.parentProcessId = stat.parent_id;
+    info.executablePath = query_executable_path(snapshot, proc_fd, name);
+    // the command is truncated to 15 characters, the path is preferred
+    info.executableName = info.executablePath.empty() ? stat.command : info.executablePath.substr(info.executablePath.rfind('/') + 1);
+    info.startTime = snapshot.boot_time + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+      std::chrono::microseconds(stat.start_time * 1000000 / static_cast<unsigned long long>(ticks_per_second)));
+
+    ProcessEntry entry;
+    entry.start_time = stat.start_time;
+    entry.name = info.executableName;
+    entry.inode = dir_entry->d_ino;
+    add_process(list, std::move(info), std::move(entry));
+  }
+
+  return list;
+}
+
+name_key to_name_key(const std::string& exename)
+{
+  return exename;
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+/**
+ * \brief constructs an empty snapshot
+ *
+ * Call Refresh() to fill the snapshot.
+ */
+ProcessSnapshot::ProcessSnapshot()
+  : d(std::make_unique<Impl::ProcessSnapshotPriv>())
+{
+
+}
+
+ProcessSnapshot::ProcessSnapshot(ProcessSnapshot&&) noexcept = default;
+
+ProcessSnapshot::~ProcessSnapshot()
+{
+
+}
+
+/**
+ * \brief updates the list of running processes
+ * \throw Exception on failure
+ *
+ * The list is retrieved with a single call to NtQuerySystemInformation().
+ * Processes that were already present in the previous snapshot keep their
+ * information, only the executable path of new processes is queried.
+ *
+ * On Linux, the list is read from /proc: only the stat file and the link to
+ * the executable of new processes are read, the other processes are
+ * identified by the inode of their directory.
+ *
+ * The executable path is left empty for processes that cannot be opened
+ * by the current process (e.g., system processes).
+ */
+void ProcessSnapshot::Refresh()
+{
+  Impl::ProcessList list = Impl::list_processes(*d);
+  d->processes = std::move(list.processes);
+  d->entries = std::move(list.entries);
+  d->by_pid = std::move(list.by_pid);
+
+  d->by_name.clear();
+  d->by_name.reserve(d->entries.size());
+
+  for (size_t i(0); i < d->entries.size(); ++i) {
+    d->by_name.emplace(d->entries[i].name, i);
+  }
+}
+
+/**
+ * \brief returns the processes in the snapshot
+ */
+const std::vector<ProcessInfo>& ProcessSnapshot::GetProcesses() const
+{
+  return d->processes;
+}
+
+/**
+ * \brief finds a process given its id
+ * \param processId  the id of the process
+ *
+ * Returns nullptr if no such process is in the snapshot.
+ */
+const ProcessInfo* ProcessSnapshot::Find(unsigned long processId) const
+{
+  auto it = d->by_pid.find(processId);
+  return it != d->by_pid.end() ? &d->processes[it->second] : nullptr;
+}
+
+/**
+ * \brief finds the processes running a given executable
+ * \param exename  the file name of the executable, including the extension
+ *
+ * The comparison is case-insensitive on Windows; the processes are looked up
+ * in an index of their lowercase names, built by Refresh().
+ */
+std::vector<const ProcessInfo*> ProcessSnapshot::FindByExecutableName(const std::string& exename) const
+{
+  const Impl::name_key name = Impl::to_name_key(exename);
+  auto range = d->by_name.equal_range(name);
+  std::vector<size_t> indices;
+
+  for (auto it = range.first; it != range.second; ++it) {
+    indices.push_back(it->second);
+  }
+
+  // in the order of the snapshot
+  std::sort(indices.begin(), indices.end());
+
+  std::vector<const ProcessInfo*> result;
+  result.reserve(indices.size());
+
+  for (size_t i : indices) {
+    result.push_back(&d->processes[i]);
+  }
+
+  return result;
+}
+
+ProcessSnapshot& ProcessSnapshot::operator=(ProcessSnapshot&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
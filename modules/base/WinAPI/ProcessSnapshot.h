@@ -0,0 +1,69 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_PROCESSSNAPSHOT_H
+#define WINAPI_PROCESSSNAPSHOT_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct ProcessSnapshotPriv;
+} // namespace Impl
+
+/**
+ * \brief describes a running process
+ */
+struct ProcessInfo
+{
+  unsigned long processId = 0;
+  unsigned long parentProcessId = 0;
+  std::string executableName;
+  std::string executablePath;
+  std::chrono::system_clock::time_point startTime;
+};
+
+/**
+ * \brief provides the list of the processes running on the system
+ *
+ * The list is built by Refresh().
+ * Information that is expensive to retrieve (e.g., the path of the executable)
+ * is kept from one refresh to the next for the processes that are still running,
+ * so refreshing a snapshot is much cheaper than creating a new one.
+ *
+ * On Linux, the processes are listed from /proc. The executable name is the
+ * file name of the executable, or the name of the command (truncated to 15
+ * characters) if the executable cannot be read, e.g. for the processes of
+ * other users.
+ */
+class ProcessSnapshot
+{
+public:
+  ProcessSnapshot();
+  ProcessSnapshot(const ProcessSnapshot&) = delete;
+  ProcessSnapshot(ProcessSnapshot&&) noexcept;
+  ~ProcessSnapshot();
+
+  void Refresh();
+
+  const std::vector<ProcessInfo>& GetProcesses() const;
+  const ProcessInfo* Find(unsigned long processId) const;
+  std::vector<const ProcessInfo*> FindByExecutableName(const std::string& exename) const;
+
+  ProcessSnapshot& operator=(const ProcessSnapshot&) = delete;
+  ProcessSnapshot& operator=(ProcessSnapshot&&) noexcept;
+
+private:
+  std::unique_ptr<Impl::ProcessSnapshotPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_PROCESSSNAPSHOT_H
\ No newline at end of file
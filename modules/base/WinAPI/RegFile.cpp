@@ -0,0 +1,1036 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegFile.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+#include "RegistryEnumeration.h"
+#include "utf16_priv.h"
+
+#ifdef _WIN32
+#include "String.h"
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+constexpr size_t regfile_chunk_size = 64 * 1024;
+constexpr std::string_view regfile_header = "Windows Registry Editor Version 5.00";
+constexpr std::string_view regfile_header_regedit4 = "REGEDIT4";
+constexpr size_t regfile_max_hex_column = 76;
+
+struct RegFileReaderPriv
+{
+  RegistryBackend* backend = nullptr;
+  size_t error_line = 0;
+};
+
+struct RegFileWriterPriv
+{
+  std::ostream* output = nullptr;
+  RegFileWriter::Encoding encoding = RegFileWriter::Utf16;
+  // the text waiting to be written, in UTF-8
+  std::string buffer;
+  std::vector<char> encoded;
+  RegistrySubKeyList subkeys;
+  RegistryValueList values;
+};
+
+// the error of a file that could not be opened
+ErrorCode regfile_open_error()
+{
+  if (errno == ENOENT) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  } else if (errno == EACCES) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  } else {
+    return ErrorCode(ERROR_OPEN_FAILED);
+  }
+}
+
+// the input of the reader, decoded to UTF-8 chunk by chunk
+struct regfile_input
+{
+  std::istream* stream = nullptr;
+  bool utf16 = false;
+  bool started = false;
+  bool eof = false;
+  // bytes read but not decoded yet (UTF-16 only)
+  std::vector<char> raw;
+  std::string text;
+  size_t position = 0;
+};
+
+// reads a chunk of the input and appends it to the text
+ErrorCode read_regfile_chunk(regfile_input& input)
+{
+  const size_t kept = input.raw.size();
+  input.raw.resize(kept + regfile_chunk_size);
+  input.stream->read(input.raw.data() + kept, regfile_chunk_size);
+  input.raw.resize(kept + static_cast<size_t>(input.stream->gcount()));
+
+  if (!*input.stream)
+  {
+    if (input.stream->bad()) {
+      return ErrorCode(ERROR_READ_FAULT);
+    }
+
+    input.eof = true;
+  }
+
+  size_t begin = 0;
+
+  if (!input.started && (input.raw.size() >= 3 || input.eof))
+  {
+    input.started = true;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(input.raw.data());
+
+    if (input.raw.size() >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE)
+    {
+      input.utf16 = true;
+      begin = 2;
+    }
+    else if (input.raw.size() >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF)
+    {
+      begin = 3;
+    }
+  }
+  else if (!input.started)
+  {
+    return ErrorCode();
+  }
+
+  if (!input.utf16)
+  {
+    input.text.append(input.raw.data() + begin, input.raw.size() - begin);
+    input.raw.clear();
+    return ErrorCode();
+  }
+
+  size_t size = (input.raw.size() - begin) & ~size_t(1);
+
+  // a surrogate pair is decoded once both its halves are read
+  if (size >= 2 && !input.eof)
+  {
+    const auto* last = reinterpret_cast<const unsigned char*>(input.raw.data() + begin + size - 2);
+    const char16_t c = static_cast<char16_t>(last[0] | (last[1] << 8));
+
+    if (c >= 0xD800 && c < 0xDC00) {
+      size -= 2;
+    }
+  }
+
+  append_utf16le_as_utf8(input.text, input.raw.data() + begin, size);
+  input.raw.erase(input.raw.begin(), input.raw.begin() + static_cast<std::ptrdiff_t>(begin + size));
+  return ErrorCode();
+}
+
+// appends the next line of the input to line, without its end of line;
+// returns false at the end of the input
+bool read_regfile_line(regfile_input& input, std::string& line, ErrorCode& err)
+{
+  for (;;)
+  {
+    const char* begin = input.text.data() + input.position;
+    const size_t available = input.text.size() - input.position;
+    const auto* newline = static_cast<const char*>(std::memchr(begin, '\n', available));
+
+    if (newline || (input.eof && available > 0))
+    {
+      size_t length = newline ? static_cast<size_t>(newline - begin) : available;
+      input.position += newline ? length + 1 : length;
+
+      if (length > 0 && begin[length - 1] == '\r') {
+        --length;
+      }
+
+      line.append(begin, length);
+      return true;
+    }
+
+    if (input.eof) {
+      return false;
+    }
+
+    // the line continues in the next chunk
+    input.text.erase(0, input.position);
+    input.position = 0;
+    err = read_regfile_chunk(input);
+
+    if (err) {
+      return false;
+    }
+  }
+}
+
+inline bool is_regfile_space(char c)
+{
+  return c == ' ' || c == '\t';
+}
+
+inline int regfile_hex_digit(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  } else {
+    return -1;
+  }
+}
+
+std::string_view trim_regfile_line(std::string_view line)
+{
+  while (!line.empty() && is_regfile_space(line.front())) {
+    line.remove_prefix(1);
+  }
+
+  while (!line.empty() && is_regfile_space(line.back())) {
+    line.remove_suffix(1);
+  }
+
+  return line;
+}
+
+bool find_regfile_root(std::string_view name, RegistryBackend::PredefinedKey& root)
+{
+  static const struct
+  {
+    std::string_view name;
+    std::string_view abbreviation;
+    RegistryBackend::PredefinedKey key;
+  } roots[] = {
+    { "HKEY_CLASSES_ROOT", "HKCR", RegistryBackend::ClassesRoot },
+    { "HKEY_CURRENT_CONFIG", "HKCC", RegistryBackend::CurrentConfig },
+    { "HKEY_CURRENT_USER", "HKCU", RegistryBackend::CurrentUser },
+    { "HKEY_LOCAL_MACHINE", "HKLM", RegistryBackend::LocalMachine },
+    { "HKEY_USERS", "HKU", RegistryBackend::Users },
+  };
+
+  for (const auto& r : roots)
+  {
+    if (registry_name_equal()(name, r.name) || registry_name_equal()(name, r.abbreviation))
+    {
+      root = r.key;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// reads a quoted string starting at p, where backslashes escape the next
+// character, and moves p after the closing quote
+bool parse_regfile_string(const char*& p, const char* end, std::string& result)
+{
+  result.clear();
+  ++p;
+
+  while (p < end)
+  {
+    const char* special = p;
+
+    while (special < end && *special != '"' && *special != '\\') {
+      ++special;
+    }
+
+    result.append(p, special);
+    p = special;
+
+    if (p == end) {
+      return false;
+    }
+
+    if (*p == '"')
+    {
+      ++p;
+      return true;
+    }
+
+    if (++p == end) {
+      return false;
+    }
+
+    result.push_back(*p++);
+  }
+
+  return false;
+}
+
+// decodes a comma-separated list of hexadecimal bytes, in place
+bool decode_regfile_hex(char* p, const char* end, size_t& size)
+{
+  auto* out = reinterpret_cast<unsigned char*>(p);
+  size = 0;
+
+  while (p < end)
+  {
+    if (*p == ',' || is_regfile_space(*p))
+    {
+      ++p;
+      continue;
+    }
+
+    const int high = regfile_hex_digit(*p++);
+    const int low = p < end ? regfile_hex_digit(*p) : -1;
+
+    if (high < 0) {
+      return false;
+    }
+
+    if (low >= 0) {
+      ++p;
+    }
+
+    out[size++] = static_cast<unsigned char>(low >= 0 ? (high << 4) | low : high);
+  }
+
+  return true;
+}
+
+// deletes a key and its subkeys, a key that does not exist is not an error
+ErrorCode delete_regfile_key(RegistryBackend& backend, RegistryBackend::KeyHandle parent, const std::string& subKey)
+{
+  RegistryBackend::KeyHandle key = nullptr;
+  ErrorCode err = backend.OpenKey(parent, subKey, static_cast<Registry::AccessRights>(Registry::Read | Registry::Write), key);
+
+  if (err.Value() == ERROR_FILE_NOT_FOUND) {
+    return ErrorCode();
+  } else if (err) {
+    return err;
+  }
+
+  // the first subkey is deleted until there is none left
+  std::u16string name(256, u'\0');
+
+  for (;;)
+  {
+    size_t length = name.size();
+    err = backend.EnumKey(key, 0, &name[0], length);
+
+    if (err.Value() == ERROR_MORE_DATA)
+    {
+      name.resize(name.size() * 2);
+      continue;
+    }
+
+    if (!err) {
+      err = delete_regfile_key(backend, key, utf16_to_utf8(name.data(), length));
+    }
+
+    if (err) {
+      break;
+    }
+  }
+
+  backend.CloseKey(key);
+  return err.Value() == ERROR_NO_MORE_ITEMS ? backend.DeleteKey(parent, subKey) : err;
+}
+
+struct regfile_import
+{
+  RegistryBackend& backend;
+  bool header = false;
+  bool regedit4 = false;
+  // false before the first key
+  bool in_key = false;
+  // nullptr in a section that deletes a key
+  RegistryBackend::KeyHandle key = nullptr;
+  bool close_key = false;
+  std::string name;
+  std::string text;
+
+  explicit regfile_import(RegistryBackend& b);
+  ~regfile_import();
+
+  void close();
+};
+
+regfile_import::regfile_import(RegistryBackend& b)
+  : backend(b)
+{
+
+}
+
+regfile_import::~regfile_import()
+{
+  close();
+}
+
+void regfile_import::close()
+{
+  if (key && close_key) {
+    backend.CloseKey(key);
+  }
+
+  key = nullptr;
+  close_key = false;
+}
+
+// [key] or [-key]
+ErrorCode import_regfile_key(regfile_import& import, std::string_view line)
+{
+  if (line.back() != ']') {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  line = line.substr(1, line.size() - 2);
+  const bool deletion = !line.empty() && line.front() == '-';
+
+  if (deletion) {
+    line.remove_prefix(1);
+  }
+
+  const size_t separator = line.find('\\');
+  RegistryBackend::PredefinedKey root;
+
+  if (!find_regfile_root(line.substr(0, separator), root)) {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  const std::string subKey{ separator == std::string_view::npos ? std::string_view() : line.substr(separator + 1) };
+  RegistryBackend::KeyHandle root_key = import.backend.GetPredefinedKey(root);
+  import.close();
+  import.in_key = true;
+
+  if (deletion) {
+    return subKey.empty() ? ErrorCode(ERROR_INVALID_DATA) : delete_regfile_key(import.backend, root_key, subKey);
+  }
+
+  if (subKey.empty())
+  {
+    import.key = root_key;
+    return ErrorCode();
+  }
+
+  bool created = false;
+  ErrorCode err = import.backend.CreateKey(root_key, subKey, Registry::Write, import.key, created);
+  import.close_key = !err;
+  return err;
+}
+
+// "name"=data or @=data
+ErrorCode import_regfile_value(regfile_import& import, std::string_view trimmed, std::string& line)
+{
+  if (!import.in_key) {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  char* p = &line[static_cast<size_t>(trimmed.data() - line.data())];
+  char* const end = p + trimmed.size();
+  const char* q = p;
+
+  if (*q == '@')
+  {
+    import.name.clear();
+    ++q;
+  }
+  else if (!parse_regfile_string(q, end, import.name))
+  {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  while (q < end && is_regfile_space(*q)) {
+    ++q;
+  }
+
+  if (q == end || *q++ != '=') {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  while (q < end && is_regfile_space(*q)) {
+    ++q;
+  }
+
+  // the values of a deleted key are ignored
+  if (!import.key) {
+    return ErrorCode();
+  }
+
+  const std::string_view data(q, static_cast<size_t>(end - q));
+
+  if (data == "-")
+  {
+    ErrorCode err = import.backend.DeleteValue(import.key, import.name);
+    return err.Value() == ERROR_FILE_NOT_FOUND ? ErrorCode() : err;
+  }
+
+  if (!data.empty() && data.front() == '"')
+  {
+    if (!parse_regfile_string(q, end, import.text) || q != end) {
+      return ErrorCode(ERROR_INVALID_DATA);
+    }
+
+    const std::u16string value = utf8_to_utf16(import.text);
+    return import.backend.SetValue(import.key, import.name, Registry::String, value.c_str(), (value.size() + 1) * sizeof(char16_t));
+  }
+
+  constexpr std::string_view dword_prefix = "dword:";
+
+  if (data.substr(0, dword_prefix.size()) == dword_prefix)
+  {
+    const std::string_view digits = data.substr(dword_prefix.size());
+    uint32_t value = 0;
+
+    if (digits.empty() || digits.size() > 8) {
+      return ErrorCode(ERROR_INVALID_DATA);
+    }
+
+    for (char c : digits)
+    {
+      const int digit = regfile_hex_digit(c);
+
+      if (digit < 0) {
+        return ErrorCode(ERROR_INVALID_DATA);
+      }
+
+      value = (value << 4) | static_cast<uint32_t>(digit);
+    }
+
+    const unsigned char bytes[4] = {
+      static_cast<unsigned char>(value),
+      static_cast<unsigned char>(value >> 8),
+      static_cast<unsigned char>(value >> 16),
+      static_cast<unsigned char>(value >> 24),
+    };
+
+    return import.backend.SetValue(import.key, import.name, Registry::DWord, bytes, sizeof(bytes));
+  }
+
+  // hex:xx,xx,... or hex(type):xx,xx,...
+  if (data.substr(0, 3) != "hex") {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  q += 3;
+  uint32_t type = Registry::Binary;
+
+  if (q < end && *q == '(')
+  {
+    type = 0;
+    const char* digits = ++q;
+
+    while (q < end && regfile_hex_digit(*q) >= 0) {
+      type = (type << 4) | static_cast<uint32_t>(regfile_hex_digit(*q++));
+    }
+
+    if (q == digits || q - digits > 8 || q == end || *q++ != ')') {
+      return ErrorCode(ERROR_INVALID_DATA);
+    }
+  }
+
+  if (q == end || *q++ != ':') {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  // the bytes are decoded over their text
+  char* const bytes = p + (q - p);
+  size_t size = 0;
+
+  if (!decode_regfile_hex(bytes, end, size)) {
+    return ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  // the strings of REGEDIT4 files are not in UTF-16
+  if (import.regedit4 && (type == Registry::String || type == Registry::ExpandString || type == Registry::MultiString))
+  {
+    const std::u16string value = utf8_to_utf16(bytes, size);
+    return import.backend.SetValue(import.key, import.name, static_cast<Registry::ValueType>(type), value.data(), value.size() * sizeof(char16_t));
+  }
+
+  return import.backend.SetValue(import.key, import.name, static_cast<Registry::ValueType>(type), bytes, size);
+}
+
+ErrorCode import_regfile(RegFileReaderPriv& reader, std::istream& stream)
+{
+  regfile_import import{ reader.backend ? *reader.backend : Registry::GetBackend() };
+  regfile_input input;
+  input.stream = &stream;
+  std::string line;
+  size_t line_number = 0;
+  ErrorCode err;
+  reader.error_line = 0;
+
+  for (;;)
+  {
+    line.clear();
+
+    if (!read_regfile_line(input, line, err)) {
+      break;
+    }
+
+    const size_t first_line = ++line_number;
+    std::string_view trimmed = trim_regfile_line(line);
+
+    // the data of a value continues on the next line after a backslash,
+    // hexadecimal lists are split that way
+    if (!trimmed.empty() && (trimmed.front() == '"' || trimmed.front() == '@'))
+    {
+      while (!trimmed.empty() && trimmed.back() == '\\')
+      {
+        line.resize(static_cast<size_t>(trimmed.data() - line.data()) + trimmed.size() - 1);
+        const size_t continuation = line.size();
+
+        if (!read_regfile_line(input, line, err)) {
+          break;
+        }
+
+        ++line_number;
+        size_t indentation = continuation;
+
+        while (indentation < line.size() && is_regfile_space(line[indentation])) {
+          ++indentation;
+        }
+
+        line.erase(continuation, indentation - continuation);
+        trimmed = trim_regfile_line(line);
+      }
+
+      if (err) {
+        break;
+      }
+    }
+
+    if (trimmed.empty() || trimmed.front() == ';') {
+      continue;
+    }
+
+    if (!import.header)
+    {
+      import.header = true;
+      import.regedit4 = trimmed == regfile_header_regedit4;
+
+      if (trimmed != regfile_header && !import.regedit4)
+      {
+        err = ErrorCode(ERROR_INVALID_DATA);
+      }
+    }
+    else if (trimmed.front() == '[')
+    {
+      err = import_regfile_key(import, trimmed);
+    }
+    else if (trimmed.front() == '"' || trimmed.front() == '@')
+    {
+      err = import_regfile_value(import, trimmed, line);
+    }
+    else
+    {
+      err = ErrorCode(ERROR_INVALID_DATA);
+    }
+
+    if (err)
+    {
+      reader.error_line = first_line;
+      return err;
+    }
+  }
+
+  if (!err && !import.header) {
+    err = ErrorCode(ERROR_INVALID_DATA);
+  }
+
+  if (err) {
+    reader.error_line = line_number + 1;
+  }
+
+  return err;
+}
+
+// names are written as they are (keys) or quoted (values), a line break
+// would end the line in the file
+void check_regfile_name(std::string_view name)
+{
+  if (name.find_first_of("\r\n") != std::string_view::npos) {
+    throw Exception(ErrorCode(ERROR_INVALID_DATA));
+  }
+}
+
+void write_regfile_string(std::string& out, std::string_view str)
+{
+  out.push_back('"');
+
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+    }
+
+    out.push_back(c);
+  }
+
+  out.push_back('"');
+}
+
+// whether the data of a value can be written as a string: it must be
+// null-terminated and not contain other null characters, nor line breaks,
+// which cannot be escaped in a quoted string
+bool is_regfile_string(const unsigned char* data, size_t size)
+{
+  if (size == 0) {
+    return true;
+  }
+
+  if (size % 2 != 0 || data[size - 2] != 0 || data[size - 1] != 0) {
+    return false;
+  }
+
+  for (size_t i(0); i + 2 < size; i += 2)
+  {
+    if (data[i + 1] == 0 && (data[i] == 0 || data[i] == '\r' || data[i] == '\n')) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void write_regfile_value(std::string& out, const RegistryValueList::Item& value)
+{
+  static const char digits[] = "0123456789abcdef";
+
+  const size_t line_start = out.size();
+  const std::string name = value.GetName();
+
+  check_regfile_name(name);
+
+  if (name.empty()) {
+    out.push_back('@');
+  } else {
+    write_regfile_string(out, name);
+  }
+
+  out.push_back('=');
+
+  const Span<const std::byte> data = value.GetData();
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+  const auto type = static_cast<uint32_t>(value.GetType());
+
+  if (type == Registry::String && is_regfile_string(bytes, data.size()))
+  {
+    write_regfile_string(out, utf16le_to_utf8(bytes, data.size() > 0 ? data.size() - 2 : 0));
+  }
+  else if (type == Registry::DWord && data.size() == 4)
+  {
+    const uint32_t dword = static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) | (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    out += "dword:";
+
+    for (int shift = 28; shift >= 0; shift -= 4) {
+      out.push_back(digits[(dword >> shift) & 0xF]);
+    }
+  }
+  else
+  {
+    out += "hex";
+
+    if (type != Registry::Binary)
+    {
+      out.push_back('(');
+      int shift = 28;
+
+      while (shift > 0 && ((type >> shift) & 0xF) == 0) {
+        shift -= 4;
+      }
+
+      for (; shift >= 0; shift -= 4) {
+        out.push_back(digits[(type >> shift) & 0xF]);
+      }
+
+      out.push_back(')');
+    }
+
+    out.push_back(':');
+    size_t column = out.size() - line_start;
+
+    // the lines are wrapped as by the Registry Editor
+    for (size_t i(0); i < data.size(); ++i)
+    {
+      out.push_back(digits[bytes[i] >> 4]);
+      out.push_back(digits[bytes[i] & 0xF]);
+      column += 2;
+
+      if (i + 1 < data.size())
+      {
+        out.push_back(',');
+        ++column;
+
+        if (column >= regfile_max_hex_column)
+        {
+          out += "\\\r\n  ";
+          column = 2;
+        }
+      }
+    }
+  }
+
+  out += "\r\n";
+}
+
+void flush_regfile_writer(RegFileWriterPriv& writer)
+{
+  if (writer.buffer.empty()) {
+    return;
+  }
+
+  if (writer.encoding == RegFileWriter::Utf8)
+  {
+    writer.output->write(writer.buffer.data(), static_cast<std::streamsize>(writer.buffer.size()));
+  }
+  else
+  {
+    const std::u16string text = utf8_to_utf16(writer.buffer);
+    writer.encoded.resize(text.size() * 2);
+
+    for (size_t i(0); i < text.size(); ++i)
+    {
+      writer.encoded[2 * i] = static_cast<char>(text[i] & 0xFF);
+      writer.encoded[2 * i + 1] = static_cast<char>(text[i] >> 8);
+    }
+
+    writer.output->write(writer.encoded.data(), static_cast<std::streamsize>(writer.encoded.size()));
+  }
+
+  writer.buffer.clear();
+
+  if (!*writer.output) {
+    throw Exception(ErrorCode(ERROR_WRITE_FAULT));
+  }
+}
+
+// writes a key and its subkeys; only one key is open at a time, the
+// subkeys are opened by their path from the key
+void write_regfile_key(RegFileWriterPriv& writer, const RegistryKey& root, const std::string& root_name)
+{
+  check_regfile_name(root_name);
+
+  std::vector<std::pair<std::string, std::string>> pending;
+  pending.emplace_back(std::string(), root_name);
+
+  while (!pending.empty())
+  {
+    const std::string path = std::move(pending.back().first);
+    const std::string name = std::move(pending.back().second);
+    pending.pop_back();
+
+    RegistryKey opened;
+
+    if (!path.empty())
+    {
+      ErrorCode err = opened.TryOpen(root, path, Registry::Read);
+
+      // the key was deleted since its parent was written
+      if (err.Value() == ERROR_FILE_NOT_FOUND) {
+        continue;
+      } else if (err) {
+        throw Exception(err);
+      }
+    }
+
+    const RegistryKey& key = path.empty() ? root : opened;
+    writer.buffer += "[";
+    writer.buffer += name;
+    writer.buffer += "]\r\n";
+
+    writer.values.Read(key, RegistryValueList::WithData);
+
+    for (size_t i(0); i < writer.values.size(); ++i) {
+      write_regfile_value(writer.buffer, writer.values[i]);
+    }
+
+    writer.buffer += "\r\n";
+
+    if (writer.buffer.size() >= regfile_chunk_size) {
+      flush_regfile_writer(writer);
+    }
+
+    // the subkeys are written in order
+    writer.subkeys.Read(key);
+
+    for (size_t i = writer.subkeys.size(); i-- > 0;)
+    {
+      const std::string subkey = writer.subkeys.GetName(i);
+      check_regfile_name(subkey);
+      pending.emplace_back(path.empty() ? subkey : path + "\\" + subkey, name + "\\" + subkey);
+    }
+  }
+}
+
+} // namespace Impl
+
+RegFileReader::RegFileReader()
+  : d(std::make_unique<Impl::RegFileReaderPriv>())
+{
+
+}
+
+RegFileReader::~RegFileReader()
+{
+
+}
+
+/**
+ * \brief sets the backend to which the files are applied
+ * \param backend  the backend, or nullptr for the current backend (see Registry::GetBackend())
+ */
+void RegFileReader::SetBackend(RegistryBackend* backend)
+{
+  d->backend = backend;
+}
+
+/**
+ * \brief applies a .reg file
+ * \param path  the path of the file, in UTF-8
+ * \throw Exception on failure
+ */
+void RegFileReader::Import(const std::string& path)
+{
+#ifdef _WIN32
+  std::ifstream input{ ToUtf16(path), std::ios::binary };
+#else
+  std::ifstream input{ path, std::ios::binary };
+#endif
+
+  if (!input)
+  {
+    d->error_line = 0;
+    throw Exception(Impl::regfile_open_error());
+  }
+
+  Import(input);
+}
+
+/**
+ * \brief applies the content of a .reg file
+ * \param input  the content of the file, opened in binary mode
+ * \throw Exception on failure
+ */
+void RegFileReader::Import(std::istream& input)
+{
+  ErrorCode err = TryImport(input);
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+/**
+ * \brief applies the content of a .reg file
+ * \param input  the content of the file, opened in binary mode
+ *
+ * Returns the first error, the entries before it have been applied.
+ */
+ErrorCode RegFileReader::TryImport(std::istream& input)
+{
+  return Impl::import_regfile(*d, input);
+}
+
+/**
+ * \brief returns the line of the last error of Import(), starting at 1
+ *
+ * Returns 0 if the last import succeeded or could not open its file.
+ */
+size_t RegFileReader::GetErrorLine() const
+{
+  return d->error_line;
+}
+
+/**
+ * \brief starts writing a .reg file
+ * \param output    the stream, opened in binary mode
+ * \param encoding  the encoding of the file
+ */
+RegFileWriter::RegFileWriter(std::ostream& output, Encoding encoding)
+  : d(std::make_unique<Impl::RegFileWriterPriv>())
+{
+  d->output = &output;
+  d->encoding = encoding;
+
+  if (encoding == Utf16) {
+    // the byte order mark, U+FEFF
+    d->buffer += "\xEF\xBB\xBF";
+  }
+
+  d->buffer += Impl::regfile_header;
+  d->buffer += "\r\n\r\n";
+}
+
+/**
+ * \brief flushes the output, errors are ignored
+ */
+RegFileWriter::~RegFileWriter()
+{
+  try
+  {
+    Impl::flush_regfile_writer(*d);
+  }
+  catch (const Exception&)
+  {
+
+  }
+}
+
+/**
+ * \brief writes a key, its values and its subkeys to a .reg file
+ * \param key       the key
+ * \param name      the full name of the key in the file, e.g. "HKEY_CURRENT_USER\\Software\\MyApp"
+ * \param path      the path of the file, in UTF-8, which is replaced if it exists
+ * \param encoding  the encoding of the file
+ * \throw Exception on failure
+ */
+void RegFileWriter::Export(const RegistryKey& key, const std::string& name, const std::string& path, Encoding encoding)
+{
+#ifdef _WIN32
+  std::ofstream output{ ToUtf16(path), std::ios::binary | std::ios::trunc };
+#else
+  std::ofstream output{ path, std::ios::binary | std::ios::trunc };
+#endif
+
+  if (!output) {
+    throw Exception(Impl::regfile_open_error());
+  }
+
+  RegFileWriter writer{ output, encoding };
+  writer.Write(key, name);
+  writer.Flush();
+}
+
+/**
+ * \brief writes a key, its values and its subkeys
+ * \param key   the key
+ * \param name  the full name of the key in the file, e.g. "HKEY_CURRENT_USER\\Software\\MyApp"
+ * \throw Exception on failure
+ */
+void RegFileWriter::Write(const RegistryKey& key, const std::string& name)
+{
+  Impl::write_regfile_key(*d, key, name);
+}
+
+/**
+ * \brief writes the buffered output to the stream
+ * \throw Exception on failure
+ */
+void RegFileWriter::Flush()
+{
+  Impl::flush_regfile_writer(*d);
+  d->output->flush();
+
+  if (!*d->output) {
+    throw Exception(ErrorCode(ERROR_WRITE_FAULT));
+  }
+}
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,107 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGFILE_H
+#define WINAPI_REGFILE_H
+
+#include "RegistryBackend.h"
+
+#include <iosfwd>
+#include <memory>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct RegFileReaderPriv;
+struct RegFileWriterPriv;
+} // namespace Impl
+
+/**
+ * \brief applies the content of .reg files to the registry
+ *
+ * The files are those written by the Registry Editor: "Windows Registry
+ * Editor Version 5.00" files, in UTF-16 or UTF-8, and "REGEDIT4" files,
+ * which are read as UTF-8.
+ * Keys are created, [-key] sections delete a key and its subkeys, and
+ * "name"=- entries delete a value.
+ *
+ * The input is read in chunks and each entry is applied as soon as it is
+ * read; the modifications are not undone if an error occurs, and
+ * GetErrorLine() then returns the line of the error.
+ * Syntax errors are reported with ERROR_INVALID_DATA.
+ *
+ * \code
+ * RegFileReader reader;
+ * reader.SetBackend(&memoryRegistry);
+ * reader.Import("settings.reg");
+ * \endcode
+ */
+class RegFileReader
+{
+public:
+  RegFileReader();
+  RegFileReader(const RegFileReader&) = delete;
+  ~RegFileReader();
+
+  void SetBackend(RegistryBackend* backend);
+
+  void Import(const std::string& path);
+  void Import(std::istream& input);
+  ErrorCode TryImport(std::istream& input);
+
+  size_t GetErrorLine() const;
+
+  RegFileReader& operator=(const RegFileReader&) = delete;
+
+private:
+  std::unique_ptr<Impl::RegFileReaderPriv> d;
+};
+
+/**
+ * \brief writes registry keys in the .reg format
+ *
+ * The keys are written as "Windows Registry Editor Version 5.00" files,
+ * with their values and subkeys.
+ * Strings that contain line breaks are written as hex(1) values, since
+ * quoted strings cannot span several lines; the export fails with
+ * ERROR_INVALID_DATA if the name of a key or of a value contains a line break.
+ * The output is buffered and written in chunks; it is flushed by Flush()
+ * and by the destructor.
+ *
+ * \code
+ * RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Software\\MyApp", Registry::Read);
+ * RegFileWriter::Export(key, "HKEY_CURRENT_USER\\Software\\MyApp", "myapp.reg");
+ * \endcode
+ */
+class RegFileWriter
+{
+public:
+  enum Encoding
+  {
+    // with a byte order mark, as written by the Registry Editor
+    Utf16,
+    Utf8,
+  };
+
+public:
+  explicit RegFileWriter(std::ostream& output, Encoding encoding = Utf16);
+  RegFileWriter(const RegFileWriter&) = delete;
+  ~RegFileWriter();
+
+  static void Export(const RegistryKey& key, const std::string& name, const std::string& path, Encoding encoding = Utf16);
+
+  void Write(const RegistryKey& key, const std::string& name);
+  void Flush();
+
+  RegFileWriter& operator=(const RegFileWriter&) = delete;
+
+private:
+  std::unique_ptr<Impl::RegFileWriterPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGFILE_H
\ No newline at end of file
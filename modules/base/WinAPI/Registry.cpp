@@ -3,29 +3,361 @@
 // For conditions of distribution and use, see copyright notice in LICENSE.
 
 #include "Registry.h"
+#include "registry_priv.h"
+
+#include "RegistryKeyCache.h"
+#include "RegistryValue.h"
+
+#include "Exception.h"
+#include "utf16_priv.h"
 
-#include "String.h"
+#ifdef _WIN32
+#include "NativeRegistry.h"
+#else
+#include "MemoryRegistry.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 
 namespace Win32
 {
-static RegistryKey CreatePredefinedRegKey(const std::string& name);
 
-const RegistryKey Registry::HKEY_CLASSES_ROOT = CreatePredefinedRegKey("HKEY_CLASSES_ROOT");
-const RegistryKey Registry::HKEY_CURRENT_CONFIG = CreatePredefinedRegKey("HKEY_CURRENT_CONFIG");
-const RegistryKey Registry::HKEY_CURRENT_USER = CreatePredefinedRegKey("HKEY_CURRENT_USER");
-const RegistryKey Registry::HKEY_LOCAL_MACHINE = CreatePredefinedRegKey("HKEY_LOCAL_MACHINE");
-const RegistryKey Registry::HKEY_USERS = CreatePredefinedRegKey("HKEY_USERS");
+namespace Impl
+{
+
+std::atomic<RegistryBackend*> registry_backend{ nullptr };
+
+RegistryBackend& default_registry_backend()
+{
+#ifdef _WIN32
+  static NativeRegistry backend;
+#else
+  // there is no system registry on other platforms
+  static MemoryRegistry backend;
+#endif
+
+  return backend;
 }
 
-#include "WindowsRegistry.h"
-#include "registry_priv.h"
+RegistryKey create_predefined_registry_key(RegistryBackend::PredefinedKey root)
+{
+  Impl::RegistryKeyPriv rk;
+  rk.root = root;
+  rk.predefined = true;
+  return RegistryKey(rk);
+}
 
-#include "Exception.h"
+void release_registry_shared_key(registry_shared_key* key)
+{
+  if (key->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    key->backend->CloseKey(key->handle);
+    delete key;
+  }
+}
 
-#include <map>
+// returns the backend of a key and the handle of the key in this backend;
+// the predefined keys use the current backend
+RegistryBackend* get_registry_key_backend(const RegistryKey& key, RegistryBackend::KeyHandle& handle)
+{
+  RegistryKeyPriv* d = key.GetImpl();
 
-namespace Win32
+  if (!d)
+  {
+    handle = nullptr;
+    return &Registry::GetBackend();
+  }
+  else if (d->predefined)
+  {
+    RegistryBackend& backend = Registry::GetBackend();
+    handle = backend.GetPredefinedKey(d->root);
+    return &backend;
+  }
+  else
+  {
+    handle = d->handle;
+    return d->backend;
+  }
+}
+
+// reads a value into a buffer, which is resized to the size of the value
+ErrorCode query_registry_value(RegistryBackend& backend, RegistryBackend::KeyHandle key, const std::string& name, Registry::ValueType& type, std::vector<unsigned char>& buffer)
+{
+  // the buffer must not be empty, otherwise only the size is returned
+  constexpr size_t min_size = 64;
+  buffer.resize((std::max)(buffer.capacity(), min_size));
+
+  for (;;)
+  {
+    size_t size = buffer.size();
+    ErrorCode err = backend.GetValue(key, name, &type, buffer.data(), &size);
+
+    if (err.Value() == ERROR_MORE_DATA)
+    {
+      // the value may have grown again before the next call
+      buffer.resize(size);
+      continue;
+    }
+
+    buffer.resize(err ? 0 : size);
+    return err;
+  }
+}
+
+// converts a REG_SZ value to UTF-8, reusing the storage of the result;
+// the value may or may not be null-terminated
+void decode_registry_string(const void* data, size_t size, std::string& result)
+{
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  size &= ~size_t(1);
+
+  while (size >= 2 && bytes[size - 2] == 0 && bytes[size - 1] == 0) {
+    size -= 2;
+  }
+
+  result.clear();
+  append_utf16le_as_utf8(result, data, size);
+}
+
+// reads a value whose type and size are fixed, e.g. a REG_DWORD
+void get_registry_fixed_value(const RegistryKey& key, const std::string& name, Registry::ValueType expected_type, void* result, size_t result_size)
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = get_registry_key_backend(key, handle);
+  Registry::ValueType type = Registry::None;
+  size_t size = result_size;
+
+  ErrorCode err = backend->GetValue(handle, name, &type, result, &size);
+
+  // a larger value does not have the expected type
+  if ((!err || err.Value() == ERROR_MORE_DATA) && (type != expected_type || size != result_size)) {
+    err = ErrorCode(ERROR_UNSUPPORTED_TYPE);
+  }
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+void get_registry_string(const RegistryKey& key, const std::string& name, Registry::ValueType expected_type, std::string& value)
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = get_registry_key_backend(key, handle);
+  Registry::ValueType type = Registry::None;
+
+  ErrorCode err = read_registry_value(*backend, handle, name, [expected_type, &type, &value](Registry::ValueType t, const void* data, size_t size) {
+    type = t;
+
+    if (type == expected_type) {
+      decode_registry_string(data, size, value);
+    }
+  });
+
+  if (!err && type != expected_type) {
+    err = ErrorCode(ERROR_UNSUPPORTED_TYPE);
+  }
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+std::u16string encode_registry_multi_string(const std::vector<std::string>& values)
+{
+  std::u16string result;
+
+  for (const std::string& value : values)
+  {
+    // an empty string would end the list
+    if (value.empty()) {
+      throw Exception(ErrorCode(ERROR_INVALID_PARAMETER));
+    }
+
+    result += utf8_to_utf16(value);
+    result.push_back(u'\0');
+  }
+
+  result.push_back(u'\0');
+  return result;
+}
+
+} // namespace Impl
+
+const RegistryKey Registry::HKEY_CLASSES_ROOT = Impl::create_predefined_registry_key(RegistryBackend::ClassesRoot);
+const RegistryKey Registry::HKEY_CURRENT_CONFIG = Impl::create_predefined_registry_key(RegistryBackend::CurrentConfig);
+const RegistryKey Registry::HKEY_CURRENT_USER = Impl::create_predefined_registry_key(RegistryBackend::CurrentUser);
+const RegistryKey Registry::HKEY_LOCAL_MACHINE = Impl::create_predefined_registry_key(RegistryBackend::LocalMachine);
+const RegistryKey Registry::HKEY_USERS = Impl::create_predefined_registry_key(RegistryBackend::Users);
+
+RegistryBackend::~RegistryBackend()
+{
+
+}
+
+/**
+ * \brief removes a value of a key
+ *
+ * This implementation fails with ERROR_NOT_SUPPORTED.
+ */
+ErrorCode RegistryBackend::DeleteValue(KeyHandle /* key */, const std::string& /* name */)
+{
+  return ErrorCode(ERROR_NOT_SUPPORTED);
+}
+
+/**
+ * \brief reads several values of a key
+ * \param key     the key
+ * \param values  the names of the values, and receives their type and location in \a buffer
+ * \param count   the number of values
+ * \param buffer  receives the data of the values
+ * \param size    the size of \a buffer, receives the size of the data of all the values
+ * 
+ * The values that do not exist are not an error, their \a found member is set to false.
+ * If the buffer is too small, the function fails with ERROR_MORE_DATA and 
+ * \a size receives the required size.
+ * 
+ * This implementation calls GetValue() for each value, backends that can 
+ * read several values at once should override it.
+ */
+ErrorCode RegistryBackend::GetValues(KeyHandle key, ValueQuery* values, size_t count, void* buffer, size_t& size)
 {
+  const size_t capacity = buffer ? size : 0;
+  size_t offset = 0;
+  bool more_data = false;
+
+  for (size_t i(0); i < count; ++i)
+  {
+    ValueQuery& value = values[i];
+    value.type = Registry::None;
+    value.offset = offset;
+
+    // once the buffer is full, only the sizes of the remaining values are read
+    void* data = !more_data && buffer ? static_cast<unsigned char*>(buffer) + offset : nullptr;
+    size_t value_size = capacity - (std::min)(offset, capacity);
+    ErrorCode err = GetValue(key, *value.name, &value.type, data, &value_size);
+
+    if (err.Value() == ERROR_FILE_NOT_FOUND)
+    {
+      value.found = false;
+      value.type = Registry::None;
+      value.size = 0;
+      continue;
+    }
+    else if (err.Value() == ERROR_MORE_DATA)
+    {
+      more_data = true;
+    }
+    else if (err)
+    {
+      return err;
+    }
+
+    value.found = true;
+    value.size = value_size;
+    offset += value_size;
+  }
+
+  size = offset;
+  return ErrorCode(more_data || offset > capacity ? ERROR_MORE_DATA : ERROR_SUCCESS);
+}
+
+/**
+ * \brief applies a list of modifications to the subkeys of a key
+ * \param key         the key to which the paths of the operations are relative
+ * \param operations  the modifications, applied in order
+ * \param count       the number of operations
+ * 
+ * The values are set on keys that must exist, or have been created by a
+ * previous operation; consecutive operations on the same key reuse the 
+ * same handle.
+ * 
+ * This implementation applies the operations one at a time and stops at the
+ * first failure, leaving the previous modifications in place; backends that
+ * support transactions should override it.
+ */
+ErrorCode RegistryBackend::ApplyBatch(KeyHandle key, const WriteOperation* operations, size_t count)
+{
+  KeyHandle current = nullptr;
+  const std::string* current_key = nullptr;
+  ErrorCode err;
+
+  auto close_current = [this, &current, &current_key]() {
+    if (current)
+    {
+      CloseKey(current);
+      current = nullptr;
+      current_key = nullptr;
+    }
+  };
+
+  for (size_t i(0); i < count && !err; ++i)
+  {
+    const WriteOperation& op = operations[i];
+
+    if (op.kind == WriteOperation::CreateKeyOperation)
+    {
+      close_current();
+      bool created = false;
+      err = CreateKey(key, *op.subKey, Registry::Write, current, created);
+      current_key = current ? op.subKey : nullptr;
+    }
+    else if (op.kind == WriteOperation::DeleteKeyOperation)
+    {
+      close_current();
+      err = DeleteKey(key, *op.subKey);
+    }
+    else
+    {
+      if (!current_key || !Impl::registry_name_equal()(*current_key, *op.subKey))
+      {
+        close_current();
+        err = OpenKey(key, *op.subKey, Registry::Write, current);
+        current_key = current ? op.subKey : nullptr;
+      }
+
+      if (!err && op.kind == WriteOperation::DeleteValueOperation) {
+        err = DeleteValue(current, *op.name);
+      } else if (!err) {
+        err = SetValue(current, *op.name, op.type, op.data, op.size);
+      }
+    }
+  }
+
+  close_current();
+  return err;
+}
+
+/**
+ * \brief returns the backend used by the predefined keys
+ * 
+ * Unless another backend was set with SetBackend(), this is a NativeRegistry 
+ * on Windows and a MemoryRegistry on other platforms.
+ */
+RegistryBackend& Registry::GetBackend()
+{
+  RegistryBackend* backend = Impl::registry_backend.load(std::memory_order_acquire);
+  return backend ? *backend : Impl::default_registry_backend();
+}
+
+/**
+ * \brief sets the backend used by the predefined keys
+ * \param backend  the new backend, or nullptr to restore the default backend
+ * 
+ * Keys opened or created from a predefined key (e.g., HKEY_LOCAL_MACHINE) 
+ * are opened with the backend that is current at that time; they keep using 
+ * that backend when another backend is set.
+ * 
+ * The backend is not owned by the registry and must outlive the keys 
+ * opened with it.
+ * The keys cached by RegistryKeyCache::Global() are closed.
+ */
+void Registry::SetBackend(RegistryBackend* backend)
+{
+  Impl::registry_backend.store(backend, std::memory_order_release);
+  RegistryKeyCache::Global().Clear();
+}
 
 /**
  * \brief opens a registry key
@@ -54,34 +386,22 @@ RegistryKey Registry::OpenKey(const RegistryKey& key, const std::string& subKey,
  */
 RegistryKey Registry::CreateKey(const RegistryKey& key, const std::string& subKey, AccessRights accessRights, bool* created)
 {
-  constexpr DWORD reserved = 0;
-  std::wstring wsubKey = ToUtf16(subKey);
-  constexpr LPWSTR kclass = nullptr;
-  DWORD options = 0;
-  SECURITY_ATTRIBUTES* secattrs = nullptr;
+  RegistryBackend::KeyHandle parent = nullptr;
   Impl::RegistryKeyPriv rkp;
-  DWORD disposition = 0;
-
-  LSTATUS status = ::RegCreateKeyExW(
-    GetHKEY(key), 
-    wsubKey.c_str(), 
-    reserved, 
-    kclass, 
-    options, 
-    static_cast<REGSAM>(accessRights), 
-    secattrs, 
-    &rkp.hkey, 
-    &disposition);
-
-  if (status != ERROR_SUCCESS) {
-    throw Exception(ErrorCode(status));
+  rkp.backend = Impl::get_registry_key_backend(key, parent);
+  bool key_created = false;
+
+  ErrorCode err = rkp.backend->CreateKey(parent, subKey, accessRights, rkp.handle, key_created);
+
+  if (err) {
+    throw Exception(err);
   }
 
   if (created) {
-    *created = (disposition == REG_CREATED_NEW_KEY);
+    *created = key_created;
   }
 
-  return RegistryKey(std::make_unique<Impl::RegistryKeyPriv>(rkp));
+  return RegistryKey(rkp);
 }
 
 /**
@@ -92,11 +412,13 @@ RegistryKey Registry::CreateKey(const RegistryKey& key, const std::string& subKe
  */
 void Registry::DeleteKey(const RegistryKey& key, const std::string& subKey)
 {
-  std::wstring wsubKey = ToUtf16(subKey);
-  LSTATUS status = ::RegDeleteKeyW(GetHKEY(key), wsubKey.c_str());
+  RegistryBackend::KeyHandle parent = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(key, parent);
 
-  if (status != ERROR_SUCCESS) {
-    throw Exception(ErrorCode(status));
+  ErrorCode err = backend->DeleteKey(parent, subKey);
+
+  if (err) {
+    throw Exception(err);
   }
 }
 
@@ -112,13 +434,13 @@ RegistryKey::RegistryKey()
 
 }
 
-RegistryKey::RegistryKey(std::unique_ptr<Impl::RegistryKeyPriv> dPtr)
-  : d(std::move(dPtr))
+RegistryKey::RegistryKey(const Impl::RegistryKeyPriv& priv)
 {
-
-
+  d.emplace(priv);
 }
 
+RegistryKey::RegistryKey(RegistryKey&&) noexcept = default;
+
 /**
  * \brief destroys the key
  * 
@@ -156,23 +478,19 @@ ErrorCode RegistryKey::TryOpen(const RegistryKey& key, const std::string& subKey
     Close();
   }
 
-  constexpr DWORD options = 0;
-  std::wstring wsubKey = ToUtf16(subKey);
+  RegistryBackend::KeyHandle parent = nullptr;
   Impl::RegistryKeyPriv rk;
+  rk.backend = Impl::get_registry_key_backend(key, parent);
   rk.predefined = false;
-  LSTATUS status = ::RegOpenKeyExW(
-    GetHKEY(key),
-    wsubKey.c_str(),
-    options,
-    static_cast<REGSAM>(accessRights),
-    &rk.hkey);
-
-  if (status == ERROR_SUCCESS)
+
+  ErrorCode err = rk.backend->OpenKey(parent, subKey, accessRights, rk.handle);
+
+  if (!err)
   {
-    d = std::make_unique<Impl::RegistryKeyPriv>(rk);
+    d.emplace(rk);
   }
 
-  return ErrorCode{ status };
+  return err;
 }
 
 /**
@@ -204,8 +522,14 @@ void RegistryKey::Open(const RegistryKey& key, const std::string& subKey, Regist
  */
 void RegistryKey::Close()
 {
-  if (d && !d->predefined) {
-    RegCloseKey(d->hkey);
+  if (d && !d->predefined)
+  {
+    if (d->shared) {
+      Impl::release_registry_shared_key(d->shared);
+    } else {
+      d->backend->CloseKey(d->handle);
+    }
+
     d.reset();
   }
 }
@@ -214,6 +538,7 @@ void RegistryKey::Close()
  * \brief sets an integer value to the registry key
  * \param name  the name of the value
  * \param value the value
+ * \throw Exception on failure
  * 
  * The value is stored in the registry as a REG_DWORD.
  * 
@@ -222,21 +547,22 @@ void RegistryKey::Close()
  */
 void RegistryKey::SetValue(const std::string& name, int value)
 {
-  std::wstring wname = ToUtf16(name);
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(*this, handle);
+  const auto dword = static_cast<uint32_t>(value);
+
+  ErrorCode err = backend->SetValue(handle, name, Registry::DWord, &dword, sizeof(dword));
 
-  LSTATUS status = ::RegSetValueExW(
-    GetHKEY(*this),
-    wname.c_str(),
-    0,
-    REG_DWORD,
-    reinterpret_cast<const BYTE*>(&value),
-    sizeof(DWORD));
+  if (err) {
+    throw Exception(err);
+  }
 }
 
 /**
 * \brief sets a string value to the registry key
 * \param name  the name of the value
 * \param value the value
+* \throw Exception on failure
 * 
 * The value is stored in the registry as a REG_SZ.
 * 
@@ -245,112 +571,292 @@ void RegistryKey::SetValue(const std::string& name, int value)
 */
 void RegistryKey::SetValue(const std::string& name, const std::string& value)
 {
-  std::wstring wname = ToUtf16(name);
-  std::wstring wvalue = ToUtf16(value);
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(*this, handle);
+  std::u16string wvalue = Impl::utf8_to_utf16(value);
+
+  ErrorCode err = backend->SetValue(
+    handle,
+    name,
+    Registry::String,
+    wvalue.c_str(),
+    sizeof(std::u16string::value_type) * (wvalue.size() + 1));
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+/**
+ * \brief sets a value to the registry key
+ * \param name  the name of the value
+ * \param type  the type of the value
+ * \param data  the data of the value, strings must be encoded in UTF-16
+ * \param size  the size in bytes of the data
+ * \throw Exception on failure
+ * 
+ * For this function to succeed, the key must have been opened
+ * with write access.
+ */
+void RegistryKey::SetValue(const std::string& name, Registry::ValueType type, const void* data, size_t size)
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(*this, handle);
+
+  ErrorCode err = backend->SetValue(handle, name, type, data, size);
+
+  if (err) {
+    throw Exception(err);
+  }
+}
 
-  LSTATUS status = ::RegSetValueExW(
-    GetHKEY(*this),
-    wname.c_str(),
-    0,
-    REG_SZ,
-    reinterpret_cast<const BYTE*>(wvalue.data()),
-    static_cast<DWORD>(sizeof(std::wstring::value_type) * (wvalue.size() + 1)));
+/**
+ * \brief sets a 64-bit integer value to the registry key
+ * \param name  the name of the value
+ * \param value the value
+ * \throw Exception on failure
+ * 
+ * The value is stored in the registry as a REG_QWORD.
+ */
+void RegistryKey::SetQWordValue(const std::string& name, uint64_t value)
+{
+  SetValue(name, Registry::QWord, &value, sizeof(value));
+}
+
+/**
+ * \brief sets a string that contains references to environment variables to the registry key
+ * \param name  the name of the value
+ * \param value the value, e.g. "%USERPROFILE%\Documents"
+ * \throw Exception on failure
+ * 
+ * The value is stored in the registry as a REG_EXPAND_SZ.
+ */
+void RegistryKey::SetExpandStringValue(const std::string& name, const std::string& value)
+{
+  std::u16string wvalue = Impl::utf8_to_utf16(value);
+  SetValue(name, Registry::ExpandString, wvalue.c_str(), sizeof(std::u16string::value_type) * (wvalue.size() + 1));
+}
+
+/**
+ * \brief sets a list of strings to the registry key
+ * \param name    the name of the value
+ * \param values  the strings, which must not be empty
+ * \throw Exception on failure
+ * 
+ * The value is stored in the registry as a REG_MULTI_SZ.
+ */
+void RegistryKey::SetMultiStringValue(const std::string& name, const std::vector<std::string>& values)
+{
+  std::u16string data = Impl::encode_registry_multi_string(values);
+  SetValue(name, Registry::MultiString, data.data(), sizeof(std::u16string::value_type) * data.size());
+}
+
+/**
+ * \brief sets binary data to the registry key
+ * \param name  the name of the value
+ * \param data  the data
+ * \param size  the size in bytes of the data
+ * \throw Exception on failure
+ * 
+ * The value is stored in the registry as a REG_BINARY.
+ */
+void RegistryKey::SetBinaryValue(const std::string& name, const void* data, size_t size)
+{
+  SetValue(name, Registry::Binary, data, size);
 }
 
 /**
  * \brief reads an integer value from the registry key
  * \param name  the name of the value
+ * \throw Exception if the value does not exist or is not a REG_DWORD
  */
 int RegistryKey::GetIntValue(const std::string& name) const
 {
-  std::wstring wname = ToUtf16(name);
-  DWORD type;
-  DWORD result;
-  DWORD size = sizeof(DWORD);
-
-  LSTATUS status = ::RegGetValueW(
-    GetHKEY(*this), 
-    nullptr,
-    wname.c_str(), 
-    RRF_RT_REG_DWORD,
-    &type,
-    reinterpret_cast<void*>(&result),
-    &size);
+  uint32_t result = 0;
+  Impl::get_registry_fixed_value(*this, name, Registry::DWord, &result, sizeof(result));
+  return static_cast<int>(result);
+}
 
+/**
+ * \brief reads a 64-bit integer value from the registry key
+ * \param name  the name of the value
+ * \throw Exception if the value does not exist or is not a REG_QWORD
+ */
+uint64_t RegistryKey::GetQWordValue(const std::string& name) const
+{
+  uint64_t result = 0;
+  Impl::get_registry_fixed_value(*this, name, Registry::QWord, &result, sizeof(result));
   return result;
 }
 
 /**
 * \brief reads a string value from the registry key
 * \param name  the name of the value
+* \throw Exception if the value does not exist or is not a REG_SZ
 */
 std::string RegistryKey::GetStringValue(const std::string& name) const
 {
-  std::wstring wname = ToUtf16(name);
-  DWORD type;
-  DWORD size = 0;
-
-  // a first call is performed to retrieve the size of the string
-  LSTATUS status = ::RegGetValueW(
-    GetHKEY(*this),
-    nullptr,
-    wname.c_str(),
-    RRF_RT_REG_SZ,
-    &type,
-    nullptr,
-    &size);
-
-  if (status != ERROR_SUCCESS) {
-    throw Exception(ErrorCode(status));
+  std::string result;
+  GetStringValue(name, result);
+  return result;
+}
+
+/**
+ * \brief reads a string value from the registry key into an existing string
+ * \param      name   the name of the value
+ * \param[out] value  receives the value
+ * \throw Exception if the value does not exist or is not a REG_SZ
+ * 
+ * The storage of \a value is reused, so that reading values repeatedly
+ * into the same string does not allocate memory once it is large enough.
+ */
+void RegistryKey::GetStringValue(const std::string& name, std::string& value) const
+{
+  Impl::get_registry_string(*this, name, Registry::String, value);
+}
+
+/**
+ * \brief reads a REG_EXPAND_SZ value from the registry key
+ * \param name  the name of the value
+ * \throw Exception if the value does not exist or is not a REG_EXPAND_SZ
+ * 
+ * The references to environment variables are not expanded.
+ */
+std::string RegistryKey::GetExpandStringValue(const std::string& name) const
+{
+  std::string result;
+  Impl::get_registry_string(*this, name, Registry::ExpandString, result);
+  return result;
+}
+
+/**
+ * \brief reads a list of strings from the registry key
+ * \param name  the name of the value
+ * \throw Exception if the value does not exist or is not a REG_MULTI_SZ
+ * 
+ * Use GetValue() and RegistryValue::GetStrings() for iterating over the 
+ * strings without building a vector.
+ */
+std::vector<std::string> RegistryKey::GetMultiStringValue(const std::string& name) const
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(*this, handle);
+  Registry::ValueType type = Registry::None;
+  std::vector<std::string> result;
+
+  ErrorCode err = Impl::read_registry_value(*backend, handle, name, [&type, &result](Registry::ValueType t, const void* data, size_t size) {
+    type = t;
+
+    if (type == Registry::MultiString)
+    {
+      const auto* bytes = static_cast<const std::byte*>(data);
+
+      for (const std::string& str : RegistryMultiStringRange(Span<const std::byte>(bytes, size))) {
+        result.push_back(str);
+      }
+    }
+  });
+
+  if (!err && type != Registry::MultiString) {
+    err = ErrorCode(ERROR_UNSUPPORTED_TYPE);
   }
 
-  std::wstring result;
-  result.resize(size);
-
-  // a second call actually retrieves the string
-  status = ::RegGetValueW(
-    GetHKEY(*this),
-    nullptr,
-    wname.c_str(),
-    RRF_RT_REG_SZ,
-    &type,
-    reinterpret_cast<void*>(result.data()),
-    &size);
-
-  if (size > 0) {
-    result.resize(size - 1);
-  } else {
-    result.clear();
+  if (err) {
+    throw Exception(err);
   }
-  
-  return ToUtf8(result);
+
+  return result;
 }
 
-Impl::RegistryKeyPriv* RegistryKey::GetImpl() const
+/**
+ * \brief reads binary data from the registry key
+ * \param name  the name of the value
+ * \throw Exception if the value does not exist or is not a REG_BINARY
+ * 
+ * The data is read directly into the returned vector.
+ */
+std::vector<unsigned char> RegistryKey::GetBinaryValue(const std::string& name) const
 {
-  return d.get();
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(*this, handle);
+  Registry::ValueType type = Registry::None;
+  std::vector<unsigned char> result;
+
+  ErrorCode err = Impl::query_registry_value(*backend, handle, name, type, result);
+
+  if (!err && type != Registry::Binary) {
+    err = ErrorCode(ERROR_UNSUPPORTED_TYPE);
+  }
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  return result;
 }
 
-RegistryKey CreatePredefinedRegKey(const std::string& name)
+/**
+ * \brief reads a value of any type from the registry key
+ * \param      name   the name of the value
+ * \param[out] value  receives the type and data of the value
+ * \throw Exception if the value does not exist
+ * 
+ * The buffer of \a value is reused and only grows if the value does not fit.
+ */
+void RegistryKey::GetValue(const std::string& name, RegistryValue& value) const
 {
-  static const std::map<std::string, HKEY> dict = {
-    {"HKEY_CLASSES_ROOT", HKEY_CLASSES_ROOT},
-    {"HKEY_CURRENT_CONFIG", HKEY_CURRENT_CONFIG},
-    {"HKEY_CURRENT_USER", HKEY_CURRENT_USER},
-    {"HKEY_LOCAL_MACHINE", HKEY_LOCAL_MACHINE},
-    {"HKEY_USERS", HKEY_USERS}
-  };
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(*this, handle);
 
-  Impl::RegistryKeyPriv rk;
-  rk.hkey = dict.at(name);
-  rk.predefined = true;
+  ErrorCode err = Impl::query_registry_value(*backend, handle, name, value.m_type, value.m_data);
 
-  return RegistryKey(std::make_unique<Impl::RegistryKeyPriv>(rk));
+  if (err) {
+    throw Exception(err);
+  }
 }
 
-HKEY GetHKEY(const RegistryKey& rk)
+/**
+ * \brief reads the raw data of a value into a buffer
+ * \param          name    the name of the value
+ * \param          buffer  the buffer
+ * \param[in, out] size    the size of the buffer, receives the size of the value
+ * \param[out]     type    receives the type of the value (can be nullptr)
+ * 
+ * If the buffer is too small, the function fails with ERROR_MORE_DATA and 
+ * \a size receives the size that is needed.
+ * If \a buffer is nullptr, only the size and type of the value are returned.
+ * 
+ * Strings are returned in UTF-16, as stored in the registry; they may or 
+ * may not be null-terminated.
+ * 
+ * This function returns a non-zero error code on failure.
+ */
+ErrorCode RegistryKey::TryGetValue(const std::string& name, void* buffer, size_t& size, Registry::ValueType* type) const
 {
-  return rk.IsNull() ? nullptr : rk.GetImpl()->hkey;
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(*this, handle);
+  return backend->GetValue(handle, name, type, buffer, &size);
+}
+
+/**
+ * \brief moves a key into this object
+ * 
+ * This object is closed first, unless it is the same object as \a other.
+ */
+RegistryKey& RegistryKey::operator=(RegistryKey&& other) noexcept
+{
+  if (this != &other)
+  {
+    Close();
+    d = std::move(other.d);
+  }
+
+  return *this;
+}
+
+Impl::RegistryKeyPriv* RegistryKey::GetImpl() const
+{
+  return d.get();
 }
 
 } // namespace Win32
\ No newline at end of file
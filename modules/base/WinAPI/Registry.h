@@ -5,12 +5,11 @@
 #ifndef WINAPI_REGISTRY_H
 #define WINAPI_REGISTRY_H
 
-#ifdef WINAPI_REGISTRYPRIV_H
-#error "Registry.h must be included before registry_priv.h"
-#endif
+#include "FastPimpl.h"
 
-#include <memory>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Win32
 {
@@ -22,12 +21,17 @@ namespace Impl
 struct RegistryKeyPriv;
 } // namespace Impl
 
+class RegistryBackend;
 class RegistryKey;
+class RegistryValue;
 
 /**
  * \brief provides access to registry keys
  * 
  * This class provides static member functions for creating, opening and deleting registry keys.
+ * 
+ * The keys are stored by a RegistryBackend, the Windows Registry by default
+ * (see SetBackend()).
  */
 class Registry
 {
@@ -44,6 +48,20 @@ public:
     Write = 0x20006,
   };
 
+  enum ValueType
+  {
+    None = 0,
+    String = 1,
+    ExpandString = 2,
+    Binary = 3,
+    DWord = 4,
+    MultiString = 7,
+    QWord = 11,
+  };
+
+  static RegistryBackend& GetBackend();
+  static void SetBackend(RegistryBackend* backend);
+
   static RegistryKey OpenKey(const RegistryKey& key, const std::string& subKey, AccessRights accessRights);
   static RegistryKey CreateKey(const RegistryKey& key, const std::string& subKey, AccessRights accessRights, bool* created = nullptr);
   static void DeleteKey(const RegistryKey& key, const std::string& subKey);
@@ -63,10 +81,10 @@ class RegistryKey
 public:
   RegistryKey();
   RegistryKey(const RegistryKey&) = delete;
-  RegistryKey(RegistryKey&&) = default;
+  RegistryKey(RegistryKey&&) noexcept;
   ~RegistryKey();
 
-  explicit RegistryKey(std::unique_ptr<Impl::RegistryKeyPriv> dPtr);
+  explicit RegistryKey(const Impl::RegistryKeyPriv& priv);
 
   bool IsNull() const;
 
@@ -76,16 +94,29 @@ public:
 
   void SetValue(const std::string& name, int value);
   void SetValue(const std::string& name, const std::string& value);
+  void SetValue(const std::string& name, Registry::ValueType type, const void* data, size_t size);
+  void SetQWordValue(const std::string& name, uint64_t value);
+  void SetExpandStringValue(const std::string& name, const std::string& value);
+  void SetMultiStringValue(const std::string& name, const std::vector<std::string>& values);
+  void SetBinaryValue(const std::string& name, const void* data, size_t size);
+
   int GetIntValue(const std::string& name) const;
+  uint64_t GetQWordValue(const std::string& name) const;
   std::string GetStringValue(const std::string& name) const;
+  void GetStringValue(const std::string& name, std::string& value) const;
+  std::string GetExpandStringValue(const std::string& name) const;
+  std::vector<std::string> GetMultiStringValue(const std::string& name) const;
+  std::vector<unsigned char> GetBinaryValue(const std::string& name) const;
+  void GetValue(const std::string& name, RegistryValue& value) const;
+  ErrorCode TryGetValue(const std::string& name, void* buffer, size_t& size, Registry::ValueType* type = nullptr) const;
 
   RegistryKey& operator=(const RegistryKey&) = delete;
-  RegistryKey& operator=(RegistryKey&&) = default;
+  RegistryKey& operator=(RegistryKey&& other) noexcept;
 
   Impl::RegistryKeyPriv* GetImpl() const;
 
 private:
-  std::unique_ptr<Impl::RegistryKeyPriv> d;
+  Impl::FastPimpl<Impl::RegistryKeyPriv, 32> d;
 };
 
 } // namespace Win32
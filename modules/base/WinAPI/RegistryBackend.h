@@ -0,0 +1,144 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYBACKEND_H
+#define WINAPI_REGISTRYBACKEND_H
+
+#include "ErrorCode.h"
+#include "Registry.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace Win32
+{
+
+/**
+ * \brief interface of the storage behind Registry and RegistryKey
+ *
+ * The Windows Registry is accessed through the NativeRegistry backend
+ * (this is the default on Windows), but keys and values can also be
+ * stored in memory with a MemoryRegistry, e.g. for testing code that
+ * uses the registry on another platform.
+ *
+ * Open keys are represented by opaque handles that are only meaningful
+ * to the backend that returned them; a null handle is never valid.
+ * The functions mirror the Win32 functions: they return the same error codes
+ * (e.g., ERROR_FILE_NOT_FOUND), sub-keys are paths whose components are
+ * separated by backslashes, and values are stored as raw bytes,
+ * with strings encoded in UTF-16.
+ *
+ * The functions of a backend may be called concurrently from several threads.
+ *
+ * The subkeys and values of a key are enumerated by index with EnumKey() and
+ * EnumValue(), which fail with ERROR_NO_MORE_ITEMS past the last one.
+ * Their names are returned in UTF-16 and the length of the buffers they need
+ * is given by QueryKeyInfo().
+ *
+ * GetValues() reads several values of a key at once, the default implementation
+ * calls GetValue() for each of them.
+ * Likewise, ApplyBatch() applies a list of modifications (see RegistryBatch),
+ * atomically if the backend supports it.
+ *
+ * DeleteValue() removes a value; the default implementation fails with
+ * ERROR_NOT_SUPPORTED, backends that can modify the registry override it.
+ *
+ * WatchKey() registers a callback that is called when the values of a key
+ * change or when the key is deleted.
+ * The callback may be called from any thread, but never while the backend
+ * holds a lock, so it may use the backend; it may also be called once for
+ * several changes, or when nothing changed.
+ * The callback is not called anymore once UnwatchKey() returns, which waits
+ * for a running callback: the callback must not remove its own watch, and
+ * the watch must be removed before the key is closed.
+ *
+ * \sa Registry::SetBackend().
+ */
+class RegistryBackend
+{
+public:
+  typedef void* KeyHandle;
+  typedef void* WatchHandle;
+
+  enum PredefinedKey
+  {
+    ClassesRoot,
+    CurrentConfig,
+    CurrentUser,
+    LocalMachine,
+    Users,
+  };
+
+  struct KeyInfo
+  {
+    size_t subKeyCount;
+    // in UTF-16 code units, without the null terminator
+    size_t maxSubKeyNameLength;
+    size_t valueCount;
+    // in UTF-16 code units, without the null terminator
+    size_t maxValueNameLength;
+    size_t maxValueSize;
+  };
+
+  // a value read by GetValues()
+  struct ValueQuery
+  {
+    const std::string* name;
+    // set by GetValues(), type is None and size is 0 if the value does not exist
+    bool found;
+    Registry::ValueType type;
+    // the data is at this offset in the buffer passed to GetValues()
+    size_t offset;
+    size_t size;
+  };
+
+  // a modification applied by ApplyBatch(), the keys are relative to the key of the batch
+  struct WriteOperation
+  {
+    enum Kind
+    {
+      CreateKeyOperation,
+      DeleteKeyOperation,
+      SetValueOperation,
+      DeleteValueOperation,
+    };
+
+    Kind kind;
+    const std::string* subKey;
+    // for SetValueOperation and DeleteValueOperation
+    const std::string* name;
+    Registry::ValueType type;
+    const void* data;
+    size_t size;
+  };
+
+public:
+  virtual ~RegistryBackend();
+
+  virtual KeyHandle GetPredefinedKey(PredefinedKey key) = 0;
+
+  virtual ErrorCode OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result) = 0;
+  virtual ErrorCode CreateKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result, bool& created) = 0;
+  virtual ErrorCode DeleteKey(KeyHandle parent, const std::string& subKey) = 0;
+  virtual void CloseKey(KeyHandle key) = 0;
+
+  virtual ErrorCode SetValue(KeyHandle key, const std::string& name, Registry::ValueType type, const void* data, size_t size) = 0;
+  virtual ErrorCode DeleteValue(KeyHandle key, const std::string& name);
+  virtual ErrorCode GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size) = 0;
+  virtual ErrorCode GetValues(KeyHandle key, ValueQuery* values, size_t count, void* buffer, size_t& size);
+
+  virtual ErrorCode ApplyBatch(KeyHandle key, const WriteOperation* operations, size_t count);
+
+  virtual ErrorCode QueryKeyInfo(KeyHandle key, KeyInfo& info) = 0;
+  virtual ErrorCode EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength) = 0;
+  virtual ErrorCode EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size) = 0;
+
+  virtual ErrorCode WatchKey(KeyHandle key, std::function<void()> callback, WatchHandle& result) = 0;
+  virtual void UnwatchKey(WatchHandle watch) = 0;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYBACKEND_H
\ No newline at end of file
@@ -0,0 +1,218 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistryBatch.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+#include "utf16_priv.h"
+
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+struct registry_batch_operation
+{
+  RegistryBackend::WriteOperation::Kind kind;
+  std::string subkey;
+  std::string name;
+  Registry::ValueType type;
+  // the data is stored in RegistryBatchPriv::data
+  size_t data_offset;
+  size_t data_size;
+};
+
+struct RegistryBatchPriv
+{
+  std::vector<registry_batch_operation> operations;
+  std::vector<unsigned char> data;
+};
+
+// a moved-from batch has no storage, it is allocated again when an operation is added
+void add_registry_batch_operation(std::unique_ptr<RegistryBatchPriv>& d, RegistryBackend::WriteOperation::Kind kind, const std::string& subkey, const std::string& name = std::string(), Registry::ValueType type = Registry::None, const void* data = nullptr, size_t size = 0)
+{
+  if (!d) {
+    d = std::make_unique<RegistryBatchPriv>();
+  }
+
+  RegistryBatchPriv& batch = *d;
+  const size_t data_offset = batch.data.size();
+
+  if (size > 0)
+  {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    batch.data.insert(batch.data.end(), bytes, bytes + size);
+  }
+
+  batch.operations.push_back(registry_batch_operation{ kind, subkey, name, type, data_offset, size });
+}
+
+} // namespace Impl
+
+RegistryBatch::RegistryBatch()
+  : d(std::make_unique<Impl::RegistryBatchPriv>())
+{
+
+}
+
+RegistryBatch::RegistryBatch(RegistryBatch&&) noexcept = default;
+
+RegistryBatch::~RegistryBatch()
+{
+
+}
+
+/**
+ * \brief returns the number of operations in the batch
+ */
+size_t RegistryBatch::size() const
+{
+  return d ? d->operations.size() : 0;
+}
+
+bool RegistryBatch::empty() const
+{
+  return size() == 0;
+}
+
+/**
+ * \brief creates a key and its missing parents, if they do not exist
+ * \param subKey  the path of the key
+ */
+void RegistryBatch::CreateKey(const std::string& subKey)
+{
+  Impl::add_registry_batch_operation(d, RegistryBackend::WriteOperation::CreateKeyOperation, subKey);
+}
+
+/**
+ * \brief deletes a key
+ * \param subKey  the path of the key
+ * 
+ * The commit fails if the key does not exist or has subkeys.
+ */
+void RegistryBatch::DeleteKey(const std::string& subKey)
+{
+  Impl::add_registry_batch_operation(d, RegistryBackend::WriteOperation::DeleteKeyOperation, subKey);
+}
+
+/**
+ * \brief sets an integer value
+ * \param subKey  the path of the key, which must exist or be created before by the batch
+ * \param name    the name of the value
+ * \param value   the value, stored as a REG_DWORD
+ */
+void RegistryBatch::SetValue(const std::string& subKey, const std::string& name, int value)
+{
+  const auto dword = static_cast<uint32_t>(value);
+  SetValue(subKey, name, Registry::DWord, &dword, sizeof(dword));
+}
+
+/**
+ * \brief sets a string value
+ * \param subKey  the path of the key, which must exist or be created before by the batch
+ * \param name    the name of the value
+ * \param value   the value, in UTF-8, stored as a REG_SZ
+ */
+void RegistryBatch::SetValue(const std::string& subKey, const std::string& name, const std::string& value)
+{
+  std::u16string wvalue = Impl::utf8_to_utf16(value);
+  SetValue(subKey, name, Registry::String, wvalue.c_str(), sizeof(std::u16string::value_type) * (wvalue.size() + 1));
+}
+
+/**
+ * \brief sets a value of any type
+ * \param subKey  the path of the key, which must exist or be created before by the batch
+ * \param name    the name of the value
+ * \param type    the type of the value
+ * \param data    the data of the value, which is copied
+ * \param size    the size of the data, in bytes
+ */
+void RegistryBatch::SetValue(const std::string& subKey, const std::string& name, Registry::ValueType type, const void* data, size_t size)
+{
+  Impl::add_registry_batch_operation(d, RegistryBackend::WriteOperation::SetValueOperation, subKey, name, type, data, size);
+}
+
+/**
+ * \brief sets a 64-bit integer value
+ * \param subKey  the path of the key, which must exist or be created before by the batch
+ * \param name    the name of the value
+ * \param value   the value, stored as a REG_QWORD
+ */
+void RegistryBatch::SetQWordValue(const std::string& subKey, const std::string& name, uint64_t value)
+{
+  SetValue(subKey, name, Registry::QWord, &value, sizeof(value));
+}
+
+/**
+ * \brief deletes a value
+ * \param subKey  the path of the key, which must exist or be created before by the batch
+ * \param name    the name of the value
+ * 
+ * The commit fails if the value does not exist.
+ */
+void RegistryBatch::DeleteValue(const std::string& subKey, const std::string& name)
+{
+  Impl::add_registry_batch_operation(d, RegistryBackend::WriteOperation::DeleteValueOperation, subKey, name);
+}
+
+/**
+ * \brief applies the operations of the batch
+ * \param key  the key to which the paths are relative
+ * \throw Exception on failure
+ * 
+ * The batch is not cleared and can be committed again.
+ */
+void RegistryBatch::Commit(const RegistryKey& key) const
+{
+  ErrorCode err = TryCommit(key);
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+/**
+ * \brief applies the operations of the batch
+ * \param key  the key to which the paths are relative
+ * 
+ * Returns the error code of the first operation that failed, in which case 
+ * no operation is applied if the backend supports transactions.
+ */
+ErrorCode RegistryBatch::TryCommit(const RegistryKey& key) const
+{
+  if (empty()) {
+    return ErrorCode();
+  }
+
+  std::vector<RegistryBackend::WriteOperation> operations;
+  operations.reserve(d->operations.size());
+
+  for (const Impl::registry_batch_operation& op : d->operations) {
+    operations.push_back(RegistryBackend::WriteOperation{ op.kind, &op.subkey, &op.name, op.type, d->data.data() + op.data_offset, op.data_size });
+  }
+
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend* backend = Impl::get_registry_key_backend(key, handle);
+  return backend->ApplyBatch(handle, operations.data(), operations.size());
+}
+
+/**
+ * \brief removes all the operations from the batch
+ */
+void RegistryBatch::Clear()
+{
+  if (d)
+  {
+    d->operations.clear();
+    d->data.clear();
+  }
+}
+
+RegistryBatch& RegistryBatch::operator=(RegistryBatch&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,81 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYBATCH_H
+#define WINAPI_REGISTRYBATCH_H
+
+#include "ErrorCode.h"
+#include "Registry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct RegistryBatchPriv;
+} // namespace Impl
+
+/**
+ * \brief collects modifications of the registry and applies them at once
+ * 
+ * The keys are created, deleted and the values set or deleted in the order
+ * in which they were added to the batch, when the batch is committed; the paths 
+ * are relative to the key passed to Commit().
+ * 
+ * With the native backend, the batch is applied in a transaction of the 
+ * Kernel Transaction Manager, so that a failure (or a crash) never leaves
+ * the registry partially modified; the MemoryRegistry provides the same 
+ * guarantee (see RegistryBackend::ApplyBatch()).
+ * 
+ * A moved-from batch is empty and can be used again.
+ * 
+ * \code
+ * RegistryBatch batch;
+ * batch.CreateKey("Software\\MyApp");
+ * batch.SetValue("Software\\MyApp", "Version", 2);
+ * batch.SetValue("Software\\MyApp", "Path", path);
+ * batch.Commit(Registry::HKEY_CURRENT_USER);
+ * \endcode
+ */
+class RegistryBatch
+{
+public:
+  RegistryBatch();
+  RegistryBatch(const RegistryBatch&) = delete;
+  RegistryBatch(RegistryBatch&&) noexcept;
+  ~RegistryBatch();
+
+  size_t size() const;
+  bool empty() const;
+
+  void CreateKey(const std::string& subKey);
+  void DeleteKey(const std::string& subKey);
+
+  void SetValue(const std::string& subKey, const std::string& name, int value);
+  void SetValue(const std::string& subKey, const std::string& name, const std::string& value);
+  void SetValue(const std::string& subKey, const std::string& name, Registry::ValueType type, const void* data, size_t size);
+  void SetQWordValue(const std::string& subKey, const std::string& name, uint64_t value);
+
+  void DeleteValue(const std::string& subKey, const std::string& name);
+
+  void Commit(const RegistryKey& key) const;
+  ErrorCode TryCommit(const RegistryKey& key) const;
+
+  void Clear();
+
+  RegistryBatch& operator=(const RegistryBatch&) = delete;
+  RegistryBatch& operator=(RegistryBatch&&) noexcept;
+
+private:
+  std::unique_ptr<Impl::RegistryBatchPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYBATCH_H
\ No newline at end of file
@@ -0,0 +1,345 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistryCache.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+struct registry_cache_entry
+{
+  ErrorCode error;
+  Registry::ValueType type = Registry::None;
+  uint32_t dword = 0;
+  std::string string;
+};
+
+typedef std::unordered_map<std::string, registry_cache_entry> registry_cache_map;
+
+struct RegistryCachePriv
+{
+  RegistryKey key;
+  RegistryBackend* backend = nullptr;
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend::WatchHandle watch = nullptr;
+
+  // incremented when the key is modified
+  std::atomic<uint64_t> generation{ 0 };
+  // value of generation when the values were last read
+  std::atomic<uint64_t> loaded_generation{ 0 };
+
+  // The values are published with the left-right technique: readers use
+  // maps[active] while the writer updates the other map, the writer then
+  // switches the maps and waits for the readers of the previous one before
+  // updating it.
+  // Readers only increment and decrement a counter, the writers are
+  // serialized by the mutex.
+  registry_cache_map maps[2];
+  std::atomic<int> active{ 0 };
+  std::atomic<int> readers_index{ 0 };
+  std::atomic<uint32_t> readers[2] = {};
+  std::mutex write_mutex;
+
+  ~RegistryCachePriv();
+};
+
+RegistryCachePriv::~RegistryCachePriv()
+{
+  if (watch) {
+    backend->UnwatchKey(watch);
+  }
+}
+
+class registry_cache_read_guard
+{
+public:
+  explicit registry_cache_read_guard(RegistryCachePriv& c)
+    : m_counter(c.readers[c.readers_index.load()])
+  {
+    m_counter.fetch_add(1);
+  }
+
+  ~registry_cache_read_guard()
+  {
+    m_counter.fetch_sub(1);
+  }
+
+private:
+  std::atomic<uint32_t>& m_counter;
+};
+
+// calls f with the cached entry; returns false if the value is not
+// cached or the cache is outdated
+template<typename F>
+bool read_registry_cache(RegistryCachePriv& c, const std::string& name, F&& f)
+{
+  if (c.loaded_generation.load() != c.generation.load()) {
+    return false;
+  }
+
+  registry_cache_read_guard guard{ c };
+  const registry_cache_map& map = c.maps[c.active.load()];
+  auto it = map.find(name);
+
+  if (it == map.end()) {
+    return false;
+  }
+
+  f(it->second);
+  return true;
+}
+
+void wait_registry_cache_readers(const std::atomic<uint32_t>& readers)
+{
+  while (readers.load() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+// replaces the content of both maps; called with the write mutex
+void publish_registry_cache(RegistryCachePriv& c, registry_cache_map map)
+{
+  const int active = c.active.load();
+  c.maps[1 - active] = map;
+  c.active.store(1 - active);
+
+  // readers that started before the switch may still be using the previous map
+  const int index = c.readers_index.load();
+  wait_registry_cache_readers(c.readers[1 - index]);
+  c.readers_index.store(1 - index);
+  wait_registry_cache_readers(c.readers[index]);
+
+  c.maps[active] = std::move(map);
+}
+
+registry_cache_entry load_registry_cache_entry(RegistryCachePriv& c, const std::string& name, std::vector<unsigned char>& buffer)
+{
+  registry_cache_entry entry;
+  entry.error = query_registry_value(*c.backend, c.handle, name, entry.type, buffer);
+
+  if (entry.error) {
+    return entry;
+  }
+
+  if (entry.type == Registry::DWord && buffer.size() == sizeof(entry.dword)) {
+    std::memcpy(&entry.dword, buffer.data(), sizeof(entry.dword));
+  } else if (entry.type == Registry::String) {
+    decode_registry_string(buffer.data(), buffer.size(), entry.string);
+  }
+
+  return entry;
+}
+
+// reads the value from the registry and calls f with it; all the cached
+// values are read again if the key was modified
+template<typename F>
+void load_registry_cache(RegistryCachePriv& c, const std::string& name, F&& f)
+{
+  std::lock_guard<std::mutex> lock{ c.write_mutex };
+
+  // the generation is read first, so that a modification that happens while
+  // the values are read causes them to be read again later
+  const uint64_t generation = c.generation.load();
+  const bool outdated = c.loaded_generation.load() != generation;
+  const registry_cache_map& current = c.maps[c.active.load()];
+
+  if (!outdated)
+  {
+    // another thread may have read the value in the meantime
+    auto it = current.find(name);
+
+    if (it != current.end())
+    {
+      f(it->second);
+      return;
+    }
+  }
+
+  std::vector<unsigned char> buffer;
+  registry_cache_map map;
+
+  if (outdated)
+  {
+    for (const auto& entry : current) {
+      map.emplace(entry.first, load_registry_cache_entry(c, entry.first, buffer));
+    }
+  }
+  else
+  {
+    map = current;
+  }
+
+  auto it = map.find(name);
+
+  if (it == map.end()) {
+    it = map.emplace(name, load_registry_cache_entry(c, name, buffer)).first;
+  }
+
+  f(it->second);
+
+  publish_registry_cache(c, std::move(map));
+  c.loaded_generation.store(generation);
+}
+
+template<typename F>
+void get_registry_cache_entry(RegistryCachePriv& c, const std::string& name, F&& f)
+{
+  if (!read_registry_cache(c, name, f)) {
+    load_registry_cache(c, name, f);
+  }
+}
+
+} // namespace Impl
+
+/**
+ * \brief constructs a null cache
+ */
+RegistryCache::RegistryCache() noexcept
+  : d(nullptr)
+{
+
+}
+
+RegistryCache::RegistryCache(RegistryCache&&) noexcept = default;
+
+RegistryCache::~RegistryCache()
+{
+
+}
+
+/**
+ * \brief constructs a cache of the values of a key
+ * \param key  the key, which must have been opened with Registry::Read access
+ * \throw Exception on failure
+ * 
+ * Values are only read when they are requested.
+ */
+RegistryCache::RegistryCache(RegistryKey key)
+  : d(std::make_unique<Impl::RegistryCachePriv>())
+{
+  d->key = std::move(key);
+  d->backend = Impl::get_registry_key_backend(d->key, d->handle);
+
+  Impl::RegistryCachePriv* priv = d.get();
+  auto on_change = [priv]() {
+    priv->generation.fetch_add(1);
+  };
+
+  ErrorCode err = d->backend->WatchKey(d->handle, on_change, d->watch);
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+/**
+ * \brief returns whether the cache is null
+ */
+bool RegistryCache::IsNull() const
+{
+  return !d;
+}
+
+/**
+ * \brief returns the key whose values are cached
+ */
+const RegistryKey& RegistryCache::GetKey() const
+{
+  if (!d) {
+    static const RegistryKey nullKey;
+    return nullKey;
+  } else {
+    return d->key;
+  }
+}
+
+/**
+ * \brief returns an integer value of the key
+ * \param name  the name of the value
+ * \throw Exception if the value does not exist or is not a REG_DWORD
+ */
+int RegistryCache::GetIntValue(const std::string& name) const
+{
+  if (!d) {
+    throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+  }
+
+  ErrorCode err;
+  uint32_t value = 0;
+
+  Impl::get_registry_cache_entry(*d, name, [&err, &value](const Impl::registry_cache_entry& entry) {
+    err = (!entry.error && entry.type != Registry::DWord) ? ErrorCode(ERROR_UNSUPPORTED_TYPE) : entry.error;
+    value = entry.dword;
+  });
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  return static_cast<int>(value);
+}
+
+/**
+ * \brief returns a string value of the key
+ * \param name  the name of the value
+ * \throw Exception if the value does not exist or is not a REG_SZ
+ */
+std::string RegistryCache::GetStringValue(const std::string& name) const
+{
+  if (!d) {
+    throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+  }
+
+  ErrorCode err;
+  std::string value;
+
+  Impl::get_registry_cache_entry(*d, name, [&err, &value](const Impl::registry_cache_entry& entry) {
+    err = (!entry.error && entry.type != Registry::String) ? ErrorCode(ERROR_UNSUPPORTED_TYPE) : entry.error;
+    value = entry.string;
+  });
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  return value;
+}
+
+/**
+ * \brief marks the cached values as outdated
+ * 
+ * The values are read again from the registry when they are next requested.
+ * This is normally not needed, as the cache is notified of the modifications of the key.
+ */
+void RegistryCache::Invalidate()
+{
+  if (d) {
+    d->generation.fetch_add(1);
+  }
+}
+
+/**
+ * \brief closes the key and clears the cache
+ */
+void RegistryCache::Close()
+{
+  d.reset();
+}
+
+RegistryCache& RegistryCache::operator=(RegistryCache&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
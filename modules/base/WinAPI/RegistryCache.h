@@ -0,0 +1,66 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYCACHE_H
+#define WINAPI_REGISTRYCACHE_H
+
+#include "Registry.h"
+
+#include <memory>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct RegistryCachePriv;
+} // namespace Impl
+
+/**
+ * \brief caches the values of a registry key
+ * 
+ * A registry cache owns a key and keeps the values that were read from it,
+ * decoded, until the key is modified; it is notified of the modifications 
+ * with RegNotifyChangeKeyValue() (see RegistryBackend::WatchKey()).
+ * Reading a value that did not change since it was last read does not
+ * access the registry.
+ * 
+ * Values are only read again when they are requested after a modification, 
+ * so that successive modifications are handled at once.
+ * A value that does not exist is cached too.
+ * 
+ * The getters can be called concurrently from several threads and do 
+ * not block unless the value has to be read from the registry.
+ */
+class RegistryCache
+{
+public:
+  RegistryCache() noexcept;
+  RegistryCache(const RegistryCache&) = delete;
+  RegistryCache(RegistryCache&&) noexcept;
+  ~RegistryCache();
+
+  explicit RegistryCache(RegistryKey key);
+
+  bool IsNull() const;
+  const RegistryKey& GetKey() const;
+
+  int GetIntValue(const std::string& name) const;
+  std::string GetStringValue(const std::string& name) const;
+
+  void Invalidate();
+
+  void Close();
+
+  RegistryCache& operator=(const RegistryCache&) = delete;
+  RegistryCache& operator=(RegistryCache&&) noexcept;
+
+private:
+  std::unique_ptr<Impl::RegistryCachePriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYCACHE_H
\ No newline at end of file
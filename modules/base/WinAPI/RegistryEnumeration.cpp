@@ -0,0 +1,462 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistryEnumeration.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+#include "utf16_priv.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+struct registry_list_entry
+{
+  size_t name_offset;
+  size_t name_length;
+  Registry::ValueType type;
+  size_t data_offset;
+  size_t data_size;
+};
+
+// The names (in UTF-16) and the data of the entries are stored one after 
+// the other in the arena, each entry starting on an 8-byte boundary.
+struct RegistryListPriv
+{
+  std::vector<registry_list_entry> entries;
+  std::unique_ptr<unsigned char[]> arena;
+  size_t arena_size = 0;
+  size_t arena_capacity = 0;
+};
+
+// the initial size of the arena is computed from RegQueryInfoKeyW() but 
+// is limited in case a few values are much larger than the others
+constexpr size_t registry_list_max_initial_arena_size = 16 * 1024 * 1024;
+
+constexpr size_t registry_list_align(size_t n)
+{
+  return (n + 7) & ~size_t(7);
+}
+
+// makes room for \a size bytes at the end of the arena
+unsigned char* reserve_registry_list_arena(RegistryListPriv& list, size_t size)
+{
+  if (list.arena_capacity - list.arena_size < size)
+  {
+    const size_t capacity = (std::max)(list.arena_size + size, 2 * list.arena_capacity);
+    // not value-initialized, the memory is written by the backend
+    std::unique_ptr<unsigned char[]> arena{ new unsigned char[capacity] };
+
+    if (list.arena_size > 0) {
+      std::memcpy(arena.get(), list.arena.get(), list.arena_size);
+    }
+
+    list.arena = std::move(arena);
+    list.arena_capacity = capacity;
+  }
+
+  return list.arena.get() + list.arena_size;
+}
+
+// the buffers of a list that is read again are reused
+void init_registry_list(RegistryListPriv& list, size_t count, size_t item_size)
+{
+  list.entries.clear();
+  list.arena_size = 0;
+  list.entries.reserve(count);
+  const size_t max_count = registry_list_max_initial_arena_size / (std::max)(item_size, size_t(1));
+  reserve_registry_list_arena(list, (std::min)(count, max_count) * item_size);
+}
+
+void read_registry_subkey_list(RegistryListPriv& list, const RegistryKey& key)
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend& backend = *get_registry_key_backend(key, handle);
+
+  RegistryBackend::KeyInfo info;
+  ErrorCode err = backend.QueryKeyInfo(handle, info);
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  size_t name_capacity = info.maxSubKeyNameLength + 1;
+  init_registry_list(list, info.subKeyCount, registry_list_align(name_capacity * sizeof(char16_t)));
+
+  for (size_t index = 0;; ++index)
+  {
+    size_t name_length = 0;
+
+    for (;;)
+    {
+      // subkeys may have been added with longer names since QueryKeyInfo()
+      auto name = reinterpret_cast<char16_t*>(reserve_registry_list_arena(list, name_capacity * sizeof(char16_t)));
+      name_length = name_capacity;
+      err = backend.EnumKey(handle, index, name, name_length);
+
+      if (err.Value() != ERROR_MORE_DATA) {
+        break;
+      }
+
+      name_capacity *= 2;
+    }
+
+    if (err.Value() == ERROR_NO_MORE_ITEMS) {
+      break;
+    } else if (err) {
+      throw Exception(err);
+    }
+
+    list.entries.push_back(registry_list_entry{ list.arena_size, name_length, Registry::None, 0, 0 });
+    list.arena_size += registry_list_align((name_length + 1) * sizeof(char16_t));
+  }
+}
+
+void read_registry_value_list(RegistryListPriv& list, const RegistryKey& key, bool with_data)
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend& backend = *get_registry_key_backend(key, handle);
+
+  RegistryBackend::KeyInfo info;
+  ErrorCode err = backend.QueryKeyInfo(handle, info);
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  size_t name_capacity = info.maxValueNameLength + 1;
+  size_t data_capacity = with_data ? info.maxValueSize : 0;
+  init_registry_list(list, info.valueCount, registry_list_align(name_capacity * sizeof(char16_t)) + registry_list_align(data_capacity));
+
+  for (size_t index = 0;; ++index)
+  {
+    size_t name_length = 0;
+    size_t data_offset = 0;
+    size_t size = 0;
+    Registry::ValueType type = Registry::None;
+
+    for (;;)
+    {
+      // the data is read after a buffer large enough for any name and is 
+      // moved after the actual name below
+      data_offset = registry_list_align(name_capacity * sizeof(char16_t));
+      unsigned char* item = reserve_registry_list_arena(list, data_offset + data_capacity);
+      name_length = name_capacity;
+      size = data_capacity;
+      err = backend.EnumValue(handle, index, reinterpret_cast<char16_t*>(item), name_length, &type, with_data ? item + data_offset : nullptr, with_data ? &size : nullptr);
+
+      if (err.Value() != ERROR_MORE_DATA) {
+        break;
+      }
+
+      // the required data size is returned, but not the length of the name
+      if (with_data && size > data_capacity) {
+        data_capacity = size;
+      } else {
+        name_capacity *= 2;
+      }
+    }
+
+    if (err.Value() == ERROR_NO_MORE_ITEMS) {
+      break;
+    } else if (err) {
+      throw Exception(err);
+    }
+
+    unsigned char* item = list.arena.get() + list.arena_size;
+    const size_t compact_data_offset = registry_list_align((name_length + 1) * sizeof(char16_t));
+
+    if (with_data && size > 0 && compact_data_offset != data_offset) {
+      std::memmove(item + compact_data_offset, item + data_offset, size);
+    }
+
+    if (!with_data) {
+      size = 0;
+    }
+
+    list.entries.push_back(registry_list_entry{ list.arena_size, name_length, type, list.arena_size + compact_data_offset, size });
+    list.arena_size += compact_data_offset + registry_list_align(size);
+  }
+}
+
+std::u16string_view get_registry_list_name(const RegistryListPriv& list, size_t index)
+{
+  const registry_list_entry& entry = list.entries[index];
+  return std::u16string_view(reinterpret_cast<const char16_t*>(list.arena.get() + entry.name_offset), entry.name_length);
+}
+
+std::string get_registry_list_utf8_name(const RegistryListPriv& list, size_t index)
+{
+  std::u16string_view name = get_registry_list_name(list, index);
+  return utf16_to_utf8(name.data(), name.size());
+}
+
+} // namespace Impl
+
+RegistrySubKeyList::Iterator::Iterator(const RegistrySubKeyList* list, size_t index)
+  : m_list(list),
+    m_index(index)
+{
+
+}
+
+/**
+ * \brief returns the name of the current subkey, in UTF-8
+ */
+std::string RegistrySubKeyList::Iterator::operator*() const
+{
+  return m_list->GetName(m_index);
+}
+
+RegistrySubKeyList::Iterator& RegistrySubKeyList::Iterator::operator++()
+{
+  ++m_index;
+  return *this;
+}
+
+bool RegistrySubKeyList::Iterator::operator==(const Iterator& other) const
+{
+  return m_list == other.m_list && m_index == other.m_index;
+}
+
+bool RegistrySubKeyList::Iterator::operator!=(const Iterator& other) const
+{
+  return !(*this == other);
+}
+
+RegistrySubKeyList::RegistrySubKeyList() noexcept
+{
+
+}
+
+RegistrySubKeyList::RegistrySubKeyList(RegistrySubKeyList&&) noexcept = default;
+
+RegistrySubKeyList::~RegistrySubKeyList()
+{
+
+}
+
+/**
+ * \brief reads the names of the subkeys of a key
+ * \param key  the key, opened with Registry::Read access
+ * \throw Exception on failure
+ */
+RegistrySubKeyList::RegistrySubKeyList(const RegistryKey& key)
+{
+  Read(key);
+}
+
+/**
+ * \brief reads the names of the subkeys of a key, replacing the content of the list
+ * \param key  the key, opened with Registry::Read access
+ * \throw Exception on failure
+ * 
+ * The memory of the list is reused, so that reading the subkeys of 
+ * several keys with the same list does not allocate memory once the
+ * list is large enough.
+ */
+void RegistrySubKeyList::Read(const RegistryKey& key)
+{
+  if (!d) {
+    d.emplace();
+  }
+
+  Impl::read_registry_subkey_list(*d, key);
+}
+
+/**
+ * \brief returns the number of subkeys
+ */
+size_t RegistrySubKeyList::size() const
+{
+  return d ? d->entries.size() : 0;
+}
+
+bool RegistrySubKeyList::empty() const
+{
+  return size() == 0;
+}
+
+/**
+ * \brief returns the name of a subkey, converted to UTF-8
+ */
+std::string RegistrySubKeyList::GetName(size_t index) const
+{
+  return Impl::get_registry_list_utf8_name(*d, index);
+}
+
+/**
+ * \brief returns the name of a subkey, in UTF-16, without conversion
+ * 
+ * The view remains valid as long as the list exists.
+ */
+std::u16string_view RegistrySubKeyList::GetRawName(size_t index) const
+{
+  return Impl::get_registry_list_name(*d, index);
+}
+
+RegistrySubKeyList::Iterator RegistrySubKeyList::begin() const
+{
+  return Iterator(this, 0);
+}
+
+RegistrySubKeyList::Iterator RegistrySubKeyList::end() const
+{
+  return Iterator(this, size());
+}
+
+RegistrySubKeyList& RegistrySubKeyList::operator=(RegistrySubKeyList&&) noexcept = default;
+
+RegistryValueList::Item::Item(const Impl::RegistryListPriv* list, size_t index)
+  : m_list(list),
+    m_index(index)
+{
+
+}
+
+/**
+ * \brief returns the name of the value, converted to UTF-8
+ */
+std::string RegistryValueList::Item::GetName() const
+{
+  return Impl::get_registry_list_utf8_name(*m_list, m_index);
+}
+
+/**
+ * \brief returns the name of the value, in UTF-16, without conversion
+ */
+std::u16string_view RegistryValueList::Item::GetRawName() const
+{
+  return Impl::get_registry_list_name(*m_list, m_index);
+}
+
+/**
+ * \brief returns the type of the value
+ */
+Registry::ValueType RegistryValueList::Item::GetType() const
+{
+  return m_list->entries[m_index].type;
+}
+
+/**
+ * \brief returns the data of the value
+ * 
+ * The data is empty if the list was constructed without WithData.
+ */
+Span<const std::byte> RegistryValueList::Item::GetData() const
+{
+  const Impl::registry_list_entry& entry = m_list->entries[m_index];
+  return Span<const std::byte>(reinterpret_cast<const std::byte*>(m_list->arena.get() + entry.data_offset), entry.data_size);
+}
+
+RegistryValueList::Iterator::Iterator(const Impl::RegistryListPriv* list, size_t index)
+  : m_list(list),
+    m_index(index)
+{
+
+}
+
+/**
+ * \brief returns the current value
+ */
+RegistryValueList::Item RegistryValueList::Iterator::operator*() const
+{
+  return Item(m_list, m_index);
+}
+
+RegistryValueList::Iterator& RegistryValueList::Iterator::operator++()
+{
+  ++m_index;
+  return *this;
+}
+
+bool RegistryValueList::Iterator::operator==(const Iterator& other) const
+{
+  return m_list == other.m_list && m_index == other.m_index;
+}
+
+bool RegistryValueList::Iterator::operator!=(const Iterator& other) const
+{
+  return !(*this == other);
+}
+
+RegistryValueList::RegistryValueList() noexcept
+{
+
+}
+
+RegistryValueList::RegistryValueList(RegistryValueList&&) noexcept = default;
+
+RegistryValueList::~RegistryValueList()
+{
+
+}
+
+/**
+ * \brief reads the values of a key
+ * \param key   the key, opened with Registry::Read access
+ * \param mode  whether the data of the values is read too
+ * \throw Exception on failure
+ */
+RegistryValueList::RegistryValueList(const RegistryKey& key, DataMode mode)
+{
+  Read(key, mode);
+}
+
+/**
+ * \brief reads the values of a key, replacing the content of the list
+ * \param key   the key, opened with Registry::Read access
+ * \param mode  whether the data of the values is read too
+ * \throw Exception on failure
+ * 
+ * As with RegistrySubKeyList::Read(), the memory of the list is reused.
+ */
+void RegistryValueList::Read(const RegistryKey& key, DataMode mode)
+{
+  if (!d) {
+    d.emplace();
+  }
+
+  Impl::read_registry_value_list(*d, key, mode == WithData);
+}
+
+/**
+ * \brief returns the number of values
+ */
+size_t RegistryValueList::size() const
+{
+  return d ? d->entries.size() : 0;
+}
+
+bool RegistryValueList::empty() const
+{
+  return size() == 0;
+}
+
+RegistryValueList::Item RegistryValueList::operator[](size_t index) const
+{
+  return Item(d.get(), index);
+}
+
+RegistryValueList::Iterator RegistryValueList::begin() const
+{
+  return Iterator(d.get(), 0);
+}
+
+RegistryValueList::Iterator RegistryValueList::end() const
+{
+  return Iterator(d.get(), size());
+}
+
+RegistryValueList& RegistryValueList::operator=(RegistryValueList&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,184 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYENUMERATION_H
+#define WINAPI_REGISTRYENUMERATION_H
+
+#include "FastPimpl.h"
+#include "Registry.h"
+#include "Span.h"
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct RegistryListPriv;
+} // namespace Impl
+
+/**
+ * \brief the names of the subkeys of a registry key
+ * 
+ * The names are read when the list is constructed, into a single buffer 
+ * sized from RegQueryInfoKeyW(); they are kept in UTF-16 and only 
+ * converted to UTF-8 by GetName() and the iterators.
+ * 
+ * The list is a snapshot: it is not updated when subkeys are added or removed.
+ */
+class RegistrySubKeyList
+{
+public:
+  /**
+   * \brief iterates over the names of the subkeys
+   */
+  class Iterator
+  {
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef std::string value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const std::string* pointer;
+    typedef std::string reference;
+
+  public:
+    Iterator() = default;
+    Iterator(const RegistrySubKeyList* list, size_t index);
+
+    std::string operator*() const;
+    Iterator& operator++();
+
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+
+  private:
+    const RegistrySubKeyList* m_list = nullptr;
+    size_t m_index = 0;
+  };
+
+public:
+  RegistrySubKeyList() noexcept;
+  RegistrySubKeyList(const RegistrySubKeyList&) = delete;
+  RegistrySubKeyList(RegistrySubKeyList&&) noexcept;
+  ~RegistrySubKeyList();
+
+  explicit RegistrySubKeyList(const RegistryKey& key);
+
+  void Read(const RegistryKey& key);
+
+  size_t size() const;
+  bool empty() const;
+
+  std::string GetName(size_t index) const;
+  std::u16string_view GetRawName(size_t index) const;
+
+  Iterator begin() const;
+  Iterator end() const;
+
+  RegistrySubKeyList& operator=(const RegistrySubKeyList&) = delete;
+  RegistrySubKeyList& operator=(RegistrySubKeyList&&) noexcept;
+
+private:
+  Impl::FastPimpl<Impl::RegistryListPriv, 64> d;
+};
+
+/**
+ * \brief the names, types and optionally the data of the values of a registry key
+ * 
+ * As with RegistrySubKeyList, the values are read when the list is 
+ * constructed, into a single buffer, and their names are converted 
+ * to UTF-8 on demand.
+ * 
+ * With WithData, the data of the values is read in the same pass as 
+ * their names (one call to RegEnumValueW() per value) and can be 
+ * accessed without copy.
+ */
+class RegistryValueList
+{
+public:
+  enum DataMode
+  {
+    WithoutData,
+    WithData,
+  };
+
+  /**
+   * \brief a value of the list
+   * 
+   * An item is a reference into the list and is invalidated when the list is destroyed.
+   */
+  class Item
+  {
+  public:
+    Item(const Impl::RegistryListPriv* list, size_t index);
+
+    std::string GetName() const;
+    std::u16string_view GetRawName() const;
+    Registry::ValueType GetType() const;
+    Span<const std::byte> GetData() const;
+
+  private:
+    const Impl::RegistryListPriv* m_list;
+    size_t m_index;
+  };
+
+  /**
+   * \brief iterates over the values
+   */
+  class Iterator
+  {
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef Item value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Item* pointer;
+    typedef Item reference;
+
+  public:
+    Iterator() = default;
+    Iterator(const Impl::RegistryListPriv* list, size_t index);
+
+    Item operator*() const;
+    Iterator& operator++();
+
+    bool operator==(const Iterator& other) const;
+    bool operator!=(const Iterator& other) const;
+
+  private:
+    const Impl::RegistryListPriv* m_list = nullptr;
+    size_t m_index = 0;
+  };
+
+public:
+  RegistryValueList() noexcept;
+  RegistryValueList(const RegistryValueList&) = delete;
+  RegistryValueList(RegistryValueList&&) noexcept;
+  ~RegistryValueList();
+
+  explicit RegistryValueList(const RegistryKey& key, DataMode mode = WithoutData);
+
+  void Read(const RegistryKey& key, DataMode mode = WithoutData);
+
+  size_t size() const;
+  bool empty() const;
+
+  Item operator[](size_t index) const;
+
+  Iterator begin() const;
+  Iterator end() const;
+
+  RegistryValueList& operator=(const RegistryValueList&) = delete;
+  RegistryValueList& operator=(RegistryValueList&&) noexcept;
+
+private:
+  Impl::FastPimpl<Impl::RegistryListPriv, 64> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYENUMERATION_H
\ No newline at end of file
@@ -0,0 +1,429 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistryKeyCache.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+constexpr size_t registry_key_cache_default_capacity = 64;
+
+struct registry_key_cache_entry
+{
+  RegistryBackend* backend;
+  RegistryBackend::PredefinedKey root;
+  Registry::AccessRights rights;
+  std::string path;
+  registry_shared_key* key = nullptr;
+  RegistryBackend::WatchHandle watch = nullptr;
+  // set by the watch when the key is modified or deleted
+  std::atomic<bool> stale{ false };
+};
+
+// the path is a view on the path of the entry, or on the path being looked up
+struct registry_key_cache_id
+{
+  RegistryBackend* backend;
+  RegistryBackend::PredefinedKey root;
+  Registry::AccessRights rights;
+  std::string_view path;
+};
+
+struct registry_key_cache_id_hash
+{
+  size_t operator()(const registry_key_cache_id& id) const noexcept
+  {
+    size_t hash = registry_name_hash()(id.path);
+    hash ^= std::hash<const void*>()(id.backend) + 31 * static_cast<size_t>(id.root) + static_cast<size_t>(id.rights);
+    return hash;
+  }
+};
+
+struct registry_key_cache_id_equal
+{
+  bool operator()(const registry_key_cache_id& lhs, const registry_key_cache_id& rhs) const noexcept
+  {
+    return lhs.backend == rhs.backend && lhs.root == rhs.root && lhs.rights == rhs.rights && registry_name_equal()(lhs.path, rhs.path);
+  }
+};
+
+typedef std::list<registry_key_cache_entry> registry_key_cache_list;
+
+struct RegistryKeyCachePriv
+{
+  size_t capacity = registry_key_cache_default_capacity;
+  std::mutex mutex;
+  // the most recently used entry first
+  registry_key_cache_list entries;
+  std::unordered_map<registry_key_cache_id, registry_key_cache_list::iterator, registry_key_cache_id_hash, registry_key_cache_id_equal> index;
+};
+
+std::string_view trim_registry_path(std::string_view path)
+{
+  while (!path.empty() && path.front() == '\\') {
+    path.remove_prefix(1);
+  }
+
+  while (!path.empty() && path.back() == '\\') {
+    path.remove_suffix(1);
+  }
+
+  return path;
+}
+
+void remove_registry_key_cache_entry(RegistryKeyCachePriv& cache, registry_key_cache_list::iterator it)
+{
+  cache.index.erase(registry_key_cache_id{ it->backend, it->root, it->rights, it->path });
+  it->backend->UnwatchKey(it->watch);
+  release_registry_shared_key(it->key);
+  cache.entries.erase(it);
+}
+
+registry_key_cache_entry* find_registry_key_cache_entry(RegistryKeyCachePriv& cache, const registry_key_cache_id& id)
+{
+  auto found = cache.index.find(id);
+
+  if (found == cache.index.end()) {
+    return nullptr;
+  }
+
+  registry_key_cache_list::iterator it = found->second;
+
+  if (it->stale.load(std::memory_order_acquire))
+  {
+    remove_registry_key_cache_entry(cache, it);
+    return nullptr;
+  }
+
+  cache.entries.splice(cache.entries.begin(), cache.entries, it);
+  return &*it;
+}
+
+// takes ownership of the handle, unless the key cannot be watched in which
+// case nullptr is returned
+registry_key_cache_entry* insert_registry_key_cache_entry(RegistryKeyCachePriv& cache, const registry_key_cache_id& id, RegistryBackend::KeyHandle handle)
+{
+  registry_key_cache_entry& entry = cache.entries.emplace_front();
+  entry.backend = id.backend;
+  entry.root = id.root;
+  entry.rights = id.rights;
+
+  std::atomic<bool>* stale = &entry.stale;
+  ErrorCode err = id.backend->WatchKey(handle, [stale]() { stale->store(true, std::memory_order_release); }, entry.watch);
+
+  if (err)
+  {
+    cache.entries.pop_front();
+    return nullptr;
+  }
+
+  entry.path = std::string(id.path);
+  entry.key = new registry_shared_key{ id.backend, handle };
+  cache.index.emplace(registry_key_cache_id{ entry.backend, entry.root, entry.rights, entry.path }, cache.entries.begin());
+
+  while (cache.entries.size() > cache.capacity) {
+    remove_registry_key_cache_entry(cache, std::prev(cache.entries.end()));
+  }
+
+  return &entry;
+}
+
+// the parent keys are cached with Registry::Read access, whatever the 
+// access rights of their subkeys; returns a new reference on the parent,
+// which stays valid if the entry is evicted
+registry_shared_key* find_registry_key_cache_parent(RegistryKeyCachePriv& cache, RegistryBackend& backend, RegistryBackend::PredefinedKey root, std::string_view path)
+{
+  registry_key_cache_entry* entry = find_registry_key_cache_entry(cache, registry_key_cache_id{ &backend, root, Registry::Read, path });
+
+  if (!entry) {
+    return nullptr;
+  }
+
+  entry->key->refs.fetch_add(1, std::memory_order_relaxed);
+  return entry->key;
+}
+
+// inserts a parent opened without holding the lock; returns the handle if it
+// must be closed, because another thread inserted the parent meanwhile or
+// because it cannot be watched
+RegistryBackend::KeyHandle insert_registry_key_cache_parent(RegistryKeyCachePriv& cache, RegistryBackend& backend, RegistryBackend::PredefinedKey root, std::string_view path, RegistryBackend::KeyHandle handle)
+{
+  const registry_key_cache_id id{ &backend, root, Registry::Read, path };
+
+  if (find_registry_key_cache_entry(cache, id) || !insert_registry_key_cache_entry(cache, id, handle)) {
+    return handle;
+  }
+
+  return nullptr;
+}
+
+// returns a key that shares the handle of the entry
+RegistryKey share_registry_key_cache_entry(RegistryBackend& backend, registry_key_cache_entry& entry)
+{
+  entry.key->refs.fetch_add(1, std::memory_order_relaxed);
+
+  RegistryKeyPriv rk;
+  rk.backend = &backend;
+  rk.handle = entry.key->handle;
+  rk.shared = entry.key;
+  return RegistryKey(rk);
+}
+
+} // namespace Impl
+
+/**
+ * \brief constructs an empty cache with the default capacity (64 keys)
+ */
+RegistryKeyCache::RegistryKeyCache()
+  : d(std::make_unique<Impl::RegistryKeyCachePriv>())
+{
+
+}
+
+/**
+ * \brief constructs an empty cache
+ * \param capacity  the maximum number of keys kept open by the cache
+ * 
+ * A cache with a capacity of 0 does not cache anything.
+ */
+RegistryKeyCache::RegistryKeyCache(size_t capacity)
+  : d(std::make_unique<Impl::RegistryKeyCachePriv>())
+{
+  d->capacity = capacity;
+}
+
+/**
+ * \brief destroys the cache
+ * 
+ * The keys that are still open keep their handle open.
+ */
+RegistryKeyCache::~RegistryKeyCache()
+{
+  Clear();
+}
+
+/**
+ * \brief returns the cache used by the library itself, e.g. by WindowsErrorReporting
+ * 
+ * This cache is cleared by Registry::SetBackend().
+ */
+RegistryKeyCache& RegistryKeyCache::Global()
+{
+  // never destroyed, so that the cache does not outlive the default 
+  // backend; the handles are closed when the process exits
+  static RegistryKeyCache* cache = new RegistryKeyCache();
+  return *cache;
+}
+
+/**
+ * \brief returns the number of keys in the cache
+ */
+size_t RegistryKeyCache::size() const
+{
+  std::lock_guard<std::mutex> lock{ d->mutex };
+  return d->entries.size();
+}
+
+/**
+ * \brief returns the maximum number of keys in the cache
+ */
+size_t RegistryKeyCache::GetCapacity() const
+{
+  return d->capacity;
+}
+
+/**
+ * \brief opens a registry key, or returns the key from the cache
+ * \param key           parent key
+ * \param subKey        name of the subkey
+ * \param accessRights  specifies whether the key should be writable or read-only
+ * \throw Exception on failure
+ * 
+ * \sa Registry::OpenKey().
+ */
+RegistryKey RegistryKeyCache::OpenKey(const RegistryKey& key, const std::string& subKey, Registry::AccessRights accessRights)
+{
+  RegistryKey result;
+  ErrorCode err = TryOpenKey(key, subKey, accessRights, result);
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  return result;
+}
+
+/**
+ * \brief opens a registry key, or returns the key from the cache
+ * \param key           parent key
+ * \param subKey        name of the subkey
+ * \param accessRights  specifies whether the key should be writable or read-only
+ * \param result        receives the key
+ * 
+ * Returns an error code if the key cannot be opened; failures are not cached.
+ * 
+ * \sa RegistryKey::TryOpen().
+ */
+ErrorCode RegistryKeyCache::TryOpenKey(const RegistryKey& key, const std::string& subKey, Registry::AccessRights accessRights, RegistryKey& result)
+{
+  result.Close();
+
+  Impl::RegistryKeyPriv* root = key.GetImpl();
+  const std::string_view path = Impl::trim_registry_path(subKey);
+
+  if (!root || !root->predefined || path.empty() || d->capacity == 0) {
+    return result.TryOpen(key, subKey, accessRights);
+  }
+
+  RegistryBackend& backend = Registry::GetBackend();
+  const Impl::registry_key_cache_id id{ &backend, root->root, accessRights, path };
+  const size_t separator = path.rfind('\\');
+  const std::string_view parent_path = separator != std::string_view::npos ? Impl::trim_registry_path(path.substr(0, separator)) : std::string_view();
+  Impl::registry_shared_key* parent = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock{ d->mutex };
+    Impl::registry_key_cache_entry* entry = Impl::find_registry_key_cache_entry(*d, id);
+
+    if (entry)
+    {
+      result = Impl::share_registry_key_cache_entry(backend, *entry);
+      return ErrorCode();
+    }
+
+    if (!parent_path.empty()) {
+      parent = Impl::find_registry_key_cache_parent(*d, backend, root->root, parent_path);
+    }
+  }
+
+  // the keys are opened without holding the lock, so that the other threads
+  // are not blocked by a slow backend; the key is opened relative to its
+  // parent, or relative to the root if the parent cannot be opened
+  const RegistryBackend::KeyHandle predefined = backend.GetPredefinedKey(root->root);
+  RegistryBackend::KeyHandle opened_parent = nullptr;
+
+  if (!parent && !parent_path.empty() && backend.OpenKey(predefined, std::string(parent_path), Registry::Read, opened_parent)) {
+    opened_parent = nullptr;
+  }
+
+  RegistryBackend::KeyHandle parent_handle = predefined;
+  std::string_view name = path;
+
+  if (parent || opened_parent)
+  {
+    parent_handle = parent ? parent->handle : opened_parent;
+    name = path.substr(separator + 1);
+  }
+
+  RegistryBackend::KeyHandle handle = nullptr;
+  ErrorCode err = backend.OpenKey(parent_handle, std::string(name), accessRights, handle);
+
+  if (parent) {
+    Impl::release_registry_shared_key(parent);
+  }
+
+  // handles that are not needed because another thread inserted the same keys
+  // meanwhile, closed once the lock is released
+  RegistryBackend::KeyHandle duplicates[2] = { nullptr, nullptr };
+
+  {
+    std::lock_guard<std::mutex> lock{ d->mutex };
+
+    if (opened_parent) {
+      duplicates[0] = Impl::insert_registry_key_cache_parent(*d, backend, root->root, parent_path, opened_parent);
+    }
+
+    if (!err)
+    {
+      Impl::registry_key_cache_entry* entry = Impl::find_registry_key_cache_entry(*d, id);
+
+      if (entry) {
+        duplicates[1] = handle;
+      } else {
+        entry = Impl::insert_registry_key_cache_entry(*d, id, handle);
+      }
+
+      if (entry)
+      {
+        result = Impl::share_registry_key_cache_entry(backend, *entry);
+      }
+      else
+      {
+        Impl::RegistryKeyPriv rk;
+        rk.backend = &backend;
+        rk.handle = handle;
+        result = RegistryKey(rk);
+      }
+    }
+  }
+
+  for (RegistryBackend::KeyHandle duplicate : duplicates)
+  {
+    if (duplicate) {
+      backend.CloseKey(duplicate);
+    }
+  }
+
+  return err;
+}
+
+/**
+ * \brief removes a key and its subkeys from the cache
+ * \param key     the parent key
+ * \param subKey  name of the subkey, empty to remove all the subkeys of \a key
+ */
+void RegistryKeyCache::Invalidate(const RegistryKey& key, const std::string& subKey)
+{
+  Impl::RegistryKeyPriv* root = key.GetImpl();
+
+  if (!root || !root->predefined) {
+    return;
+  }
+
+  RegistryBackend* backend = &Registry::GetBackend();
+  const std::string_view path = Impl::trim_registry_path(subKey);
+
+  std::lock_guard<std::mutex> lock{ d->mutex };
+
+  for (auto it = d->entries.begin(); it != d->entries.end();)
+  {
+    auto next = std::next(it);
+    std::string_view entry_path = it->path;
+
+    const bool in_path = entry_path.size() == path.size() || path.empty() || (entry_path.size() > path.size() && entry_path[path.size()] == '\\');
+
+    if (it->backend == backend && it->root == root->root && in_path && Impl::registry_name_equal()(entry_path.substr(0, path.size()), path)) {
+      Impl::remove_registry_key_cache_entry(*d, it);
+    }
+
+    it = next;
+  }
+}
+
+/**
+ * \brief removes all the keys from the cache
+ */
+void RegistryKeyCache::Clear()
+{
+  std::lock_guard<std::mutex> lock{ d->mutex };
+
+  while (!d->entries.empty()) {
+    Impl::remove_registry_key_cache_entry(*d, d->entries.begin());
+  }
+}
+
+} // namespace Win32
\ No newline at end of file
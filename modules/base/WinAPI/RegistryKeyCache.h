@@ -0,0 +1,73 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYKEYCACHE_H
+#define WINAPI_REGISTRYKEYCACHE_H
+
+#include "ErrorCode.h"
+#include "Registry.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct RegistryKeyCachePriv;
+} // namespace Impl
+
+/**
+ * \brief keeps the most recently opened registry keys open
+ * 
+ * Opening a key that is in the cache does not access the registry: the 
+ * returned RegistryKey shares the handle of the cache, which is closed 
+ * when it has been evicted from the cache and all the keys sharing 
+ * it are closed.
+ * Keys are identified by their root, their path (compared without regard 
+ * to case) and the access rights they were opened with.
+ * 
+ * The parent of a key is cached too and the key is opened relative to it,
+ * so that opening the siblings of a key only walks their last component.
+ * 
+ * Only the subkeys of the predefined keys (e.g., Registry::HKEY_LOCAL_MACHINE)
+ * are cached, and only if they can be watched (see RegistryBackend::WatchKey(),
+ * this requires Registry::Read access): a key is reopened after it was 
+ * modified or deleted.
+ * As the notification is asynchronous, code that deletes a key should also 
+ * call Invalidate().
+ * 
+ * All functions can be called concurrently from several threads.
+ */
+class RegistryKeyCache
+{
+public:
+  RegistryKeyCache();
+  RegistryKeyCache(const RegistryKeyCache&) = delete;
+  ~RegistryKeyCache();
+
+  explicit RegistryKeyCache(size_t capacity);
+
+  static RegistryKeyCache& Global();
+
+  size_t size() const;
+  size_t GetCapacity() const;
+
+  RegistryKey OpenKey(const RegistryKey& key, const std::string& subKey, Registry::AccessRights accessRights);
+  ErrorCode TryOpenKey(const RegistryKey& key, const std::string& subKey, Registry::AccessRights accessRights, RegistryKey& result);
+
+  void Invalidate(const RegistryKey& key, const std::string& subKey);
+  void Clear();
+
+  RegistryKeyCache& operator=(const RegistryKeyCache&) = delete;
+
+private:
+  std::unique_ptr<Impl::RegistryKeyCachePriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYKEYCACHE_H
\ No newline at end of file
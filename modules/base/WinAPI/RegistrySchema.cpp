@@ -0,0 +1,122 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistrySchema.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+#include "RegistryValue.h"
+
+#include <cstring>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+/**
+ * \brief reads the values of a schema into a buffer
+ * \throw Exception on failure
+ */
+void read_registry_schema(const RegistryKey& key, RegistryBackend::ValueQuery* values, size_t count, registry_schema_buffer& buffer)
+{
+  RegistryBackend::KeyHandle handle = nullptr;
+  RegistryBackend& backend = *get_registry_key_backend(key, handle);
+  size_t size = sizeof(buffer.m_stack);
+
+  ErrorCode err = backend.GetValues(handle, values, count, buffer.m_stack, size);
+
+  // the values may grow between two calls
+  while (err.Value() == ERROR_MORE_DATA)
+  {
+    buffer.m_heap.resize(size);
+    buffer.m_data = buffer.m_heap.data();
+    err = backend.GetValues(handle, values, count, buffer.m_heap.data(), size);
+  }
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+// the data of the values is not necessarily aligned
+template<typename T>
+T read_registry_field_integer(const RegistryBackend::ValueQuery& value, const unsigned char* data, Registry::ValueType expected_type)
+{
+  T result;
+
+  if (value.type != expected_type || value.size != sizeof(result)) {
+    throw Exception(ErrorCode(ERROR_UNSUPPORTED_TYPE));
+  }
+
+  std::memcpy(&result, data, sizeof(result));
+  return result;
+}
+
+template<typename T>
+T read_registry_field_integer64(const RegistryBackend::ValueQuery& value, const unsigned char* data)
+{
+  if (value.type == Registry::DWord) {
+    return static_cast<T>(read_registry_field_integer<uint32_t>(value, data, Registry::DWord));
+  } else {
+    return static_cast<T>(read_registry_field_integer<uint64_t>(value, data, Registry::QWord));
+  }
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, bool& field)
+{
+  field = read_registry_field_integer<uint32_t>(value, data, Registry::DWord) != 0;
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, int32_t& field)
+{
+  field = static_cast<int32_t>(read_registry_field_integer<uint32_t>(value, data, Registry::DWord));
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, uint32_t& field)
+{
+  field = read_registry_field_integer<uint32_t>(value, data, Registry::DWord);
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, int64_t& field)
+{
+  field = read_registry_field_integer64<int64_t>(value, data);
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, uint64_t& field)
+{
+  field = read_registry_field_integer64<uint64_t>(value, data);
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, std::string& field)
+{
+  if (value.type != Registry::String && value.type != Registry::ExpandString) {
+    throw Exception(ErrorCode(ERROR_UNSUPPORTED_TYPE));
+  }
+
+  decode_registry_string(data, value.size, field);
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, std::vector<std::string>& field)
+{
+  if (value.type != Registry::MultiString) {
+    throw Exception(ErrorCode(ERROR_UNSUPPORTED_TYPE));
+  }
+
+  field.clear();
+
+  for (const std::string& str : RegistryMultiStringRange(Span<const std::byte>(reinterpret_cast<const std::byte*>(data), value.size))) {
+    field.push_back(str);
+  }
+}
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, std::vector<unsigned char>& field)
+{
+  field.assign(data, data + value.size);
+}
+
+} // namespace Impl
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,200 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYSCHEMA_H
+#define WINAPI_REGISTRYSCHEMA_H
+
+#include "Registry.h"
+#include "RegistryBackend.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// holds the data of the values read by a schema, on the stack
+// unless they are too large
+class registry_schema_buffer
+{
+public:
+  registry_schema_buffer() = default;
+  registry_schema_buffer(const registry_schema_buffer&) = delete;
+
+  const unsigned char* data() const;
+
+  registry_schema_buffer& operator=(const registry_schema_buffer&) = delete;
+
+private:
+  friend void read_registry_schema(const RegistryKey& key, RegistryBackend::ValueQuery* values, size_t count, registry_schema_buffer& buffer);
+
+private:
+  alignas(8) unsigned char m_stack[1024];
+  std::vector<unsigned char> m_heap;
+  const unsigned char* m_data = m_stack;
+};
+
+inline const unsigned char* registry_schema_buffer::data() const
+{
+  return m_data;
+}
+
+void read_registry_schema(const RegistryKey& key, RegistryBackend::ValueQuery* values, size_t count, registry_schema_buffer& buffer);
+
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, bool& field);
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, int32_t& field);
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, uint32_t& field);
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, int64_t& field);
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, uint64_t& field);
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, std::string& field);
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, std::vector<std::string>& field);
+void decode_registry_field(const RegistryBackend::ValueQuery& value, const unsigned char* data, std::vector<unsigned char>& field);
+
+} // namespace Impl
+
+/**
+ * \brief binds a registry value to a member of a struct
+ * 
+ * The member can be a bool, a 32-bit integer (REG_DWORD), a 64-bit integer
+ * (REG_QWORD or REG_DWORD), a std::string (REG_SZ or REG_EXPAND_SZ, 
+ * without expansion), a std::vector<std::string> (REG_MULTI_SZ) or 
+ * a std::vector<unsigned char> (any type).
+ * 
+ * \sa RegistrySchema.
+ */
+template<typename T, typename M>
+struct RegistryField
+{
+  const char* name;
+  M T::* member;
+
+  RegistryField(const char* valueName, M T::* fieldMember);
+};
+
+template<typename T, typename M>
+inline RegistryField<T, M>::RegistryField(const char* valueName, M T::* fieldMember)
+  : name(valueName),
+    member(fieldMember)
+{
+
+}
+
+/**
+ * \brief reads the values of a registry key into the members of a struct
+ * 
+ * The fields are described at compile time and all the values are read
+ * at once, with a single call to RegQueryMultipleValuesW() (see 
+ * RegistryBackend::GetValues()); they are decoded directly into 
+ * the members of the struct.
+ * 
+ * \code
+ * struct Config
+ * {
+ *   int timeout = 30;
+ *   std::string folder;
+ * };
+ * 
+ * static const auto config_schema = MakeRegistrySchema<Config>(
+ *   RegistryField("Timeout", &Config::timeout),
+ *   RegistryField("Folder", &Config::folder));
+ * 
+ * Config config;
+ * config_schema.Read(key, config);
+ * \endcode
+ * 
+ * A schema is meant to be constructed once (it converts the names of 
+ * the values) and can then be used concurrently from several threads.
+ */
+template<typename T, typename... Fields>
+class RegistrySchema
+{
+public:
+  explicit RegistrySchema(Fields... fields);
+
+  static constexpr size_t size();
+
+  void Read(const RegistryKey& key, T& object) const;
+
+private:
+  template<size_t... I>
+  void decode(const RegistryBackend::ValueQuery* values, const unsigned char* data, T& object, std::index_sequence<I...>) const;
+
+private:
+  std::tuple<Fields...> m_fields;
+  std::array<std::string, sizeof...(Fields)> m_names;
+};
+
+template<typename T, typename... Fields>
+inline RegistrySchema<T, Fields...>::RegistrySchema(Fields... fields)
+  : m_fields(fields...),
+    m_names{ std::string(fields.name)... }
+{
+
+}
+
+/**
+ * \brief returns the number of fields of the schema
+ */
+template<typename T, typename... Fields>
+inline constexpr size_t RegistrySchema<T, Fields...>::size()
+{
+  return sizeof...(Fields);
+}
+
+/**
+ * \brief reads the values into the members of \a object
+ * \param key     the key, opened with Registry::Read access
+ * \param object  the object whose members receive the values
+ * \throw Exception on failure
+ * 
+ * The members bound to values that do not exist are left unchanged.
+ * If a value does not have a type compatible with its member, an Exception
+ * with the ERROR_UNSUPPORTED_TYPE error code is thrown; the members may 
+ * have been partially assigned.
+ */
+template<typename T, typename... Fields>
+inline void RegistrySchema<T, Fields...>::Read(const RegistryKey& key, T& object) const
+{
+  std::array<RegistryBackend::ValueQuery, sizeof...(Fields)> values;
+
+  for (size_t i(0); i < values.size(); ++i) {
+    values[i].name = &m_names[i];
+  }
+
+  Impl::registry_schema_buffer buffer;
+  Impl::read_registry_schema(key, values.data(), values.size(), buffer);
+  decode(values.data(), buffer.data(), object, std::index_sequence_for<Fields...>());
+}
+
+template<typename T, typename... Fields>
+template<size_t... I>
+inline void RegistrySchema<T, Fields...>::decode(const RegistryBackend::ValueQuery* values, const unsigned char* data, T& object, std::index_sequence<I...>) const
+{
+  (void)values;
+  (void)data;
+  (void)object;
+
+  ((values[I].found ? Impl::decode_registry_field(values[I], data + values[I].offset, object.*(std::get<I>(m_fields).member)) : void()), ...);
+}
+
+/**
+ * \brief constructs a RegistrySchema, deducing the types of the fields
+ */
+template<typename T, typename... Fields>
+inline RegistrySchema<T, Fields...> MakeRegistrySchema(Fields... fields)
+{
+  return RegistrySchema<T, Fields...>(fields...);
+}
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYSCHEMA_H
\ No newline at end of file
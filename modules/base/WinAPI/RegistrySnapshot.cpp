@@ -0,0 +1,862 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistrySnapshot.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+#include "RegistryBatch.h"
+#include "RegistryEnumeration.h"
+#include "filemapping_priv.h"
+#include "utf16_priv.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// Layout of a snapshot file, in the byte order of the machine (little-endian
+// on all the supported platforms); each section is aligned on 8 bytes:
+// - the header;
+// - the names, sorted without regard to case, as offsets in the characters;
+// - the characters of the names, in UTF-16;
+// - the keys, the root key first; the subkeys of a key are contiguous,
+//   sorted by name, and come after it;
+// - the values, the values of a key are contiguous and sorted by name;
+// - the data of the values, each aligned on 8 bytes.
+// Names are referenced by their index in the table, which orders them as
+// they are sorted.
+
+constexpr uint32_t registry_snapshot_magic = 0x504E5352; // "RSNP"
+constexpr uint32_t registry_snapshot_version = 1;
+constexpr uint32_t registry_snapshot_no_name = 0xFFFFFFFF;
+constexpr size_t registry_snapshot_alignment = 8;
+
+struct registry_snapshot_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;
+  uint32_t string_count;
+  uint32_t character_count;
+  uint32_t key_count;
+  uint32_t value_count;
+  uint64_t strings_offset;
+  uint64_t characters_offset;
+  uint64_t keys_offset;
+  uint64_t values_offset;
+  uint64_t data_offset;
+};
+
+struct registry_snapshot_string
+{
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct registry_snapshot_key
+{
+  uint32_t name;
+  uint32_t first_subkey;
+  uint32_t subkey_count;
+  uint32_t first_value;
+  uint32_t value_count;
+  // returned by QueryKeyInfo()
+  uint32_t max_subkey_name_length;
+  uint32_t max_value_name_length;
+  uint32_t max_value_size;
+};
+
+struct registry_snapshot_value
+{
+  uint32_t name;
+  uint32_t type;
+  uint32_t size;
+  uint32_t reserved;
+  // from the start of the data
+  uint64_t data;
+};
+
+struct RegistrySnapshotPriv
+{
+  MappedFile file;
+  const registry_snapshot_header* header = nullptr;
+  const registry_snapshot_string* strings = nullptr;
+  const char16_t* characters = nullptr;
+  const registry_snapshot_key* keys = nullptr;
+  const registry_snapshot_value* values = nullptr;
+  const unsigned char* data = nullptr;
+};
+
+inline size_t registry_snapshot_align(size_t size)
+{
+  return (size + registry_snapshot_alignment - 1) & ~(registry_snapshot_alignment - 1);
+}
+
+inline char16_t registry_snapshot_tolower(char16_t c)
+{
+  return (c >= u'A' && c <= u'Z') ? static_cast<char16_t>(c - u'A' + u'a') : c;
+}
+
+// compares names without regard to the case of ASCII letters
+int compare_registry_snapshot_names(std::u16string_view a, std::u16string_view b)
+{
+  const size_t length = (std::min)(a.size(), b.size());
+
+  for (size_t i(0); i < length; ++i)
+  {
+    const char16_t ca = registry_snapshot_tolower(a[i]);
+    const char16_t cb = registry_snapshot_tolower(b[i]);
+
+    if (ca != cb) {
+      return ca < cb ? -1 : 1;
+    }
+  }
+
+  return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+}
+
+// the order of the names in the table: names that only differ by case are
+// adjacent
+bool registry_snapshot_name_less(std::u16string_view a, std::u16string_view b)
+{
+  const int result = compare_registry_snapshot_names(a, b);
+  return result < 0 || (result == 0 && a < b);
+}
+
+std::u16string_view get_registry_snapshot_name(const RegistrySnapshotPriv& snapshot, uint32_t index)
+{
+  const registry_snapshot_string& str = snapshot.strings[index];
+  return std::u16string_view(snapshot.characters + str.offset, str.length);
+}
+
+// returns the range of the indices of the names that are equal to a name
+// without regard to case
+std::pair<uint32_t, uint32_t> find_registry_snapshot_names(const RegistrySnapshotPriv& snapshot, std::u16string_view name)
+{
+  const registry_snapshot_string* begin = snapshot.strings;
+  const registry_snapshot_string* end = begin + snapshot.header->string_count;
+
+  auto lower = std::lower_bound(begin, end, name, [&snapshot](const registry_snapshot_string& str, std::u16string_view n) {
+    return compare_registry_snapshot_names(std::u16string_view(snapshot.characters + str.offset, str.length), n) < 0;
+  });
+
+  auto upper = std::upper_bound(lower, end, name, [&snapshot](std::u16string_view n, const registry_snapshot_string& str) {
+    return compare_registry_snapshot_names(n, std::u16string_view(snapshot.characters + str.offset, str.length)) < 0;
+  });
+
+  return { static_cast<uint32_t>(lower - begin), static_cast<uint32_t>(upper - begin) };
+}
+
+// finds an item by name in the subkeys or values of a key, which are sorted by name
+template<typename T>
+const T* find_registry_snapshot_item(const RegistrySnapshotPriv& snapshot, const T* items, size_t count, std::u16string_view name)
+{
+  const std::pair<uint32_t, uint32_t> names = find_registry_snapshot_names(snapshot, name);
+
+  if (names.first == names.second) {
+    return nullptr;
+  }
+
+  const T* it = std::lower_bound(items, items + count, names.first, [](const T& item, uint32_t n) {
+    return item.name < n;
+  });
+
+  return it != items + count && it->name < names.second ? it : nullptr;
+}
+
+inline RegistryBackend::KeyHandle make_registry_snapshot_handle(const registry_snapshot_key* key)
+{
+  return const_cast<registry_snapshot_key*>(key);
+}
+
+inline const registry_snapshot_key* get_registry_snapshot_key(RegistryBackend::KeyHandle handle)
+{
+  return static_cast<const registry_snapshot_key*>(handle);
+}
+
+bool check_registry_snapshot_section(const RegistrySnapshotPriv& snapshot, uint64_t offset, uint64_t count, size_t item_size)
+{
+  const uint64_t size = snapshot.file.size;
+  return offset % registry_snapshot_alignment == 0 && offset <= size && count <= (size - offset) / item_size;
+}
+
+// checks the header and the references between the sections, so that the
+// snapshot can then be read without checks
+bool read_registry_snapshot(RegistrySnapshotPriv& snapshot)
+{
+  if (snapshot.file.size < sizeof(registry_snapshot_header)) {
+    return false;
+  }
+
+  const auto& header = *reinterpret_cast<const registry_snapshot_header*>(snapshot.file.data);
+
+  if (header.magic != registry_snapshot_magic || header.version != registry_snapshot_version || header.size != snapshot.file.size || header.key_count == 0) {
+    return false;
+  }
+
+  if (!check_registry_snapshot_section(snapshot, header.strings_offset, header.string_count, sizeof(registry_snapshot_string))
+    || !check_registry_snapshot_section(snapshot, header.characters_offset, header.character_count, sizeof(char16_t))
+    || !check_registry_snapshot_section(snapshot, header.keys_offset, header.key_count, sizeof(registry_snapshot_key))
+    || !check_registry_snapshot_section(snapshot, header.values_offset, header.value_count, sizeof(registry_snapshot_value))
+    || !check_registry_snapshot_section(snapshot, header.data_offset, 0, 1))
+  {
+    return false;
+  }
+
+  snapshot.header = &header;
+  snapshot.strings = reinterpret_cast<const registry_snapshot_string*>(snapshot.file.data + header.strings_offset);
+  snapshot.characters = reinterpret_cast<const char16_t*>(snapshot.file.data + header.characters_offset);
+  snapshot.keys = reinterpret_cast<const registry_snapshot_key*>(snapshot.file.data + header.keys_offset);
+  snapshot.values = reinterpret_cast<const registry_snapshot_value*>(snapshot.file.data + header.values_offset);
+  snapshot.data = snapshot.file.data + header.data_offset;
+
+  for (uint32_t i(0); i < header.string_count; ++i)
+  {
+    const registry_snapshot_string& str = snapshot.strings[i];
+
+    if (uint64_t(str.offset) + str.length > header.character_count) {
+      return false;
+    }
+  }
+
+  const uint64_t data_size = snapshot.file.size - header.data_offset;
+
+  for (uint32_t i(0); i < header.key_count; ++i)
+  {
+    const registry_snapshot_key& key = snapshot.keys[i];
+    const bool valid_name = i == 0 ? key.name == registry_snapshot_no_name : key.name < header.string_count;
+    // subkeys come after their parent, so the keys cannot form a cycle
+    const bool valid_subkeys = key.subkey_count == 0 || (key.first_subkey > i && uint64_t(key.first_subkey) + key.subkey_count <= header.key_count);
+    const bool valid_values = uint64_t(key.first_value) + key.value_count <= header.value_count;
+    // the buffers of the enumerations are sized from these
+    const bool valid_lengths = key.max_subkey_name_length <= header.character_count && key.max_value_name_length <= header.character_count && key.max_value_size <= data_size;
+
+    if (!valid_name || !valid_subkeys || !valid_values || !valid_lengths) {
+      return false;
+    }
+  }
+
+  for (uint32_t i(0); i < header.value_count; ++i)
+  {
+    const registry_snapshot_value& value = snapshot.values[i];
+
+    if (value.name >= header.string_count || value.data > data_size || value.size > data_size - value.data) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void copy_registry_snapshot_name(std::u16string_view name, char16_t* out)
+{
+  std::copy(name.begin(), name.end(), out);
+  out[name.size()] = u'\0';
+}
+
+// a key being exported
+struct registry_snapshot_source_key
+{
+  std::u16string name;
+  std::vector<size_t> subkeys;
+  // in the values of the export
+  size_t first_value = 0;
+  size_t value_count = 0;
+};
+
+struct registry_snapshot_source_value
+{
+  std::u16string name;
+  Registry::ValueType type = Registry::None;
+  // in the data of the export
+  size_t offset = 0;
+  size_t size = 0;
+};
+
+struct registry_snapshot_export
+{
+  std::vector<registry_snapshot_source_key> keys;
+  std::vector<registry_snapshot_source_value> values;
+  std::vector<unsigned char> data;
+};
+
+// reads the key and its subkeys; only one key is open at a time, the
+// subkeys are opened by their path from the exported key
+void read_registry_snapshot_export(registry_snapshot_export& source, const RegistryKey& root)
+{
+  RegistrySubKeyList subkeys;
+  RegistryValueList values;
+  std::vector<std::pair<size_t, std::string>> pending;
+  pending.emplace_back(0, std::string());
+  source.keys.emplace_back();
+
+  while (!pending.empty())
+  {
+    const size_t index = pending.back().first;
+    const std::string path = std::move(pending.back().second);
+    pending.pop_back();
+
+    RegistryKey opened;
+
+    if (!path.empty())
+    {
+      ErrorCode err = opened.TryOpen(root, path, Registry::Read);
+
+      // the key was deleted since its parent was read
+      if (err.Value() == ERROR_FILE_NOT_FOUND) {
+        continue;
+      } else if (err) {
+        throw Exception(err);
+      }
+    }
+
+    const RegistryKey& key = path.empty() ? root : opened;
+    values.Read(key, RegistryValueList::WithData);
+    source.keys[index].first_value = source.values.size();
+    source.keys[index].value_count = values.size();
+
+    for (size_t i(0); i < values.size(); ++i)
+    {
+      const RegistryValueList::Item item = values[i];
+      const Span<const std::byte> data = item.GetData();
+
+      registry_snapshot_source_value value;
+      value.name = std::u16string(item.GetRawName());
+      value.type = item.GetType();
+      value.offset = source.data.size();
+      value.size = data.size();
+      source.values.push_back(std::move(value));
+
+      const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+      source.data.insert(source.data.end(), bytes, bytes + data.size());
+    }
+
+    subkeys.Read(key);
+
+    for (size_t i(0); i < subkeys.size(); ++i)
+    {
+      const size_t subkey = source.keys.size();
+      source.keys.emplace_back();
+      source.keys.back().name = std::u16string(subkeys.GetRawName(i));
+      source.keys[index].subkeys.push_back(subkey);
+      pending.emplace_back(subkey, path.empty() ? subkeys.GetName(i) : path + "\\" + subkeys.GetName(i));
+    }
+  }
+}
+
+void write_registry_snapshot_export(const registry_snapshot_export& source, std::vector<unsigned char>& out)
+{
+  // the table of names
+  std::vector<std::u16string_view> names;
+  names.reserve(source.keys.size() + source.values.size());
+
+  for (size_t i(1); i < source.keys.size(); ++i) {
+    names.push_back(source.keys[i].name);
+  }
+
+  for (const registry_snapshot_source_value& value : source.values) {
+    names.push_back(value.name);
+  }
+
+  std::sort(names.begin(), names.end(), registry_snapshot_name_less);
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+
+  std::unordered_map<std::u16string_view, uint32_t> name_indices;
+  name_indices.reserve(names.size());
+  size_t character_count = 0;
+
+  for (size_t i(0); i < names.size(); ++i)
+  {
+    name_indices.emplace(names[i], static_cast<uint32_t>(i));
+    character_count += names[i].size();
+  }
+
+  if (character_count > UINT32_MAX || source.keys.size() > UINT32_MAX || source.values.size() > UINT32_MAX) {
+    throw Exception(ErrorCode(ERROR_INVALID_PARAMETER));
+  }
+
+  // the keys in their order in the snapshot, the subkeys of a key are
+  // added after it, sorted by name
+  std::vector<size_t> order;
+  order.reserve(source.keys.size());
+  order.push_back(0);
+  std::vector<std::pair<uint32_t, size_t>> sorted;
+
+  for (size_t i(0); i < order.size(); ++i)
+  {
+    const registry_snapshot_source_key& key = source.keys[order[i]];
+    sorted.clear();
+
+    for (size_t subkey : key.subkeys) {
+      sorted.emplace_back(name_indices.at(source.keys[subkey].name), subkey);
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const auto& subkey : sorted) {
+      order.push_back(subkey.second);
+    }
+  }
+
+  // the sections
+  registry_snapshot_header header = {};
+  header.magic = registry_snapshot_magic;
+  header.version = registry_snapshot_version;
+  header.string_count = static_cast<uint32_t>(names.size());
+  header.character_count = static_cast<uint32_t>(character_count);
+  header.key_count = static_cast<uint32_t>(order.size());
+  header.value_count = static_cast<uint32_t>(source.values.size());
+  header.strings_offset = registry_snapshot_align(sizeof(registry_snapshot_header));
+  header.characters_offset = registry_snapshot_align(header.strings_offset + names.size() * sizeof(registry_snapshot_string));
+  header.keys_offset = registry_snapshot_align(header.characters_offset + character_count * sizeof(char16_t));
+  header.values_offset = header.keys_offset + order.size() * sizeof(registry_snapshot_key);
+  header.data_offset = header.values_offset + source.values.size() * sizeof(registry_snapshot_value);
+
+  size_t data_size = 0;
+
+  for (const registry_snapshot_source_value& value : source.values) {
+    data_size += registry_snapshot_align(value.size);
+  }
+
+  header.size = header.data_offset + data_size;
+  out.assign(static_cast<size_t>(header.size), 0);
+  std::memcpy(out.data(), &header, sizeof(header));
+
+  auto* strings = reinterpret_cast<registry_snapshot_string*>(out.data() + header.strings_offset);
+  auto* characters = reinterpret_cast<char16_t*>(out.data() + header.characters_offset);
+  auto* keys = reinterpret_cast<registry_snapshot_key*>(out.data() + header.keys_offset);
+  auto* values = reinterpret_cast<registry_snapshot_value*>(out.data() + header.values_offset);
+  unsigned char* data = out.data() + header.data_offset;
+
+  uint32_t character_offset = 0;
+
+  for (size_t i(0); i < names.size(); ++i)
+  {
+    strings[i].offset = character_offset;
+    strings[i].length = static_cast<uint32_t>(names[i].size());
+    std::copy(names[i].begin(), names[i].end(), characters + character_offset);
+    character_offset += static_cast<uint32_t>(names[i].size());
+  }
+
+  uint32_t next_subkey = 1;
+  uint32_t next_value = 0;
+  uint64_t data_offset = 0;
+  std::vector<std::pair<uint32_t, size_t>> sorted_values;
+
+  for (size_t i(0); i < order.size(); ++i)
+  {
+    const registry_snapshot_source_key& source_key = source.keys[order[i]];
+    registry_snapshot_key& key = keys[i];
+    key.name = i == 0 ? registry_snapshot_no_name : name_indices.at(source_key.name);
+    key.first_subkey = next_subkey;
+    key.subkey_count = static_cast<uint32_t>(source_key.subkeys.size());
+    key.first_value = next_value;
+    key.value_count = static_cast<uint32_t>(source_key.value_count);
+    next_subkey += key.subkey_count;
+
+    for (size_t subkey : source_key.subkeys) {
+      key.max_subkey_name_length = (std::max)(key.max_subkey_name_length, static_cast<uint32_t>(source.keys[subkey].name.size()));
+    }
+
+    sorted_values.clear();
+
+    for (size_t j(0); j < source_key.value_count; ++j)
+    {
+      const size_t index = source_key.first_value + j;
+      sorted_values.emplace_back(name_indices.at(source.values[index].name), index);
+    }
+
+    std::sort(sorted_values.begin(), sorted_values.end());
+
+    for (const auto& v : sorted_values)
+    {
+      const registry_snapshot_source_value& source_value = source.values[v.second];
+      registry_snapshot_value& value = values[next_value++];
+      value.name = v.first;
+      value.type = static_cast<uint32_t>(source_value.type);
+      value.size = static_cast<uint32_t>(source_value.size);
+      value.data = data_offset;
+
+      if (source_value.size > 0) {
+        std::memcpy(data + data_offset, source.data.data() + source_value.offset, source_value.size);
+      }
+
+      data_offset += registry_snapshot_align(source_value.size);
+      key.max_value_name_length = (std::max)(key.max_value_name_length, static_cast<uint32_t>(source_value.name.size()));
+      key.max_value_size = (std::max)(key.max_value_size, value.size);
+    }
+  }
+}
+
+} // namespace Impl
+
+/**
+ * \brief opens a snapshot file
+ * \param path  the path of the file, in UTF-8
+ * \throw Exception on failure
+ *
+ * The file is mapped in memory and its structure is checked; the error code
+ * of the exception is ERROR_BAD_FORMAT if the file is not a snapshot or was
+ * written by an incompatible version.
+ */
+RegistrySnapshot::RegistrySnapshot(const std::string& path)
+  : d(std::make_unique<Impl::RegistrySnapshotPriv>())
+{
+  ErrorCode err = Impl::map_file(d->file, path);
+
+  if (err) {
+    throw Exception(err);
+  }
+
+  if (!Impl::read_registry_snapshot(*d)) {
+    throw Exception(ErrorCode(ERROR_BAD_FORMAT));
+  }
+}
+
+RegistrySnapshot::~RegistrySnapshot()
+{
+
+}
+
+/**
+ * \brief writes a key, its values and its subkeys to a snapshot file
+ * \param key   the key
+ * \param path  the path of the file, in UTF-8, which is replaced if it exists
+ * \throw Exception on failure
+ *
+ * The key is read entirely before the file is written.
+ */
+void RegistrySnapshot::Export(const RegistryKey& key, const std::string& path)
+{
+  Impl::registry_snapshot_export source;
+  Impl::read_registry_snapshot_export(source, key);
+
+  std::vector<unsigned char> out;
+  Impl::write_registry_snapshot_export(source, out);
+
+  ErrorCode err = Impl::write_file(path, out.data(), out.size());
+
+  if (err) {
+    throw Exception(err);
+  }
+}
+
+/**
+ * \brief returns the root key of the snapshot, i.e. the exported key
+ */
+RegistryKey RegistrySnapshot::GetRootKey()
+{
+  Impl::RegistryKeyPriv rk;
+  rk.backend = this;
+  rk.handle = Impl::make_registry_snapshot_handle(d->keys);
+  return RegistryKey(rk);
+}
+
+/**
+ * \brief copies the values and the subkeys of the snapshot to a key
+ * \param key  the key, which must have been opened with write access
+ * \throw Exception on failure
+ *
+ * Existing values are replaced and other values and subkeys are kept.
+ * The modifications are applied with a single RegistryBatch, so they are
+ * atomic if the backend of the key supports it.
+ */
+void RegistrySnapshot::Import(const RegistryKey& key) const
+{
+  RegistryBatch batch;
+  std::vector<std::string> paths(d->header->key_count);
+
+  for (uint32_t i(0); i < d->header->key_count; ++i)
+  {
+    const Impl::registry_snapshot_key& k = d->keys[i];
+
+    if (i > 0) {
+      batch.CreateKey(paths[i]);
+    }
+
+    for (uint32_t j(0); j < k.value_count; ++j)
+    {
+      const Impl::registry_snapshot_value& value = d->values[k.first_value + j];
+      const std::u16string_view name = Impl::get_registry_snapshot_name(*d, value.name);
+      batch.SetValue(paths[i], Impl::utf16_to_utf8(name.data(), name.size()), static_cast<Registry::ValueType>(value.type), d->data + value.data, value.size);
+    }
+
+    for (uint32_t j(0); j < k.subkey_count; ++j)
+    {
+      const uint32_t subkey = k.first_subkey + j;
+      const std::u16string_view name = Impl::get_registry_snapshot_name(*d, d->keys[subkey].name);
+      paths[subkey] = i == 0 ? std::string() : paths[i] + "\\";
+      paths[subkey] += Impl::utf16_to_utf8(name.data(), name.size());
+    }
+  }
+
+  batch.Commit(key);
+}
+
+/**
+ * \brief returns the root key of the snapshot
+ *
+ * All the predefined keys are the root key.
+ */
+RegistryBackend::KeyHandle RegistrySnapshot::GetPredefinedKey(PredefinedKey key)
+{
+  if (key < ClassesRoot || key > Users) {
+    return nullptr;
+  }
+
+  return Impl::make_registry_snapshot_handle(d->keys);
+}
+
+/**
+ * \brief opens a key
+ */
+ErrorCode RegistrySnapshot::OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights /* accessRights */, KeyHandle& result)
+{
+  result = nullptr;
+
+  if (!parent) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  const Impl::registry_snapshot_key* key = Impl::get_registry_snapshot_key(parent);
+  size_t begin = 0;
+
+  while (begin < subKey.size())
+  {
+    size_t end = subKey.find('\\', begin);
+
+    if (end == std::string::npos) {
+      end = subKey.size();
+    }
+
+    if (end > begin)
+    {
+      const std::u16string name = Impl::utf8_to_utf16(subKey.data() + begin, end - begin);
+      key = Impl::find_registry_snapshot_item(*d, d->keys + key->first_subkey, key->subkey_count, name);
+
+      if (!key) {
+        return ErrorCode(ERROR_FILE_NOT_FOUND);
+      }
+    }
+
+    begin = end + 1;
+  }
+
+  result = Impl::make_registry_snapshot_handle(key);
+  return ErrorCode();
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, snapshots are read-only
+ */
+ErrorCode RegistrySnapshot::CreateKey(KeyHandle /* parent */, const std::string& /* subKey */, Registry::AccessRights /* accessRights */, KeyHandle& result, bool& created)
+{
+  result = nullptr;
+  created = false;
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, snapshots are read-only
+ */
+ErrorCode RegistrySnapshot::DeleteKey(KeyHandle /* parent */, const std::string& /* subKey */)
+{
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief does nothing, the keys of a snapshot do not need to be closed
+ */
+void RegistrySnapshot::CloseKey(KeyHandle /* key */)
+{
+
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, snapshots are read-only
+ */
+ErrorCode RegistrySnapshot::SetValue(KeyHandle /* key */, const std::string& /* name */, Registry::ValueType /* type */, const void* /* data */, size_t /* size */)
+{
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief fails with ERROR_ACCESS_DENIED, snapshots are read-only
+ */
+ErrorCode RegistrySnapshot::DeleteValue(KeyHandle /* key */, const std::string& /* name */)
+{
+  return ErrorCode(ERROR_ACCESS_DENIED);
+}
+
+/**
+ * \brief reads a value
+ */
+ErrorCode RegistrySnapshot::GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (data && !size) {
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+
+  const Impl::registry_snapshot_key* k = Impl::get_registry_snapshot_key(key);
+  const Impl::registry_snapshot_value* value = Impl::find_registry_snapshot_item(*d, d->values + k->first_value, k->value_count, Impl::utf8_to_utf16(name));
+
+  if (!value) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  }
+
+  if (type) {
+    *type = static_cast<Registry::ValueType>(value->type);
+  }
+
+  if (data)
+  {
+    if (*size < value->size)
+    {
+      *size = value->size;
+      return ErrorCode(ERROR_MORE_DATA);
+    }
+
+    if (value->size > 0) {
+      std::memcpy(data, d->data + value->data, value->size);
+    }
+  }
+
+  if (size) {
+    *size = value->size;
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief returns the number of subkeys and values of a key
+ */
+ErrorCode RegistrySnapshot::QueryKeyInfo(KeyHandle key, KeyInfo& info)
+{
+  info = KeyInfo();
+
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  const Impl::registry_snapshot_key* k = Impl::get_registry_snapshot_key(key);
+  info.subKeyCount = k->subkey_count;
+  info.maxSubKeyNameLength = k->max_subkey_name_length;
+  info.valueCount = k->value_count;
+  info.maxValueNameLength = k->max_value_name_length;
+  info.maxValueSize = k->max_value_size;
+  return ErrorCode();
+}
+
+/**
+ * \brief returns the name of a subkey
+ *
+ * \a nameLength is the size of the buffer, including the null terminator,
+ * and receives the length of the name.
+ */
+ErrorCode RegistrySnapshot::EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  const Impl::registry_snapshot_key* k = Impl::get_registry_snapshot_key(key);
+
+  if (index >= k->subkey_count) {
+    return ErrorCode(ERROR_NO_MORE_ITEMS);
+  }
+
+  const std::u16string_view subkey_name = Impl::get_registry_snapshot_name(*d, d->keys[k->first_subkey + index].name);
+
+  if (nameLength <= subkey_name.size()) {
+    return ErrorCode(ERROR_MORE_DATA);
+  }
+
+  Impl::copy_registry_snapshot_name(subkey_name, name);
+  nameLength = subkey_name.size();
+  return ErrorCode();
+}
+
+/**
+ * \brief returns the name, and optionally the data, of a value
+ *
+ * \a nameLength is the size of the buffer, including the null terminator,
+ * and receives the length of the name.
+ * The data is returned as with GetValue().
+ */
+ErrorCode RegistrySnapshot::EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size)
+{
+  if (!key) {
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  }
+
+  if (data && !size) {
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+
+  const Impl::registry_snapshot_key* k = Impl::get_registry_snapshot_key(key);
+
+  if (index >= k->value_count) {
+    return ErrorCode(ERROR_NO_MORE_ITEMS);
+  }
+
+  const Impl::registry_snapshot_value& value = d->values[k->first_value + index];
+  const std::u16string_view value_name = Impl::get_registry_snapshot_name(*d, value.name);
+
+  if (type) {
+    *type = static_cast<Registry::ValueType>(value.type);
+  }
+
+  const bool name_fits = nameLength > value_name.size();
+  const bool data_fits = !data || *size >= value.size;
+
+  if (size) {
+    *size = value.size;
+  }
+
+  if (!name_fits || !data_fits) {
+    return ErrorCode(ERROR_MORE_DATA);
+  }
+
+  Impl::copy_registry_snapshot_name(value_name, name);
+  nameLength = value_name.size();
+
+  if (data && value.size > 0) {
+    std::memcpy(data, d->data + value.data, value.size);
+  }
+
+  return ErrorCode();
+}
+
+/**
+ * \brief accepts the watch, the callback is never called since snapshots are read-only
+ */
+ErrorCode RegistrySnapshot::WatchKey(KeyHandle key, std::function<void()> /* callback */, WatchHandle& result)
+{
+  result = key;
+  return ErrorCode(key ? ERROR_SUCCESS : ERROR_INVALID_HANDLE);
+}
+
+/**
+ * \brief does nothing
+ */
+void RegistrySnapshot::UnwatchKey(WatchHandle /* watch */)
+{
+
+}
+
+} // namespace Win32
\ No newline at end of file
@@ -0,0 +1,86 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYSNAPSHOT_H
+#define WINAPI_REGISTRYSNAPSHOT_H
+
+#include "RegistryBackend.h"
+
+#include <memory>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct RegistrySnapshotPriv;
+} // namespace Impl
+
+/**
+ * \brief a copy of a registry key and its subkeys, stored in a file
+ *
+ * Export() writes the values and the subkeys of a key to a snapshot file.
+ * Opening a snapshot maps the file in memory: the snapshot is a read-only
+ * registry backend whose root key is the exported key, so it can serve reads
+ * without a live registry, and Import() copies it into a key of any backend.
+ *
+ * \code
+ * RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Software\\MyApp", Registry::Read);
+ * RegistrySnapshot::Export(key, "myapp.snapshot");
+ *
+ * RegistrySnapshot snapshot{ "myapp.snapshot" };
+ * std::string path = snapshot.GetRootKey().GetStringValue("Path");
+ * snapshot.Import(Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Software\\MyApp", Registry::Write));
+ * \endcode
+ *
+ * The names are kept in a sorted table, so that keys and values are found
+ * with binary searches; as in the MemoryRegistry, only ASCII letters are
+ * compared without regard to case.
+ * Subkeys and values are enumerated in the order of their names.
+ *
+ * All the predefined keys are the root key of the snapshot.
+ * The keys do not need to be closed and the functions that modify the
+ * registry fail with ERROR_ACCESS_DENIED.
+ *
+ * The snapshot must outlive the keys opened with it.
+ */
+class RegistrySnapshot : public RegistryBackend
+{
+public:
+  explicit RegistrySnapshot(const std::string& path);
+  RegistrySnapshot(const RegistrySnapshot&) = delete;
+  ~RegistrySnapshot();
+
+  static void Export(const RegistryKey& key, const std::string& path);
+
+  RegistryKey GetRootKey();
+  void Import(const RegistryKey& key) const;
+
+  KeyHandle GetPredefinedKey(PredefinedKey key) override;
+
+  ErrorCode OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result) override;
+  ErrorCode CreateKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result, bool& created) override;
+  ErrorCode DeleteKey(KeyHandle parent, const std::string& subKey) override;
+  void CloseKey(KeyHandle key) override;
+
+  ErrorCode SetValue(KeyHandle key, const std::string& name, Registry::ValueType type, const void* data, size_t size) override;
+  ErrorCode DeleteValue(KeyHandle key, const std::string& name) override;
+  ErrorCode GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size) override;
+
+  ErrorCode QueryKeyInfo(KeyHandle key, KeyInfo& info) override;
+  ErrorCode EnumKey(KeyHandle key, size_t index, char16_t* name, size_t& nameLength) override;
+  ErrorCode EnumValue(KeyHandle key, size_t index, char16_t* name, size_t& nameLength, Registry::ValueType* type, void* data, size_t* size) override;
+
+  ErrorCode WatchKey(KeyHandle key, std::function<void()> callback, WatchHandle& result) override;
+  void UnwatchKey(WatchHandle watch) override;
+
+  RegistrySnapshot& operator=(const RegistrySnapshot&) = delete;
+
+private:
+  std::unique_ptr<Impl::RegistrySnapshotPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYSNAPSHOT_H
\ No newline at end of file
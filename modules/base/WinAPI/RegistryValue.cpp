@@ -0,0 +1,208 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistryValue.h"
+#include "registry_priv.h"
+
+#include "Exception.h"
+#include "utf16_priv.h"
+
+#include <cstring>
+
+namespace Win32
+{
+
+/**
+ * \brief constructs an iterator on the first string of a REG_MULTI_SZ value
+ * \param begin  the beginning of the data of the value
+ * \param end    the end of the data of the value
+ */
+RegistryMultiStringIterator::RegistryMultiStringIterator(const std::byte* begin, const std::byte* end)
+  : m_pos(begin),
+    m_end(end)
+{
+  read();
+}
+
+/**
+ * \brief returns the current string
+ */
+const std::string& RegistryMultiStringIterator::operator*() const
+{
+  return m_current;
+}
+
+const std::string* RegistryMultiStringIterator::operator->() const
+{
+  return &m_current;
+}
+
+/**
+ * \brief moves to the next string
+ * 
+ * The string returned by the previous call to operator*() is overwritten.
+ */
+RegistryMultiStringIterator& RegistryMultiStringIterator::operator++()
+{
+  m_pos = m_next;
+  read();
+  return *this;
+}
+
+bool RegistryMultiStringIterator::operator==(const RegistryMultiStringIterator& other) const
+{
+  return m_pos == other.m_pos;
+}
+
+bool RegistryMultiStringIterator::operator!=(const RegistryMultiStringIterator& other) const
+{
+  return !(*this == other);
+}
+
+// decodes the string at m_pos, the list ends with an empty string
+// or at the end of the data
+void RegistryMultiStringIterator::read()
+{
+  const std::byte* it = m_pos;
+
+  while (m_end - it >= 2 && (it[0] != std::byte{ 0 } || it[1] != std::byte{ 0 })) {
+    it += 2;
+  }
+
+  if (it == m_pos)
+  {
+    m_pos = m_next = m_end = nullptr;
+    m_current.clear();
+    return;
+  }
+
+  m_current.clear();
+  Impl::append_utf16le_as_utf8(m_current, m_pos, static_cast<size_t>(it - m_pos));
+  m_next = (m_end - it >= 2) ? it + 2 : it;
+}
+
+RegistryMultiStringRange::RegistryMultiStringRange(Span<const std::byte> data)
+  : m_data(data)
+{
+
+}
+
+RegistryMultiStringIterator RegistryMultiStringRange::begin() const
+{
+  return RegistryMultiStringIterator(m_data.begin(), m_data.end());
+}
+
+RegistryMultiStringIterator RegistryMultiStringRange::end() const
+{
+  return RegistryMultiStringIterator();
+}
+
+/**
+ * \brief constructs an empty value of type Registry::None
+ */
+RegistryValue::RegistryValue()
+{
+
+}
+
+/**
+ * \brief returns the type of the value
+ */
+Registry::ValueType RegistryValue::GetType() const
+{
+  return m_type;
+}
+
+/**
+ * \brief returns the raw data of the value
+ * 
+ * The data remains valid until the object is modified.
+ * Strings are stored in UTF-16.
+ */
+Span<const std::byte> RegistryValue::GetData() const
+{
+  return Span<const std::byte>(reinterpret_cast<const std::byte*>(m_data.data()), m_data.size());
+}
+
+/**
+ * \brief returns a REG_DWORD value
+ * \throw Exception if the value is not a REG_DWORD
+ */
+uint32_t RegistryValue::ToDWord() const
+{
+  uint32_t result = 0;
+
+  if (m_type != Registry::DWord || m_data.size() != sizeof(result)) {
+    throw Exception(ErrorCode(ERROR_UNSUPPORTED_TYPE));
+  }
+
+  std::memcpy(&result, m_data.data(), sizeof(result));
+  return result;
+}
+
+/**
+ * \brief returns a REG_QWORD value
+ * \throw Exception if the value is not a REG_QWORD
+ */
+uint64_t RegistryValue::ToQWord() const
+{
+  uint64_t result = 0;
+
+  if (m_type != Registry::QWord || m_data.size() != sizeof(result)) {
+    throw Exception(ErrorCode(ERROR_UNSUPPORTED_TYPE));
+  }
+
+  std::memcpy(&result, m_data.data(), sizeof(result));
+  return result;
+}
+
+/**
+ * \brief returns a REG_SZ or REG_EXPAND_SZ value
+ * \throw Exception if the value is not a string
+ * 
+ * The environment variables in a REG_EXPAND_SZ are not expanded.
+ */
+std::string RegistryValue::ToString() const
+{
+  if (m_type != Registry::String && m_type != Registry::ExpandString) {
+    throw Exception(ErrorCode(ERROR_UNSUPPORTED_TYPE));
+  }
+
+  std::string result;
+  Impl::decode_registry_string(m_data.data(), m_data.size(), result);
+  return result;
+}
+
+/**
+ * \brief returns the strings of a REG_MULTI_SZ value
+ * \throw Exception if the value is not a REG_MULTI_SZ
+ * 
+ * The strings are converted to UTF-8 while iterating; the range remains 
+ * valid until the object is modified.
+ */
+RegistryMultiStringRange RegistryValue::GetStrings() const
+{
+  if (m_type != Registry::MultiString) {
+    throw Exception(ErrorCode(ERROR_UNSUPPORTED_TYPE));
+  }
+
+  return RegistryMultiStringRange(GetData());
+}
+
+/**
+ * \brief returns the strings of a REG_MULTI_SZ value
+ * \throw Exception if the value is not a REG_MULTI_SZ
+ */
+std::vector<std::string> RegistryValue::ToStringList() const
+{
+  std::vector<std::string> result;
+
+  for (const std::string& str : GetStrings()) {
+    result.push_back(str);
+  }
+
+  return result;
+}
+
+} // namespace Win32
\ No newline at end of file
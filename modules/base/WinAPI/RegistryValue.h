@@ -0,0 +1,109 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYVALUE_H
+#define WINAPI_REGISTRYVALUE_H
+
+#include "Registry.h"
+#include "Span.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace Win32
+{
+
+/**
+ * \brief iterates over the strings of a REG_MULTI_SZ value
+ * 
+ * The strings are converted to UTF-8 one at a time, when the iterator 
+ * reaches them, into a string owned by the iterator.
+ */
+class RegistryMultiStringIterator
+{
+public:
+  typedef std::input_iterator_tag iterator_category;
+  typedef std::string value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const std::string* pointer;
+  typedef const std::string& reference;
+
+public:
+  RegistryMultiStringIterator() = default;
+  RegistryMultiStringIterator(const std::byte* begin, const std::byte* end);
+
+  const std::string& operator*() const;
+  const std::string* operator->() const;
+
+  RegistryMultiStringIterator& operator++();
+
+  bool operator==(const RegistryMultiStringIterator& other) const;
+  bool operator!=(const RegistryMultiStringIterator& other) const;
+
+private:
+  void read();
+
+private:
+  const std::byte* m_pos = nullptr;
+  const std::byte* m_next = nullptr;
+  const std::byte* m_end = nullptr;
+  std::string m_current;
+};
+
+/**
+ * \brief the strings of a REG_MULTI_SZ value, for use in a range-based for loop
+ */
+class RegistryMultiStringRange
+{
+public:
+  RegistryMultiStringRange() = default;
+  explicit RegistryMultiStringRange(Span<const std::byte> data);
+
+  RegistryMultiStringIterator begin() const;
+  RegistryMultiStringIterator end() const;
+
+private:
+  Span<const std::byte> m_data;
+};
+
+/**
+ * \brief holds the type and the raw data of a registry value
+ * 
+ * A RegistryValue is a reusable buffer: reading several values into the 
+ * same object with RegistryKey::GetValue() only allocates memory when
+ * a value is larger than the previous ones.
+ * 
+ * The data can be accessed without copy with GetData() and GetStrings(), 
+ * or converted with the other functions, which throw an Exception with 
+ * the ERROR_UNSUPPORTED_TYPE error code if the value does not have the
+ * expected type.
+ */
+class RegistryValue
+{
+public:
+  RegistryValue();
+
+  Registry::ValueType GetType() const;
+  Span<const std::byte> GetData() const;
+
+  uint32_t ToDWord() const;
+  uint64_t ToQWord() const;
+  std::string ToString() const;
+  RegistryMultiStringRange GetStrings() const;
+  std::vector<std::string> ToStringList() const;
+
+private:
+  friend class RegistryKey;
+
+private:
+  Registry::ValueType m_type = Registry::None;
+  std::vector<unsigned char> m_data;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYVALUE_H
\ No newline at end of file
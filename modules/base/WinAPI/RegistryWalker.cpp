@@ -0,0 +1,497 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "RegistryWalker.h"
+
+#include "Exception.h"
+#include "utf16_priv.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// a key whose subkeys are being visited; it is kept open so that the
+// subkeys are opened relative to it, and is closed with its last subkey
+struct registry_walker_parent
+{
+  RegistryKey key;
+  std::string path;
+  size_t depth = 0;
+  RegistrySubKeyList subkeys;
+};
+
+// subkeys [begin, end) of a key, that remain to be visited
+struct registry_walker_range
+{
+  std::shared_ptr<const registry_walker_parent> parent;
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+// a key to visit; the root of the walk has no parent
+struct registry_walker_item
+{
+  std::shared_ptr<const registry_walker_parent> parent;
+  size_t index = 0;
+};
+
+// the state of a thread of the walk, whose buffers are reused from one key to the next
+struct registry_walker_thread
+{
+  size_t index = 0;
+  RegistryKey key;
+  std::string path;
+  size_t depth = 0;
+  std::string name;
+  RegistrySubKeyList subkeys;
+  RegistryValueList values;
+  std::string value_name;
+
+  // the subkeys queued by this thread, which other threads steal from the front;
+  // a visited key adds at most one range, so the length of the queue is
+  // bounded by the depth of the walk
+  std::mutex mutex;
+  std::deque<registry_walker_range> queue;
+};
+
+struct RegistryWalkerPriv
+{
+  size_t thread_count = 0;
+  RegistryWalker::KeyVisitor key_visitor;
+  RegistryWalker::ValueVisitor value_visitor;
+  RegistryValueList::DataMode data_mode = RegistryValueList::WithData;
+};
+
+struct registry_walk
+{
+  const RegistryWalkerPriv& walker;
+  const RegistryKey& root;
+  std::vector<std::unique_ptr<registry_walker_thread>> threads;
+  // the number of keys that are queued or being visited
+  std::atomic<size_t> pending{ 0 };
+  std::atomic<bool> stopped{ false };
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  registry_walk(const RegistryWalkerPriv& w, const RegistryKey& r)
+    : walker(w),
+      root(r)
+  {
+
+  }
+};
+
+// takes the first subkey of the last range, so that the keys are visited depth-first and in order
+bool pop_registry_walker_range(registry_walker_thread& thread, registry_walker_item& item)
+{
+  std::lock_guard<std::mutex> lock{ thread.mutex };
+
+  if (thread.queue.empty()) {
+    return false;
+  }
+
+  registry_walker_range& range = thread.queue.back();
+  item.index = range.begin++;
+
+  if (range.begin == range.end)
+  {
+    item.parent = std::move(range.parent);
+    thread.queue.pop_back();
+  }
+  else
+  {
+    item.parent = range.parent;
+  }
+
+  return true;
+}
+
+bool pop_registry_walker_item(registry_walk& walk, registry_walker_thread& thread, registry_walker_item& item)
+{
+  if (pop_registry_walker_range(thread, item)) {
+    return true;
+  }
+
+  // steals the second half of the oldest range of another thread, whose keys
+  // are likely to have many subkeys
+  for (size_t i(1); i < walk.threads.size(); ++i)
+  {
+    registry_walker_thread& other = *walk.threads[(thread.index + i) % walk.threads.size()];
+    registry_walker_range stolen;
+
+    {
+      std::lock_guard<std::mutex> lock{ other.mutex };
+
+      if (other.queue.empty()) {
+        continue;
+      }
+
+      registry_walker_range& range = other.queue.front();
+      const size_t middle = range.begin + (range.end - range.begin) / 2;
+
+      if (middle == range.begin)
+      {
+        stolen = std::move(range);
+        other.queue.pop_front();
+      }
+      else
+      {
+        stolen = registry_walker_range{ range.parent, middle, range.end };
+        range.end = middle;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{ thread.mutex };
+      thread.queue.push_back(std::move(stolen));
+    }
+
+    if (pop_registry_walker_range(thread, item)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void stop_registry_walk(registry_walk& walk)
+{
+  walk.stopped.store(true, std::memory_order_relaxed);
+}
+
+// opens the key of an item in the key buffer of the thread
+bool open_registry_walker_item(registry_walk& walk, registry_walker_thread& thread, const registry_walker_item& item)
+{
+  if (!item.parent)
+  {
+    thread.path.clear();
+    thread.depth = 0;
+    return !thread.key.TryOpen(walk.root, std::string(), Registry::Read);
+  }
+
+  const registry_walker_parent& parent = *item.parent;
+  std::u16string_view name = parent.subkeys.GetRawName(item.index);
+  thread.name.clear();
+  append_utf16_as_utf8(thread.name, name.size(), [&name](size_t j) { return name[j]; });
+
+  if (thread.key.TryOpen(parent.key, thread.name, Registry::Read)) {
+    return false;
+  }
+
+  thread.path.assign(parent.path);
+
+  if (!thread.path.empty()) {
+    thread.path.push_back('\\');
+  }
+
+  thread.path.append(thread.name);
+  thread.depth = parent.depth + 1;
+  return true;
+}
+
+void visit_registry_walker_item(registry_walk& walk, registry_walker_thread& thread, const registry_walker_item& item)
+{
+  if (!open_registry_walker_item(walk, thread, item)) {
+    return;
+  }
+
+  const RegistryWalker::Key key{ &thread };
+  RegistryWalker::Action action = RegistryWalker::Continue;
+
+  if (walk.walker.key_visitor) {
+    action = walk.walker.key_visitor(key);
+  }
+
+  if (action == RegistryWalker::Continue && walk.walker.value_visitor)
+  {
+    try
+    {
+      thread.values.Read(thread.key, walk.walker.data_mode);
+    }
+    catch (const Exception&)
+    {
+      return;
+    }
+
+    for (size_t i(0); i < thread.values.size() && action == RegistryWalker::Continue; ++i) {
+      action = walk.walker.value_visitor(key, RegistryWalker::Value{ &thread, i });
+    }
+  }
+
+  if (action == RegistryWalker::Stop) {
+    stop_registry_walk(walk);
+  }
+
+  if (action != RegistryWalker::Continue) {
+    return;
+  }
+
+  try
+  {
+    thread.subkeys.Read(thread.key);
+  }
+  catch (const Exception&)
+  {
+    return;
+  }
+
+  const size_t count = thread.subkeys.size();
+
+  if (count == 0) {
+    return;
+  }
+
+  // the key and the names of its subkeys are handed over to the threads
+  // that visit the subkeys
+  auto parent = std::make_shared<registry_walker_parent>();
+  parent->key = std::move(thread.key);
+  parent->path = thread.path;
+  parent->depth = thread.depth;
+  parent->subkeys = std::move(thread.subkeys);
+
+  walk.pending.fetch_add(count, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock{ thread.mutex };
+  thread.queue.push_back(registry_walker_range{ std::move(parent), 0, count });
+}
+
+void run_registry_walker_thread(registry_walk& walk, registry_walker_thread& thread)
+{
+  registry_walker_item item;
+
+  while (!walk.stopped.load(std::memory_order_relaxed))
+  {
+    if (!pop_registry_walker_item(walk, thread, item))
+    {
+      if (walk.pending.load(std::memory_order_acquire) == 0) {
+        break;
+      }
+
+      // another thread is enumerating subkeys
+      std::this_thread::yield();
+      continue;
+    }
+
+    try
+    {
+      visit_registry_walker_item(walk, thread, item);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock{ walk.error_mutex };
+
+      if (!walk.error) {
+        walk.error = std::current_exception();
+      }
+
+      stop_registry_walk(walk);
+    }
+
+    // the parent is closed as soon as its last subkey has been visited
+    item.parent.reset();
+    walk.pending.fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  thread.key.Close();
+}
+
+} // namespace Impl
+
+RegistryWalker::Key::Key(const Impl::registry_walker_thread* thread)
+  : m_thread(thread)
+{
+
+}
+
+/**
+ * \brief returns the key, opened with Registry::Read access
+ */
+const RegistryKey& RegistryWalker::Key::GetKey() const
+{
+  return m_thread->key;
+}
+
+/**
+ * \brief returns the path of the key relative to the root of the walk, which is empty for the root
+ */
+const std::string& RegistryWalker::Key::GetPath() const
+{
+  return m_thread->path;
+}
+
+/**
+ * \brief returns the depth of the key, 0 for the root of the walk
+ */
+size_t RegistryWalker::Key::GetDepth() const
+{
+  return m_thread->depth;
+}
+
+/**
+ * \brief returns the index of the thread visiting the key, between 0 and the number of threads
+ */
+size_t RegistryWalker::Key::GetThreadIndex() const
+{
+  return m_thread->index;
+}
+
+RegistryWalker::Value::Value(Impl::registry_walker_thread* thread, size_t index)
+  : m_thread(thread),
+    m_index(index)
+{
+
+}
+
+/**
+ * \brief returns the name of the value, converted to UTF-8 in a buffer of the thread
+ */
+const std::string& RegistryWalker::Value::GetName() const
+{
+  std::u16string_view name = GetRawName();
+  m_thread->value_name.clear();
+  Impl::append_utf16_as_utf8(m_thread->value_name, name.size(), [&name](size_t i) { return name[i]; });
+  return m_thread->value_name;
+}
+
+/**
+ * \brief returns the name of the value, in UTF-16
+ */
+std::u16string_view RegistryWalker::Value::GetRawName() const
+{
+  return m_thread->values[m_index].GetRawName();
+}
+
+/**
+ * \brief returns the type of the value
+ */
+Registry::ValueType RegistryWalker::Value::GetType() const
+{
+  return m_thread->values[m_index].GetType();
+}
+
+/**
+ * \brief returns the data of the value, empty unless the value visitor was set with RegistryValueList::WithData
+ */
+Span<const std::byte> RegistryWalker::Value::GetData() const
+{
+  return m_thread->values[m_index].GetData();
+}
+
+RegistryWalker::RegistryWalker()
+  : d(std::make_unique<Impl::RegistryWalkerPriv>())
+{
+
+}
+
+RegistryWalker::~RegistryWalker()
+{
+
+}
+
+/**
+ * \brief sets the number of threads of the walk
+ * \param count  the number of threads, 0 for the number of processors
+ * 
+ * The thread calling Walk() is one of them.
+ */
+void RegistryWalker::SetThreadCount(size_t count)
+{
+  d->thread_count = count;
+}
+
+/**
+ * \brief sets the function called for each key, including the root
+ * 
+ * The function returns SkipSubKeys to skip the values and subkeys of the key.
+ */
+void RegistryWalker::SetKeyVisitor(KeyVisitor visitor)
+{
+  d->key_visitor = std::move(visitor);
+}
+
+/**
+ * \brief sets the function called for each value
+ * \param visitor  the function
+ * \param mode     whether the data of the values is read
+ * 
+ * The values of a key are read at once and visited by the thread that
+ * visited the key, after the key visitor.
+ * The function returns SkipSubKeys to skip the remaining values and the
+ * subkeys of the key.
+ */
+void RegistryWalker::SetValueVisitor(ValueVisitor visitor, RegistryValueList::DataMode mode)
+{
+  d->value_visitor = std::move(visitor);
+  d->data_mode = mode;
+}
+
+/**
+ * \brief visits a key and its subkeys recursively
+ * \param key     parent key
+ * \param subKey  name of the subkey at the root of the walk
+ * \throw Exception if the root cannot be opened
+ * 
+ * Returns false if the walk was stopped by a visitor.
+ * If a visitor throws an exception, the walk is stopped and the exception 
+ * is rethrown by this function.
+ */
+bool RegistryWalker::Walk(const RegistryKey& key, const std::string& subKey) const
+{
+  RegistryKey root = Registry::OpenKey(key, subKey, Registry::Read);
+
+  size_t thread_count = d->thread_count;
+
+  if (thread_count == 0) {
+    thread_count = (std::max)(std::thread::hardware_concurrency(), 1u);
+  }
+
+  Impl::registry_walk walk{ *d, root };
+
+  for (size_t i(0); i < thread_count; ++i)
+  {
+    walk.threads.push_back(std::make_unique<Impl::registry_walker_thread>());
+    walk.threads.back()->index = i;
+  }
+
+  // the root is a range without parent
+  walk.pending.store(1, std::memory_order_relaxed);
+  walk.threads.front()->queue.push_back(Impl::registry_walker_range{ nullptr, 0, 1 });
+
+  std::vector<std::thread> workers;
+
+  try
+  {
+    for (size_t i(1); i < thread_count; ++i) {
+      workers.emplace_back(Impl::run_registry_walker_thread, std::ref(walk), std::ref(*walk.threads[i]));
+    }
+  }
+  catch (const std::system_error&)
+  {
+    // the walk continues with the threads that could be created
+  }
+
+  Impl::run_registry_walker_thread(walk, *walk.threads.front());
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  if (walk.error) {
+    std::rethrow_exception(walk.error);
+  }
+
+  return !walk.stopped.load(std::memory_order_relaxed);
+}
+
+} // namespace Win32
\ No newline at end of file
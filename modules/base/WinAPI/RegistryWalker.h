@@ -0,0 +1,126 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_REGISTRYWALKER_H
+#define WINAPI_REGISTRYWALKER_H
+
+#include "Registry.h"
+#include "RegistryEnumeration.h"
+#include "Span.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct RegistryWalkerPriv;
+struct registry_walker_thread;
+} // namespace Impl
+
+/**
+ * \brief visits the subkeys and values of a registry key recursively, with several threads
+ * 
+ * The keys are visited by a pool of threads: each thread enumerates the subkeys
+ * of the keys it visits and queues them as a single range, and idle threads
+ * steal half of the oldest range of another thread.
+ * As each thread visits the range it queued last first, the keys are visited 
+ * depth-first and the queues never hold more ranges than the depth of the walk.
+ * A key stays open while its subkeys are visited, so that they are opened
+ * relative to it rather than from the root of the walk.
+ * 
+ * The visitors are called concurrently from several threads, in no particular
+ * order; GetThreadIndex() can be used to accumulate results per thread.
+ * The objects passed to the visitors (the key, its path, the names and data 
+ * of the values) are buffers owned by the thread, which are only valid 
+ * during the call and are reused for the next keys, so that visiting
+ * a key does not allocate memory in most cases.
+ * 
+ * Keys that cannot be opened or enumerated (e.g., because of their access rights)
+ * are skipped.
+ * 
+ * \code
+ * RegistryWalker walker;
+ * walker.SetValueVisitor([](const RegistryWalker::Key& key, const RegistryWalker::Value& value) {
+ *   return value.GetName() == "DisplayName" ? RegistryWalker::Stop : RegistryWalker::Continue;
+ * });
+ * walker.Walk(Registry::HKEY_LOCAL_MACHINE, "SOFTWARE");
+ * \endcode
+ */
+class RegistryWalker
+{
+public:
+  enum Action
+  {
+    // visits the values and subkeys of the key
+    Continue,
+    // does not visit the (remaining) values and the subkeys of the key
+    SkipSubKeys,
+    // stops the walk as soon as possible
+    Stop,
+  };
+
+  /**
+   * \brief the key being visited
+   */
+  class Key
+  {
+  public:
+    explicit Key(const Impl::registry_walker_thread* thread);
+
+    const RegistryKey& GetKey() const;
+    const std::string& GetPath() const;
+    size_t GetDepth() const;
+    size_t GetThreadIndex() const;
+
+  private:
+    const Impl::registry_walker_thread* m_thread;
+  };
+
+  /**
+   * \brief a value of the key being visited
+   */
+  class Value
+  {
+  public:
+    Value(Impl::registry_walker_thread* thread, size_t index);
+
+    const std::string& GetName() const;
+    std::u16string_view GetRawName() const;
+    Registry::ValueType GetType() const;
+    Span<const std::byte> GetData() const;
+
+  private:
+    Impl::registry_walker_thread* m_thread;
+    size_t m_index;
+  };
+
+  typedef std::function<Action(const Key&)> KeyVisitor;
+  typedef std::function<Action(const Key&, const Value&)> ValueVisitor;
+
+public:
+  RegistryWalker();
+  RegistryWalker(const RegistryWalker&) = delete;
+  ~RegistryWalker();
+
+  void SetThreadCount(size_t count);
+  void SetKeyVisitor(KeyVisitor visitor);
+  void SetValueVisitor(ValueVisitor visitor, RegistryValueList::DataMode mode = RegistryValueList::WithData);
+
+  bool Walk(const RegistryKey& key, const std::string& subKey = std::string()) const;
+
+  RegistryWalker& operator=(const RegistryWalker&) = delete;
+
+private:
+  std::unique_ptr<Impl::RegistryWalkerPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_REGISTRYWALKER_H
\ No newline at end of file
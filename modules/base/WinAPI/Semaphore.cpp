@@ -0,0 +1,528 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "Semaphore.h"
+
+#include "sharedmemory_priv.h"
+
+#ifndef _WIN32
+#include "EventImpl.h"
+#include "futex_priv.h"
+#endif
+
+#include <algorithm>
+#include <climits>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+constexpr uint32_t semaphore_magic = 0x414D4553; // "SEMA"
+
+struct semaphore_header
+{
+  std::atomic<uint32_t> magic;
+  int32_t maximum;
+  // on Linux, this is also the futex on which the waiting threads block
+  std::atomic<int32_t> count;
+  // number of threads blocked (or about to block) on the system semaphore,
+  // or on the futex
+  std::atomic<uint32_t> waiters;
+};
+
+struct SemaphorePriv
+{
+  std::string name;
+  SharedMemory shm;
+  semaphore_header* header = nullptr;
+#ifdef _WIN32
+  // system semaphore, released when the count is increased while there are waiters
+  HANDLE semaphore = nullptr;
+#endif
+  bool created = false;
+  int spin_count = 0;
+
+  ~SemaphorePriv();
+};
+
+SemaphorePriv::~SemaphorePriv()
+{
+#ifdef _WIN32
+  if (semaphore) {
+    ::CloseHandle(semaphore);
+  }
+#endif
+}
+
+void initialize_semaphore(SemaphorePriv& s, int initial_count, int maximum_count)
+{
+  s.header = static_cast<semaphore_header*>(s.shm.view);
+  s.created = s.shm.created;
+
+  if (s.created)
+  {
+    s.header->maximum = maximum_count;
+    s.header->count.store(initial_count, std::memory_order_relaxed);
+    s.header->magic.store(semaphore_magic, std::memory_order_release);
+  }
+  else
+  {
+    wait_shared_memory_initialized(s.header->magic, semaphore_magic);
+  }
+}
+
+bool try_acquire_semaphore(semaphore_header& h)
+{
+  int32_t count = h.count.load(std::memory_order_relaxed);
+
+  while (count > 0)
+  {
+    if (h.count.compare_exchange_weak(count, count - 1, std::memory_order_seq_cst)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+#ifdef _WIN32
+
+std::wstring semaphore_kernel_name(const std::string& name)
+{
+  return ToUtf16(name + "Semaphore");
+}
+
+// creates or opens the file mapping and the system semaphore of a semaphore
+void create_semaphore(SemaphorePriv& s, const std::string& name, int initial_count, int maximum_count, bool must_create)
+{
+  if (maximum_count <= 0 || initial_count < 0 || initial_count > maximum_count) {
+    throw Exception(ErrorCode(ERROR_INVALID_PARAMETER));
+  }
+
+  s.name = name;
+
+  // the system semaphore is created first, so that it exists when the
+  // semaphore is initialized
+  constexpr LONG kernel_initial_count = 0;
+  constexpr LONG kernel_maximum_count = LONG_MAX;
+  s.semaphore = ::CreateSemaphoreW(nullptr, kernel_initial_count, kernel_maximum_count, semaphore_kernel_name(name).c_str());
+
+  if (!s.semaphore) {
+    throw Exception(GetLastError());
+  }
+
+  create_shared_memory(s.shm, name, sizeof(semaphore_header), must_create);
+  initialize_semaphore(s, initial_count, maximum_count);
+}
+
+void open_semaphore(SemaphorePriv& s, const std::string& name)
+{
+  s.name = name;
+
+  open_shared_memory(s.shm, name);
+  s.header = static_cast<semaphore_header*>(s.shm.view);
+  wait_shared_memory_initialized(s.header->magic, semaphore_magic);
+
+  constexpr DWORD desired_access = SEMAPHORE_MODIFY_STATE | SYNCHRONIZE;
+  constexpr bool inherit_handle = false;
+  s.semaphore = ::OpenSemaphoreW(desired_access, inherit_handle, semaphore_kernel_name(name).c_str());
+
+  if (!s.semaphore) {
+    throw Exception(GetLastError());
+  }
+}
+
+// Each thread that waits on the system semaphore is counted in 'waiters',
+// and Release() removes from this count the threads it releases a permit
+// for. A thread that stops waiting without consuming a permit must
+// therefore remove itself from the count, or consume the permit released
+// for it, so that permits do not accumulate.
+void cancel_semaphore_wait(SemaphorePriv& s)
+{
+  semaphore_header& h = *s.header;
+  uint32_t waiters = h.waiters.load(std::memory_order_seq_cst);
+
+  while (waiters > 0)
+  {
+    if (h.waiters.compare_exchange_weak(waiters, waiters - 1, std::memory_order_seq_cst)) {
+      return;
+    }
+  }
+
+  // Release() has already counted this thread, the permit is released
+  // right after the count is decreased
+  ::WaitForSingleObject(s.semaphore, INFINITE);
+}
+
+bool acquire_semaphore(SemaphorePriv& s, std::chrono::milliseconds timeout, bool infinite)
+{
+  semaphore_header& h = *s.header;
+
+  for (int i(0); i <= s.spin_count; ++i)
+  {
+    if (try_acquire_semaphore(h)) {
+      return true;
+    }
+
+    YieldProcessor();
+  }
+
+  if (!infinite && timeout.count() <= 0) {
+    return false;
+  }
+
+  // INFINITE must not be reached by a finite timeout
+  const DWORD ms = infinite ? INFINITE : static_cast<DWORD>((std::min)(timeout.count(), static_cast<std::chrono::milliseconds::rep>(INFINITE - 1)));
+  const ULONGLONG deadline = ::GetTickCount64() + ms;
+
+  for (;;)
+  {
+    // Release() increases the count before reading the number of waiters,
+    // so either it sees us or we see the new count.
+    h.waiters.fetch_add(1, std::memory_order_seq_cst);
+
+    if (try_acquire_semaphore(h)) {
+      cancel_semaphore_wait(s);
+      return true;
+    }
+
+    DWORD remaining = ms;
+
+    if (!infinite)
+    {
+      const ULONGLONG now = ::GetTickCount64();
+      remaining = now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+    }
+
+    const DWORD wait_result = ::WaitForSingleObject(s.semaphore, remaining);
+
+    if (wait_result == WAIT_OBJECT_0)
+    {
+      // a permit was consumed, so this thread is no longer counted; the
+      // count may already have been taken by another thread, in which case
+      // this thread waits again
+      if (try_acquire_semaphore(h)) {
+        return true;
+      }
+
+      continue;
+    }
+
+    cancel_semaphore_wait(s);
+    return wait_result == WAIT_TIMEOUT && try_acquire_semaphore(h);
+  }
+}
+
+void wake_semaphore_waiters(SemaphorePriv& s, int count)
+{
+  semaphore_header& h = *s.header;
+  uint32_t waiters = h.waiters.load(std::memory_order_seq_cst);
+  uint32_t released = 0;
+
+  // the threads a permit is released for are removed from the count, so
+  // that they are not released again by the next call
+  do
+  {
+    released = (std::min)(waiters, static_cast<uint32_t>(count));
+  } while (released > 0 && !h.waiters.compare_exchange_weak(waiters, waiters - released, std::memory_order_seq_cst));
+
+  if (released > 0) {
+    ::ReleaseSemaphore(s.semaphore, static_cast<LONG>(released), nullptr);
+  }
+}
+
+#else
+
+// creates or opens the shared memory object of a semaphore
+void create_semaphore(SemaphorePriv& s, const std::string& name, int initial_count, int maximum_count, bool must_create)
+{
+  if (maximum_count <= 0 || initial_count < 0 || initial_count > maximum_count) {
+    throw Exception(ErrorCode(ERROR_INVALID_PARAMETER));
+  }
+
+  s.name = name;
+
+  create_shared_memory(s.shm, name, sizeof(semaphore_header), must_create);
+  initialize_semaphore(s, initial_count, maximum_count);
+}
+
+void open_semaphore(SemaphorePriv& s, const std::string& name)
+{
+  s.name = name;
+
+  open_shared_memory(s.shm, name);
+
+  if (s.shm.size < sizeof(semaphore_header)) {
+    throw Exception(ErrorCode(ERROR_INVALID_DATA));
+  }
+
+  s.header = static_cast<semaphore_header*>(s.shm.view);
+  wait_shared_memory_initialized(s.header->magic, semaphore_magic);
+}
+
+// the threads block on the count itself, while it is zero
+bool acquire_semaphore(SemaphorePriv& s, std::chrono::milliseconds timeout, bool infinite)
+{
+  semaphore_header& h = *s.header;
+
+  for (int i(0); i <= s.spin_count; ++i)
+  {
+    if (try_acquire_semaphore(h)) {
+      return true;
+    }
+
+    pause_processor();
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  for (;;)
+  {
+    if (try_acquire_semaphore(h)) {
+      return true;
+    }
+
+    std::chrono::nanoseconds remaining(0);
+
+    if (!infinite)
+    {
+      remaining = futex_remaining(deadline);
+
+      if (remaining.count() <= 0) {
+        return false;
+      }
+    }
+
+    // Release() increases the count before reading the number of waiters,
+    // so either it wakes us or the futex is no longer zero
+    h.waiters.fetch_add(1, std::memory_order_seq_cst);
+    futex_wait(h.count, 0, remaining, infinite);
+    h.waiters.fetch_sub(1, std::memory_order_seq_cst);
+  }
+}
+
+void wake_semaphore_waiters(SemaphorePriv& s, int count)
+{
+  semaphore_header& h = *s.header;
+
+  if (h.waiters.load(std::memory_order_seq_cst) > 0) {
+    futex_wake(h.count, count);
+  }
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+Semaphore::Semaphore() noexcept
+  : d(nullptr)
+{
+
+}
+
+Semaphore::Semaphore(Semaphore&&) noexcept = default;
+
+Semaphore::~Semaphore()
+{
+
+}
+
+/**
+ * \brief create or open a semaphore
+ * \param semaphoreName  the name of the semaphore
+ * \param initialCount   the initial count of the semaphore
+ * \param maximumCount   the maximum count of the semaphore
+ * \throw Exception on failure
+ *
+ * \a initialCount and \a maximumCount are only used if the semaphore is created.
+ *
+ * Use the Created() function to check whether this constructor actually
+ * created the semaphore or only opened it.
+ */
+Semaphore::Semaphore(const std::string& semaphoreName, int initialCount, int maximumCount)
+  : d(std::make_unique<Impl::SemaphorePriv>())
+{
+  constexpr bool must_create = false;
+  Impl::create_semaphore(*d, semaphoreName, initialCount, maximumCount, must_create);
+}
+
+Semaphore::Semaphore(std::unique_ptr<Impl::SemaphorePriv> dPtr)
+  : d(std::move(dPtr))
+{
+
+}
+
+/**
+ * \brief open a semaphore
+ * \param semaphoreName  the name of the semaphore
+ * \return the opened semaphore
+ * \throw Exception on failure
+ *
+ * This function will fail if the semaphore does not exist.
+ */
+Semaphore Semaphore::Open(const std::string& semaphoreName)
+{
+  auto dptr = std::make_unique<Impl::SemaphorePriv>();
+  Impl::open_semaphore(*dptr, semaphoreName);
+  return Semaphore{ std::move(dptr) };
+}
+
+/**
+ * \brief create a semaphore
+ * \param semaphoreName  the name of the semaphore
+ * \param initialCount   the initial count of the semaphore
+ * \param maximumCount   the maximum count of the semaphore
+ * \return the created semaphore
+ * \throw Exception on failure
+ *
+ * This function will fail if the semaphore already exists, in which case the
+ * error code of the exception is ERROR_ALREADY_EXISTS.
+ */
+Semaphore Semaphore::Create(const std::string& semaphoreName, int initialCount, int maximumCount)
+{
+  auto dptr = std::make_unique<Impl::SemaphorePriv>();
+  constexpr bool must_create = true;
+  Impl::create_semaphore(*dptr, semaphoreName, initialCount, maximumCount, must_create);
+  return Semaphore{ std::move(dptr) };
+}
+
+/**
+ * \brief returns whether this object does not represent a valid semaphore
+ */
+bool Semaphore::IsNull() const
+{
+  return !d;
+}
+
+/**
+ * \brief returns whether the semaphore was created by this reference to the semaphore
+ */
+bool Semaphore::Created() const
+{
+  return d && d->created;
+}
+
+/**
+ * \brief returns the name of the semaphore
+ */
+const std::string& Semaphore::GetName() const
+{
+  if (!d) {
+    static const std::string emptyName = "";
+    return emptyName;
+  } else {
+    return d->name;
+  }
+}
+
+/**
+ * \brief returns the current count of the semaphore
+ *
+ * The value may be outdated as soon as it is returned.
+ */
+int Semaphore::GetCount() const
+{
+  return d ? d->header->count.load(std::memory_order_relaxed) : 0;
+}
+
+/**
+ * \brief returns the maximum count of the semaphore
+ */
+int Semaphore::GetMaximumCount() const
+{
+  return d ? d->header->maximum : 0;
+}
+
+/**
+ * \brief waits until the count of the semaphore is positive and decrements it
+ *
+ * Returns false if the wait failed.
+ *
+ * \sa SetSpinCount().
+ */
+bool Semaphore::Acquire()
+{
+  constexpr bool infinite = true;
+  return d && Impl::acquire_semaphore(*d, std::chrono::milliseconds(0), infinite);
+}
+
+/**
+ * \brief waits until the count of the semaphore is positive or a timeout expires
+ * \param timeout  the maximum waiting time
+ *
+ * Returns true if the count was decremented before the timeout expired.
+ */
+bool Semaphore::AcquireFor(std::chrono::milliseconds timeout)
+{
+  if (!d) {
+    return false;
+  }
+
+  constexpr bool infinite = false;
+  return Impl::acquire_semaphore(*d, (std::max)(timeout, std::chrono::milliseconds(0)), infinite);
+}
+
+/**
+ * \brief decrements the count of the semaphore if it is positive
+ *
+ * This function never enters the kernel.
+ */
+bool Semaphore::TryAcquire()
+{
+  return d && Impl::try_acquire_semaphore(*d->header);
+}
+
+/**
+ * \brief increments the count of the semaphore
+ * \param count  the amount by which the count is incremented
+ *
+ * Returns false, and leaves the count unchanged, if the count would
+ * exceed the maximum count.
+ *
+ * Waiting threads are only woken up, with a system call, if there are any.
+ */
+bool Semaphore::Release(int count)
+{
+  if (!d || count <= 0) {
+    return false;
+  }
+
+  Impl::semaphore_header& h = *d->header;
+  int32_t current = h.count.load(std::memory_order_relaxed);
+
+  do
+  {
+    if (current > h.maximum - count) {
+      return false;
+    }
+  } while (!h.count.compare_exchange_weak(current, current + count, std::memory_order_seq_cst));
+
+  Impl::wake_semaphore_waiters(*d, count);
+  return true;
+}
+
+/**
+ * \brief enables spinning before blocking in Acquire() and AcquireFor()
+ * \param spinCount  the number of times the count is tested
+ */
+void Semaphore::SetSpinCount(int spinCount)
+{
+  if (d) {
+    d->spin_count = (std::max)(spinCount, 0);
+  }
+}
+
+/**
+ * \brief closes the semaphore
+ */
+void Semaphore::Close()
+{
+  d.reset();
+}
+
+Semaphore& Semaphore::operator=(Semaphore&&) noexcept = default;
+
+} // namespace Win32
\ No newline at end of file
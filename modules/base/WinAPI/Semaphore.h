@@ -0,0 +1,67 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_SEMAPHORE_H
+#define WINAPI_SEMAPHORE_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct SemaphorePriv;
+} // namespace Impl
+
+/**
+ * \brief represents a named counting semaphore
+ * 
+ * The count of the semaphore is a word in shared memory: acquiring the 
+ * semaphore while its count is positive, and releasing it while no thread
+ * is waiting, do not enter the kernel.
+ */
+class Semaphore
+{
+public:
+  Semaphore() noexcept;
+  Semaphore(const Semaphore&) = delete;
+  Semaphore(Semaphore&&) noexcept;
+  ~Semaphore();
+
+  Semaphore(const std::string& semaphoreName, int initialCount, int maximumCount);
+
+  static Semaphore Open(const std::string& semaphoreName);
+  static Semaphore Create(const std::string& semaphoreName, int initialCount, int maximumCount);
+
+  bool IsNull() const;
+  bool Created() const;
+  const std::string& GetName() const;
+  int GetCount() const;
+  int GetMaximumCount() const;
+
+  bool Acquire();
+  bool AcquireFor(std::chrono::milliseconds timeout);
+  bool TryAcquire();
+  bool Release(int count = 1);
+
+  void SetSpinCount(int spinCount);
+
+  void Close();
+
+  Semaphore& operator=(const Semaphore&) = delete;
+  Semaphore& operator=(Semaphore&&) noexcept;
+
+private:
+  explicit Semaphore(std::unique_ptr<Impl::SemaphorePriv> dPtr);
+
+private:
+  std::unique_ptr<Impl::SemaphorePriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_SEMAPHORE_H
\ No newline at end of file
@@ -0,0 +1,85 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_SPAN_H
+#define WINAPI_SPAN_H
+
+#include <cstddef>
+
+namespace Win32
+{
+
+/**
+ * \brief a view on a contiguous sequence of objects
+ * 
+ * This is a minimal replacement for C++20 std::span.
+ */
+template<typename T>
+class Span
+{
+public:
+  Span() = default;
+  Span(T* data, size_t size);
+
+  T* data() const;
+  size_t size() const;
+  bool empty() const;
+
+  T* begin() const;
+  T* end() const;
+
+  T& operator[](size_t index) const;
+
+private:
+  T* m_data = nullptr;
+  size_t m_size = 0;
+};
+
+template<typename T>
+inline Span<T>::Span(T* data, size_t size)
+  : m_data(data),
+    m_size(size)
+{
+
+}
+
+template<typename T>
+inline T* Span<T>::data() const
+{
+  return m_data;
+}
+
+template<typename T>
+inline size_t Span<T>::size() const
+{
+  return m_size;
+}
+
+template<typename T>
+inline bool Span<T>::empty() const
+{
+  return m_size == 0;
+}
+
+template<typename T>
+inline T* Span<T>::begin() const
+{
+  return m_data;
+}
+
+template<typename T>
+inline T* Span<T>::end() const
+{
+  return m_data + m_size;
+}
+
+template<typename T>
+inline T& Span<T>::operator[](size_t index) const
+{
+  return m_data[index];
+}
+
+} // namespace Win32
+
+#endif // WINAPI_SPAN_H
\ No newline at end of file
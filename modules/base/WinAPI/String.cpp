@@ -59,4 +59,18 @@ std::string ToUtf8(const std::wstring& utf16)
   return result;
 }
 
+/**
+ * \brief converts a utf16 string to lowercase
+ * 
+ * This is mostly useful for case-insensitive comparisons, e.g. of file names.
+ */
+std::wstring ToLower(std::wstring utf16)
+{
+  if (!utf16.empty()) {
+    ::CharLowerBuffW(utf16.data(), static_cast<DWORD>(utf16.size()));
+  }
+
+  return utf16;
+}
+
 } // namespace Win32
\ No newline at end of file
@@ -13,6 +13,8 @@ namespace Win32
 std::wstring ToUtf16(const std::string& utf8);
 std::string ToUtf8(const std::wstring& utf16);
 
+std::wstring ToLower(std::wstring utf16);
+
 } // namespace Win32
 
 #endif // WINAPI_STRING_H
\ No newline at end of file
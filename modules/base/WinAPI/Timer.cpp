@@ -0,0 +1,251 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "Timer.h"
+#include "timer_priv.h"
+
+#include "Exception.h"
+
+#ifndef _WIN32
+#include "winerror_priv.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <poll.h>
+#include <sys/timerfd.h>
+#endif
+
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif // _WIN32
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+void create_timer(TimerPriv& t)
+{
+  constexpr LPCWSTR name = nullptr;
+  HANDLE handle = ::CreateWaitableTimerExW(nullptr, name, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+  if (!handle) {
+    // high-resolution timers are not supported before Windows 10, version 1803
+    constexpr DWORD flags = 0;
+    handle = ::CreateWaitableTimerExW(nullptr, name, flags, TIMER_ALL_ACCESS);
+  }
+
+  if (!handle) {
+    throw Exception(GetLastError());
+  }
+
+  t.handle = handle;
+}
+
+bool start_timer(TimerPriv& t, std::chrono::nanoseconds due_time, std::chrono::milliseconds period)
+{
+  // a negative value is a time relative to the current time, in 100-nanosecond intervals
+  LARGE_INTEGER relative_due_time;
+  relative_due_time.QuadPart = -(std::max)(due_time.count() / 100, std::chrono::nanoseconds::rep(0));
+
+  const auto period_ms = static_cast<LONG>((std::min)(period.count(), static_cast<std::chrono::milliseconds::rep>(MAXLONG)));
+
+  constexpr PTIMERAPCROUTINE completion_routine = nullptr;
+  constexpr bool resume = false;
+  return ::SetWaitableTimer(t.handle, &relative_due_time, (std::max)(period_ms, LONG(0)), completion_routine, nullptr, resume);
+}
+
+bool stop_timer(TimerPriv& t)
+{
+  return ::CancelWaitableTimer(t.handle);
+}
+
+bool wait_timer(TimerPriv& t, std::chrono::milliseconds timeout, bool infinite)
+{
+  // INFINITE must not be reached by a finite timeout
+  const DWORD ms = infinite ? INFINITE : static_cast<DWORD>((std::min)(timeout.count(), static_cast<std::chrono::milliseconds::rep>(INFINITE - 1)));
+  return ::WaitForSingleObject(t.handle, ms) == WAIT_OBJECT_0;
+}
+
+#else
+
+void create_timer(TimerPriv& t)
+{
+  // the timer is not affected by changes of the system time, as a waitable timer
+  // started with a relative due time
+  t.fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+  if (t.fd == -1) {
+    throw Exception(ErrorCode((errno == EMFILE || errno == ENFILE) ? ERROR_TOO_MANY_OPEN_FILES : ERROR_NOT_ENOUGH_MEMORY));
+  }
+}
+
+struct timespec to_timespec(std::chrono::nanoseconds duration)
+{
+  struct timespec result = {};
+  result.tv_sec = static_cast<time_t>(duration.count() / 1000000000);
+  result.tv_nsec = static_cast<long>(duration.count() % 1000000000);
+  return result;
+}
+
+bool start_timer(TimerPriv& t, std::chrono::nanoseconds due_time, std::chrono::milliseconds period)
+{
+  // a zero due time would stop the timer, the timer is signaled as soon as possible instead
+  struct itimerspec settings = {};
+  settings.it_value = to_timespec((std::max)(due_time, std::chrono::nanoseconds(1)));
+  settings.it_interval = to_timespec((std::max)(period, std::chrono::milliseconds(0)));
+
+  constexpr int relative = 0;
+  return ::timerfd_settime(t.fd, relative, &settings, nullptr) == 0;
+}
+
+bool stop_timer(TimerPriv& t)
+{
+  const struct itimerspec settings = {};
+  constexpr int relative = 0;
+  return ::timerfd_settime(t.fd, relative, &settings, nullptr) == 0;
+}
+
+// reading the timerfd resets it, as a waitable timer is reset when a waiting
+// thread is released; a thread that sees the timer readable may therefore
+// find it reset by another thread, and waits again
+bool wait_timer(TimerPriv& t, std::chrono::milliseconds timeout, bool infinite)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  for (;;)
+  {
+    uint64_t expirations = 0;
+
+    if (::read(t.fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+      return true;
+    }
+
+    if (errno != EAGAIN && errno != EINTR) {
+      return false;
+    }
+
+    int ms = -1;
+
+    if (!infinite)
+    {
+      const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+      if (remaining <= 0) {
+        return false;
+      }
+
+      ms = static_cast<int>((std::min)(remaining, static_cast<std::chrono::milliseconds::rep>(INT_MAX)));
+    }
+
+    struct pollfd timer_fd = { t.fd, POLLIN, 0 };
+
+    if (::poll(&timer_fd, 1, ms) == -1 && errno != EINTR) {
+      return false;
+    }
+  }
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+/**
+ * \brief creates a timer
+ * \throw Exception on failure
+ *
+ * The timer is not started.
+ */
+Timer::Timer()
+{
+  Impl::create_timer(d.emplace());
+}
+
+Timer::Timer(Timer&&) noexcept = default;
+
+Timer::~Timer()
+{
+
+}
+
+/**
+ * \brief starts the timer
+ * \param dueTime  the time after which the timer is signaled for the first time
+ * \param period   the period of the timer, 0 for a timer that is signaled once
+ *
+ * If the timer was already started, it is restarted with the new settings.
+ *
+ * Returns false on failure.
+ */
+bool Timer::Start(std::chrono::nanoseconds dueTime, std::chrono::milliseconds period)
+{
+  return d && Impl::start_timer(*d, dueTime, period);
+}
+
+/**
+ * \brief stops the timer
+ *
+ * Returns false on failure.
+ */
+bool Timer::Stop()
+{
+  return d && Impl::stop_timer(*d);
+}
+
+/**
+ * \brief waits until the timer is signaled
+ *
+ * Returns false if the wait failed.
+ */
+bool Timer::Wait()
+{
+  constexpr bool infinite = true;
+  return d && Impl::wait_timer(*d, std::chrono::milliseconds(0), infinite);
+}
+
+/**
+ * \brief waits until the timer is signaled or a timeout expires
+ * \param timeout  the maximum waiting time
+ *
+ * Returns true if the timer was signaled before the timeout expired.
+ */
+bool Timer::WaitFor(std::chrono::milliseconds timeout)
+{
+  constexpr bool infinite = false;
+  return d && Impl::wait_timer(*d, (std::max)(timeout, std::chrono::milliseconds(0)), infinite);
+}
+
+Timer& Timer::operator=(Timer&&) noexcept = default;
+
+Impl::TimerPriv* Timer::GetImpl() const
+{
+  return d.get();
+}
+
+#ifdef _WIN32
+
+HANDLE GetHANDLE(const Timer& timer)
+{
+  return timer.GetImpl() ? timer.GetImpl()->handle : nullptr;
+}
+
+#else
+
+int GetFileDescriptor(const Timer& timer)
+{
+  return timer.GetImpl() ? timer.GetImpl()->fd : -1;
+}
+
+#endif // _WIN32
+
+} // namespace Win32
\ No newline at end of file
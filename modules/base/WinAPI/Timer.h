@@ -0,0 +1,55 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_TIMER_H
+#define WINAPI_TIMER_H
+
+#include "FastPimpl.h"
+
+#include <chrono>
+
+namespace Win32
+{
+
+namespace Impl
+{
+struct TimerPriv;
+} // namespace Impl
+
+/**
+ * \brief represents a waitable timer
+ * 
+ * A timer is signaled when its due time is reached, and then again after 
+ * each period if it is periodic.
+ * It is reset when a thread waiting for it is released, so it can be used
+ * in a WaitSet or in any wait function alongside other objects.
+ * 
+ * A high-resolution timer is used when the system supports it.
+ */
+class Timer
+{
+public:
+  Timer();
+  Timer(const Timer&) = delete;
+  Timer(Timer&&) noexcept;
+  ~Timer();
+
+  bool Start(std::chrono::nanoseconds dueTime, std::chrono::milliseconds period = std::chrono::milliseconds(0));
+  bool Stop();
+
+  bool Wait();
+  bool WaitFor(std::chrono::milliseconds timeout);
+
+  Timer& operator=(const Timer&) = delete;
+  Timer& operator=(Timer&&) noexcept;
+
+  Impl::TimerPriv* GetImpl() const;
+
+private:
+  Impl::FastPimpl<Impl::TimerPriv, 16> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_TIMER_H
\ No newline at end of file
@@ -0,0 +1,870 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "WaitSet.h"
+#include "waitset_priv.h"
+
+#include "Event.h"
+#include "EventImpl.h"
+#include "Exception.h"
+#include "processpriv.h"
+#include "timer_priv.h"
+
+#ifndef _WIN32
+#include "futex_priv.h"
+#include "winerror_priv.h"
+
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <functional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#endif
+
+#include <algorithm>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+WaitSet::Id make_wait_id(const WaitSlot& slot)
+{
+  return (static_cast<WaitSet::Id>(slot.generation) << 32) | slot.index;
+}
+
+// returns nullptr if the id does not identify an object of the set
+WaitSlot* find_wait_slot(WaitSetPriv& set, WaitSet::Id id)
+{
+  const auto index = static_cast<uint32_t>(id & 0xFFFFFFFF);
+  const auto generation = static_cast<uint32_t>(id >> 32);
+
+  if (index >= set.slots.size()) {
+    return nullptr;
+  }
+
+  WaitSlot& slot = set.slots[index];
+  return slot.active && slot.generation == generation ? &slot : nullptr;
+}
+
+// returns a free slot, which is not active; must be called with the mutex held
+WaitSlot& allocate_wait_slot(WaitSetPriv& set)
+{
+  if (!set.free_slots.empty())
+  {
+    WaitSlot& slot = set.slots[set.free_slots.back()];
+    set.free_slots.pop_back();
+    return slot;
+  }
+
+  WaitSlot& slot = set.slots.emplace_back();
+  slot.index = static_cast<uint32_t>(set.slots.size() - 1);
+  return slot;
+}
+
+// makes the id of the slot stale; must be called with the mutex held
+void release_wait_slot(WaitSetPriv& set, WaitSlot& slot)
+{
+  slot.active = false;
+  slot.armed = false;
+
+  if (++slot.generation == 0) {
+    slot.generation = 1;
+  }
+
+  --set.size;
+}
+
+// moves the ready list into the caller's vector, whose storage is
+// recycled for the next batch
+bool take_ready(WaitSetPriv& set, std::vector<WaitSet::Id>& ready)
+{
+  ready.clear();
+
+  std::lock_guard<std::mutex> lock{ set.mutex };
+  std::swap(ready, set.ready);
+
+  // objects may have been removed after being reported
+  auto is_stale = [&set](WaitSet::Id id) {
+    return find_wait_slot(set, id) == nullptr;
+  };
+
+  ready.erase(std::remove_if(ready.begin(), ready.end(), is_stale), ready.end());
+  return !ready.empty();
+}
+
+#ifdef _WIN32
+
+void CALLBACK wait_callback(PTP_CALLBACK_INSTANCE /* instance */, PVOID context, PTP_WAIT /* wait */, TP_WAIT_RESULT /* result */)
+{
+  auto* slot = static_cast<WaitSlot*>(context);
+  WaitSetPriv& set = *slot->owner;
+  bool was_empty = false;
+
+  {
+    std::lock_guard<std::mutex> lock{ set.mutex };
+
+    if (!slot->active || !slot->armed) {
+      return;
+    }
+
+    slot->armed = false;
+    was_empty = set.ready.empty();
+    set.ready.push_back(make_wait_id(*slot));
+  }
+
+  // the waiting thread is only woken up once per batch
+  if (was_empty) {
+    ::SetEvent(set.ready_event);
+  }
+}
+
+void create_wait_set(WaitSetPriv& set)
+{
+  constexpr bool manual_reset = false;
+  constexpr bool initial_state = false;
+  set.ready_event = ::CreateEventW(nullptr, manual_reset, initial_state, nullptr);
+
+  if (!set.ready_event) {
+    throw Exception(GetLastError());
+  }
+}
+
+// waits for the thread pool callbacks that are still running
+void destroy_wait_set(WaitSetPriv& set)
+{
+  for (WaitSlot& slot : set.slots)
+  {
+    if (!slot.wait) {
+      continue;
+    }
+
+    ::SetThreadpoolWait(slot.wait, nullptr, nullptr);
+    constexpr bool cancel_pending_callbacks = true;
+    ::WaitForThreadpoolWaitCallbacks(slot.wait, cancel_pending_callbacks);
+    ::CloseThreadpoolWait(slot.wait);
+  }
+
+  ::CloseHandle(set.ready_event);
+}
+
+WaitSet::Id add_handle(WaitSetPriv& set, HANDLE handle)
+{
+  if (!handle) {
+    throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+  }
+
+  std::lock_guard<std::mutex> lock{ set.mutex };
+  WaitSlot& slot = allocate_wait_slot(set);
+
+  if (!slot.wait)
+  {
+    slot.owner = &set;
+    slot.wait = ::CreateThreadpoolWait(wait_callback, &slot, nullptr);
+
+    if (!slot.wait) {
+      ErrorCode err = GetLastError();
+      set.free_slots.push_back(slot.index);
+      throw Exception(err);
+    }
+  }
+
+  slot.handle = handle;
+  slot.active = true;
+  slot.armed = true;
+  ++set.size;
+
+  ::SetThreadpoolWait(slot.wait, handle, nullptr);
+
+  return make_wait_id(slot);
+}
+
+// must be called with the mutex held
+void arm_wait(WaitSetPriv& /* set */, WaitSlot& slot)
+{
+  ::SetThreadpoolWait(slot.wait, slot.handle, nullptr);
+}
+
+bool remove_wait(WaitSetPriv& set, WaitSet::Id id)
+{
+  WaitSlot* slot = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock{ set.mutex };
+    slot = find_wait_slot(set, id);
+
+    if (!slot) {
+      return false;
+    }
+
+    release_wait_slot(set, *slot);
+    slot->handle = nullptr;
+    ::SetThreadpoolWait(slot->wait, nullptr, nullptr);
+  }
+
+  // a callback may be running for the object, the slot can only be reused
+  // once it has returned; this cannot be done while holding the mutex
+  constexpr bool cancel_pending_callbacks = true;
+  ::WaitForThreadpoolWaitCallbacks(slot->wait, cancel_pending_callbacks);
+
+  std::lock_guard<std::mutex> lock{ set.mutex };
+  set.free_slots.push_back(slot->index);
+  return true;
+}
+
+bool wait_ready(WaitSetPriv& set, std::vector<WaitSet::Id>& ready, std::chrono::milliseconds timeout, bool infinite)
+{
+  // INFINITE must not be reached by a finite timeout
+  const DWORD ms = infinite ? INFINITE : static_cast<DWORD>((std::min)(timeout.count(), static_cast<std::chrono::milliseconds::rep>(INFINITE - 1)));
+  const ULONGLONG deadline = ::GetTickCount64() + ms;
+
+  for (;;)
+  {
+    if (take_ready(set, ready)) {
+      return true;
+    }
+
+    DWORD remaining = ms;
+
+    if (!infinite)
+    {
+      const ULONGLONG now = ::GetTickCount64();
+      remaining = now < deadline ? static_cast<DWORD>(deadline - now) : 0;
+    }
+
+    DWORD result = ::WaitForSingleObject(set.ready_event, remaining);
+
+    if (result == WAIT_FAILED) {
+      throw Exception(GetLastError());
+    }
+
+    if (result == WAIT_TIMEOUT) {
+      return take_ready(set, ready);
+    }
+
+    // the event may have been set for a batch that was already taken,
+    // in which case we wait again
+  }
+}
+
+#else
+
+// the id of the eventfd of the set in the epoll instance, which no
+// registration has as its generation is never zero
+constexpr WaitSet::Id ready_fd_id = 0;
+
+ErrorCode wait_error_from_errno(int err)
+{
+  switch (err)
+  {
+  case EBADF:
+    return ErrorCode(ERROR_INVALID_HANDLE);
+  case EEXIST:
+    return ErrorCode(ERROR_ALREADY_EXISTS);
+  case EPERM:
+    // regular files and directories cannot be waited for
+    return ErrorCode(ERROR_NOT_SUPPORTED);
+  case EMFILE:
+  case ENFILE:
+    return ErrorCode(ERROR_TOO_MANY_OPEN_FILES);
+  case ENOMEM:
+  case ENOSPC:
+    return ErrorCode(ERROR_NOT_ENOUGH_MEMORY);
+  default:
+    return ErrorCode(ERROR_INVALID_PARAMETER);
+  }
+}
+
+// futex_waitv() is not available before Linux 5.16
+bool can_wait_for_events()
+{
+  // fails with EINVAL when supported, as there is no word to wait for
+  static const bool supported = futex_wait_any(nullptr, 0) != -1 || errno != ENOSYS;
+  return supported;
+}
+
+// makes the watcher rebuild its list of words; must be called with the mutex
+// held, so that the thread sees the change if it is not blocked yet
+void interrupt_watcher(EventWatcher& watcher)
+{
+  watcher.control.fetch_add(1, std::memory_order_relaxed);
+  futex_wake(watcher.control, 1);
+}
+
+// wakes up the threads waiting for the set; must be called with the mutex held
+bool signal_ready(WaitSetPriv& set)
+{
+  const uint64_t one = 1;
+  return ::write(set.ready_fd, &one, sizeof(one)) == sizeof(one);
+}
+
+// resets the eventfd of the set; fails if it was already reset
+bool reset_ready(WaitSetPriv& set)
+{
+  uint64_t value = 0;
+  return ::read(set.ready_fd, &value, sizeof(value)) == sizeof(value);
+}
+
+struct futex_waitv make_futex_waitv(std::atomic<uint32_t>& word, uint32_t expected)
+{
+  struct futex_waitv result = {};
+  result.val = expected;
+  result.uaddr = reinterpret_cast<uintptr_t>(&word);
+  result.flags = FUTEX_32;
+  return result;
+}
+
+void watch_events(WaitSetPriv& set, EventWatcher& watcher)
+{
+  std::vector<struct futex_waitv> words;
+  words.reserve(event_watcher_capacity + 1);
+  std::unique_lock<std::mutex> lock{ set.mutex };
+
+  while (!watcher.stop)
+  {
+    words.clear();
+    words.push_back(make_futex_waitv(watcher.control, watcher.control.load(std::memory_order_relaxed)));
+    const bool was_empty = set.ready.empty();
+
+    for (uint32_t index : watcher.slots)
+    {
+      WaitSlot& slot = set.slots[index];
+
+      if (!slot.armed) {
+        continue;
+      }
+
+      if (prepare_event_wait(*slot.event, slot.expected, slot.blocked))
+      {
+        slot.armed = false;
+        slot.blocked = false;
+        set.ready.push_back(make_wait_id(slot));
+      }
+      else
+      {
+        slot.blocked = true;
+        words.push_back(make_futex_waitv(slot.event->state, slot.expected));
+      }
+    }
+
+    // the waiting thread is only woken up once per batch
+    if (was_empty && !set.ready.empty()) {
+      signal_ready(set);
+    }
+
+    lock.unlock();
+    // returns immediately if a word changed since it was read
+    futex_wait_any(words.data(), static_cast<unsigned int>(words.size()));
+    lock.lock();
+  }
+}
+
+void create_wait_set(WaitSetPriv& set)
+{
+  set.epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+
+  if (set.epoll_fd == -1) {
+    throw Exception(wait_error_from_errno(errno));
+  }
+
+  set.ready_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  struct epoll_event ready_event = {};
+  ready_event.events = EPOLLIN;
+  ready_event.data.u64 = ready_fd_id;
+
+  if (set.ready_fd == -1 || ::epoll_ctl(set.epoll_fd, EPOLL_CTL_ADD, set.ready_fd, &ready_event) == -1)
+  {
+    const int err = errno;
+
+    if (set.ready_fd != -1) {
+      ::close(set.ready_fd);
+    }
+
+    ::close(set.epoll_fd);
+    throw Exception(wait_error_from_errno(err));
+  }
+}
+
+// stops the watchers, which may be blocked
+void destroy_wait_set(WaitSetPriv& set)
+{
+  {
+    std::lock_guard<std::mutex> lock{ set.mutex };
+
+    for (EventWatcher& watcher : set.watchers)
+    {
+      watcher.stop = true;
+      interrupt_watcher(watcher);
+    }
+  }
+
+  for (EventWatcher& watcher : set.watchers) {
+    watcher.thread.join();
+  }
+
+  ::close(set.ready_fd);
+  ::close(set.epoll_fd);
+}
+
+// the registration fires once, hence EPOLLONESHOT; must be called with the mutex held
+bool update_epoll(WaitSetPriv& set, WaitSlot& slot, int op)
+{
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ev.data.u64 = make_wait_id(slot);
+  return ::epoll_ctl(set.epoll_fd, op, slot.fd, &ev) == 0;
+}
+
+WaitSet::Id add_file_descriptor(WaitSetPriv& set, int fd, WaitSource source)
+{
+  if (fd == -1) {
+    throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+  }
+
+  std::lock_guard<std::mutex> lock{ set.mutex };
+  WaitSlot& slot = allocate_wait_slot(set);
+  slot.source = source;
+  slot.fd = fd;
+  slot.event = nullptr;
+
+  if (!update_epoll(set, slot, EPOLL_CTL_ADD)) {
+    const int err = errno;
+    set.free_slots.push_back(slot.index);
+    throw Exception(wait_error_from_errno(err));
+  }
+
+  slot.active = true;
+  slot.armed = true;
+  ++set.size;
+
+  return make_wait_id(slot);
+}
+
+// returns the index of a watcher that can watch one more event; must be
+// called with the mutex held
+uint32_t get_event_watcher(WaitSetPriv& set)
+{
+  for (size_t i(0); i < set.watchers.size(); ++i)
+  {
+    if (set.watchers[i].slots.size() < event_watcher_capacity) {
+      return static_cast<uint32_t>(i);
+    }
+  }
+
+  if (!can_wait_for_events()) {
+    throw Exception(ErrorCode(ERROR_NOT_SUPPORTED));
+  }
+
+  EventWatcher& watcher = set.watchers.emplace_back();
+  watcher.slots.reserve(event_watcher_capacity);
+
+  try
+  {
+    // the thread blocks on the mutex until the caller releases it
+    watcher.thread = std::thread(watch_events, std::ref(set), std::ref(watcher));
+  }
+  catch (const std::system_error&)
+  {
+    set.watchers.pop_back();
+    throw Exception(ErrorCode(ERROR_NOT_ENOUGH_MEMORY));
+  }
+
+  return static_cast<uint32_t>(set.watchers.size() - 1);
+}
+
+WaitSet::Id add_event(WaitSetPriv& set, event_header* header)
+{
+  if (!header) {
+    throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+  }
+
+  std::lock_guard<std::mutex> lock{ set.mutex };
+  const uint32_t watcher = get_event_watcher(set);
+  WaitSlot& slot = allocate_wait_slot(set);
+  slot.source = WaitSource::Event;
+  slot.fd = -1;
+  slot.event = header;
+  slot.watcher = watcher;
+  slot.blocked = false;
+  slot.active = true;
+  slot.armed = true;
+  ++set.size;
+
+  set.watchers[watcher].slots.push_back(slot.index);
+  interrupt_watcher(set.watchers[watcher]);
+
+  return make_wait_id(slot);
+}
+
+// must be called with the mutex held
+void arm_wait(WaitSetPriv& set, WaitSlot& slot)
+{
+  if (slot.source == WaitSource::Event)
+  {
+    slot.blocked = false;
+    interrupt_watcher(set.watchers[slot.watcher]);
+  }
+  else
+  {
+    // fails if the file descriptor was closed, it is then never reported
+    update_epoll(set, slot, EPOLL_CTL_MOD);
+  }
+}
+
+// neither epoll nor the watchers report a stale id, so the slot can be
+// reused immediately
+bool remove_wait(WaitSetPriv& set, WaitSet::Id id)
+{
+  std::lock_guard<std::mutex> lock{ set.mutex };
+  WaitSlot* slot = find_wait_slot(set, id);
+
+  if (!slot) {
+    return false;
+  }
+
+  if (slot->source == WaitSource::Event)
+  {
+    EventWatcher& watcher = set.watchers[slot->watcher];
+    auto it = std::find(watcher.slots.begin(), watcher.slots.end(), slot->index);
+    *it = watcher.slots.back();
+    watcher.slots.pop_back();
+    interrupt_watcher(watcher);
+    slot->event = nullptr;
+  }
+  else
+  {
+    struct epoll_event ev = {};
+    ::epoll_ctl(set.epoll_fd, EPOLL_CTL_DEL, slot->fd, &ev);
+    slot->fd = -1;
+  }
+
+  release_wait_slot(set, *slot);
+  set.free_slots.push_back(slot->index);
+  return true;
+}
+
+// moves the file descriptors reported by epoll to the ready list
+void collect_ready(WaitSetPriv& set, const struct epoll_event* events, int count)
+{
+  std::lock_guard<std::mutex> lock{ set.mutex };
+
+  for (int i(0); i < count; ++i)
+  {
+    const WaitSet::Id id = events[i].data.u64;
+
+    if (id == ready_fd_id)
+    {
+      // the ready list is taken after this
+      reset_ready(set);
+      continue;
+    }
+
+    WaitSlot* slot = find_wait_slot(set, id);
+
+    if (!slot || !slot->armed) {
+      continue;
+    }
+
+    if (slot->source == WaitSource::Timer)
+    {
+      // waiting for a timer resets it; it may have been reset by a thread
+      // waiting for it directly, in which case it is waited for again
+      uint64_t expirations = 0;
+
+      if (::read(slot->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+      {
+        update_epoll(set, *slot, EPOLL_CTL_MOD);
+        continue;
+      }
+    }
+
+    slot->armed = false;
+    set.ready.push_back(id);
+  }
+}
+
+bool wait_ready(WaitSetPriv& set, std::vector<WaitSet::Id>& ready, std::chrono::milliseconds timeout, bool infinite)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::array<struct epoll_event, 64> events;
+  // the first pass collects the objects that are already signaled
+  int ms = 0;
+
+  for (;;)
+  {
+    int count = 0;
+
+    do
+    {
+      count = ::epoll_wait(set.epoll_fd, events.data(), static_cast<int>(events.size()), ms);
+
+      if (count == -1)
+      {
+        if (errno != EINTR) {
+          throw Exception(ErrorCode(ERROR_INVALID_HANDLE));
+        }
+
+        count = 0;
+      }
+
+      collect_ready(set, events.data(), count);
+      ms = 0;
+    } while (count == static_cast<int>(events.size()));
+
+    if (take_ready(set, ready)) {
+      return true;
+    }
+
+    ms = -1;
+
+    if (!infinite)
+    {
+      const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+      if (remaining <= 0) {
+        return false;
+      }
+
+      ms = static_cast<int>((std::min)(remaining, static_cast<std::chrono::milliseconds::rep>(INT_MAX)));
+    }
+  }
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+/**
+ * \brief constructs an empty wait set
+ * \throw Exception on failure
+ */
+WaitSet::WaitSet()
+  : d(std::make_unique<Impl::WaitSetPriv>())
+{
+  Impl::create_wait_set(*d);
+}
+
+/**
+ * \brief destroys the wait set
+ *
+ * This function waits for the thread pool callbacks that are still running
+ * on Windows, and for the threads of the set on Linux.
+ */
+WaitSet::~WaitSet()
+{
+  Impl::destroy_wait_set(*d);
+}
+
+/**
+ * \brief adds an event to the set
+ * \param ev  the event
+ * \throw Exception on failure
+ *
+ * The event must not be closed while it is in the set.
+ * Note that waiting for an auto-reset event resets it.
+ *
+ * On Linux, this function fails with ERROR_NOT_SUPPORTED before Linux 5.16.
+ */
+WaitSet::Id WaitSet::Add(const Event& ev)
+{
+#ifdef _WIN32
+  return Add(GetHANDLE(ev));
+#else
+  return Impl::add_event(*d, ev.GetImpl() ? ev.GetImpl()->header : nullptr);
+#endif // _WIN32
+}
+
+/**
+ * \brief adds a process to the set
+ * \param process  a started process
+ * \throw Exception on failure
+ *
+ * The process is reported when it exits. On Linux, it is not reaped,
+ * which is done by Process::WaitForFinished() or Process::GetExitCode().
+ */
+WaitSet::Id WaitSet::Add(const Process& process)
+{
+#ifdef _WIN32
+  return Add(process.GetImpl()->handle);
+#else
+  return Impl::add_file_descriptor(*d, GetFileDescriptor(process), Impl::WaitSource::FileDescriptor);
+#endif // _WIN32
+}
+
+/**
+ * \brief adds a timer to the set
+ * \param timer  the timer
+ * \throw Exception on failure
+ *
+ * The timer is reported each time it is signaled, provided that Rearm() is
+ * called after each report.
+ */
+WaitSet::Id WaitSet::Add(const Timer& timer)
+{
+#ifdef _WIN32
+  return Add(GetHANDLE(timer));
+#else
+  return Impl::add_file_descriptor(*d, GetFileDescriptor(timer), Impl::WaitSource::Timer);
+#endif // _WIN32
+}
+
+#ifdef _WIN32
+
+/**
+ * \brief adds a waitable object to the set
+ * \param handle  a handle to the object
+ * \throw Exception on failure
+ *
+ * Returns an id that identifies the object in the set until it is removed.
+ * The object is waited for immediately.
+ *
+ * The handle must stay valid while the object is in the set.
+ */
+WaitSet::Id WaitSet::Add(void* handle)
+{
+  return Impl::add_handle(*d, handle);
+}
+
+#else
+
+/**
+ * \brief adds a file descriptor to the set
+ * \param fd  the file descriptor
+ * \throw Exception on failure
+ *
+ * Returns an id that identifies the file descriptor in the set until it is
+ * removed. The file descriptor is reported when it is readable; it is not
+ * read, unlike a timer.
+ *
+ * The file descriptor must stay open while it is in the set, and cannot be
+ * added twice to the same set (ERROR_ALREADY_EXISTS).
+ */
+WaitSet::Id WaitSet::Add(int fd)
+{
+  return Impl::add_file_descriptor(*d, fd, Impl::WaitSource::FileDescriptor);
+}
+
+#endif // _WIN32
+
+/**
+ * \brief waits again for an object that was reported as signaled
+ * \param id  the id of the object
+ *
+ * Returns false if \a id does not identify an object of the set.
+ */
+bool WaitSet::Rearm(Id id)
+{
+  std::lock_guard<std::mutex> lock{ d->mutex };
+  Impl::WaitSlot* slot = Impl::find_wait_slot(*d, id);
+
+  if (!slot) {
+    return false;
+  }
+
+  if (!slot->armed)
+  {
+    slot->armed = true;
+    Impl::arm_wait(*d, *slot);
+  }
+
+  return true;
+}
+
+/**
+ * \brief removes an object from the set
+ * \param id  the id of the object
+ *
+ * Returns false if \a id does not identify an object of the set.
+ *
+ * Once this function returns, \a id is never reported by Wait() or WaitFor(),
+ * even if the object was signaled before.
+ */
+bool WaitSet::Remove(Id id)
+{
+  return Impl::remove_wait(*d, id);
+}
+
+/**
+ * \brief returns the number of objects in the set
+ */
+size_t WaitSet::Size() const
+{
+  std::lock_guard<std::mutex> lock{ d->mutex };
+  return d->size;
+}
+
+/**
+ * \brief waits until at least one object of the set is signaled
+ * \param ready  receives the ids of the signaled objects
+ * \throw Exception on failure
+ *
+ * All the objects that were signaled since the last call are returned at once.
+ * The storage of \a ready is reused by the set, so that passing the same
+ * vector to every call does not allocate memory.
+ *
+ * \sa WaitFor().
+ */
+bool WaitSet::Wait(std::vector<Id>& ready)
+{
+  constexpr bool infinite = true;
+  return Impl::wait_ready(*d, ready, std::chrono::milliseconds(0), infinite);
+}
+
+/**
+ * \brief waits until at least one object of the set is signaled or a timeout expires
+ * \param ready    receives the ids of the signaled objects
+ * \param timeout  the maximum waiting time
+ * \throw Exception on failure
+ *
+ * Returns false if no object was signaled before the timeout expired.
+ *
+ * A zero timeout can be used to collect the signaled objects after the handle
+ * (or file descriptor) of the set was waited for by other means (e.g., a
+ * message loop).
+ *
+ * \sa Wait().
+ */
+bool WaitSet::WaitFor(std::vector<Id>& ready, std::chrono::milliseconds timeout)
+{
+  constexpr bool infinite = false;
+  return Impl::wait_ready(*d, ready, (std::max)(timeout, std::chrono::milliseconds(0)), infinite);
+}
+
+Impl::WaitSetPriv* WaitSet::GetImpl() const
+{
+  return d.get();
+}
+
+#ifdef _WIN32
+
+/**
+ * \brief returns a handle that is signaled when objects of the set are ready
+ *
+ * This is an auto-reset event: after waiting for it, call WaitFor() with a
+ * zero timeout to collect the signaled objects.
+ */
+HANDLE GetHANDLE(const WaitSet& waitSet)
+{
+  return waitSet.GetImpl()->ready_event;
+}
+
+#else
+
+/**
+ * \brief returns a file descriptor that is readable when objects of the set are ready
+ *
+ * This is the epoll instance of the set: after polling it, call WaitFor()
+ * with a zero timeout to collect the signaled objects.
+ */
+int GetFileDescriptor(const WaitSet& waitSet)
+{
+  return waitSet.GetImpl()->epoll_fd;
+}
+
+#endif // _WIN32
+
+} // namespace Win32
\ No newline at end of file
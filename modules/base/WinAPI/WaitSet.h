@@ -0,0 +1,78 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_WAITSET_H
+#define WINAPI_WAITSET_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Win32
+{
+
+class Event;
+class Process;
+class Timer;
+
+namespace Impl
+{
+struct WaitSetPriv;
+} // namespace Impl
+
+/**
+ * \brief waits for any number of waitable objects at once
+ *
+ * Unlike WaitForMultipleObjects(), a wait set is not limited to 64 objects.
+ * Objects are added to the set with Add(), which returns a non-zero id that
+ * identifies the registration; Wait() and WaitFor() then return the
+ * ids of the objects that were signaled since the last call, as a batch.
+ *
+ * A registration fires once: after its id has been reported, the object is
+ * no longer waited for until Rearm() is called.
+ *
+ * On Windows, the waits are performed by the system thread pool, so adding
+ * and removing objects are constant-time operations that do not require
+ * interrupting a waiting thread.
+ * On Linux, file descriptors (timers and processes included) are waited
+ * for with epoll, and events by threads of the set that each block on up to
+ * 127 of them at once with futex_waitv() (Linux 5.16).
+ */
+class WaitSet
+{
+public:
+  using Id = uint64_t;
+
+  WaitSet();
+  WaitSet(const WaitSet&) = delete;
+  ~WaitSet();
+
+  Id Add(const Event& ev);
+  Id Add(const Process& process);
+  Id Add(const Timer& timer);
+#ifdef _WIN32
+  Id Add(void* handle);
+#else
+  Id Add(int fd);
+#endif // _WIN32
+  bool Rearm(Id id);
+  bool Remove(Id id);
+
+  size_t Size() const;
+
+  bool Wait(std::vector<Id>& ready);
+  bool WaitFor(std::vector<Id>& ready, std::chrono::milliseconds timeout);
+
+  WaitSet& operator=(const WaitSet&) = delete;
+
+  Impl::WaitSetPriv* GetImpl() const;
+
+private:
+  std::unique_ptr<Impl::WaitSetPriv> d;
+};
+
+} // namespace Win32
+
+#endif // WINAPI_WAITSET_H
\ No newline at end of file
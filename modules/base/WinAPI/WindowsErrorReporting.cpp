@@ -6,6 +6,8 @@
 
 #include "ErrorCode.h"
 #include "Registry.h"
+#include "RegistryBatch.h"
+#include "RegistryKeyCache.h"
 
 namespace Win32
 {
@@ -15,13 +17,16 @@ namespace Win32
  * 
  * Local dumps are an opt-in functionnality of the Windows Error Reporting system,
  * so by default this function returns false.
+ * 
+ * The key of the application is kept open in RegistryKeyCache::Global().
  */
 bool WindowsErrorReporting::IsEnabled(const std::string& exename)
 {
   RegistryKey rk;
-  ErrorCode err = rk.TryOpen(Registry::HKEY_LOCAL_MACHINE,
+  ErrorCode err = RegistryKeyCache::Global().TryOpenKey(Registry::HKEY_LOCAL_MACHINE,
     "SOFTWARE\\Microsoft\\Windows\\Windows Error Reporting\\LocalDumps\\" + exename,
-    Registry::Read);
+    Registry::Read,
+    rk);
   return !err;
 }
 
@@ -30,8 +35,9 @@ bool WindowsErrorReporting::IsEnabled(const std::string& exename)
 */
 void WindowsErrorReporting::Disable(const std::string& exename)
 {
-  Registry::DeleteKey(Registry::HKEY_LOCAL_MACHINE,
-    "SOFTWARE\\Microsoft\\Windows\\Windows Error Reporting\\LocalDumps\\" + exename);
+  const std::string subkey = "SOFTWARE\\Microsoft\\Windows\\Windows Error Reporting\\LocalDumps\\" + exename;
+  Registry::DeleteKey(Registry::HKEY_LOCAL_MACHINE, subkey);
+  RegistryKeyCache::Global().Invalidate(Registry::HKEY_LOCAL_MACHINE, subkey);
 }
 
 /**
@@ -50,16 +56,19 @@ void WindowsErrorReporting::Enable(const std::string& exename)
  * \param dumpFolder  folder in which the dumps should be written
  * \param dumpType    type of the dumps
  * \param dumpCount   maximum number of dumps that should be kept on disk
+ * 
+ * The key and its values are written in a single transaction (see RegistryBatch).
  */
 void WindowsErrorReporting::Enable(const std::string& exename, const std::string& dumpFolder, DumpType dumpType, int dumpCount)
 {
-  RegistryKey rk = Registry::CreateKey(Registry::HKEY_LOCAL_MACHINE,
-    "SOFTWARE\\Microsoft\\Windows\\Windows Error Reporting\\LocalDumps\\" + exename,
-    Registry::Write);
+  const std::string subkey = "SOFTWARE\\Microsoft\\Windows\\Windows Error Reporting\\LocalDumps\\" + exename;
 
-  rk.SetValue("DumpFolder", dumpFolder);
-  rk.SetValue("DumpType", static_cast<int>(dumpType));
-  rk.SetValue("DumpCount", dumpCount);
+  RegistryBatch batch;
+  batch.CreateKey(subkey);
+  batch.SetValue(subkey, "DumpFolder", dumpFolder);
+  batch.SetValue(subkey, "DumpType", static_cast<int>(dumpType));
+  batch.SetValue(subkey, "DumpCount", dumpCount);
+  batch.Commit(Registry::HKEY_LOCAL_MACHINE);
 }
 
 } // namespace Win32
\ No newline at end of file
@@ -0,0 +1,233 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_FILEMAPPINGPRIV_H
+#define WINAPI_FILEMAPPINGPRIV_H
+
+#include "ErrorCode.h"
+#include "winerror_priv.h"
+
+#ifdef _WIN32
+#include "String.h"
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// a file mapped in memory in its entirety, read-only
+struct MappedFile
+{
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#endif
+
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  ~MappedFile();
+
+  MappedFile& operator=(const MappedFile&) = delete;
+};
+
+inline MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+  if (data) {
+    ::UnmapViewOfFile(data);
+  }
+
+  if (mapping) {
+    ::CloseHandle(mapping);
+  }
+
+  if (file != INVALID_HANDLE_VALUE) {
+    ::CloseHandle(file);
+  }
+#else
+  if (data) {
+    ::munmap(const_cast<unsigned char*>(data), size);
+  }
+#endif
+}
+
+#ifndef _WIN32
+
+inline ErrorCode file_error_from_errno(int err, long default_error)
+{
+  if (err == ENOENT) {
+    return ErrorCode(ERROR_FILE_NOT_FOUND);
+  } else if (err == EACCES || err == EPERM) {
+    return ErrorCode(ERROR_ACCESS_DENIED);
+  } else {
+    return ErrorCode(default_error);
+  }
+}
+
+#endif // !_WIN32
+
+// maps a file in memory; an empty file is not mapped, data is then nullptr
+inline ErrorCode map_file(MappedFile& mapping, const std::string& path)
+{
+#ifdef _WIN32
+  constexpr LPSECURITY_ATTRIBUTES security_attributes = nullptr;
+  constexpr HANDLE template_file = nullptr;
+  mapping.file = ::CreateFileW(ToUtf16(path).c_str(), GENERIC_READ, FILE_SHARE_READ, security_attributes, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, template_file);
+
+  if (mapping.file == INVALID_HANDLE_VALUE) {
+    return GetLastError();
+  }
+
+  LARGE_INTEGER file_size;
+
+  if (!::GetFileSizeEx(mapping.file, &file_size)) {
+    return GetLastError();
+  }
+
+  if (static_cast<unsigned long long>(file_size.QuadPart) > SIZE_MAX) {
+    return ErrorCode(ERROR_NOT_ENOUGH_MEMORY);
+  }
+
+  if (file_size.QuadPart == 0) {
+    return ErrorCode();
+  }
+
+  // the size of the mapping is the size of the file
+  constexpr DWORD maximum_size_high = 0;
+  constexpr DWORD maximum_size_low = 0;
+  constexpr LPCWSTR name = nullptr;
+  mapping.mapping = ::CreateFileMappingW(mapping.file, security_attributes, PAGE_READONLY, maximum_size_high, maximum_size_low, name);
+
+  if (!mapping.mapping) {
+    return GetLastError();
+  }
+
+  constexpr DWORD offset_high = 0;
+  constexpr DWORD offset_low = 0;
+  constexpr SIZE_T whole_file = 0;
+  mapping.data = static_cast<const unsigned char*>(::MapViewOfFile(mapping.mapping, FILE_MAP_READ, offset_high, offset_low, whole_file));
+
+  if (!mapping.data) {
+    return GetLastError();
+  }
+
+  mapping.size = static_cast<size_t>(file_size.QuadPart);
+  return ErrorCode();
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    return file_error_from_errno(errno, ERROR_OPEN_FAILED);
+  }
+
+  struct stat st;
+
+  if (::fstat(fd, &st) != 0 || static_cast<unsigned long long>(st.st_size) > SIZE_MAX)
+  {
+    ::close(fd);
+    return ErrorCode(ERROR_OPEN_FAILED);
+  }
+
+  if (st.st_size == 0)
+  {
+    ::close(fd);
+    return ErrorCode();
+  }
+
+  // the mapping remains valid once the file is closed
+  void* view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (view == MAP_FAILED) {
+    return ErrorCode(ERROR_NOT_ENOUGH_MEMORY);
+  }
+
+  mapping.data = static_cast<const unsigned char*>(view);
+  mapping.size = static_cast<size_t>(st.st_size);
+  return ErrorCode();
+#endif
+}
+
+// creates or replaces a file
+inline ErrorCode write_file(const std::string& path, const void* data, size_t size)
+{
+  auto bytes = static_cast<const unsigned char*>(data);
+
+#ifdef _WIN32
+  constexpr DWORD share_mode = 0;
+  constexpr LPSECURITY_ATTRIBUTES security_attributes = nullptr;
+  constexpr HANDLE template_file = nullptr;
+  HANDLE file = ::CreateFileW(ToUtf16(path).c_str(), GENERIC_WRITE, share_mode, security_attributes, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, template_file);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    return GetLastError();
+  }
+
+  ErrorCode err;
+
+  while (size > 0 && !err)
+  {
+    DWORD written = 0;
+    const auto chunk = static_cast<DWORD>((std::min)(size, static_cast<size_t>(MAXDWORD)));
+
+    if (!::WriteFile(file, bytes, chunk, &written, nullptr)) {
+      err = GetLastError();
+    }
+
+    bytes += written;
+    size -= written;
+  }
+
+  ::CloseHandle(file);
+  return err;
+#else
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd < 0) {
+    return file_error_from_errno(errno, ERROR_OPEN_FAILED);
+  }
+
+  while (size > 0)
+  {
+    const ssize_t written = ::write(fd, bytes, size);
+
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (written <= 0)
+    {
+      ::close(fd);
+      return ErrorCode(ERROR_WRITE_FAULT);
+    }
+
+    bytes += written;
+    size -= static_cast<size_t>(written);
+  }
+
+  return ErrorCode(::close(fd) == 0 ? 0 : ERROR_WRITE_FAULT);
+#endif
+}
+
+} // namespace Impl
+
+} // namespace Win32
+
+#endif // WINAPI_FILEMAPPINGPRIV_H
\ No newline at end of file
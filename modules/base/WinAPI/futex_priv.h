@@ -0,0 +1,80 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_FUTEXPRIV_H
+#define WINAPI_FUTEXPRIV_H
+
+// futexes on words in shared memory, with which the synchronization objects
+// are implemented on Linux; the operations are not private as the words
+// are shared with other processes
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SYS_futex_waitv
+#define SYS_futex_waitv 449
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// a futex is a plain 32-bit word
+template<typename T>
+constexpr bool is_futex_word = sizeof(std::atomic<T>) == sizeof(uint32_t) && std::atomic<T>::is_always_lock_free;
+
+// blocks while the word is equal to expected, at most for the given time
+// unless infinite; returns on EINTR and spuriously, so the caller must
+// read the word again
+template<typename T>
+void futex_wait(std::atomic<T>& word, T expected, std::chrono::nanoseconds timeout, bool infinite)
+{
+  static_assert(is_futex_word<T>, "a futex must be a 32-bit word");
+
+  struct timespec relative_timeout = {};
+  relative_timeout.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+  relative_timeout.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+
+  ::syscall(SYS_futex, &word, FUTEX_WAIT, expected, infinite ? nullptr : &relative_timeout, nullptr, 0);
+}
+
+// wakes at most count threads blocked on the word, INT_MAX for all of them
+template<typename T>
+void futex_wake(std::atomic<T>& word, int count)
+{
+  static_assert(is_futex_word<T>, "a futex must be a 32-bit word");
+
+  ::syscall(SYS_futex, &word, FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+// blocks until one of the words is woken or is no longer equal to its
+// expected value (Linux 5.16); returns the index of the word that was woken,
+// or -1 with errno set (EAGAIN if a word was not equal to its value)
+inline long futex_wait_any(struct futex_waitv* words, unsigned int count)
+{
+  return ::syscall(SYS_futex_waitv, words, count, 0, nullptr, CLOCK_MONOTONIC);
+}
+
+// returns the time left before the deadline, or zero if it is reached
+inline std::chrono::nanoseconds futex_remaining(std::chrono::steady_clock::time_point deadline)
+{
+  const auto remaining = std::chrono::ceil<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+  return (std::max)(remaining, std::chrono::nanoseconds(0));
+}
+
+} // namespace Impl
+
+} // namespace Win32
+
+#endif // WINAPI_FUTEXPRIV_H
\ No newline at end of file
@@ -0,0 +1,101 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_JOBOBJECTPRIV_H
+#define WINAPI_JOBOBJECTPRIV_H
+
+#include "JobObject.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/types.h>
+#endif
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+struct JobObjectPriv
+{
+  HANDLE handle = nullptr;
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+  HANDLE completion_port = nullptr;
+  std::thread listener;
+  std::mutex callback_mutex;
+  JobObject::NotificationCallback callback;
+  // set when Close() is called by the callback
+  bool closed_by_listener = false;
+};
+
+#else
+
+// the limits applied to a process when it joins the job, as the resource
+// limits of Linux are per process
+struct JobLimits
+{
+  rlim_t process_memory = RLIM_INFINITY;
+  // in seconds
+  rlim_t process_time = RLIM_INFINITY;
+  rlim_t file_descriptors = RLIM_INFINITY;
+  bool kill_on_close = false;
+};
+
+// a process of the job, whose pidfd becomes readable when it exits
+struct JobProcess
+{
+  pid_t pid = -1;
+  int pidfd = -1;
+};
+
+// there is no job in the kernel: the job is the list of the processes
+// that were started in it or assigned to it, which is watched by the
+// listener with epoll
+struct JobObjectPriv
+{
+  JobLimits limits;
+  int active_process_limit = 0;
+  std::mutex mutex;
+  std::vector<JobProcess> processes;
+  // processes being started, which count against the active process limit
+  int starting = 0;
+  // notifications to be emitted by the listener, along with the exits
+  std::vector<JobObject::Notification> notifications;
+  int epoll_fd = -1;
+  // an eventfd that wakes up the listener
+  int wakeup_fd = -1;
+  bool stop = false;
+  std::thread listener;
+  std::mutex callback_mutex;
+  JobObject::NotificationCallback callback;
+  // set when Close() is called by the callback
+  bool closed_by_listener = false;
+
+  ~JobObjectPriv();
+};
+
+bool reserve_job_process(JobObjectPriv& job, JobLimits& limits);
+bool add_reserved_process(JobObjectPriv& job, pid_t pid, int pidfd);
+bool apply_job_limits(const JobLimits& limits, pid_t parent);
+
+#endif // _WIN32
+
+} // namespace Impl
+
+#ifdef _WIN32
+HANDLE GetHANDLE(const JobObject& job);
+#endif // _WIN32
+
+} // namespace Win32
+
+#endif // WINAPI_JOBOBJECTPRIV_H
\ No newline at end of file
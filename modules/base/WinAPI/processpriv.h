@@ -5,26 +5,125 @@
 #ifndef WINAPI_PROCESSPRIV_H
 #define WINAPI_PROCESSPRIV_H
 
-#include "processenvironment.h"
+#include "Process.h"
+#include "ProcessEnvironment.h"
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#endif
 
 #include <optional>
 #include <string>
+#include <utility>
 
 namespace Win32
 {
 
+class JobObject;
+
 namespace Impl
 {
+
+#ifdef _WIN32
+
 struct ProcessPriv
 {
   std::string executable_path;
   std::optional<ProcessEnvironment> environment;
+  JobObject* job = nullptr;
+  StdioRedirect stdin_redirect;
+  StdioRedirect stdout_redirect;
+  StdioRedirect stderr_redirect;
   HANDLE handle = {};
 };
+
+const std::wstring& executable_path();
+const std::wstring& executable_directory();
+
+#else
+
+// the exit code returned by GetExitCode() while the process is running,
+// as on Windows
+constexpr int still_active = 259;
+
+// a process is identified by its pid until it is reaped, and by a pidfd that
+// is readable once it has exited (Linux 5.3)
+struct ProcessPriv
+{
+  std::string executable_path;
+  std::optional<ProcessEnvironment> environment;
+  JobObject* job = nullptr;
+  StdioRedirect stdin_redirect;
+  StdioRedirect stdout_redirect;
+  StdioRedirect stderr_redirect;
+  pid_t pid = -1;
+  int pidfd = -1;
+  int exit_code = still_active;
+  bool reaped = false;
+
+  ProcessPriv() = default;
+  ProcessPriv(const ProcessPriv&) = delete;
+  ProcessPriv(ProcessPriv&& other) noexcept;
+  ~ProcessPriv();
+};
+
+inline ProcessPriv::ProcessPriv(ProcessPriv&& other) noexcept
+  : executable_path(std::move(other.executable_path)),
+    environment(std::move(other.environment)),
+    job(std::exchange(other.job, nullptr)),
+    stdin_redirect(std::move(other.stdin_redirect)),
+    stdout_redirect(std::move(other.stdout_redirect)),
+    stderr_redirect(std::move(other.stderr_redirect)),
+    pid(std::exchange(other.pid, -1)),
+    pidfd(std::exchange(other.pidfd, -1)),
+    exit_code(other.exit_code),
+    reaped(other.reaped)
+{
+
+}
+
+inline ProcessPriv::~ProcessPriv()
+{
+  if (pidfd != -1) {
+    ::close(pidfd);
+  }
+}
+
+// pidfds are not available before Linux 5.3
+inline int open_pidfd(pid_t pid)
+{
+  return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+}
+
+// unlike kill(), cannot signal another process that reused the pid
+inline bool signal_pidfd(int pidfd, int sig)
+{
+  return ::syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0) == 0;
+}
+
+const std::string& executable_path();
+const std::string& executable_directory();
+
+#endif // _WIN32
+
 } // namespace Impl
 
+#ifndef _WIN32
+int GetFileDescriptor(const Process& process);
+#endif // !_WIN32
+
 } // namespace Win32
 
 #endif // WINAPI_PROCESSPRIV_H
\ No newline at end of file
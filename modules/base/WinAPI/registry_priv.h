@@ -5,8 +5,14 @@
 #ifndef WINAPI_REGISTRYPRIV_H
 #define WINAPI_REGISTRYPRIV_H
 
-#include <Windows.h>
-#include <winreg.h>
+#include "RegistryBackend.h"
+#include "winerror_priv.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace Win32
 {
@@ -14,12 +20,110 @@ namespace Win32
 namespace Impl
 {
 
+// a handle shared by several keys (see RegistryKeyCache), closed with the last key
+struct registry_shared_key
+{
+  RegistryBackend* backend;
+  RegistryBackend::KeyHandle handle;
+  std::atomic<size_t> refs{ 1 };
+};
+
+void release_registry_shared_key(registry_shared_key* key);
+
 struct RegistryKeyPriv
 {
-  HKEY hkey = nullptr;
+  // nullptr for the predefined keys, which use Registry::GetBackend()
+  RegistryBackend* backend = nullptr;
+  RegistryBackend::KeyHandle handle = nullptr;
+  // non-null if the handle is shared
+  registry_shared_key* shared = nullptr;
+  RegistryBackend::PredefinedKey root = RegistryBackend::LocalMachine;
   bool predefined = false;
 };
 
+inline char registry_name_tolower(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// case-insensitive FNV-1a hash
+struct registry_name_hash
+{
+  size_t operator()(std::string_view name) const noexcept
+  {
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char c : name)
+    {
+      hash ^= static_cast<unsigned char>(registry_name_tolower(c));
+      hash *= 1099511628211ull;
+    }
+
+    return static_cast<size_t>(hash);
+  }
+};
+
+struct registry_name_equal
+{
+  bool operator()(std::string_view lhs, std::string_view rhs) const noexcept
+  {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+
+    for (size_t i(0); i < lhs.size(); ++i)
+    {
+      if (registry_name_tolower(lhs[i]) != registry_name_tolower(rhs[i])) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+RegistryBackend* get_registry_key_backend(const RegistryKey& key, RegistryBackend::KeyHandle& handle);
+
+ErrorCode query_registry_value(RegistryBackend& backend, RegistryBackend::KeyHandle key, const std::string& name, Registry::ValueType& type, std::vector<unsigned char>& buffer);
+void decode_registry_string(const void* data, size_t size, std::string& result);
+
+// size of the buffer on the stack used for reading values, 
+// most values are smaller than this
+constexpr size_t registry_stack_buffer_size = 256;
+
+// reads a value and calls f(type, data, size); values that fit in a buffer on the 
+// stack are read with a single call to the backend
+template<typename F>
+ErrorCode read_registry_value(RegistryBackend& backend, RegistryBackend::KeyHandle key, const std::string& name, F&& f)
+{
+  alignas(8) unsigned char stack_buffer[registry_stack_buffer_size];
+  Registry::ValueType type = Registry::None;
+  size_t size = sizeof(stack_buffer);
+
+  ErrorCode err = backend.GetValue(key, name, &type, stack_buffer, &size);
+
+  if (!err)
+  {
+    f(type, static_cast<const void*>(stack_buffer), size);
+    return err;
+  }
+
+  std::vector<unsigned char> heap_buffer;
+
+  // the value may grow between two calls
+  while (err.Value() == ERROR_MORE_DATA)
+  {
+    heap_buffer.resize(size);
+    err = backend.GetValue(key, name, &type, heap_buffer.data(), &size);
+  }
+
+  if (!err) {
+    f(type, static_cast<const void*>(heap_buffer.data()), size);
+  }
+
+  return err;
+}
+
 } // namespace Impl
 
 } // namespace Win32
@@ -0,0 +1,385 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_SHAREDMEMORYPRIV_H
+#define WINAPI_SHAREDMEMORYPRIV_H
+
+#include "Exception.h"
+
+#ifdef _WIN32
+#include "String.h"
+#include <Windows.h>
+#else
+#include "filemapping_priv.h"
+#include "winerror_priv.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+// a named file mapping backed by the paging file, mapped in its entirety
+struct SharedMemory
+{
+  HANDLE mapping = nullptr;
+  void* view = nullptr;
+  size_t size = 0;
+  bool created = false;
+
+  SharedMemory() = default;
+  SharedMemory(const SharedMemory&) = delete;
+  ~SharedMemory();
+
+  SharedMemory& operator=(const SharedMemory&) = delete;
+};
+
+inline SharedMemory::~SharedMemory()
+{
+  if (view) {
+    ::UnmapViewOfFile(view);
+  }
+
+  if (mapping) {
+    ::CloseHandle(mapping);
+  }
+}
+
+inline void map_shared_memory(SharedMemory& shm)
+{
+  constexpr DWORD offset_high = 0;
+  constexpr DWORD offset_low = 0;
+  constexpr SIZE_T whole_mapping = 0;
+  shm.view = ::MapViewOfFile(shm.mapping, FILE_MAP_READ | FILE_MAP_WRITE, offset_high, offset_low, whole_mapping);
+
+  if (!shm.view) {
+    throw Exception(GetLastError());
+  }
+
+  // the size of an opened mapping is not known, the size of the view is
+  // the size of the mapping rounded up to a multiple of the page size
+  MEMORY_BASIC_INFORMATION info;
+
+  if (::VirtualQuery(shm.view, &info, sizeof(info)) != sizeof(info)) {
+    throw Exception(GetLastError());
+  }
+
+  shm.size = info.RegionSize;
+}
+
+// creates or opens a file mapping; the memory of a new file mapping is zero-initialized
+inline void create_shared_memory(SharedMemory& shm, const std::string& name, uint64_t size, bool must_create)
+{
+  std::wstring wname = ToUtf16(name);
+
+  shm.mapping = ::CreateFileMappingW(
+    INVALID_HANDLE_VALUE,
+    nullptr,
+    PAGE_READWRITE,
+    static_cast<DWORD>(size >> 32),
+    static_cast<DWORD>(size & 0xFFFFFFFF),
+    wname.c_str());
+
+  if (!shm.mapping) {
+    throw Exception(GetLastError());
+  }
+
+  shm.created = ::GetLastError() != ERROR_ALREADY_EXISTS;
+
+  if (!shm.created && must_create) {
+    throw Exception(ErrorCode(ERROR_ALREADY_EXISTS));
+  }
+
+  map_shared_memory(shm);
+}
+
+inline void open_shared_memory(SharedMemory& shm, const std::string& name)
+{
+  std::wstring wname = ToUtf16(name);
+
+  constexpr bool inherit_handle = false;
+  shm.mapping = ::OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, inherit_handle, wname.c_str());
+
+  if (!shm.mapping) {
+    throw Exception(GetLastError());
+  }
+
+  map_shared_memory(shm);
+}
+
+#else
+
+// A named file mapping is a POSIX shared memory object, whose name is the
+// name of the mapping prefixed with "/WinAPI.".
+//
+// The processes that use the object are tracked with open file description
+// locks, which the system releases when a process terminates:
+// - a process holds a shared lock on the 'users' byte while the object is open;
+// - the 'init' byte is locked exclusively while a process opens or closes the object.
+// An object on which no process holds a lock was left by processes that
+// terminated, and is initialized again rather than opened; the last process
+// that closes the object removes it, as a Windows file mapping is destroyed
+// when its last handle is closed.
+
+constexpr off_t shared_memory_init_lock = 0;
+constexpr off_t shared_memory_users_lock = 1;
+
+inline std::string get_shared_memory_object_name(const std::string& name)
+{
+  // the name of a shared memory object starts with a slash and
+  // cannot contain another one
+  std::string result = "/WinAPI.";
+
+  for (char c : name) {
+    result.push_back(c == '/' ? '\\' : c);
+  }
+
+  return result;
+}
+
+inline bool lock_shared_memory_byte(int fd, off_t byte, short type, bool wait)
+{
+  struct flock lock = {};
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = byte;
+  lock.l_len = 1;
+
+  while (::fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &lock) == -1)
+  {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// returns whether the name still refers to the shared memory object
+inline bool is_shared_memory_linked(int fd, const std::string& object_name)
+{
+  struct stat opened;
+  struct stat current;
+  const int current_fd = ::shm_open(object_name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+
+  if (current_fd == -1) {
+    return false;
+  }
+
+  const bool same = ::fstat(fd, &opened) == 0 && ::fstat(current_fd, &current) == 0
+    && opened.st_dev == current.st_dev && opened.st_ino == current.st_ino;
+  ::close(current_fd);
+  return same;
+}
+
+// opens a shared memory object and locks its init byte; returns -1 and sets
+// err on failure
+inline int open_shared_memory_object(const std::string& object_name, bool create, ErrorCode& err)
+{
+  for (;;)
+  {
+    const int fd = ::shm_open(object_name.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0666);
+
+    if (fd == -1)
+    {
+      err = (errno == ENAMETOOLONG || errno == EINVAL) ? ErrorCode(ERROR_INVALID_NAME) : file_error_from_errno(errno, ERROR_OPEN_FAILED);
+      return -1;
+    }
+
+    if (!lock_shared_memory_byte(fd, shared_memory_init_lock, F_WRLCK, true))
+    {
+      ::close(fd);
+      err = ErrorCode(ERROR_LOCK_FAILED);
+      return -1;
+    }
+
+    // the last process that used the object may have removed it before
+    // it was locked, in which case another one must be opened
+    if (is_shared_memory_linked(fd, object_name)) {
+      return fd;
+    }
+
+    ::close(fd);
+  }
+}
+
+// removes the object if no other process uses it, the init byte must be locked
+inline void release_shared_memory_object(int fd, const std::string& object_name)
+{
+  if (lock_shared_memory_byte(fd, shared_memory_users_lock, F_WRLCK, false)) {
+    ::shm_unlink(object_name.c_str());
+  }
+
+  // releases the locks
+  ::close(fd);
+}
+
+// a named shared memory object, mapped in its entirety
+struct SharedMemory
+{
+  int fd = -1;
+  std::string object_name;
+  void* view = nullptr;
+  size_t size = 0;
+  bool created = false;
+
+  SharedMemory() = default;
+  SharedMemory(const SharedMemory&) = delete;
+  ~SharedMemory();
+
+  SharedMemory& operator=(const SharedMemory&) = delete;
+};
+
+inline SharedMemory::~SharedMemory()
+{
+  if (view) {
+    ::munmap(view, size);
+  }
+
+  if (fd != -1)
+  {
+    lock_shared_memory_byte(fd, shared_memory_init_lock, F_WRLCK, true);
+    release_shared_memory_object(fd, object_name);
+  }
+}
+
+// maps the object and registers this process as one of its users; the init
+// byte of the object must be locked, it is unlocked on success
+inline void map_shared_memory(SharedMemory& shm, int fd)
+{
+  struct stat st;
+
+  if (::fstat(fd, &st) == -1)
+  {
+    const int error = errno;
+    release_shared_memory_object(fd, shm.object_name);
+    throw Exception(file_error_from_errno(error, ERROR_OPEN_FAILED));
+  }
+
+  void* view = st.st_size > 0 ? ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+  if (view == MAP_FAILED)
+  {
+    release_shared_memory_object(fd, shm.object_name);
+    throw Exception(ErrorCode(st.st_size > 0 ? ERROR_NOT_ENOUGH_MEMORY : ERROR_INVALID_HANDLE));
+  }
+
+  // this converts the exclusive lock taken if the object was created
+  lock_shared_memory_byte(fd, shared_memory_users_lock, F_RDLCK, false);
+  lock_shared_memory_byte(fd, shared_memory_init_lock, F_UNLCK, false);
+
+  shm.fd = fd;
+  shm.view = view;
+  shm.size = static_cast<size_t>(st.st_size);
+}
+
+// creates or opens a shared memory object; the memory of a new object is zero-initialized
+inline void create_shared_memory(SharedMemory& shm, const std::string& name, uint64_t size, bool must_create)
+{
+  if (name.empty())
+  {
+    // an unnamed mapping can only be shared with child processes
+    shm.view = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (shm.view == MAP_FAILED)
+    {
+      shm.view = nullptr;
+      throw Exception(ErrorCode(ERROR_NOT_ENOUGH_MEMORY));
+    }
+
+    shm.size = static_cast<size_t>(size);
+    shm.created = true;
+    return;
+  }
+
+  shm.object_name = get_shared_memory_object_name(name);
+
+  constexpr bool create = true;
+  ErrorCode err;
+  const int fd = open_shared_memory_object(shm.object_name, create, err);
+
+  if (fd == -1) {
+    throw Exception(err);
+  }
+
+  if (lock_shared_memory_byte(fd, shared_memory_users_lock, F_WRLCK, false))
+  {
+    // truncating to 0 first clears the content left by terminated processes
+    if (::ftruncate(fd, 0) == -1 || ::ftruncate(fd, static_cast<off_t>(size)) == -1)
+    {
+      const int error = errno;
+      ::shm_unlink(shm.object_name.c_str());
+      ::close(fd);
+      throw Exception(file_error_from_errno(error, ERROR_NOT_ENOUGH_MEMORY));
+    }
+
+    shm.created = true;
+  }
+  else if (must_create)
+  {
+    ::close(fd);
+    throw Exception(ErrorCode(ERROR_ALREADY_EXISTS));
+  }
+
+  map_shared_memory(shm, fd);
+}
+
+inline void open_shared_memory(SharedMemory& shm, const std::string& name)
+{
+  if (name.empty()) {
+    throw Exception(ErrorCode(ERROR_INVALID_PARAMETER));
+  }
+
+  shm.object_name = get_shared_memory_object_name(name);
+
+  constexpr bool create = false;
+  ErrorCode err;
+  const int fd = open_shared_memory_object(shm.object_name, create, err);
+
+  if (fd == -1) {
+    throw Exception(err);
+  }
+
+  // an object that is not used by any process does not exist on Windows
+  if (lock_shared_memory_byte(fd, shared_memory_users_lock, F_WRLCK, false))
+  {
+    ::shm_unlink(shm.object_name.c_str());
+    ::close(fd);
+    throw Exception(ErrorCode(ERROR_FILE_NOT_FOUND));
+  }
+
+  map_shared_memory(shm, fd);
+}
+
+#endif // _WIN32
+
+// waits for the creator of a file mapping to store a magic value
+// once the mapping is initialized
+inline void wait_shared_memory_initialized(const std::atomic<uint32_t>& magic, uint32_t value)
+{
+  for (int i(0); magic.load(std::memory_order_acquire) != value; ++i)
+  {
+    if (i == 1000) {
+      throw Exception(ErrorCode(ERROR_TIMEOUT));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+} // namespace Impl
+
+} // namespace Win32
+
+#endif // WINAPI_SHAREDMEMORYPRIV_H
\ No newline at end of file
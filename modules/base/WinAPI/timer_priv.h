@@ -0,0 +1,87 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_TIMERPRIV_H
+#define WINAPI_TIMERPRIV_H
+
+#include "Timer.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+struct TimerPriv
+{
+  HANDLE handle = nullptr;
+
+  TimerPriv() = default;
+  TimerPriv(const TimerPriv&) = delete;
+  TimerPriv(TimerPriv&& other) noexcept;
+  ~TimerPriv();
+};
+
+inline TimerPriv::TimerPriv(TimerPriv&& other) noexcept
+  : handle(std::exchange(other.handle, nullptr))
+{
+
+}
+
+inline TimerPriv::~TimerPriv()
+{
+  if (handle) {
+    ::CloseHandle(handle);
+  }
+}
+
+#else
+
+// a timerfd, which is readable while the timer is signaled
+struct TimerPriv
+{
+  int fd = -1;
+
+  TimerPriv() = default;
+  TimerPriv(const TimerPriv&) = delete;
+  TimerPriv(TimerPriv&& other) noexcept;
+  ~TimerPriv();
+};
+
+inline TimerPriv::TimerPriv(TimerPriv&& other) noexcept
+  : fd(std::exchange(other.fd, -1))
+{
+
+}
+
+inline TimerPriv::~TimerPriv()
+{
+  if (fd != -1) {
+    ::close(fd);
+  }
+}
+
+#endif // _WIN32
+
+} // namespace Impl
+
+#ifdef _WIN32
+HANDLE GetHANDLE(const Timer& timer);
+#else
+int GetFileDescriptor(const Timer& timer);
+#endif // _WIN32
+
+} // namespace Win32
+
+#endif // WINAPI_TIMERPRIV_H
\ No newline at end of file
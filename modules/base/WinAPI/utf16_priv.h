@@ -0,0 +1,182 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_UTF16PRIV_H
+#define WINAPI_UTF16PRIV_H
+
+#include <cstddef>
+#include <string>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+// Conversions between UTF-8 and UTF-16 that do not depend on the Windows API,
+// used for the values of the registry backends.
+// Invalid sequences are replaced by U+FFFD.
+
+constexpr char32_t utf_replacement_char = 0xFFFD;
+
+inline void append_utf16(std::u16string& out, char32_t c)
+{
+  if (c < 0x10000)
+  {
+    out.push_back(static_cast<char16_t>(c));
+  }
+  else
+  {
+    c -= 0x10000;
+    out.push_back(static_cast<char16_t>(0xD800 + (c >> 10)));
+    out.push_back(static_cast<char16_t>(0xDC00 + (c & 0x3FF)));
+  }
+}
+
+inline void append_utf8(std::string& out, char32_t c)
+{
+  if (c < 0x80)
+  {
+    out.push_back(static_cast<char>(c));
+  }
+  else if (c < 0x800)
+  {
+    out.push_back(static_cast<char>(0xC0 | (c >> 6)));
+    out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+  }
+  else if (c < 0x10000)
+  {
+    out.push_back(static_cast<char>(0xE0 | (c >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+  }
+  else
+  {
+    out.push_back(static_cast<char>(0xF0 | (c >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+  }
+}
+
+inline std::u16string utf8_to_utf16(const char* str, size_t size)
+{
+  std::u16string result;
+  result.reserve(size);
+
+  const auto* it = reinterpret_cast<const unsigned char*>(str);
+  const auto* end = it + size;
+
+  while (it != end)
+  {
+    const unsigned char lead = *it++;
+
+    if (lead < 0x80)
+    {
+      result.push_back(lead);
+      continue;
+    }
+
+    int length = 0;
+    char32_t c = 0;
+    char32_t min = 0;
+
+    if ((lead & 0xE0) == 0xC0)
+    {
+      length = 1;
+      c = lead & 0x1F;
+      min = 0x80;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+      length = 2;
+      c = lead & 0x0F;
+      min = 0x800;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+      length = 3;
+      c = lead & 0x07;
+      min = 0x10000;
+    }
+    else
+    {
+      append_utf16(result, utf_replacement_char);
+      continue;
+    }
+
+    int i = 0;
+
+    for (; i < length && it != end && (*it & 0xC0) == 0x80; ++i, ++it) {
+      c = (c << 6) | (*it & 0x3F);
+    }
+
+    const bool valid = i == length && c >= min && c <= 0x10FFFF && (c < 0xD800 || c > 0xDFFF);
+    append_utf16(result, valid ? c : utf_replacement_char);
+  }
+
+  return result;
+}
+
+inline std::u16string utf8_to_utf16(const std::string& str)
+{
+  return utf8_to_utf16(str.data(), str.size());
+}
+
+// appends the UTF-8 encoding of a UTF-16 string whose i-th code unit is unit(i)
+template<typename F>
+void append_utf16_as_utf8(std::string& out, size_t size, F&& unit)
+{
+  for (size_t i(0); i < size; ++i)
+  {
+    const char16_t c = unit(i);
+
+    if (c < 0xD800 || c > 0xDFFF)
+    {
+      append_utf8(out, c);
+    }
+    else if (c < 0xDC00 && i + 1 < size && unit(i + 1) >= 0xDC00 && unit(i + 1) <= 0xDFFF)
+    {
+      append_utf8(out, 0x10000 + ((char32_t(c) - 0xD800) << 10) + (char32_t(unit(i + 1)) - 0xDC00));
+      ++i;
+    }
+    else
+    {
+      append_utf8(out, utf_replacement_char);
+    }
+  }
+}
+
+inline std::string utf16_to_utf8(const char16_t* str, size_t size)
+{
+  std::string result;
+  result.reserve(size);
+  append_utf16_as_utf8(result, size, [str](size_t i) { return str[i]; });
+  return result;
+}
+
+// appends a little-endian UTF-16 string stored in a byte buffer,
+// e.g. a registry value; a trailing odd byte is ignored
+inline void append_utf16le_as_utf8(std::string& out, const void* data, size_t size)
+{
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  out.reserve(out.size() + size / 2);
+
+  append_utf16_as_utf8(out, size / 2, [bytes](size_t i) {
+    return static_cast<char16_t>(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+  });
+}
+
+inline std::string utf16le_to_utf8(const void* data, size_t size)
+{
+  std::string result;
+  append_utf16le_as_utf8(result, data, size);
+  return result;
+}
+
+} // namespace Impl
+
+} // namespace Win32
+
+#endif // WINAPI_UTF16PRIV_H
\ No newline at end of file
@@ -0,0 +1,127 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_WAITSETPRIV_H
+#define WINAPI_WAITSETPRIV_H
+
+#include "WaitSet.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <linux/futex.h>
+
+#include <atomic>
+#include <thread>
+#endif
+
+#include <deque>
+#include <mutex>
+
+namespace Win32
+{
+
+namespace Impl
+{
+
+#ifdef _WIN32
+
+struct WaitSetPriv;
+
+// a registration; slots are reused once their object is removed from the set,
+// together with their thread pool wait
+struct WaitSlot
+{
+  WaitSetPriv* owner = nullptr;
+  uint32_t index = 0;
+  uint32_t generation = 1;
+  PTP_WAIT wait = nullptr;
+  HANDLE handle = nullptr;
+  bool active = false;
+  bool armed = false;
+};
+
+struct WaitSetPriv
+{
+  std::mutex mutex;
+  // a deque so that the slots, which are the context of the thread pool
+  // callbacks, never move
+  std::deque<WaitSlot> slots;
+  std::vector<uint32_t> free_slots;
+  std::vector<WaitSet::Id> ready;
+  size_t size = 0;
+  // auto-reset event, set when the ready list becomes non-empty
+  HANDLE ready_event = nullptr;
+};
+
+#else
+
+struct event_header;
+
+enum class WaitSource
+{
+  FileDescriptor,
+  Timer,
+  Event,
+};
+
+// a registration; file descriptors are in the epoll instance of the set
+// with their id as data, events are watched by a thread of the set
+struct WaitSlot
+{
+  uint32_t index = 0;
+  uint32_t generation = 1;
+  WaitSource source = WaitSource::FileDescriptor;
+  int fd = -1;
+  event_header* event = nullptr;
+  uint32_t watcher = 0;
+  // the state word of the event when the watcher last blocked on it
+  uint32_t expected = 0;
+  bool blocked = false;
+  bool active = false;
+  bool armed = false;
+};
+
+// a thread that blocks on the state words of up to event_watcher_capacity
+// events at once with futex_waitv(), events cannot be added to epoll
+struct EventWatcher
+{
+  std::thread thread;
+  // incremented to interrupt the thread when its events change
+  std::atomic<uint32_t> control{ 0 };
+  std::vector<uint32_t> slots;
+  bool stop = false;
+};
+
+// the first word waited for by a watcher is its control word
+constexpr size_t event_watcher_capacity = FUTEX_WAITV_MAX - 1;
+
+struct WaitSetPriv
+{
+  std::mutex mutex;
+  std::deque<WaitSlot> slots;
+  std::vector<uint32_t> free_slots;
+  std::vector<WaitSet::Id> ready;
+  size_t size = 0;
+  int epoll_fd = -1;
+  // eventfd in the epoll instance, written by the watchers when the ready
+  // list becomes non-empty
+  int ready_fd = -1;
+  // a deque so that the watchers, which are used by their threads, never move
+  std::deque<EventWatcher> watchers;
+};
+
+#endif // _WIN32
+
+} // namespace Impl
+
+#ifdef _WIN32
+HANDLE GetHANDLE(const WaitSet& waitSet);
+#else
+int GetFileDescriptor(const WaitSet& waitSet);
+#endif // _WIN32
+
+} // namespace Win32
+
+#endif // WINAPI_WAITSETPRIV_H
\ No newline at end of file
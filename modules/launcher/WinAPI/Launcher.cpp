@@ -8,13 +8,22 @@
 
 #include "WinAPI/Event.h"
 #include "WinAPI/EventImpl.h"
+#include "WinAPI/ExecutableResolver.h"
+#include "WinAPI/JobObject.h"
 #include "WinAPI/ProcessEnvironment.h"
 #include "WinAPI/Process.h"
 #include "WinAPI/processpriv.h"
+#include "WinAPI/ProcessSnapshot.h"
+#include "WinAPI/String.h"
+#include "WinAPI/Timer.h"
+#include "WinAPI/WaitSet.h"
+#include "WinAPI/waitset_priv.h"
 
 #include <Windows.h>
 #include <shlwapi.h>
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <numeric>
 #include <optional>
@@ -39,6 +48,43 @@ std::string compute_close_event_name(const std::string& appname, bool single_ins
   return ev_name;
 }
 
+// checks whether a process is running the executable, 
+// including instances that were not started by a launcher
+bool is_running(const std::string& exePath)
+{
+  ProcessSnapshot snapshot;
+
+  try
+  {
+    snapshot.Refresh();
+  }
+  catch (const std::exception&)
+  {
+    return false;
+  }
+
+  const std::string exename = std::filesystem::u8path(exePath).filename().u8string();
+  const std::wstring wexePath = ToUtf16(exePath);
+
+  for (const ProcessInfo* info : snapshot.FindByExecutableName(exename))
+  {
+    constexpr bool ignore_case = true;
+    std::wstring path = ToUtf16(info->executablePath);
+
+    if (::CompareStringOrdinal(path.c_str(), -1, wexePath.c_str(), -1, ignore_case) == CSTR_EQUAL) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+struct PeriodicCallback
+{
+  std::chrono::milliseconds period;
+  std::function<void()> callback;
+};
+
 struct LauncherPriv
 {
   std::string appname;
@@ -47,6 +93,9 @@ struct LauncherPriv
   std::string executable_path;
   bool single_instance = false;
   Event single_instance_event;
+  JobObject* job = nullptr;
+  std::chrono::milliseconds splash_timeout{ 0 };
+  std::vector<PeriodicCallback> periodic_callbacks;
   int app_exit_code = 0;
 };
 
@@ -78,7 +127,9 @@ Launcher::~Launcher()
  * \brief sets the name of the executable
  * \param exeName  the name of the executable (without the extension)
  * 
- * The executable must be in the same directory as the executable of the current process.
+ * The executable is searched in the directory of the executable of the current process,
+ * then in the "App Paths" registry keys and in the directories listed in the PATH 
+ * environment variable (see ExecutableResolver).
  * 
  * Alternatively, you may specify a full path using SetExecutablePath().
  */
@@ -104,6 +155,48 @@ void Launcher::PreventMultipleInstances()
   d->single_instance = true;
 }
 
+/**
+ * \brief sets the job object in which the application is run
+ * \param job  the job object (can be nullptr)
+ * 
+ * This can be used to limit the resources used by the application, or to make
+ * sure that the application does not outlive the launcher (see JobObject::SetKillOnClose()).
+ * 
+ * The job object must outlive the call to Run().
+ */
+void Launcher::SetJobObject(JobObject* job)
+{
+  d->job = job;
+}
+
+/**
+ * \brief closes the splashscreen after a given time
+ * \param timeout  the maximum display time of the splashscreen, 0 for no limit
+ * 
+ * By default, the splashscreen is shown until the application requests
+ * it to be hidden, which may never happen (e.g., if the application fails 
+ * to start properly).
+ */
+void Launcher::SetSplashScreenTimeout(std::chrono::milliseconds timeout)
+{
+  d->splash_timeout = timeout;
+}
+
+/**
+ * \brief calls a function periodically while the application is running
+ * \param period    the period
+ * \param callback  the function
+ * 
+ * The function is called by the thread running Run(), between the processing
+ * of window messages, so it can be used to update the splashscreen or to 
+ * monitor the application without creating a thread.
+ * If the function takes longer than \a period, the missed calls are skipped.
+ */
+void Launcher::AddPeriodicCallback(std::chrono::milliseconds period, std::function<void()> callback)
+{
+  d->periodic_callbacks.push_back({ period, std::move(callback) });
+}
+
 /**
  * \brief runs the application and wait for it to be finished
  * 
@@ -112,16 +205,34 @@ void Launcher::PreventMultipleInstances()
  * 
  * If PreventMultipleInstances() was called, and an instance of the application 
  * is already running, this function does not start a new instance and returns immediately.
+ * Instances that were started without the launcher are also detected.
  */
 void Launcher::Run()
 {
-  std::vector<HANDLE> handles;
+  std::string exe_path = d->executable_path;
+
+  if (exe_path.empty()) {
+    if (!d->executable_name.empty()) {
+      exe_path = d->executable_name + ".exe";
+    } else {
+      exe_path = d->appname + ".exe";
+    }
+
+    std::string resolved_path = ExecutableResolver::Resolve(exe_path);
+
+    if (!resolved_path.empty()) {
+      exe_path = std::move(resolved_path);
+    } else {
+      auto myfolder = std::filesystem::path(Process::GetExecutablePath()).parent_path();
+      exe_path = (myfolder / std::filesystem::path(exe_path)).u8string();
+    }
+  }
 
   if (d->single_instance)
   {
     d->single_instance_event = Event{ d->appname + "InstanceRunning" };
 
-    if (!d->single_instance_event.Created()) {
+    if (!d->single_instance_event.Created() || Impl::is_running(exe_path)) {
       std::cout << "app already running, exiting..." << std::endl;
       return;
     }
@@ -133,7 +244,6 @@ void Launcher::Run()
 
     if (d->ss->CreateCloseEvent(closeEventName)) {
       d->ss->Show();
-      handles.push_back(GetHANDLE(d->ss->GetCloseEvent()));
     }
     else {
       // event creation failed for some reasons...
@@ -141,21 +251,9 @@ void Launcher::Run()
     }
   }
 
-  std::string exe_path = d->executable_path;
-
-  if (exe_path.empty()) {
-    if (!d->executable_name.empty()) {
-      exe_path = d->executable_name + ".exe";
-    } else {
-      exe_path = d->appname + ".exe";
-    }
-
-    auto myfolder = std::filesystem::path(Process::GetExecutablePath()).parent_path();
-    exe_path = (myfolder / std::filesystem::path(exe_path)).u8string();
-  }
-
   Process p;
   p.SetExecutablePath(exe_path);
+  p.SetJobObject(d->job);
 
   if (d->ss && !d->single_instance) {
     auto penv = ProcessEnvironment::GetSystemEnvironment();
@@ -170,15 +268,50 @@ void Launcher::Run()
   }
 
   AllowSetForegroundWindow(GetProcessId(p.GetImpl()->handle));
-  handles.push_back(p.GetImpl()->handle);
+
+  // the timers must outlive the wait set
+  std::optional<Timer> splash_timer;
+  std::vector<Timer> periodic_timers;
+
+  // the process, the close event and the timers are waited for by the thread pool, 
+  // the message loop only waits for the wait set to report them
+  WaitSet waitset;
+  const WaitSet::Id process_id = waitset.Add(p);
+  WaitSet::Id close_event_id = 0;
+  WaitSet::Id splash_timer_id = 0;
+  std::vector<WaitSet::Id> periodic_timer_ids;
+
+  if (d->ss && !d->ss->GetImpl()->close_event.IsNull())
+  {
+    close_event_id = waitset.Add(d->ss->GetCloseEvent());
+
+    if (d->splash_timeout.count() > 0)
+    {
+      splash_timer.emplace();
+      splash_timer->Start(d->splash_timeout);
+      splash_timer_id = waitset.Add(*splash_timer);
+    }
+  }
+
+  periodic_timers.reserve(d->periodic_callbacks.size());
+
+  for (const Impl::PeriodicCallback& pc : d->periodic_callbacks)
+  {
+    periodic_timers.emplace_back();
+    periodic_timers.back().Start(pc.period, pc.period);
+    periodic_timer_ids.push_back(waitset.Add(periodic_timers.back()));
+  }
+
+  HANDLE ready_event = GetHANDLE(waitset);
+  std::vector<WaitSet::Id> ready;
 
   for (;;)
   {
     constexpr DWORD timeout = INFINITE;
     constexpr bool wait_all = false;
     DWORD wait_result = ::MsgWaitForMultipleObjects(
-      static_cast<DWORD>(handles.size()), 
-      handles.data(), 
+      1, 
+      &ready_event, 
       wait_all, 
       timeout, 
       QS_ALLINPUT);
@@ -187,42 +320,48 @@ void Launcher::Run()
     {
       std::cout << "wait failed " << GetLastError() << std::endl;
     }
-    else
+    else if (wait_result == WAIT_OBJECT_0 + 1)
     {
-      if (wait_result == WAIT_OBJECT_0 + handles.size())
+      MSG msg;
+      while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) != FALSE)
       {
-        MSG msg;
-        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) != FALSE)
+        if (msg.message == WM_QUIT)
         {
-          if (msg.message == WM_QUIT)
-          {
-            PostQuitMessage((int)msg.wParam);
-            return;
-          }
-
-          TranslateMessage(&msg);
-          DispatchMessage(&msg);
+          PostQuitMessage((int)msg.wParam);
+          return;
         }
+
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
       }
-      else
+    }
+    else if (waitset.WaitFor(ready, std::chrono::milliseconds(0)))
+    {
+      for (WaitSet::Id id : ready)
       {
-        size_t handle_index = wait_result - WAIT_OBJECT_0;
-        
-        if (handle_index < handles.size())
+        if (id == process_id)
+        {
+          // process has exited, return
+          d->app_exit_code = p.GetExitCode();
+          return;
+        }
+        else if (id == close_event_id || id == splash_timer_id)
+        {
+          // received request to close splash screen, or the splash screen timed out
+          d->ss->Close();
+          waitset.Remove(close_event_id);
+          waitset.Remove(splash_timer_id);
+          close_event_id = 0;
+          splash_timer_id = 0;
+        }
+        else
         {
-          HANDLE h = handles.at(handle_index);
+          auto it = std::find(periodic_timer_ids.begin(), periodic_timer_ids.end(), id);
 
-          if (h == p.GetImpl()->handle)
-          {
-            // process has exited, return
-            d->app_exit_code = p.GetExitCode();
-            return;
-          }
-          else if (d->ss && !d->ss->GetImpl()->close_event.IsNull())
+          if (it != periodic_timer_ids.end())
           {
-            // received request to close splash screen
-            d->ss->Close();
-            handles.erase(handles.begin() + handle_index);
+            d->periodic_callbacks.at(it - periodic_timer_ids.begin()).callback();
+            waitset.Rearm(id);
           }
         }
       }
@@ -5,12 +5,15 @@
 #ifndef WINAPI_LAUNCHER_H
 #define WINAPI_LAUNCHER_H
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 
 namespace Win32
 {
 
+class JobObject;
 class SplashScreen;
 
 namespace Impl
@@ -35,6 +38,11 @@ public:
 
   void PreventMultipleInstances();
 
+  void SetJobObject(JobObject* job);
+
+  void SetSplashScreenTimeout(std::chrono::milliseconds timeout);
+  void AddPeriodicCallback(std::chrono::milliseconds period, std::function<void()> callback);
+
   void Run();
 
   int GetApplicationExitCode() const;
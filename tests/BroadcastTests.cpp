@@ -0,0 +1,194 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Broadcast.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_already_exists = 183;
+
+// broadcasts are shared by all the processes, the names used by the tests
+// must not collide with those of another instance of the tests
+std::string broadcast_name(const std::string& name)
+{
+#ifdef _WIN32
+  const unsigned long pid = ::GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(::getpid());
+#endif
+  return "WinAPI.Tests." + std::to_string(pid) + "." + name;
+}
+
+void create_and_open()
+{
+  const std::string name = broadcast_name("CreateAndOpen");
+
+  CHECK(Testing::ErrorThrownBy([&]() { Broadcast::Open(name); }) == error_file_not_found);
+
+  Broadcast created = Broadcast::Create(name);
+  CHECK(created.Created());
+  CHECK(created.GetName() == name);
+  CHECK(created.GetGeneration() == 0);
+  CHECK(Testing::ErrorThrownBy([&]() { Broadcast::Create(name); }) == error_already_exists);
+
+  Broadcast opened = Broadcast::Open(name);
+  CHECK(!opened.Created());
+  Broadcast other{ name };
+  CHECK(!other.Created());
+
+  // the generation is shared
+  uint64_t generation = opened.GetGeneration();
+  CHECK(!opened.Poll(generation));
+  CHECK(created.Publish() == 1);
+  CHECK(created.Publish() == 2);
+  CHECK(opened.Poll(generation) && generation == 2);
+  CHECK(!other.Poll(generation));
+
+  Broadcast null;
+  CHECK(null.IsNull());
+  CHECK(null.Publish() == 0);
+  CHECK(!null.Wait(generation));
+}
+
+void wait_for()
+{
+  Broadcast broadcast = Broadcast::Create(broadcast_name("WaitFor"));
+  uint64_t generation = 0;
+
+  // nothing was published
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(!broadcast.WaitFor(generation, std::chrono::milliseconds(50)));
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+  CHECK(!broadcast.WaitFor(generation, std::chrono::milliseconds(-1)));
+  CHECK(generation == 0);
+
+  // a notification published while the subscriber was busy is not missed,
+  // and several of them are coalesced into one
+  broadcast.Publish();
+  broadcast.Publish();
+  CHECK(broadcast.WaitFor(generation, std::chrono::milliseconds(0)) && generation == 2);
+  CHECK(!broadcast.WaitFor(generation, std::chrono::milliseconds(0)));
+
+  // a notification published while the subscriber is blocked
+  std::thread publisher{ [&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    broadcast.Publish();
+  } };
+
+  CHECK(broadcast.WaitFor(generation, std::chrono::seconds(10)) && generation == 3);
+  publisher.join();
+}
+
+// Subscribers that see each notification immediately wait again while the
+// others have not woken up yet. None of them must take the wake-up of another
+// one, which would then miss the last notification.
+void no_lost_wakeup()
+{
+  Broadcast broadcast = Broadcast::Create(broadcast_name("NoLostWakeup"));
+  constexpr int subscriber_count = 8;
+  constexpr uint64_t notifications = 2000;
+  std::atomic<int> missed{ 0 };
+  std::vector<std::thread> subscribers;
+
+  for (int t(0); t < subscriber_count; ++t)
+  {
+    subscribers.emplace_back([&, t]() {
+      Broadcast subscriber = Broadcast::Open(broadcast.GetName());
+      uint64_t generation = 0;
+
+      while (generation < notifications)
+      {
+        if (!subscriber.WaitFor(generation, std::chrono::seconds(10))) {
+          ++missed;
+          return;
+        }
+
+        // the slow subscribers
+        if (t % 2 == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  for (uint64_t i(0); i < notifications; ++i)
+  {
+    broadcast.Publish();
+
+    if (i % 16 == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  for (std::thread& subscriber : subscribers) {
+    subscriber.join();
+  }
+
+  CHECK(missed == 0);
+}
+
+#ifndef _WIN32
+
+void shared_between_processes()
+{
+  const std::string name = broadcast_name("Processes");
+  Broadcast broadcast = Broadcast::Create(name);
+  constexpr int child_count = 4;
+  std::vector<pid_t> children;
+
+  for (int i(0); i < child_count; ++i)
+  {
+    const pid_t child = ::fork();
+
+    if (child == 0)
+    {
+      Broadcast subscriber = Broadcast::Open(name);
+      uint64_t generation = 0;
+      ::_exit(subscriber.WaitFor(generation, std::chrono::seconds(10)) && generation == 1 ? 0 : 1);
+    }
+
+    children.push_back(child);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  broadcast.Publish();
+
+  for (pid_t child : children)
+  {
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  RUN_TEST(create_and_open);
+  RUN_TEST(wait_for);
+  RUN_TEST(no_lost_wakeup);
+#ifndef _WIN32
+  RUN_TEST(shared_between_processes);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,245 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Channel.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_insufficient_buffer = 122;
+constexpr long error_already_exists = 183;
+
+// channels are shared by all the processes, the names used by the tests
+// must not collide with those of another instance of the tests
+std::string channel_name(const std::string& name)
+{
+#ifdef _WIN32
+  const unsigned long pid = ::GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(::getpid());
+#endif
+  return "WinAPI.Tests." + std::to_string(pid) + "." + name;
+}
+
+void create_and_open()
+{
+  const std::string name = channel_name("CreateAndOpen");
+
+  CHECK(Testing::ErrorThrownBy([&]() { Channel::Open(name); }) == error_file_not_found);
+
+  Channel created = Channel::Create(name, 5000, Channel::MultiProducer);
+  CHECK(created.Created());
+  CHECK(created.GetName() == name);
+  CHECK(created.GetCapacity() == 8192);
+  CHECK(created.GetProducerMode() == Channel::MultiProducer);
+  CHECK(Testing::ErrorThrownBy([&]() { Channel::Create(name, 4096); }) == error_already_exists);
+
+  // the capacity and the mode are those of the existing channel
+  Channel opened = Channel::Open(name);
+  CHECK(!opened.Created());
+  CHECK(opened.GetCapacity() == 8192);
+  CHECK(opened.GetProducerMode() == Channel::MultiProducer);
+
+  Channel other{ name, 4096 };
+  CHECK(!other.Created());
+  CHECK(other.GetCapacity() == 8192);
+
+  // the channel is shared
+  CHECK(opened.TrySend("hello"));
+  std::string message;
+  CHECK(created.TryReceive(message) && message == "hello");
+  CHECK(!created.TryReceive(message));
+
+  // the channel is destroyed with its last reference
+  created.Close();
+  opened.Close();
+  other.Close();
+  CHECK(Testing::ErrorThrownBy([&]() { Channel::Open(name); }) == error_file_not_found);
+}
+
+void full_channel()
+{
+  Channel channel = Channel::Create(channel_name("Full"), 4096);
+  CHECK(Testing::ErrorThrownBy([&]() { channel.TrySend(std::string(channel.GetMaxMessageSize() + 1, 'x')); }) == error_insufficient_buffer);
+
+  // messages of 120 bytes take records of 128 bytes
+  const std::string message(120, 'm');
+  int sent = 0;
+
+  while (channel.TrySend(message)) {
+    ++sent;
+  }
+
+  CHECK(sent == 4096 / 128);
+
+  std::string received;
+
+  while (channel.TryReceive(received)) {
+    --sent;
+  }
+
+  CHECK(sent == 0);
+
+  // messages of varying sizes make the records wrap around the end of the
+  // buffer, which is kept half full; they are received in order
+  auto nth_message = [](int i) { return std::to_string(i) + std::string(static_cast<size_t>(i % 200), 'w'); };
+  constexpr int queued = 16;
+  constexpr int rotations = 1000;
+  bool in_order = true;
+
+  for (int i(0); i < queued; ++i) {
+    in_order = in_order && channel.TrySend(nth_message(i));
+  }
+
+  for (int i(queued); i < queued + rotations && in_order; ++i) {
+    in_order = channel.TryReceive(received) && received == nth_message(i - queued) && channel.TrySend(nth_message(i));
+  }
+
+  for (int i(rotations); i < queued + rotations && in_order; ++i) {
+    in_order = channel.TryReceive(received) && received == nth_message(i);
+  }
+
+  CHECK(in_order);
+  CHECK(!channel.TryReceive(received));
+  CHECK(!channel.ReceiveFor(received, std::chrono::milliseconds(10)));
+}
+
+void concurrent_producers()
+{
+  Channel channel = Channel::Create(channel_name("Producers"), 4096, Channel::MultiProducer);
+  constexpr int producer_count = 4;
+  constexpr int messages_per_producer = 10000;
+  std::vector<std::thread> producers;
+
+  for (int p(0); p < producer_count; ++p)
+  {
+    producers.emplace_back([&, p]() {
+      Channel producer = Channel::Open(channel.GetName());
+
+      for (int i(0); i < messages_per_producer; ++i)
+      {
+        const std::string message = std::to_string(p) + ":" + std::to_string(i);
+
+        while (!producer.TrySend(message)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // the messages of each producer are received in order
+  std::vector<int> next(producer_count, 0);
+  bool in_order = true;
+  std::string message;
+
+  for (int i(0); i < producer_count * messages_per_producer && in_order; ++i)
+  {
+    in_order = channel.ReceiveFor(message, std::chrono::seconds(10));
+
+    if (in_order)
+    {
+      const int p = std::stoi(message.substr(0, message.find(':')));
+      in_order = std::stoi(message.substr(message.find(':') + 1)) == next[p]++;
+    }
+  }
+
+  for (std::thread& producer : producers) {
+    producer.join();
+  }
+
+  CHECK(in_order);
+  CHECK(!channel.TryReceive(message));
+}
+
+#ifndef _WIN32
+
+void shared_between_processes()
+{
+  const std::string name = channel_name("Processes");
+  Channel channel = Channel::Create(name, 4096);
+  constexpr int message_count = 10000;
+
+  const pid_t child = ::fork();
+
+  if (child == 0)
+  {
+    Channel producer = Channel::Open(name);
+
+    for (int i(0); i < message_count; ++i)
+    {
+      while (!producer.TrySend(std::to_string(i))) {
+        std::this_thread::yield();
+      }
+    }
+
+    ::_exit(0);
+  }
+
+  bool in_order = true;
+  std::string message;
+
+  for (int i(0); i < message_count && in_order; ++i) {
+    in_order = channel.ReceiveFor(message, std::chrono::seconds(10)) && message == std::to_string(i);
+  }
+
+  CHECK(in_order);
+
+  int status = 0;
+  ::waitpid(child, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+void left_by_terminated_process()
+{
+  const std::string name = channel_name("Terminated");
+
+  const pid_t child = ::fork();
+
+  if (child == 0)
+  {
+    // terminates without closing the channel
+    Channel channel = Channel::Create(name, 4096);
+    channel.TrySend("lost");
+    ::_exit(0);
+  }
+
+  int status = 0;
+  ::waitpid(child, &status, 0);
+
+  // the channel is not opened but created again, empty
+  CHECK(Testing::ErrorThrownBy([&]() { Channel::Open(name); }) == error_file_not_found);
+  Channel channel = Channel::Create(name, 4096);
+  CHECK(channel.Created());
+  std::string message;
+  CHECK(!channel.TryReceive(message));
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  RUN_TEST(create_and_open);
+  RUN_TEST(full_channel);
+  RUN_TEST(concurrent_producers);
+#ifndef _WIN32
+  RUN_TEST(shared_between_processes);
+  RUN_TEST(left_by_terminated_process);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
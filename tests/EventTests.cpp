@@ -0,0 +1,202 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Event.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_already_exists = 183;
+
+// events are shared by all the processes, the names used by the tests
+// must not collide with those of another instance of the tests
+std::string event_name(const std::string& name)
+{
+#ifdef _WIN32
+  const unsigned long pid = ::GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(::getpid());
+#endif
+  return "WinAPI.Tests." + std::to_string(pid) + "." + name;
+}
+
+void create_and_open()
+{
+  const std::string name = event_name("CreateAndOpen");
+
+  CHECK(Testing::ErrorThrownBy([&]() { Event::Open(name); }) == error_file_not_found);
+
+  Event created = Event::Create(name);
+  CHECK(created.Created());
+  CHECK(created.GetName() == name);
+  CHECK(Testing::ErrorThrownBy([&]() { Event::Create(name); }) == error_already_exists);
+
+  Event opened = Event::Open(name);
+  CHECK(!opened.Created());
+
+  Event other{ name };
+  CHECK(!other.Created());
+
+  // the event is shared
+  CHECK(!opened.WaitFor(std::chrono::milliseconds(0)));
+  created.Set();
+  CHECK(opened.WaitFor(std::chrono::milliseconds(0)));
+  CHECK(other.Wait());
+
+  // the event is destroyed with its last reference
+  created.Close();
+  opened.Close();
+  other.Close();
+  CHECK(created.IsNull());
+  CHECK(Testing::ErrorThrownBy([&]() { Event::Open(name); }) == error_file_not_found);
+}
+
+void manual_reset()
+{
+  Event event = Event::Create(event_name("ManualReset"), Event::ManualReset);
+
+  CHECK(!event.WaitFor(std::chrono::milliseconds(10)));
+  event.Set();
+  CHECK(event.WaitFor(std::chrono::milliseconds(0)));
+  CHECK(event.WaitFor(std::chrono::milliseconds(10)));
+  event.Reset();
+  CHECK(!event.WaitFor(std::chrono::milliseconds(0)));
+
+  // all the waiting threads are released
+  std::atomic<int> released{ 0 };
+  std::thread first{ [&]() { released += event.Wait(); } };
+  std::thread second{ [&]() { released += event.Wait(); } };
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  event.Set();
+  first.join();
+  second.join();
+  CHECK(released == 2);
+}
+
+void auto_reset()
+{
+  Event event = Event::Create(event_name("AutoReset"), Event::AutoReset);
+
+  event.Set();
+  CHECK(event.WaitFor(std::chrono::milliseconds(0)));
+  CHECK(!event.WaitFor(std::chrono::milliseconds(0)));
+
+  // a single thread is released by each Set()
+  std::thread waiter{ [&]() {
+    event.Wait();
+    event.Wait();
+  } };
+
+  event.Set();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  event.Set();
+  waiter.join();
+  CHECK(!event.WaitFor(std::chrono::milliseconds(0)));
+}
+
+void spin_wait()
+{
+  Event ping = Event::Create(event_name("SpinPing"), Event::AutoReset);
+  Event pong = Event::Create(event_name("SpinPong"), Event::AutoReset);
+  ping.SetSpinCount(4000);
+  pong.SetSpinCount(4000);
+
+  constexpr int round_trips = 1000;
+
+  std::thread other{ [&]() {
+    for (int i(0); i < round_trips; ++i)
+    {
+      ping.Wait();
+      pong.Set();
+    }
+  } };
+
+  bool ok = true;
+
+  for (int i(0); i < round_trips; ++i)
+  {
+    ping.Set();
+    ok = ok && pong.WaitFor(std::chrono::seconds(5));
+  }
+
+  other.join();
+  CHECK(ok);
+}
+
+#ifndef _WIN32
+
+void shared_between_processes()
+{
+  const std::string name = event_name("Processes");
+  Event event = Event::Create(name, Event::AutoReset);
+
+  const pid_t child = ::fork();
+
+  if (child == 0)
+  {
+    Event opened = Event::Open(name);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    opened.Set();
+    ::_exit(0);
+  }
+
+  CHECK(event.WaitFor(std::chrono::seconds(5)));
+
+  int status = 0;
+  ::waitpid(child, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+void left_by_terminated_process()
+{
+  const std::string name = event_name("Terminated");
+
+  const pid_t child = ::fork();
+
+  if (child == 0)
+  {
+    // terminates without closing the event
+    Event event = Event::Create(name, Event::ManualReset);
+    event.Set();
+    ::_exit(0);
+  }
+
+  int status = 0;
+  ::waitpid(child, &status, 0);
+
+  // the event is not opened but created again, in its initial state
+  CHECK(Testing::ErrorThrownBy([&]() { Event::Open(name); }) == error_file_not_found);
+  Event event = Event::Create(name, Event::AutoReset);
+  CHECK(event.Created());
+  CHECK(!event.WaitFor(std::chrono::milliseconds(0)));
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  RUN_TEST(create_and_open);
+  RUN_TEST(manual_reset);
+  RUN_TEST(auto_reset);
+  RUN_TEST(spin_wait);
+#ifndef _WIN32
+  RUN_TEST(shared_between_processes);
+  RUN_TEST(left_by_terminated_process);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
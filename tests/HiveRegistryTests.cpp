@@ -0,0 +1,565 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/HiveRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryEnumeration.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_access_denied = 5;
+constexpr long error_baddb = 1009;
+
+constexpr uint32_t reg_sz = 1;
+constexpr uint32_t reg_binary = 3;
+constexpr uint32_t reg_dword = 4;
+
+// builds a hive file with a single hive bin, following the layout read by
+// HiveRegistry; offsets are relative to the hive bin, as in the file
+class HiveBuilder
+{
+public:
+  static constexpr uint32_t no_cell = 0xFFFFFFFF;
+
+  // a cell, allocated (negative size) and aligned on 8 bytes
+  uint32_t Cell(const std::string& data)
+  {
+    const size_t size = (4 + data.size() + 7) / 8 * 8;
+    const auto offset = static_cast<uint32_t>(bin_header_size + m_cells.size());
+    Append32(m_cells, static_cast<uint32_t>(-static_cast<int32_t>(size)));
+    m_cells += data;
+    m_cells.append(size - 4 - data.size(), '\0');
+    return offset;
+  }
+
+  uint32_t Key(const std::string& name, uint32_t parent)
+  {
+    std::string data(0x4C, '\0');
+    data[0] = 'n';
+    data[1] = 'k';
+    Put16(data, 0x02, 0x0020);
+    Put32(data, 0x10, parent);
+    Put32(data, 0x1C, no_cell);
+    Put32(data, 0x28, no_cell);
+    Put16(data, 0x48, static_cast<uint16_t>(name.size()));
+    return Cell(data + name);
+  }
+
+  // a key whose name is stored in UTF-16
+  uint32_t Key(const std::u16string& name, uint32_t parent)
+  {
+    const uint32_t key = Key(Utf16(name), parent);
+    Patch16(key, 0x02, 0);
+    return key;
+  }
+
+  // a list of subkeys, "lf", "lh" or "li"
+  uint32_t SubKeyList(const std::string& kind, const std::vector<uint32_t>& keys)
+  {
+    std::string data = kind;
+    Append16(data, static_cast<uint16_t>(keys.size()));
+
+    for (uint32_t key : keys)
+    {
+      Append32(data, key);
+
+      if (kind == "lf") {
+        data += Name(key).substr(0, 4) + std::string(4 - (std::min)(size_t(4), Name(key).size()), '\0');
+      } else if (kind == "lh") {
+        Append32(data, Hash(Name(key)));
+      }
+    }
+
+    return Cell(data);
+  }
+
+  uint32_t IndexRoot(const std::vector<uint32_t>& lists)
+  {
+    std::string data = "ri";
+    Append16(data, static_cast<uint16_t>(lists.size()));
+
+    for (uint32_t list : lists) {
+      Append32(data, list);
+    }
+
+    return Cell(data);
+  }
+
+  void SetSubKeys(uint32_t key, size_t count, uint32_t list)
+  {
+    Patch32(key, 0x14, static_cast<uint32_t>(count));
+    Patch32(key, 0x1C, list);
+  }
+
+  uint32_t Value(const std::string& name, uint32_t type, const std::string& data)
+  {
+    std::string value(0x14, '\0');
+    value[0] = 'v';
+    value[1] = 'k';
+    Put16(value, 0x02, static_cast<uint16_t>(name.size()));
+    Put32(value, 0x0C, type);
+    Put16(value, 0x10, 0x0001);
+
+    if (data.size() <= 4)
+    {
+      Put32(value, 0x04, static_cast<uint32_t>(data.size()) | 0x80000000);
+      value.replace(0x08, data.size(), data);
+    }
+    else
+    {
+      Put32(value, 0x04, static_cast<uint32_t>(data.size()));
+      Put32(value, 0x08, data.size() > big_data_segment_size ? BigData(data) : Cell(data));
+    }
+
+    return Cell(value + name);
+  }
+
+  void SetValues(uint32_t key, const std::vector<uint32_t>& values)
+  {
+    std::string list;
+
+    for (uint32_t value : values) {
+      Append32(list, value);
+    }
+
+    Patch32(key, 0x24, static_cast<uint32_t>(values.size()));
+    Patch32(key, 0x28, Cell(list));
+  }
+
+  // writes in the data of a cell
+  void Patch16(uint32_t cell, size_t position, uint16_t value)
+  {
+    Put16(m_cells, cell - bin_header_size + 4 + position, value);
+  }
+
+  void Patch32(uint32_t cell, size_t position, uint32_t value)
+  {
+    Put32(m_cells, cell - bin_header_size + 4 + position, value);
+  }
+
+  void SetCellSize(uint32_t cell, int32_t size)
+  {
+    Put32(m_cells, cell - bin_header_size, static_cast<uint32_t>(size));
+  }
+
+  std::string Build(uint32_t root) const
+  {
+    const size_t bin_size = (bin_header_size + m_cells.size() + 4 + 0xFFF) / 0x1000 * 0x1000;
+    std::string base(0x1000, '\0');
+    base.replace(0, 4, "regf");
+    Put32(base, 0x24, root);
+    Put32(base, 0x28, static_cast<uint32_t>(bin_size));
+
+    std::string bin = "hbin";
+    Append32(bin, 0);
+    Append32(bin, static_cast<uint32_t>(bin_size));
+    bin.append(bin_header_size - bin.size(), '\0');
+    bin += m_cells;
+    // the rest of the bin is a free cell
+    Append32(bin, static_cast<uint32_t>(bin_size - bin.size()));
+    bin.resize(bin_size, '\0');
+    return base + bin;
+  }
+
+  // the data of a REG_SZ value, the string is in ASCII
+  static std::string String(const std::string& str)
+  {
+    return Utf16(std::u16string(str.begin(), str.end())) + std::string(2, '\0');
+  }
+
+  static std::string Utf16(const std::u16string& str)
+  {
+    std::string result;
+
+    for (char16_t c : str) {
+      Append16(result, c);
+    }
+
+    return result;
+  }
+
+private:
+  static constexpr size_t bin_header_size = 0x20;
+  static constexpr size_t big_data_segment_size = 16344;
+
+  static void Put16(std::string& data, size_t position, uint16_t value)
+  {
+    data[position] = static_cast<char>(value & 0xFF);
+    data[position + 1] = static_cast<char>(value >> 8);
+  }
+
+  static void Put32(std::string& data, size_t position, uint32_t value)
+  {
+    Put16(data, position, static_cast<uint16_t>(value & 0xFFFF));
+    Put16(data, position + 2, static_cast<uint16_t>(value >> 16));
+  }
+
+  static void Append16(std::string& data, uint16_t value)
+  {
+    data.append(2, '\0');
+    Put16(data, data.size() - 2, value);
+  }
+
+  static void Append32(std::string& data, uint32_t value)
+  {
+    data.append(4, '\0');
+    Put32(data, data.size() - 4, value);
+  }
+
+  // the name of a key with a compressed name
+  std::string Name(uint32_t key) const
+  {
+    const size_t position = key - bin_header_size + 4;
+    const size_t length = static_cast<unsigned char>(m_cells[position + 0x48]) | (static_cast<unsigned char>(m_cells[position + 0x49]) << 8);
+    return m_cells.substr(position + 0x4C, length);
+  }
+
+  static uint32_t Hash(const std::string& name)
+  {
+    uint32_t hash = 0;
+
+    for (char c : name) {
+      hash = hash * 37 + static_cast<unsigned char>((c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c);
+    }
+
+    return hash;
+  }
+
+  uint32_t BigData(const std::string& data)
+  {
+    std::string segments;
+
+    for (size_t i(0); i < data.size(); i += big_data_segment_size) {
+      Append32(segments, Cell(data.substr(i, big_data_segment_size)));
+    }
+
+    std::string db = "db";
+    Append16(db, static_cast<uint16_t>(segments.size() / 4));
+    Append32(db, Cell(segments));
+    return Cell(db);
+  }
+
+private:
+  std::string m_cells;
+};
+
+std::string subkey_name(size_t i)
+{
+  const std::string digits = std::to_string(i);
+  return "Sub" + std::string(3 - digits.size(), '0') + digits;
+}
+
+// adds subkeys named Sub000, Sub001... to a key, in order
+std::vector<uint32_t> add_subkeys(HiveBuilder& builder, uint32_t key, size_t count)
+{
+  std::vector<uint32_t> keys;
+
+  for (size_t i(0); i < count; ++i) {
+    keys.push_back(builder.Key(subkey_name(i), key));
+  }
+
+  return keys;
+}
+
+std::vector<std::string> subkey_names(const RegistryKey& key)
+{
+  RegistrySubKeyList list{ key };
+  return std::vector<std::string>(list.begin(), list.end());
+}
+
+std::string read_subkey_value(const RegistryKey& root, const std::string& path)
+{
+  return Registry::OpenKey(root, path, Registry::Read).GetStringValue("Path");
+}
+
+void reads_keys_and_values()
+{
+  HiveBuilder builder;
+  const uint32_t root = builder.Key("ROOT", 0);
+  const uint32_t software = builder.Key("Software", root);
+  const uint32_t unicode = builder.Key(u"Ünicode", root);
+  builder.SetSubKeys(root, 2, builder.SubKeyList("lf", { software, unicode }));
+
+  std::string big;
+
+  for (size_t i(0); i < 40000; ++i) {
+    big.push_back(static_cast<char>(i * 7));
+  }
+
+  builder.SetValues(software, {
+    builder.Value("", reg_sz, HiveBuilder::String("default")),
+    builder.Value("Name", reg_sz, HiveBuilder::String("hello")),
+    builder.Value("Count", reg_dword, std::string("\x2A\0\0\0", 4)),
+    builder.Value("Medium", reg_binary, std::string(100, 'm')),
+    builder.Value("Big", reg_binary, big),
+    builder.Value("Empty", reg_binary, std::string()),
+  });
+
+  Testing::TemporaryFile file{ "test_hiveregistry_values.hive" };
+  file.Write(builder.Build(root));
+  HiveRegistry hive{ file.Path() };
+  RegistryKey root_key = hive.GetRootKey();
+
+  CHECK(subkey_names(root_key) == std::vector<std::string>({ "Software", "\xC3\x9Cnicode" }));
+  CHECK(!Registry::OpenKey(root_key, "\xC3\x9Cnicode", Registry::Read).IsNull());
+
+  RegistryKey key = Registry::OpenKey(root_key, "SOFTWARE", Registry::Read);
+  CHECK(key.GetStringValue("") == "default");
+  CHECK(key.GetStringValue("name") == "hello");
+  CHECK(key.GetIntValue("Count") == 42);
+  CHECK(key.GetBinaryValue("Medium") == std::vector<unsigned char>(100, 'm'));
+  CHECK(key.GetBinaryValue("Big") == std::vector<unsigned char>(big.begin(), big.end()));
+  CHECK(key.GetBinaryValue("Empty").empty());
+
+  CHECK(Testing::ErrorThrownBy([&]() { key.GetIntValue("Missing"); }) == error_file_not_found);
+  CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "Software\\Missing", Registry::Read); }) == error_file_not_found);
+  CHECK(Testing::ErrorThrownBy([&]() { key.SetValue("Count", 1); }) == error_access_denied);
+}
+
+void subkey_lists()
+{
+  for (const char* kind : { "lf", "lh", "li" })
+  {
+    constexpr size_t count = 50;
+    HiveBuilder builder;
+    const uint32_t root = builder.Key("ROOT", 0);
+    const std::vector<uint32_t> keys = add_subkeys(builder, root, count);
+    builder.SetSubKeys(root, count, builder.SubKeyList(kind, keys));
+
+    for (size_t i(0); i < count; ++i) {
+      builder.SetValues(keys[i], { builder.Value("Path", reg_sz, HiveBuilder::String(subkey_name(i))) });
+    }
+
+    Testing::TemporaryFile file{ std::string("test_hiveregistry_") + kind + ".hive" };
+    file.Write(builder.Build(root));
+    HiveRegistry hive{ file.Path() };
+    RegistryKey root_key = hive.GetRootKey();
+
+    std::vector<std::string> expected;
+
+    for (size_t i(0); i < count; ++i) {
+      expected.push_back(subkey_name(i));
+    }
+
+    CHECK(subkey_names(root_key) == expected);
+
+    bool all_found = true;
+
+    for (size_t i(0); i < count; ++i)
+    {
+      std::string name = subkey_name(i);
+      std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+      all_found = all_found && read_subkey_value(root_key, name) == subkey_name(i);
+    }
+
+    CHECK(all_found);
+    CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "Sub", Registry::Read); }) == error_file_not_found);
+    CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "Sub050", Registry::Read); }) == error_file_not_found);
+    CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "A", Registry::Read); }) == error_file_not_found);
+  }
+}
+
+void index_root()
+{
+  // leaves of 256 subkeys, alternately "li" and "lh" lists
+  constexpr size_t count = 600;
+  constexpr size_t leaf_size = 256;
+  HiveBuilder builder;
+  const uint32_t root = builder.Key("ROOT", 0);
+  const std::vector<uint32_t> keys = add_subkeys(builder, root, count);
+  std::vector<uint32_t> leaves;
+
+  for (size_t i(0); i < count; i += leaf_size)
+  {
+    const std::vector<uint32_t> leaf(keys.begin() + i, keys.begin() + (std::min)(count, i + leaf_size));
+    leaves.push_back(builder.SubKeyList(leaves.size() % 2 ? "lh" : "li", leaf));
+  }
+
+  builder.SetSubKeys(root, count, builder.IndexRoot(leaves));
+
+  Testing::TemporaryFile file{ "test_hiveregistry_ri.hive" };
+  file.Write(builder.Build(root));
+  HiveRegistry hive{ file.Path() };
+  RegistryKey root_key = hive.GetRootKey();
+
+  const std::vector<std::string> names = subkey_names(root_key);
+  CHECK(names.size() == count);
+  CHECK(names.front() == "Sub000" && names.back() == "Sub599");
+
+  bool all_found = true;
+
+  for (size_t i(0); i < count; ++i) {
+    all_found = all_found && !Registry::OpenKey(root_key, subkey_name(i), Registry::Read).IsNull();
+  }
+
+  CHECK(all_found);
+  CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "Sub600", Registry::Read); }) == error_file_not_found);
+  CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "A", Registry::Read); }) == error_file_not_found);
+}
+
+// lists that are not sorted, e.g. written by other tools, are still searched
+void unsorted_lists()
+{
+  for (const char* kind : { "lf", "lh", "li" })
+  {
+    constexpr size_t count = 20;
+    HiveBuilder builder;
+    const uint32_t root = builder.Key("ROOT", 0);
+    std::vector<uint32_t> keys = add_subkeys(builder, root, count);
+    std::reverse(keys.begin(), keys.end());
+    std::swap(keys[3], keys[11]);
+    builder.SetSubKeys(root, count, builder.SubKeyList(kind, keys));
+
+    Testing::TemporaryFile file{ std::string("test_hiveregistry_unsorted_") + kind + ".hive" };
+    file.Write(builder.Build(root));
+    HiveRegistry hive{ file.Path() };
+    RegistryKey root_key = hive.GetRootKey();
+
+    bool all_found = true;
+
+    for (size_t i(0); i < count; ++i) {
+      all_found = all_found && !Registry::OpenKey(root_key, subkey_name(i), Registry::Read).IsNull();
+    }
+
+    CHECK(all_found);
+    CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "Sub020", Registry::Read); }) == error_file_not_found);
+  }
+}
+
+void damaged_hives()
+{
+  HiveBuilder builder;
+  const uint32_t root = builder.Key("ROOT", 0);
+  const std::vector<uint32_t> keys = add_subkeys(builder, root, 3);
+  const uint32_t list = builder.SubKeyList("lh", keys);
+  builder.SetSubKeys(root, keys.size(), list);
+  const uint32_t value = builder.Value("Data", reg_binary, std::string(64, 'd'));
+  builder.SetValues(keys[0], { value });
+  const std::string hive_data = builder.Build(root);
+
+  Testing::TemporaryFile file{ "test_hiveregistry_damaged.hive" };
+  CHECK(Testing::ErrorThrownBy([&]() { HiveRegistry hive{ file.Path() }; }) == error_file_not_found);
+
+  // not a hive
+  file.Write(std::string(0x2000, 'x'));
+  CHECK(Testing::ErrorThrownBy([&]() { HiveRegistry hive{ file.Path() }; }) == error_baddb);
+
+  // truncated in the base block, or before the root key
+  file.Write(hive_data.substr(0, 0x800));
+  CHECK(Testing::ErrorThrownBy([&]() { HiveRegistry hive{ file.Path() }; }) == error_baddb);
+  file.Write(hive_data.substr(0, 0x1000 + root + 16));
+  CHECK(Testing::ErrorThrownBy([&]() { HiveRegistry hive{ file.Path() }; }) == error_baddb);
+
+  // a root key out of the file
+  {
+    std::string data = hive_data;
+    data[0x26] = '\x7F';
+    file.Write(data);
+    CHECK(Testing::ErrorThrownBy([&]() { HiveRegistry hive{ file.Path() }; }) == error_baddb);
+  }
+
+  // each case damages a copy of the builder
+  auto open_damaged = [&](HiveBuilder damaged, auto&& check) {
+    file.Write(damaged.Build(root));
+    HiveRegistry hive{ file.Path() };
+    RegistryKey root_key = hive.GetRootKey();
+    check(root_key);
+  };
+
+  auto open_sub000 = [](RegistryKey& root_key) {
+    return Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "Sub000", Registry::Read); });
+  };
+
+  // the list of subkeys out of the file, or not aligned
+  {
+    HiveBuilder damaged = builder;
+    damaged.Patch32(root, 0x1C, 0x7FFFFFF8);
+    open_damaged(damaged, [&](RegistryKey& root_key) {
+      CHECK(open_sub000(root_key) == error_baddb);
+      CHECK(Testing::ErrorThrownBy([&]() { subkey_names(root_key); }) == error_baddb);
+    });
+
+    damaged.Patch32(root, 0x1C, list + 2);
+    open_damaged(damaged, [&](RegistryKey& root_key) { CHECK(open_sub000(root_key) == error_baddb); });
+  }
+
+  // a list with more entries than its cell
+  {
+    HiveBuilder damaged = builder;
+    damaged.Patch16(list, 0x02, 1000);
+    open_damaged(damaged, [&](RegistryKey& root_key) { CHECK(open_sub000(root_key) == error_baddb); });
+  }
+
+  // a cell larger than the file
+  {
+    HiveBuilder damaged = builder;
+    damaged.SetCellSize(list, -0x100000);
+    open_damaged(damaged, [&](RegistryKey& root_key) { CHECK(open_sub000(root_key) == error_baddb); });
+  }
+
+  // a subkey that refers to another parent, which could form a cycle
+  {
+    HiveBuilder damaged = builder;
+    damaged.Patch32(keys[1], 0x10, keys[0]);
+    open_damaged(damaged, [&](RegistryKey& root_key) {
+      CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root_key, "Sub001", Registry::Read); }) == error_baddb);
+    });
+  }
+
+  // an index root that references an index root
+  {
+    HiveBuilder damaged = builder;
+    const uint32_t nested = damaged.IndexRoot({ list });
+    damaged.SetSubKeys(root, keys.size(), damaged.IndexRoot({ nested }));
+    open_damaged(damaged, [&](RegistryKey& root_key) { CHECK(open_sub000(root_key) == error_baddb); });
+  }
+
+  // a value larger than its cell
+  {
+    HiveBuilder damaged = builder;
+    damaged.Patch32(value, 0x04, 4096);
+    open_damaged(damaged, [&](RegistryKey& root_key) {
+      RegistryKey key = Registry::OpenKey(root_key, "Sub000", Registry::Read);
+      CHECK(Testing::ErrorThrownBy([&]() { key.GetBinaryValue("Data"); }) == error_baddb);
+    });
+  }
+
+  // big data with too few segments
+  {
+    HiveBuilder damaged = builder;
+    const uint32_t big = damaged.Value("Big", reg_binary, std::string(40000, 'b'));
+    damaged.SetValues(keys[0], { big });
+    const HiveBuilder intact = damaged;
+    damaged.Patch32(big, 0x04, 80000);
+
+    open_damaged(intact, [&](RegistryKey& root_key) {
+      CHECK(Registry::OpenKey(root_key, "Sub000", Registry::Read).GetBinaryValue("Big").size() == 40000);
+    });
+
+    open_damaged(damaged, [&](RegistryKey& root_key) {
+      RegistryKey key = Registry::OpenKey(root_key, "Sub000", Registry::Read);
+      CHECK(Testing::ErrorThrownBy([&]() { key.GetBinaryValue("Big"); }) == error_baddb);
+    });
+  }
+}
+
+int main()
+{
+  RUN_TEST(reads_keys_and_values);
+  RUN_TEST(subkey_lists);
+  RUN_TEST(index_root);
+  RUN_TEST(unsorted_lists);
+  RUN_TEST(damaged_hives);
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,266 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/JobObject.h"
+#include "WinAPI/Process.h"
+#include "WinAPI/ProcessEnvironment.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// sanitized programs reserve much more address space than they use, and
+// cannot start with a memory limit
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define WINAPI_TESTS_SANITIZED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#define WINAPI_TESTS_SANITIZED
+#endif
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_not_supported = 50;
+
+// Process does not pass arguments, the tests start this program with
+// the behavior of the child in an environment variable
+constexpr const char* child_variable = "WINAPI_TESTS_CHILD";
+
+int run_child(const std::string& mode)
+{
+  if (mode == "allocate")
+  {
+    try
+    {
+      auto memory = std::make_unique<char[]>(size_t(1) << 30);
+      return memory ? 0 : 1;
+    }
+    catch (const std::bad_alloc&)
+    {
+      return 1;
+    }
+  }
+  else if (mode == "files")
+  {
+    std::vector<std::FILE*> files;
+
+    for (int i(0); i < 64; ++i)
+    {
+      if (std::FILE* file = std::fopen(Process::GetExecutablePath().c_str(), "rb")) {
+        files.push_back(file);
+      }
+    }
+
+    const bool opened = files.size() == 64;
+
+    for (std::FILE* file : files) {
+      std::fclose(file);
+    }
+
+    return opened ? 0 : 1;
+  }
+  else if (mode == "sleep")
+  {
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+  }
+  else if (mode == "spin")
+  {
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < end);
+  }
+  else if (mode == "exit")
+  {
+    return 3;
+  }
+
+  return 0;
+}
+
+Process child_process(const std::string& mode, JobObject& job)
+{
+  ProcessEnvironment environment = ProcessEnvironment::GetSystemEnvironment();
+  environment.Insert(child_variable, mode);
+
+  Process process;
+  process.SetExecutablePath(Process::GetExecutablePath());
+  process.SetProcessEnvironment(environment);
+  process.SetJobObject(&job);
+  return process;
+}
+
+// collects the notifications of a job, which are emitted by another thread
+class Notifications
+{
+public:
+  explicit Notifications(JobObject& job)
+  {
+    job.SetNotificationCallback([this](const JobObject::Notification& notification) {
+      std::lock_guard<std::mutex> lock{ m_mutex };
+      m_notifications.push_back(notification);
+      });
+  }
+
+  bool WaitFor(JobObject::NotificationType type)
+  {
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+    while (std::chrono::steady_clock::now() < end)
+    {
+      if (Count(type) > 0) {
+        return true;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return false;
+  }
+
+  size_t Count(JobObject::NotificationType type)
+  {
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    return std::count_if(m_notifications.begin(), m_notifications.end(), [type](const JobObject::Notification& notification) {
+      return notification.type == type;
+      });
+  }
+
+  std::vector<JobObject::Notification> Get()
+  {
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    return m_notifications;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::vector<JobObject::Notification> m_notifications;
+};
+
+void notifications()
+{
+  JobObject job;
+  Notifications received{ job };
+
+  Process process = child_process("exit", job);
+  process.Start();
+  CHECK(received.WaitFor(JobObject::ActiveProcessZero));
+  process.WaitForFinished();
+  CHECK(process.GetExitCode() == 3);
+
+  const std::vector<JobObject::Notification> list = received.Get();
+  CHECK(list.size() == 3);
+  CHECK(list.size() == 3 && list[0].type == JobObject::NewProcess && list[1].type == JobObject::ExitProcess);
+  CHECK(list.size() == 3 && list[0].processId == list[1].processId && list[0].processId != 0);
+}
+
+void active_process_limit()
+{
+  JobObject job;
+  job.SetActiveProcessLimit(1);
+  Notifications received{ job };
+
+  Process first = child_process("sleep", job);
+  first.Start();
+
+  // the second process is not started
+  Process second = child_process("exit", job);
+  second.Start();
+  CHECK(received.WaitFor(JobObject::ActiveProcessLimit));
+  second.WaitForFinished();
+  CHECK(second.GetExitCode() != 3);
+
+  CHECK(job.Terminate(1));
+  first.WaitForFinished();
+  CHECK(received.WaitFor(JobObject::ActiveProcessZero));
+}
+
+void kill_on_close()
+{
+  JobObject job;
+  job.SetKillOnClose();
+
+  Process process = child_process("sleep", job);
+  process.Start();
+
+  const auto start = std::chrono::steady_clock::now();
+  job.Close();
+  CHECK(job.IsNull());
+  process.WaitForFinished();
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  CHECK(process.GetExitCode() != 0);
+}
+
+void process_time_limit()
+{
+  JobObject job;
+  job.SetProcessTimeLimit(std::chrono::milliseconds(500));
+  Notifications received{ job };
+
+  const auto start = std::chrono::steady_clock::now();
+  Process process = child_process("spin", job);
+  process.Start();
+  CHECK(received.WaitFor(JobObject::EndOfProcessTime));
+  process.WaitForFinished();
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  CHECK(process.GetExitCode() != 0);
+}
+
+void process_memory_limit()
+{
+  JobObject job;
+  job.SetProcessMemoryLimit(size_t(256) << 20);
+
+  Process process = child_process("allocate", job);
+  process.Start();
+  process.WaitForFinished();
+  CHECK(process.GetExitCode() == 1);
+}
+
+#ifndef _WIN32
+
+void file_descriptor_limit()
+{
+  JobObject job;
+  job.SetFileDescriptorLimit(16);
+
+  Process process = child_process("files", job);
+  process.Start();
+  process.WaitForFinished();
+  CHECK(process.GetExitCode() == 1);
+
+  // job-wide limits require cgroups
+  CHECK(Testing::ErrorThrownBy([&]() { job.SetJobMemoryLimit(size_t(256) << 20); }) == error_not_supported);
+  CHECK(Testing::ErrorThrownBy([&]() { job.SetCpuRateLimit(50); }) == error_not_supported);
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  if (const char* mode = std::getenv(child_variable)) {
+    return run_child(mode);
+  }
+
+  RUN_TEST(notifications);
+  RUN_TEST(active_process_limit);
+  RUN_TEST(kill_on_close);
+  RUN_TEST(process_time_limit);
+#ifndef WINAPI_TESTS_SANITIZED
+  RUN_TEST(process_memory_limit);
+#endif // !WINAPI_TESTS_SANITIZED
+#ifndef _WIN32
+  RUN_TEST(file_descriptor_limit);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
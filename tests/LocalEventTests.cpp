@@ -0,0 +1,133 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/LocalEvent.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace Win32;
+
+void manual_reset()
+{
+  LocalEvent event;
+  CHECK(event.GetResetMode() == Event::ManualReset);
+  CHECK(!event.IsSet());
+  CHECK(!event.WaitFor(std::chrono::milliseconds(10)));
+
+  event.Set();
+  CHECK(event.IsSet());
+  CHECK(event.WaitFor(std::chrono::milliseconds(0)));
+  event.Wait();
+  CHECK(event.IsSet());
+
+  event.Reset();
+  CHECK(!event.IsSet());
+  CHECK(LocalEvent(Event::ManualReset, true).IsSet());
+}
+
+void auto_reset()
+{
+  LocalEvent event{ Event::AutoReset, true };
+  CHECK(event.WaitFor(std::chrono::milliseconds(0)));
+  CHECK(!event.IsSet());
+  CHECK(!event.WaitFor(std::chrono::milliseconds(10)));
+
+  // each Set() releases a single thread
+  constexpr int thread_count = 4;
+  std::atomic<int> released{ 0 };
+  std::vector<std::thread> threads;
+
+  for (int i(0); i < thread_count; ++i)
+  {
+    threads.emplace_back([&]() {
+      event.Wait();
+      ++released;
+    });
+  }
+
+  for (int i(0); i < thread_count; ++i)
+  {
+    event.Set();
+
+    while (released.load() != i + 1) {
+      std::this_thread::yield();
+    }
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(released == thread_count);
+  CHECK(!event.IsSet());
+}
+
+// all the blocked threads are released, even if the event is reset
+// before they are scheduled
+void set_releases_all_waiters()
+{
+  LocalEvent event;
+  constexpr int thread_count = 4;
+  std::atomic<int> released{ 0 };
+  std::vector<std::thread> threads;
+
+  for (int i(0); i < thread_count; ++i)
+  {
+    threads.emplace_back([&]() {
+      if (event.WaitFor(std::chrono::seconds(10))) {
+        ++released;
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  event.Set();
+  event.Reset();
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(released == thread_count);
+}
+
+void ping_pong()
+{
+  LocalEvent ping{ Event::AutoReset };
+  LocalEvent pong{ Event::AutoReset };
+  constexpr int round_trips = 10000;
+
+  std::thread thread{ [&]() {
+    for (int i(0); i < round_trips; ++i)
+    {
+      ping.Wait();
+      pong.Set();
+    }
+  } };
+
+  bool all_answered = true;
+
+  for (int i(0); i < round_trips; ++i)
+  {
+    ping.Set();
+    all_answered = all_answered && pong.WaitFor(std::chrono::seconds(10));
+  }
+
+  thread.join();
+  CHECK(all_answered);
+}
+
+int main()
+{
+  RUN_TEST(manual_reset);
+  RUN_TEST(auto_reset);
+  RUN_TEST(set_releases_all_waiters);
+  RUN_TEST(ping_pong);
+  return Testing::Result();
+}
\ No newline at end of file
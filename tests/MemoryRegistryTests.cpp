@@ -0,0 +1,300 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryBatch.h"
+#include "WinAPI/RegistryEnumeration.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_access_denied = 5;
+constexpr long error_key_deleted = 1018;
+
+void keys_and_values()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  {
+    RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Software\\WinAPI\\Tests", Registry::Write);
+    key.SetValue("Int", 42);
+    key.SetValue("String", "value");
+    key.SetQWordValue("QWord", 1ull << 40);
+    key.SetMultiStringValue("Multi", { "a", "b" });
+  }
+
+  // names are case-insensitive
+  RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "SOFTWARE\\winapi\\tests", Registry::Read);
+  CHECK(key.GetIntValue("int") == 42);
+  CHECK(key.GetStringValue("STRING") == "value");
+  CHECK(key.GetQWordValue("QWord") == 1ull << 40);
+  CHECK((key.GetMultiStringValue("Multi") == std::vector<std::string>{ "a", "b" }));
+  CHECK(Testing::ErrorThrownBy([&]() { key.GetIntValue("Missing"); }) == error_file_not_found);
+
+  // a key opened for reading cannot be written
+  CHECK(Testing::ErrorThrownBy([&]() { key.SetValue("Int", 1); }) == error_access_denied);
+
+  RegistryKey missing;
+  CHECK(missing.TryOpen(Registry::HKEY_CURRENT_USER, "Software\\Missing", Registry::Read).Value() == error_file_not_found);
+
+  Registry::SetBackend(nullptr);
+}
+
+void delete_keys()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "A\\B", Registry::Write);
+
+  // a key that has subkeys cannot be deleted
+  CHECK(Testing::ErrorThrownBy([]() { Registry::DeleteKey(Registry::HKEY_CURRENT_USER, "A"); }) == error_access_denied);
+
+  Registry::DeleteKey(Registry::HKEY_CURRENT_USER, "A\\B");
+  CHECK(Testing::ErrorThrownBy([&]() { key.SetValue("x", 1); }) == error_key_deleted);
+
+  Registry::DeleteKey(Registry::HKEY_CURRENT_USER, "A");
+  RegistryKey deleted;
+  CHECK(deleted.TryOpen(Registry::HKEY_CURRENT_USER, "A", Registry::Read).Value() == error_file_not_found);
+
+  Registry::SetBackend(nullptr);
+}
+
+void enumeration()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Enum", static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+
+  for (const char* name : { "first", "second", "third" })
+  {
+    Registry::CreateKey(key, name, Registry::Write);
+    key.SetValue(name, name);
+  }
+
+  // in creation order
+  RegistrySubKeyList subkeys{ key };
+  CHECK(subkeys.size() == 3);
+  CHECK(subkeys.GetName(0) == "first");
+  CHECK(subkeys.GetName(2) == "third");
+
+  RegistryValueList values{ key, RegistryValueList::WithData };
+  CHECK(values.size() == 3);
+  CHECK(values[1].GetName() == "second");
+  CHECK(values[1].GetType() == Registry::String);
+
+  Registry::SetBackend(nullptr);
+}
+
+void batch_requires_write_access()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Batch", Registry::Write).SetValue("Value", 1);
+  RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Batch", Registry::Read);
+
+  RegistryBatch batch;
+  batch.SetValue("", "Value", 2);
+  batch.CreateKey("Sub");
+  CHECK(batch.TryCommit(key).Value() == error_access_denied);
+  CHECK(key.GetIntValue("Value") == 1);
+
+  RegistryKey sub;
+  CHECK(sub.TryOpen(key, "Sub", Registry::Read).Value() == error_file_not_found);
+
+  Registry::SetBackend(nullptr);
+}
+
+void batch_delete_value()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "BatchDelete", static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+  key.SetValue("first", 1);
+  key.SetValue("second", 2);
+  key.SetValue("third", 3);
+
+  RegistryBatch batch;
+  batch.DeleteValue("", "second");
+  batch.Commit(key);
+  CHECK(RegistryValueList(key).size() == 2);
+  CHECK(Testing::ErrorThrownBy([&]() { key.GetIntValue("second"); }) == error_file_not_found);
+
+  // deleting a value that does not exist fails the batch
+  RegistryBatch missing;
+  missing.DeleteValue("", "second");
+  CHECK(missing.TryCommit(key).Value() == error_file_not_found);
+
+  Registry::SetBackend(nullptr);
+}
+
+void batch_rollback()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Rollback", static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+  key.SetValue("first", 1);
+  key.SetValue("second", 2);
+  key.SetValue("third", 3);
+
+  RegistryBatch batch;
+  batch.SetValue("", "first", 10);
+  batch.DeleteValue("", "second");
+  batch.CreateKey("Sub");
+  batch.SetValue("Sub", "Value", 1);
+  batch.DeleteValue("", "third");
+  batch.DeleteValue("", "missing");
+  CHECK(batch.TryCommit(key).Value() == error_file_not_found);
+
+  // nothing was applied, and the deleted values are restored in their enumeration order
+  CHECK(key.GetIntValue("first") == 1);
+  std::vector<std::string> names;
+
+  for (RegistryValueList::Item value : RegistryValueList{ key }) {
+    names.push_back(value.GetName());
+  }
+
+  CHECK((names == std::vector<std::string>{ "first", "second", "third" }));
+  CHECK(key.GetIntValue("second") == 2);
+  CHECK(key.GetIntValue("third") == 3);
+
+  RegistryKey sub;
+  CHECK(sub.TryOpen(key, "Sub", Registry::Read).Value() == error_file_not_found);
+
+  Registry::SetBackend(nullptr);
+}
+
+void batch_moved_from()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Moved", static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+
+  RegistryBatch batch;
+  batch.SetValue("", "first", 1);
+  RegistryBatch moved{ std::move(batch) };
+  CHECK(moved.size() == 1);
+
+  // the moved-from batch is empty and can be used again
+  CHECK(batch.empty());
+  CHECK(!batch.TryCommit(key));
+  batch.SetValue("", "second", 2);
+  batch.DeleteValue("", "second");
+  CHECK(batch.size() == 2);
+  moved.Commit(key);
+  batch.Commit(key);
+  CHECK(key.GetIntValue("first") == 1);
+  CHECK(RegistryValueList(key).size() == 1);
+
+  Registry::SetBackend(nullptr);
+}
+
+void watch_callback_can_use_registry()
+{
+  MemoryRegistry memory;
+  RegistryBackend::KeyHandle root = memory.GetPredefinedKey(RegistryBackend::CurrentUser);
+  RegistryBackend::KeyHandle writer = nullptr;
+  RegistryBackend::KeyHandle reader = nullptr;
+  bool created = false;
+  CHECK(!memory.CreateKey(root, "Watched", Registry::Write, writer, created));
+  CHECK(!memory.OpenKey(root, "Watched", Registry::Read, reader));
+
+  // reading the value that changed from the callback used to deadlock
+  int seen = 0;
+  size_t size = sizeof(seen);
+  RegistryBackend::WatchHandle watch = nullptr;
+  CHECK(!memory.WatchKey(reader, [&]() { memory.GetValue(reader, "Value", nullptr, &seen, &size); }, watch));
+
+  const int value = 7;
+  CHECK(!memory.SetValue(writer, "Value", Registry::DWord, &value, sizeof(value)));
+  CHECK(seen == 7);
+
+  memory.UnwatchKey(watch);
+  memory.CloseKey(reader);
+  memory.CloseKey(writer);
+}
+
+void unwatch_deleted_key()
+{
+  MemoryRegistry memory;
+  RegistryBackend::KeyHandle root = memory.GetPredefinedKey(RegistryBackend::CurrentUser);
+  RegistryBackend::KeyHandle key = nullptr;
+  bool created = false;
+  CHECK(!memory.CreateKey(root, "Deleted", Registry::Read, key, created));
+
+  int notifications = 0;
+  RegistryBackend::WatchHandle watch = nullptr;
+  CHECK(!memory.WatchKey(key, [&]() { ++notifications; }, watch));
+
+  CHECK(!memory.DeleteKey(root, "Deleted"));
+  CHECK(notifications == 1);
+
+  // the key is destroyed with its last handle, the watch must remain valid
+  memory.CloseKey(key);
+  memory.UnwatchKey(watch);
+}
+
+void unwatch_waits_for_callback()
+{
+  MemoryRegistry memory;
+  RegistryBackend::KeyHandle root = memory.GetPredefinedKey(RegistryBackend::CurrentUser);
+  RegistryBackend::KeyHandle key = nullptr;
+  bool created = false;
+  CHECK(!memory.CreateKey(root, "Slow", Registry::Write, key, created));
+
+  std::atomic<bool> started{ false };
+  std::atomic<bool> finished{ false };
+  RegistryBackend::WatchHandle watch = nullptr;
+
+  CHECK(!memory.WatchKey(key, [&]() {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    finished = true;
+  }, watch));
+
+  std::thread writer{ [&]() {
+    const int value = 1;
+    memory.SetValue(key, "Value", Registry::DWord, &value, sizeof(value));
+  } };
+
+  while (!started) {
+    std::this_thread::yield();
+  }
+
+  memory.UnwatchKey(watch);
+  CHECK(finished);
+
+  writer.join();
+  memory.CloseKey(key);
+}
+
+int main()
+{
+  RUN_TEST(keys_and_values);
+  RUN_TEST(delete_keys);
+  RUN_TEST(enumeration);
+  RUN_TEST(batch_requires_write_access);
+  RUN_TEST(batch_delete_value);
+  RUN_TEST(batch_rollback);
+  RUN_TEST(batch_moved_from);
+  RUN_TEST(watch_callback_can_use_registry);
+  RUN_TEST(unwatch_deleted_key);
+  RUN_TEST(unwatch_waits_for_callback);
+  return Testing::Result();
+}
\ No newline at end of file
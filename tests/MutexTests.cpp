@@ -0,0 +1,185 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Mutex.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_already_exists = 183;
+
+// mutexes are shared by all the processes, the names used by the tests
+// must not collide with those of another instance of the tests
+std::string mutex_name(const std::string& name)
+{
+#ifdef _WIN32
+  const unsigned long pid = ::GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(::getpid());
+#endif
+  return "WinAPI.Tests." + std::to_string(pid) + "." + name;
+}
+
+void create_and_open()
+{
+  const std::string name = mutex_name("CreateAndOpen");
+
+  CHECK(Testing::ErrorThrownBy([&]() { Mutex::Open(name); }) == error_file_not_found);
+
+  Mutex created = Mutex::Create(name);
+  CHECK(created.Created());
+  CHECK(created.GetName() == name);
+  CHECK(Testing::ErrorThrownBy([&]() { Mutex::Create(name); }) == error_already_exists);
+
+  Mutex opened = Mutex::Open(name);
+  CHECK(!opened.Created());
+  Mutex other{ name };
+  CHECK(!other.Created());
+
+  // the mutex is shared
+  CHECK(created.Lock() == Mutex::Acquired);
+  std::thread{ [&]() { CHECK(!opened.TryLock()); } }.join();
+  CHECK(created.Unlock());
+  std::thread{ [&]() { CHECK(opened.TryLock() && opened.Unlock()); } }.join();
+
+  Mutex null;
+  CHECK(null.IsNull());
+  CHECK(null.Lock() == Mutex::Failed);
+  CHECK(!null.Unlock());
+}
+
+void recursive_lock()
+{
+  Mutex mutex = Mutex::Create(mutex_name("Recursive"));
+
+  CHECK(mutex.Lock() == Mutex::Acquired);
+  CHECK(mutex.TryLock());
+  CHECK(mutex.LockFor(std::chrono::milliseconds(0)) == Mutex::Acquired);
+
+  // the mutex must be unlocked as many times as it was locked
+  CHECK(mutex.Unlock());
+  CHECK(mutex.Unlock());
+  std::thread{ [&]() { CHECK(mutex.LockFor(std::chrono::milliseconds(20)) == Mutex::TimedOut); } }.join();
+  CHECK(mutex.Unlock());
+  CHECK(!mutex.Unlock());
+
+  // only the owner can unlock the mutex
+  CHECK(mutex.Lock() == Mutex::Acquired);
+  std::thread{ [&]() { CHECK(!mutex.Unlock()); } }.join();
+  CHECK(mutex.Unlock());
+}
+
+void mutual_exclusion()
+{
+  Mutex mutex = Mutex::Create(mutex_name("Exclusion"));
+  mutex.SetSpinCount(100);
+  constexpr int thread_count = 4;
+  constexpr int increments = 20000;
+  int counter = 0;
+  std::vector<std::thread> threads;
+
+  for (int t(0); t < thread_count; ++t)
+  {
+    threads.emplace_back([&]() {
+      for (int i(0); i < increments; ++i)
+      {
+        if (mutex.Lock() == Mutex::Acquired)
+        {
+          ++counter;
+          mutex.Unlock();
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(counter == thread_count * increments);
+}
+
+#ifndef _WIN32
+
+void abandoned_by_terminated_process()
+{
+  const std::string name = mutex_name("Abandoned");
+  Mutex mutex = Mutex::Create(name);
+
+  const pid_t child = ::fork();
+
+  if (child == 0)
+  {
+    // terminates without unlocking the mutex
+    Mutex m = Mutex::Open(name);
+    ::_exit(m.Lock() == Mutex::Acquired ? 0 : 1);
+  }
+
+  int status = 0;
+  ::waitpid(child, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // the mutex is owned by this thread, and usable again
+  CHECK(mutex.LockFor(std::chrono::seconds(10)) == Mutex::Abandoned);
+  CHECK(mutex.Unlock());
+  CHECK(mutex.Lock() == Mutex::Acquired);
+  CHECK(mutex.Unlock());
+}
+
+void blocked_by_other_process()
+{
+  const std::string name = mutex_name("Processes");
+  Mutex mutex = Mutex::Create(name);
+  CHECK(mutex.Lock() == Mutex::Acquired);
+
+  const pid_t child = ::fork();
+
+  if (child == 0)
+  {
+    Mutex m = Mutex::Open(name);
+
+    if (m.LockFor(std::chrono::milliseconds(10)) != Mutex::TimedOut) {
+      ::_exit(1);
+    }
+
+    // the parent unlocks the mutex
+    ::_exit(m.LockFor(std::chrono::seconds(10)) == Mutex::Acquired && m.Unlock() ? 0 : 2);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  CHECK(mutex.Unlock());
+
+  int status = 0;
+  ::waitpid(child, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  RUN_TEST(create_and_open);
+  RUN_TEST(recursive_lock);
+  RUN_TEST(mutual_exclusion);
+#ifndef _WIN32
+  RUN_TEST(abandoned_by_terminated_process);
+  RUN_TEST(blocked_by_other_process);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Process.h"
+#include "WinAPI/ProcessEnvironment.h"
+#include "WinAPI/ProcessSnapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// Process does not pass arguments, the tests start this program with
+// the behavior of the child in an environment variable
+constexpr const char* child_variable = "WINAPI_TESTS_CHILD";
+
+unsigned long current_process_id()
+{
+#ifdef _WIN32
+  return ::GetCurrentProcessId();
+#else
+  return static_cast<unsigned long>(::getpid());
+#endif
+}
+
+std::string file_name(const std::string& path)
+{
+  return path.substr(path.find_last_of("/\\") + 1);
+}
+
+std::vector<const ProcessInfo*> find_children(const ProcessSnapshot& snapshot)
+{
+  std::vector<const ProcessInfo*> result;
+
+  for (const ProcessInfo& info : snapshot.GetProcesses())
+  {
+    if (info.parentProcessId == current_process_id()) {
+      result.push_back(&info);
+    }
+  }
+
+  return result;
+}
+
+void current_process()
+{
+  ProcessSnapshot snapshot;
+  CHECK(snapshot.GetProcesses().empty());
+  snapshot.Refresh();
+  CHECK(!snapshot.GetProcesses().empty());
+
+  const ProcessInfo* self = snapshot.Find(current_process_id());
+  CHECK(self != nullptr);
+
+  if (!self) {
+    return;
+  }
+
+  CHECK(self->processId == current_process_id());
+  CHECK(self->executablePath == Process::GetExecutablePath());
+  CHECK(self->executableName == file_name(Process::GetExecutablePath()));
+  CHECK(snapshot.Find(self->parentProcessId) != nullptr);
+#ifndef _WIN32
+  CHECK(self->parentProcessId == static_cast<unsigned long>(::getppid()));
+#endif // !_WIN32
+
+  // the process was started by the test
+  const auto now = std::chrono::system_clock::now();
+  CHECK(self->startTime <= now + std::chrono::seconds(1));
+  CHECK(self->startTime >= now - std::chrono::minutes(10));
+
+  const std::vector<const ProcessInfo*> found = snapshot.FindByExecutableName(self->executableName);
+  CHECK(std::find(found.begin(), found.end(), self) != found.end());
+  CHECK(snapshot.FindByExecutableName("WinAPI.Tests.Missing").empty());
+}
+
+void refresh()
+{
+  ProcessSnapshot snapshot;
+  snapshot.Refresh();
+  CHECK(find_children(snapshot).empty());
+
+  ProcessEnvironment environment = ProcessEnvironment::GetSystemEnvironment();
+  environment.Insert(child_variable, "sleep");
+
+  Process process;
+  process.SetExecutablePath(Process::GetExecutablePath());
+  process.SetProcessEnvironment(environment);
+  process.Start();
+
+  // the child is listed, along with the processes that were already running
+  const size_t count = snapshot.GetProcesses().size();
+  snapshot.Refresh();
+  const std::vector<const ProcessInfo*> children = find_children(snapshot);
+  CHECK(children.size() == 1);
+  CHECK(snapshot.GetProcesses().size() + 64 > count);
+
+  const unsigned long child_id = children.empty() ? 0 : children.front()->processId;
+  CHECK(snapshot.Find(current_process_id()) != nullptr);
+
+  // and removed once it exited
+  process.WaitForFinished();
+  snapshot.Refresh();
+  CHECK(snapshot.Find(child_id) == nullptr);
+  CHECK(find_children(snapshot).empty());
+}
+
+int main()
+{
+  if (std::getenv(child_variable))
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    return 0;
+  }
+
+  RUN_TEST(current_process);
+  RUN_TEST(refresh);
+  return Testing::Result();
+}
\ No newline at end of file
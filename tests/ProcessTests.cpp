@@ -0,0 +1,277 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Process.h"
+#include "WinAPI/ProcessEnvironment.h"
+#include "WinAPI/WaitSet.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+
+// Process does not pass arguments, the tests start this program with
+// the behavior of the child in an environment variable
+constexpr const char* child_variable = "WINAPI_TESTS_CHILD";
+
+int run_child(const std::string& mode)
+{
+  if (mode == "echo")
+  {
+    std::fputs("output\n", stdout);
+    std::fputs("error\n", stderr);
+  }
+  else if (mode == "copy")
+  {
+    char buffer[4096];
+    size_t count = 0;
+
+    while ((count = std::fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+      std::fwrite(buffer, 1, count, stdout);
+    }
+  }
+  else if (mode == "environment")
+  {
+    const char* value = std::getenv("WINAPI_TESTS_VALUE");
+    std::fputs(value ? value : "", stdout);
+  }
+  else if (mode == "sleep")
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  else if (mode == "exit")
+  {
+    return 3;
+  }
+
+  return 0;
+}
+
+// the files are created in the working directory, their names must not
+// collide with those of another instance of the tests
+std::string file_name(const std::string& name)
+{
+#ifdef _WIN32
+  const unsigned long pid = ::GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(::getpid());
+#endif
+  return "WinAPI.Tests." + std::to_string(pid) + "." + name + ".txt";
+}
+
+std::string read_file(const std::string& path)
+{
+  std::ifstream file{ path, std::ios::binary };
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// the output of the child is in text mode, whose line endings differ on Windows
+size_t count_lines(const std::string& text, const std::string& line)
+{
+  size_t count = 0;
+
+  for (size_t pos = text.find(line); pos != std::string::npos; pos = text.find(line, pos + line.size())) {
+    ++count;
+  }
+
+  return count;
+}
+
+void write_file(const std::string& path, const std::string& content)
+{
+  std::ofstream file{ path, std::ios::binary };
+  file << content;
+}
+
+Process child_process(const std::string& mode)
+{
+  ProcessEnvironment environment = ProcessEnvironment::GetSystemEnvironment();
+  environment.Insert(child_variable, mode);
+
+  Process process;
+  process.SetExecutablePath(Process::GetExecutablePath());
+  process.SetProcessEnvironment(environment);
+  return process;
+}
+
+int run_to_completion(Process& process)
+{
+  process.Start();
+  process.WaitForFinished();
+  return process.GetExitCode();
+}
+
+void exit_code()
+{
+  Process process = child_process("exit");
+  CHECK(run_to_completion(process) == 3);
+
+  // a process that cannot be started has no exit code
+  Process missing;
+  missing.SetExecutablePath(file_name("Missing"));
+  missing.Start();
+  CHECK(missing.GetExitCode() == 0);
+}
+
+void output_to_file()
+{
+  const std::string path = file_name("Output");
+
+  // stdout and stderr share the file, so that they do not overwrite each other
+  Process process = child_process("echo");
+  process.SetStandardOutput(StdioRedirect::ToFile(path));
+  process.SetStandardError(StdioRedirect::ToFile(path));
+  CHECK(run_to_completion(process) == 0);
+
+  const std::string output = read_file(path);
+  CHECK(count_lines(output, "output") == 1 && count_lines(output, "error") == 1);
+
+  // the output is appended to the file
+  Process appending = child_process("echo");
+  appending.SetStandardOutput(StdioRedirect::ToFile(path, true));
+  appending.SetStandardError(StdioRedirect::ToNull());
+  CHECK(run_to_completion(appending) == 0);
+  CHECK(read_file(path).compare(0, output.size(), output) == 0);
+  CHECK(count_lines(read_file(path), "output") == 2);
+
+  // or replaces it
+  Process truncating = child_process("echo");
+  truncating.SetStandardOutput(StdioRedirect::ToFile(path));
+  truncating.SetStandardError(StdioRedirect::ToNull());
+  CHECK(run_to_completion(truncating) == 0);
+  CHECK(count_lines(read_file(path), "output") == 1 && count_lines(read_file(path), "error") == 0);
+
+  std::remove(path.c_str());
+}
+
+void input_from_file()
+{
+  const std::string input_path = file_name("Input");
+  const std::string output_path = file_name("Copy");
+
+  std::string input;
+  for (int i(0); i < 10000; ++i) {
+    input += std::to_string(i) + ' ';
+  }
+
+  write_file(input_path, input);
+
+  Process process = child_process("copy");
+  process.SetStandardInput(StdioRedirect::ToFile(input_path));
+  process.SetStandardOutput(StdioRedirect::ToFile(output_path));
+  CHECK(run_to_completion(process) == 0);
+  CHECK(read_file(output_path) == input);
+
+  // the null device is empty
+  Process empty = child_process("copy");
+  empty.SetStandardInput(StdioRedirect::ToNull());
+  empty.SetStandardOutput(StdioRedirect::ToFile(output_path));
+  CHECK(run_to_completion(empty) == 0);
+  CHECK(read_file(output_path).empty());
+
+  // the input file must exist
+  Process missing = child_process("copy");
+  missing.SetStandardInput(StdioRedirect::ToFile(file_name("MissingInput")));
+  CHECK(Testing::ErrorThrownBy([&]() { missing.Start(); }) == error_file_not_found);
+
+  std::remove(input_path.c_str());
+  std::remove(output_path.c_str());
+}
+
+void environment()
+{
+  const std::string path = file_name("Environment");
+  ProcessEnvironment environment = ProcessEnvironment::GetSystemEnvironment();
+  CHECK(!environment.IsEmpty());
+  environment.Insert(child_variable, "environment");
+  environment.Insert("WINAPI_TESTS_VALUE", "value");
+
+  Process process;
+  process.SetExecutablePath(Process::GetExecutablePath());
+  process.SetProcessEnvironment(environment);
+  process.SetStandardOutput(StdioRedirect::ToFile(path));
+  CHECK(run_to_completion(process) == 0);
+  CHECK(read_file(path) == "value");
+
+  std::remove(path.c_str());
+}
+
+void wait_set()
+{
+  Process process = child_process("sleep");
+  process.Start();
+
+  WaitSet set;
+  const WaitSet::Id id = set.Add(process);
+  std::vector<WaitSet::Id> ready;
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ id });
+
+  process.WaitForFinished();
+  CHECK(process.GetExitCode() == 0);
+}
+
+#ifndef _WIN32
+
+void output_to_file_descriptor()
+{
+  int fds[2];
+  CHECK(::pipe(fds) == 0);
+
+  Process process = child_process("echo");
+  process.SetStandardOutput(StdioRedirect::ToFileDescriptor(fds[1]));
+  process.SetStandardError(StdioRedirect::ToNull());
+  process.Start();
+
+  // the file descriptor was duplicated, the pipe is closed when the child exits
+  ::close(fds[1]);
+
+  std::string output;
+  char buffer[64];
+  ssize_t count = 0;
+
+  while ((count = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+    output.append(buffer, static_cast<size_t>(count));
+  }
+
+  ::close(fds[0]);
+  process.WaitForFinished();
+  CHECK(output == "output\n");
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  if (const char* mode = std::getenv(child_variable)) {
+    return run_child(mode);
+  }
+
+  RUN_TEST(exit_code);
+  RUN_TEST(output_to_file);
+  RUN_TEST(input_from_file);
+  RUN_TEST(environment);
+  RUN_TEST(wait_set);
+#ifndef _WIN32
+  RUN_TEST(output_to_file_descriptor);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
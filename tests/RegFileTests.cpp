@@ -0,0 +1,267 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/RegFile.h"
+#include "WinAPI/Registry.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_invalid_data = 13;
+
+void fill_registry(RegistryKey& key)
+{
+  key.SetValue("", "default");
+  key.SetValue("Int", 42);
+  key.SetValue("String", "C:\\Program Files\\\"quoted\"");
+  key.SetValue("Empty", "");
+  key.SetValue("Lines", "first\r\nsecond\nthird\r");
+  key.SetValue("N\xC3\xA4me", "\xE2\x82\xAC");
+  key.SetQWordValue("QWord", 1ull << 40);
+  key.SetExpandStringValue("Expand", "%PATH%");
+  key.SetMultiStringValue("Multi", { "a", "b" });
+
+  // long enough to be wrapped on several lines
+  std::vector<unsigned char> binary;
+
+  for (int i(0); i < 200; ++i) {
+    binary.push_back(static_cast<unsigned char>(i));
+  }
+
+  key.SetBinaryValue("Binary", binary.data(), binary.size());
+
+  RegistryKey sub = Registry::CreateKey(key, "Sub\\Nested", Registry::Write);
+  sub.SetValue("Value", 1);
+  Registry::CreateKey(key, "Another", Registry::Write);
+}
+
+std::string export_regfile(const RegistryKey& key, RegFileWriter::Encoding encoding)
+{
+  std::ostringstream output;
+  RegFileWriter writer{ output, encoding };
+  writer.Write(key, "HKEY_CURRENT_USER\\Source");
+  writer.Flush();
+  return output.str();
+}
+
+void import_regfile(MemoryRegistry& memory, const std::string& content)
+{
+  std::istringstream input{ content };
+  RegFileReader reader;
+  reader.SetBackend(&memory);
+  reader.Import(input);
+}
+
+void round_trip(RegFileWriter::Encoding encoding)
+{
+  std::string exported;
+
+  {
+    MemoryRegistry memory;
+    Registry::SetBackend(&memory);
+    RegistryKey source = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Write);
+    fill_registry(source);
+    exported = export_regfile(Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Read), encoding);
+    Registry::SetBackend(nullptr);
+  }
+
+  const std::string bom = encoding == RegFileWriter::Utf16 ? "\xFF\xFE" : "";
+  CHECK(exported.substr(0, bom.size()) == bom);
+
+  MemoryRegistry memory;
+  import_regfile(memory, exported);
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Read);
+  CHECK(key.GetStringValue("") == "default");
+  CHECK(key.GetIntValue("Int") == 42);
+  CHECK(key.GetStringValue("String") == "C:\\Program Files\\\"quoted\"");
+  CHECK(key.GetStringValue("Empty").empty());
+  CHECK(key.GetStringValue("Lines") == "first\r\nsecond\nthird\r");
+  CHECK(key.GetStringValue("N\xC3\xA4me") == "\xE2\x82\xAC");
+  CHECK(key.GetQWordValue("QWord") == 1ull << 40);
+  CHECK(key.GetExpandStringValue("Expand") == "%PATH%");
+  CHECK((key.GetMultiStringValue("Multi") == std::vector<std::string>{ "a", "b" }));
+  CHECK(key.GetBinaryValue("Binary").size() == 200 && key.GetBinaryValue("Binary")[199] == 199);
+  CHECK(Registry::OpenKey(key, "Sub\\Nested", Registry::Read).GetIntValue("Value") == 1);
+  CHECK(!Registry::OpenKey(key, "Another", Registry::Read).IsNull());
+
+  // exporting the imported key gives the same file
+  CHECK(export_regfile(key, encoding) == exported);
+
+  Registry::SetBackend(nullptr);
+}
+
+void round_trip_utf16()
+{
+  round_trip(RegFileWriter::Utf16);
+}
+
+void round_trip_utf8()
+{
+  round_trip(RegFileWriter::Utf8);
+}
+
+// strings with line breaks cannot be quoted, they are written as hex(1)
+void strings_with_line_breaks()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Write);
+  key.SetValue("Quoted", "one line");
+  key.SetValue("Lines", "a\nb");
+
+  const std::string exported = export_regfile(Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Read), RegFileWriter::Utf8);
+  CHECK(exported.find("\"Quoted\"=\"one line\"\r\n") != std::string::npos);
+  CHECK(exported.find("\"Lines\"=hex(1):61,00,0a,00,62,00,00,00\r\n") != std::string::npos);
+
+  Registry::SetBackend(nullptr);
+}
+
+// names cannot be written as hex, names with line breaks cannot be exported
+void names_with_line_breaks()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  {
+    RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Values", Registry::Write);
+    key.SetValue("Line\nBreak", 1);
+    Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Keys\\Line\rBreak", Registry::Write);
+  }
+
+  for (const char* name : { "Values", "Keys" })
+  {
+    const RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, name, Registry::Read);
+    CHECK(Testing::ErrorThrownBy([&]() { export_regfile(key, RegFileWriter::Utf8); }) == error_invalid_data);
+  }
+
+  Registry::SetBackend(nullptr);
+}
+
+void regedit4()
+{
+  // the strings of hex(2) and hex(7) values are in the code page of the file
+  const std::string content =
+    "REGEDIT4\r\n"
+    "\r\n"
+    "[HKEY_CURRENT_USER\\Old]\r\n"
+    "\"String\"=\"value\"\r\n"
+    "\"Expand\"=hex(2):25,50,41,54,48,25,00\r\n"
+    "\"Multi\"=hex(7):61,00,62,00,00\r\n"
+    "\"Int\"=dword:0000002a\r\n";
+
+  MemoryRegistry memory;
+  import_regfile(memory, content);
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Old", Registry::Read);
+  CHECK(key.GetStringValue("String") == "value");
+  CHECK(key.GetExpandStringValue("Expand") == "%PATH%");
+  CHECK((key.GetMultiStringValue("Multi") == std::vector<std::string>{ "a", "b" }));
+  CHECK(key.GetIntValue("Int") == 42);
+
+  Registry::SetBackend(nullptr);
+}
+
+void continuation_lines()
+{
+  const std::string content =
+    "Windows Registry Editor Version 5.00\n"
+    "\n"
+    "; a comment\n"
+    "[HKCU\\Lines]\n"
+    "\"Binary\"=hex:00,01,\\\n"
+    "  02,03,\\\n"
+    "\t04\n"
+    "@ = \"default\"\n";
+
+  MemoryRegistry memory;
+  import_regfile(memory, content);
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Lines", Registry::Read);
+  CHECK((key.GetBinaryValue("Binary") == std::vector<unsigned char>{ 0, 1, 2, 3, 4 }));
+  CHECK(key.GetStringValue("") == "default");
+
+  Registry::SetBackend(nullptr);
+}
+
+void deletions()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  {
+    RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Software\\Kept", Registry::Write);
+    key.SetValue("Deleted", 1);
+    key.SetValue("Kept", 2);
+    Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Software\\Deleted\\Sub\\Sub", Registry::Write).SetValue("Value", 3);
+  }
+
+  const std::string content =
+    "Windows Registry Editor Version 5.00\r\n"
+    "\r\n"
+    "[-HKEY_CURRENT_USER\\Software\\Deleted]\r\n"
+    "\"Ignored\"=dword:00000001\r\n"
+    "\r\n"
+    "[-HKEY_CURRENT_USER\\Software\\Missing]\r\n"
+    "\r\n"
+    "[HKEY_CURRENT_USER\\Software\\Kept]\r\n"
+    "\"Deleted\"=-\r\n"
+    "\"Missing\"=-\r\n";
+
+  import_regfile(memory, content);
+
+  CHECK(Testing::ErrorThrownBy([]() { Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Software\\Deleted", Registry::Read); }) == error_file_not_found);
+  RegistryKey key = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Software\\Kept", Registry::Read);
+  CHECK(Testing::ErrorThrownBy([&]() { key.GetIntValue("Deleted"); }) == error_file_not_found);
+  CHECK(key.GetIntValue("Kept") == 2);
+
+  Registry::SetBackend(nullptr);
+}
+
+void syntax_errors()
+{
+  MemoryRegistry memory;
+  RegFileReader reader;
+  reader.SetBackend(&memory);
+
+  auto import = [&](const std::string& content) {
+    std::istringstream input{ content };
+    return reader.TryImport(input).Value();
+  };
+
+  const std::string header = "Windows Registry Editor Version 5.00\r\n\r\n[HKCU\\Errors]\r\n";
+  CHECK(import("not a reg file\r\n") == error_invalid_data);
+  CHECK(reader.GetErrorLine() == 1);
+  CHECK(import(header + "\"Int\"=dword:1234567890\r\n") == error_invalid_data);
+  CHECK(reader.GetErrorLine() == 4);
+  CHECK(import(header + "\"Binary\"=hex:0g\r\n") == error_invalid_data);
+  CHECK(import(header + "\"Unterminated=\"value\"\r\n") == error_invalid_data);
+  CHECK(import(header + "[HKEY_NOWHERE\\Key]\r\n") == error_invalid_data);
+  CHECK(import(header + "\r\n\"Value\"=\"ok\"\r\n") == 0);
+  CHECK(reader.GetErrorLine() == 0);
+}
+
+int main()
+{
+  RUN_TEST(round_trip_utf16);
+  RUN_TEST(round_trip_utf8);
+  RUN_TEST(strings_with_line_breaks);
+  RUN_TEST(names_with_line_breaks);
+  RUN_TEST(regedit4);
+  RUN_TEST(continuation_lines);
+  RUN_TEST(deletions);
+  RUN_TEST(syntax_errors);
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryCache.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_key_deleted = 1018;
+constexpr long error_unsupported_type = 1630;
+
+// counts the values read through the backend, i.e. the misses of the cache
+class CountingRegistry : public MemoryRegistry
+{
+public:
+  ErrorCode GetValue(KeyHandle key, const std::string& name, Registry::ValueType* type, void* data, size_t* size) override
+  {
+    reads.fetch_add(1);
+    return MemoryRegistry::GetValue(key, name, type, data, size);
+  }
+
+  std::atomic<int> reads{ 0 };
+};
+
+void invalidated_by_set_value()
+{
+  CountingRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey writer = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Cached", Registry::Write);
+  writer.SetValue("Int", 1);
+  writer.SetValue("String", "first");
+
+  RegistryCache cache{ Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Cached", Registry::Read) };
+  CHECK(cache.GetIntValue("Int") == 1);
+  CHECK(cache.GetStringValue("String") == "first");
+  CHECK(Testing::ErrorThrownBy([&]() { cache.GetIntValue("Missing"); }) == error_file_not_found);
+  CHECK(Testing::ErrorThrownBy([&]() { cache.GetStringValue("Int"); }) == error_unsupported_type);
+
+  // the values, including the missing one, are read once
+  const int reads = memory.reads.load();
+  CHECK(cache.GetIntValue("Int") == 1);
+  CHECK(cache.GetStringValue("String") == "first");
+  CHECK(Testing::ErrorThrownBy([&]() { cache.GetIntValue("Missing"); }) == error_file_not_found);
+  CHECK(memory.reads.load() == reads);
+
+  writer.SetValue("String", "second");
+  writer.SetValue("Missing", 3);
+  CHECK(cache.GetStringValue("String") == "second");
+  CHECK(cache.GetIntValue("Missing") == 3);
+  CHECK(cache.GetIntValue("Int") == 1);
+
+  // all the cached values were read again at once
+  CHECK(memory.reads.load() == reads + 3);
+
+  Registry::SetBackend(nullptr);
+}
+
+void invalidated_by_delete_key()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Deleted", Registry::Write).SetValue("Int", 1);
+
+  RegistryCache cache{ Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Deleted", Registry::Read) };
+  CHECK(cache.GetIntValue("Int") == 1);
+
+  Registry::DeleteKey(Registry::HKEY_CURRENT_USER, "Deleted");
+  CHECK(Testing::ErrorThrownBy([&]() { cache.GetIntValue("Int"); }) == error_key_deleted);
+
+  // a key created with the same name is another key
+  Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Deleted", Registry::Write).SetValue("Int", 2);
+  CHECK(Testing::ErrorThrownBy([&]() { cache.GetIntValue("Int"); }) == error_key_deleted);
+
+  Registry::SetBackend(nullptr);
+}
+
+// readers never see a value older than one they have already seen, nor an
+// error, while the values are read again after each modification
+void concurrent_reads_during_reload()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey writer = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Concurrent", Registry::Write);
+  writer.SetValue("Counter", 0);
+  writer.SetValue("Name", "value 0");
+
+  RegistryCache cache{ Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Concurrent", Registry::Read) };
+  constexpr int modifications = 2000;
+  std::atomic<bool> done{ false };
+  std::atomic<int> failures{ 0 };
+  std::vector<std::thread> readers;
+
+  for (int t(0); t < 4; ++t)
+  {
+    readers.emplace_back([&]() {
+      int last = 0;
+
+      while (!done.load())
+      {
+        const int counter = cache.GetIntValue("Counter");
+        const std::string name = cache.GetStringValue("Name");
+
+        if (counter < last || name.compare(0, 6, "value ") != 0) {
+          ++failures;
+        }
+
+        last = counter;
+      }
+    });
+  }
+
+  for (int i(1); i <= modifications; ++i)
+  {
+    writer.SetValue("Counter", i);
+    writer.SetValue("Name", "value " + std::to_string(i));
+  }
+
+  done.store(true);
+
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  CHECK(failures == 0);
+  CHECK(cache.GetIntValue("Counter") == modifications);
+  CHECK(cache.GetStringValue("Name") == "value " + std::to_string(modifications));
+
+  Registry::SetBackend(nullptr);
+}
+
+int main()
+{
+  RUN_TEST(invalidated_by_set_value);
+  RUN_TEST(invalidated_by_delete_key);
+  RUN_TEST(concurrent_reads_during_reload);
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryKeyCache.h"
+
+#include <atomic>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+
+// records the keys opened through the backend, i.e. the misses of the cache
+class CountingRegistry : public MemoryRegistry
+{
+public:
+  ErrorCode OpenKey(KeyHandle parent, const std::string& subKey, Registry::AccessRights accessRights, KeyHandle& result) override
+  {
+    opened.emplace_back(parent, subKey);
+    return MemoryRegistry::OpenKey(parent, subKey, accessRights, result);
+  }
+
+  std::vector<std::pair<KeyHandle, std::string>> opened;
+};
+
+void create_keys(std::initializer_list<const char*> paths)
+{
+  for (const char* path : paths) {
+    Registry::CreateKey(Registry::HKEY_CURRENT_USER, path, Registry::Write);
+  }
+}
+
+void least_recently_used_key_is_evicted()
+{
+  CountingRegistry memory;
+  Registry::SetBackend(&memory);
+  create_keys({ "A", "B", "C" });
+
+  RegistryKeyCache cache{ 2 };
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "A", Registry::Read);
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "B", Registry::Read);
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "\\a\\", Registry::Read);
+  CHECK(memory.opened.size() == 2);
+
+  // B is the least recently used key
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "C", Registry::Read);
+  CHECK(cache.size() == 2);
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "A", Registry::Read);
+  CHECK(memory.opened.size() == 3);
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "B", Registry::Read);
+  CHECK(memory.opened.size() == 4);
+  CHECK(memory.opened.back().second == "B");
+
+  // the access rights are part of the identity of a key
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "B", Registry::Write);
+  CHECK(memory.opened.size() == 5);
+
+  // a key evicted while it is open remains usable
+  RegistryKey key = cache.OpenKey(Registry::HKEY_CURRENT_USER, "C", Registry::Read);
+  cache.Clear();
+  CHECK(cache.size() == 0);
+  Registry::OpenKey(Registry::HKEY_CURRENT_USER, "C", Registry::Write).SetValue("Value", 1);
+  CHECK(key.GetIntValue("Value") == 1);
+
+  // failures are not cached
+  CHECK(Testing::ErrorThrownBy([&]() { cache.OpenKey(Registry::HKEY_CURRENT_USER, "Missing", Registry::Read); }) == error_file_not_found);
+  CHECK(cache.size() == 0);
+
+  Registry::SetBackend(nullptr);
+}
+
+void modified_key_is_reopened()
+{
+  CountingRegistry memory;
+  Registry::SetBackend(&memory);
+  create_keys({ "Watched", "Deleted" });
+
+  RegistryKeyCache cache;
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "Watched", Registry::Read);
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "Watched", Registry::Read);
+  CHECK(memory.opened.size() == 1);
+
+  Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Watched", Registry::Write).SetValue("Value", 2);
+  CHECK(cache.OpenKey(Registry::HKEY_CURRENT_USER, "Watched", Registry::Read).GetIntValue("Value") == 2);
+  CHECK(memory.opened.size() == 3);
+
+  // a deleted key is not returned from the cache
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "Deleted", Registry::Read);
+  Registry::DeleteKey(Registry::HKEY_CURRENT_USER, "Deleted");
+  CHECK(Testing::ErrorThrownBy([&]() { cache.OpenKey(Registry::HKEY_CURRENT_USER, "Deleted", Registry::Read); }) == error_file_not_found);
+
+  // nor a key that was invalidated
+  const size_t opened = memory.opened.size();
+  cache.Invalidate(Registry::HKEY_CURRENT_USER, "WATCHED");
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "Watched", Registry::Read);
+  CHECK(memory.opened.size() == opened + 1);
+
+  Registry::SetBackend(nullptr);
+}
+
+void key_is_opened_relative_to_its_parent()
+{
+  CountingRegistry memory;
+  Registry::SetBackend(&memory);
+  create_keys({ "Parent\\First", "Parent\\Second" });
+
+  RegistryKeyCache cache;
+  RegistryKey first = cache.OpenKey(Registry::HKEY_CURRENT_USER, "Parent\\First", Registry::Write);
+  CHECK(memory.opened.size() == 2);
+  CHECK(memory.opened[0].second == "Parent");
+  CHECK(memory.opened[1].second == "First");
+  CHECK(memory.opened[1].first != memory.GetPredefinedKey(RegistryBackend::CurrentUser));
+  CHECK(cache.size() == 2);
+
+  // the sibling only opens its last component, from the cached parent
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "Parent\\Second", Registry::Read);
+  CHECK(memory.opened.size() == 3);
+  CHECK(memory.opened[2].second == "Second");
+  CHECK(memory.opened[2].first == memory.opened[1].first);
+
+  // the parent is cached with read access, the keys with their own rights
+  cache.OpenKey(Registry::HKEY_CURRENT_USER, "Parent", Registry::Read);
+  CHECK(memory.opened.size() == 3);
+  first.SetValue("Value", 3);
+  CHECK(cache.OpenKey(Registry::HKEY_CURRENT_USER, "Parent\\First", Registry::Read).GetIntValue("Value") == 3);
+
+  Registry::SetBackend(nullptr);
+}
+
+void concurrent_opens()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+  create_keys({ "Shared\\0", "Shared\\1", "Shared\\2", "Shared\\3" });
+
+  RegistryKeyCache cache{ 4 };
+  std::atomic<int> failures{ 0 };
+  std::vector<std::thread> threads;
+
+  for (int t(0); t < 4; ++t)
+  {
+    threads.emplace_back([&, t]() {
+      for (int i(0); i < 1000; ++i)
+      {
+        RegistryKey key;
+
+        if (cache.TryOpenKey(Registry::HKEY_CURRENT_USER, "Shared\\" + std::to_string((i + t) % 4), Registry::Read, key) || key.IsNull()) {
+          ++failures;
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(failures == 0);
+  CHECK(cache.size() <= 4);
+  cache.Clear();
+
+  Registry::SetBackend(nullptr);
+}
+
+int main()
+{
+  RUN_TEST(least_recently_used_key_is_evicted);
+  RUN_TEST(modified_key_is_reopened);
+  RUN_TEST(key_is_opened_relative_to_its_parent);
+  RUN_TEST(concurrent_opens);
+  return Testing::Result();
+}
\ No newline at end of file
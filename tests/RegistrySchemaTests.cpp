@@ -0,0 +1,184 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistrySchema.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_unsupported_type = 1630;
+
+// counts the calls to GetValues(), which is called again when the
+// values do not fit in the buffer
+class CountingRegistry : public MemoryRegistry
+{
+public:
+  ErrorCode GetValues(KeyHandle key, ValueQuery* values, size_t count, void* buffer, size_t& size) override
+  {
+    ++calls;
+    return MemoryRegistry::GetValues(key, values, count, buffer, size);
+  }
+
+  int calls = 0;
+};
+
+struct Config
+{
+  bool enabled = false;
+  int32_t timeout = 30;
+  uint32_t flags = 0;
+  int64_t size = 0;
+  uint64_t limit = 0;
+  std::string folder = "default";
+  std::vector<std::string> names;
+  std::vector<unsigned char> data;
+};
+
+const auto& config_schema()
+{
+  static const auto schema = MakeRegistrySchema<Config>(
+    RegistryField("Enabled", &Config::enabled),
+    RegistryField("Timeout", &Config::timeout),
+    RegistryField("Flags", &Config::flags),
+    RegistryField("Size", &Config::size),
+    RegistryField("Limit", &Config::limit),
+    RegistryField("Folder", &Config::folder),
+    RegistryField("Names", &Config::names),
+    RegistryField("Data", &Config::data));
+
+  return schema;
+}
+
+void read_values()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Schema", static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+  key.SetValue("Enabled", 1);
+  key.SetValue("Flags", -1);
+  key.SetQWordValue("Size", uint64_t(1) << 40);
+  key.SetExpandStringValue("Folder", "%TEMP%\\Schema");
+  key.SetMultiStringValue("Names", { "first", "second", "third" });
+  key.SetValue("Data", "ab");
+
+  Config config;
+  config_schema().Read(key, config);
+  CHECK(config.enabled);
+  CHECK(config.flags == 0xFFFFFFFF);
+  CHECK(config.size == int64_t(1) << 40);
+  CHECK(config.folder == "%TEMP%\\Schema");
+  CHECK((config.names == std::vector<std::string>{ "first", "second", "third" }));
+  // any type can be read as bytes, here a REG_SZ in UTF-16
+  CHECK((config.data == std::vector<unsigned char>{ 'a', 0, 'b', 0, 0, 0 }));
+
+  // the members of the missing values are left unchanged
+  CHECK(config.timeout == 30);
+  CHECK(config.limit == 0);
+
+  // a REG_DWORD is widened to a 64-bit member, without sign extension
+  key.SetValue("Size", -2);
+  key.SetValue("Limit", 7);
+  config_schema().Read(key, config);
+  CHECK(config.size == 0xFFFFFFFE);
+  CHECK(config.limit == 7);
+
+  // an empty REG_MULTI_SZ
+  key.SetMultiStringValue("Names", {});
+  config_schema().Read(key, config);
+  CHECK(config.names.empty());
+
+  Registry::SetBackend(nullptr);
+}
+
+// returns the error thrown when reading a key with the values set by f
+template<typename F>
+long read_error(F f)
+{
+  static int keys = 0;
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Mismatch" + std::to_string(++keys), static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+  f(key);
+
+  return Testing::ErrorThrownBy([&]() {
+    Config config;
+    config_schema().Read(key, config);
+  });
+}
+
+void type_mismatches()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  CHECK(read_error([](RegistryKey&) {}) == -1);
+
+  // a string for an integer, and an integer for a string
+  CHECK(read_error([](RegistryKey& key) { key.SetValue("Timeout", "30"); }) == error_unsupported_type);
+  CHECK(read_error([](RegistryKey& key) { key.SetValue("Folder", 1); }) == error_unsupported_type);
+
+  // a REG_QWORD does not fit in a 32-bit member
+  CHECK(read_error([](RegistryKey& key) { key.SetQWordValue("Flags", 1); }) == error_unsupported_type);
+
+  // integers of the wrong size
+  CHECK(read_error([](RegistryKey& key) { key.SetValue("Enabled", Registry::DWord, "\x01\x00", 2); }) == error_unsupported_type);
+  CHECK(read_error([](RegistryKey& key) { key.SetValue("Enabled", Registry::DWord, "\x01\x00\x00\x00\x00\x00\x00\x00", 8); }) == error_unsupported_type);
+  CHECK(read_error([](RegistryKey& key) { key.SetValue("Size", Registry::QWord, "\x01\x00\x00\x00", 4); }) == error_unsupported_type);
+
+  // a string for a REG_MULTI_SZ
+  CHECK(read_error([](RegistryKey& key) { key.SetValue("Names", "first"); }) == error_unsupported_type);
+
+  Registry::SetBackend(nullptr);
+}
+
+// values larger than the buffer on the stack are read again into a buffer
+// on the heap
+void large_values()
+{
+  CountingRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey key = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Large", static_cast<Registry::AccessRights>(Registry::Read | Registry::Write));
+  key.SetValue("Timeout", 5);
+
+  Config config;
+  config_schema().Read(key, config);
+  CHECK(memory.calls == 1);
+
+  std::vector<unsigned char> data(3000);
+
+  for (size_t i(0); i < data.size(); ++i) {
+    data[i] = static_cast<unsigned char>(i * 13);
+  }
+
+  const std::string folder(600, 'f');
+  key.SetValue("Folder", folder);
+  key.SetBinaryValue("Data", data.data(), data.size());
+  key.SetMultiStringValue("Names", { std::string(100, 'a'), std::string(200, 'b') });
+
+  memory.calls = 0;
+  config_schema().Read(key, config);
+  CHECK(memory.calls == 2);
+  CHECK(config.timeout == 5);
+  CHECK(config.folder == folder);
+  CHECK(config.data == data);
+  CHECK((config.names == std::vector<std::string>{ std::string(100, 'a'), std::string(200, 'b') }));
+
+  Registry::SetBackend(nullptr);
+}
+
+int main()
+{
+  RUN_TEST(read_values);
+  RUN_TEST(type_mismatches);
+  RUN_TEST(large_values);
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,206 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryEnumeration.h"
+#include "WinAPI/RegistrySnapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_access_denied = 5;
+constexpr long error_bad_format = 11;
+
+// offsets of some fields of the snapshot file
+constexpr size_t snapshot_version_field = 4;
+constexpr size_t snapshot_keys_offset_field = 48;
+constexpr size_t snapshot_values_offset_field = 56;
+constexpr size_t snapshot_key_first_subkey = 4;
+constexpr size_t snapshot_value_size_field = 8;
+
+void fill_registry(RegistryKey& key)
+{
+  key.SetValue("", "default");
+  key.SetValue("Int", 42);
+  key.SetValue("String", "value");
+  key.SetQWordValue("QWord", 1ull << 40);
+  key.SetExpandStringValue("Expand", "%PATH%");
+  key.SetMultiStringValue("Multi", { "a", "b" });
+  key.SetBinaryValue("Binary", "\x00\x01\x02", 3);
+  key.SetBinaryValue("Empty", nullptr, 0);
+
+  RegistryKey sub = Registry::CreateKey(key, "Sub\\Nested", Registry::Write);
+  sub.SetValue("N\xC3\xA4me", "\xE2\x82\xAC");
+  Registry::CreateKey(key, "Another", Registry::Write);
+  Registry::CreateKey(key, "sub\\Empty", Registry::Write);
+}
+
+uint64_t read_u64(const std::string& data, size_t position)
+{
+  uint64_t value = 0;
+  std::memcpy(&value, data.data() + position, sizeof(value));
+  return value;
+}
+
+void write_u32(std::string& data, size_t position, uint32_t value)
+{
+  std::memcpy(&data[position], &value, sizeof(value));
+}
+
+void export_and_open()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  RegistryKey source = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Software\\Source", Registry::Write);
+  fill_registry(source);
+
+  Testing::TemporaryFile file{ "test_registrysnapshot_export.snapshot" };
+  RegistrySnapshot::Export(Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Software\\Source", Registry::Read), file.Path());
+
+  RegistrySnapshot snapshot{ file.Path() };
+  RegistryKey root = snapshot.GetRootKey();
+  CHECK(root.GetStringValue("") == "default");
+  CHECK(root.GetIntValue("INT") == 42);
+  CHECK(root.GetStringValue("string") == "value");
+  CHECK(root.GetQWordValue("QWord") == 1ull << 40);
+  CHECK(root.GetExpandStringValue("Expand") == "%PATH%");
+  CHECK((root.GetMultiStringValue("Multi") == std::vector<std::string>{ "a", "b" }));
+  CHECK((root.GetBinaryValue("Binary") == std::vector<unsigned char>{ 0, 1, 2 }));
+  CHECK(root.GetBinaryValue("Empty").empty());
+  CHECK(Registry::OpenKey(root, "SUB\\nested", Registry::Read).GetStringValue("N\xC3\xA4me") == "\xE2\x82\xAC");
+
+  // subkeys are enumerated in the order of their names
+  RegistrySubKeyList subkeys{ root };
+  CHECK((std::vector<std::string>(subkeys.begin(), subkeys.end()) == std::vector<std::string>{ "Another", "Sub" }));
+  RegistrySubKeyList nested{ Registry::OpenKey(root, "Sub", Registry::Read) };
+  CHECK((std::vector<std::string>(nested.begin(), nested.end()) == std::vector<std::string>{ "Empty", "Nested" }));
+
+  CHECK(Testing::ErrorThrownBy([&]() { root.GetIntValue("Missing"); }) == error_file_not_found);
+  CHECK(Testing::ErrorThrownBy([&]() { Registry::OpenKey(root, "Sub\\Missing", Registry::Read); }) == error_file_not_found);
+  CHECK(Testing::ErrorThrownBy([&]() { root.SetValue("Int", 1); }) == error_access_denied);
+  CHECK(Testing::ErrorThrownBy([&]() { Registry::CreateKey(root, "New", Registry::Write); }) == error_access_denied);
+
+  Registry::SetBackend(nullptr);
+}
+
+void import_round_trip()
+{
+  Testing::TemporaryFile first{ "test_registrysnapshot_first.snapshot" };
+  Testing::TemporaryFile second{ "test_registrysnapshot_second.snapshot" };
+
+  {
+    MemoryRegistry memory;
+    Registry::SetBackend(&memory);
+    RegistryKey source = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Write);
+    fill_registry(source);
+    RegistrySnapshot::Export(Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Read), first.Path());
+    Registry::SetBackend(nullptr);
+  }
+
+  // imported into another registry, existing values are replaced and the others are kept
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  {
+    RegistryKey target = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Target", Registry::Write);
+    target.SetValue("Int", 1);
+    target.SetValue("Kept", 2);
+    RegistrySnapshot snapshot{ first.Path() };
+    snapshot.Import(target);
+  }
+
+  RegistryKey target = Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Target", Registry::Read);
+  CHECK(target.GetIntValue("Int") == 42);
+  CHECK(target.GetIntValue("Kept") == 2);
+  CHECK(Registry::OpenKey(target, "Sub\\Nested", Registry::Read).GetStringValue("N\xC3\xA4me") == "\xE2\x82\xAC");
+  CHECK(!Registry::OpenKey(target, "Sub\\Empty", Registry::Read).IsNull());
+
+  // imported into an empty key, exporting again gives the same file
+  {
+    RegistrySnapshot snapshot{ first.Path() };
+    snapshot.Import(Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Copy", Registry::Write));
+  }
+
+  RegistrySnapshot::Export(Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Copy", Registry::Read), second.Path());
+  CHECK(second.Read() == first.Read());
+
+  Registry::SetBackend(nullptr);
+}
+
+void rejects_corrupt_files()
+{
+  Testing::TemporaryFile file{ "test_registrysnapshot_corrupt.snapshot" };
+  auto open = [&]() { RegistrySnapshot snapshot{ file.Path() }; };
+
+  CHECK(Testing::ErrorThrownBy(open) == error_file_not_found);
+
+  std::string data;
+
+  {
+    MemoryRegistry memory;
+    Registry::SetBackend(&memory);
+    RegistryKey source = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Write);
+    fill_registry(source);
+    RegistrySnapshot::Export(Registry::OpenKey(Registry::HKEY_CURRENT_USER, "Source", Registry::Read), file.Path());
+    data = file.Read();
+    Registry::SetBackend(nullptr);
+  }
+
+  CHECK(Testing::ErrorThrownBy(open) == -1);
+
+  file.Write(std::string());
+  CHECK(Testing::ErrorThrownBy(open) == error_bad_format);
+
+  file.Write(std::string(data.size(), 'x'));
+  CHECK(Testing::ErrorThrownBy(open) == error_bad_format);
+
+  // truncated anywhere, including in the data
+  bool all_rejected = true;
+
+  for (size_t size : { size_t(4), size_t(40), data.size() / 2, data.size() - 8, data.size() - 1 })
+  {
+    file.Write(data.substr(0, size));
+    all_rejected = all_rejected && Testing::ErrorThrownBy(open) == error_bad_format;
+  }
+
+  CHECK(all_rejected);
+
+  auto open_modified = [&](size_t position, uint32_t value) {
+    std::string modified = data;
+    write_u32(modified, position, value);
+    file.Write(modified);
+    return Testing::ErrorThrownBy(open);
+  };
+
+  const size_t keys = static_cast<size_t>(read_u64(data, snapshot_keys_offset_field));
+  const size_t values = static_cast<size_t>(read_u64(data, snapshot_values_offset_field));
+
+  // another version
+  CHECK(open_modified(snapshot_version_field, 2) == error_bad_format);
+  // a section that is not aligned, or out of the file
+  CHECK(open_modified(snapshot_keys_offset_field, static_cast<uint32_t>(keys + 4)) == error_bad_format);
+  CHECK(open_modified(snapshot_values_offset_field, static_cast<uint32_t>(data.size() + 8)) == error_bad_format);
+  // the root key as its own subkey
+  CHECK(open_modified(keys + snapshot_key_first_subkey, 0) == error_bad_format);
+  // a value whose data is out of the file
+  CHECK(open_modified(values + snapshot_value_size_field, static_cast<uint32_t>(data.size())) == error_bad_format);
+}
+
+int main()
+{
+  RUN_TEST(export_and_open);
+  RUN_TEST(import_round_trip);
+  RUN_TEST(rejects_corrupt_files);
+  return Testing::Result();
+}
\ No newline at end of file
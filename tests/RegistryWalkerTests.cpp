@@ -0,0 +1,142 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/MemoryRegistry.h"
+#include "WinAPI/Registry.h"
+#include "WinAPI/RegistryWalker.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace Win32;
+
+// creates a tree of keys: 'fanout' subkeys per key down to 'depth', with one value per key
+void create_tree(RegistryKey& key, int fanout, int depth, std::vector<std::string>& paths, const std::string& path = std::string())
+{
+  key.SetValue("Path", path);
+
+  if (depth == 0) {
+    return;
+  }
+
+  for (int i(0); i < fanout; ++i)
+  {
+    const std::string name = "Key" + std::to_string(i);
+    const std::string child_path = path.empty() ? name : path + "\\" + name;
+    paths.push_back(child_path);
+    RegistryKey child = Registry::CreateKey(key, name, Registry::Write);
+    create_tree(child, fanout, depth - 1, paths, child_path);
+  }
+}
+
+void visits_all_keys()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  std::vector<std::string> expected{ "" };
+  RegistryKey tree = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Tree", Registry::Write);
+  create_tree(tree, 5, 4, expected);
+
+  std::mutex mutex;
+  std::vector<std::string> visited;
+  bool depths_ok = true;
+  bool values_ok = true;
+
+  RegistryWalker walker;
+  walker.SetThreadCount(4);
+  walker.SetKeyVisitor([&](const RegistryWalker::Key& key) {
+    std::lock_guard<std::mutex> lock{ mutex };
+    visited.push_back(key.GetPath());
+    const size_t depth = key.GetPath().empty() ? 0 : std::count(key.GetPath().begin(), key.GetPath().end(), '\\') + 1;
+    depths_ok = depths_ok && key.GetDepth() == depth;
+    return RegistryWalker::Continue;
+  });
+  walker.SetValueVisitor([&](const RegistryWalker::Key& key, const RegistryWalker::Value& value) {
+    // the value is read from the key being visited
+    const bool ok = value.GetName() == "Path" && key.GetKey().GetStringValue("Path") == key.GetPath();
+    std::lock_guard<std::mutex> lock{ mutex };
+    values_ok = values_ok && ok;
+    return RegistryWalker::Continue;
+  });
+
+  CHECK(walker.Walk(Registry::HKEY_CURRENT_USER, "Tree"));
+
+  std::sort(expected.begin(), expected.end());
+  std::sort(visited.begin(), visited.end());
+  CHECK(visited == expected);
+  CHECK(depths_ok);
+  CHECK(values_ok);
+
+  Registry::SetBackend(nullptr);
+}
+
+void visits_in_order_with_one_thread()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  std::vector<std::string> expected{ "" };
+  RegistryKey tree = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Tree", Registry::Write);
+  create_tree(tree, 3, 3, expected);
+
+  std::vector<std::string> visited;
+  RegistryWalker walker;
+  walker.SetThreadCount(1);
+  walker.SetKeyVisitor([&](const RegistryWalker::Key& key) {
+    visited.push_back(key.GetPath());
+    return RegistryWalker::Continue;
+  });
+
+  CHECK(walker.Walk(Registry::HKEY_CURRENT_USER, "Tree"));
+
+  // depth-first, in creation order
+  CHECK(visited == expected);
+
+  Registry::SetBackend(nullptr);
+}
+
+void skip_and_stop()
+{
+  MemoryRegistry memory;
+  Registry::SetBackend(&memory);
+
+  std::vector<std::string> paths;
+  RegistryKey tree = Registry::CreateKey(Registry::HKEY_CURRENT_USER, "Tree", Registry::Write);
+  create_tree(tree, 3, 3, paths);
+
+  std::mutex mutex;
+  std::vector<std::string> visited;
+
+  RegistryWalker walker;
+  walker.SetThreadCount(2);
+  walker.SetKeyVisitor([&](const RegistryWalker::Key& key) {
+    std::lock_guard<std::mutex> lock{ mutex };
+    visited.push_back(key.GetPath());
+    return key.GetDepth() == 1 ? RegistryWalker::SkipSubKeys : RegistryWalker::Continue;
+  });
+
+  CHECK(walker.Walk(Registry::HKEY_CURRENT_USER, "Tree"));
+  CHECK(visited.size() == 4);
+
+  walker.SetKeyVisitor([&](const RegistryWalker::Key& key) {
+    return key.GetPath() == "Key1" ? RegistryWalker::Stop : RegistryWalker::Continue;
+  });
+
+  CHECK(!walker.Walk(Registry::HKEY_CURRENT_USER, "Tree"));
+
+  Registry::SetBackend(nullptr);
+}
+
+int main()
+{
+  RUN_TEST(visits_all_keys);
+  RUN_TEST(visits_in_order_with_one_thread);
+  RUN_TEST(skip_and_stop);
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Semaphore.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_file_not_found = 2;
+constexpr long error_invalid_parameter = 87;
+constexpr long error_already_exists = 183;
+
+// semaphores are shared by all the processes, the names used by the tests
+// must not collide with those of another instance of the tests
+std::string semaphore_name(const std::string& name)
+{
+#ifdef _WIN32
+  const unsigned long pid = ::GetCurrentProcessId();
+#else
+  const unsigned long pid = static_cast<unsigned long>(::getpid());
+#endif
+  return "WinAPI.Tests." + std::to_string(pid) + "." + name;
+}
+
+void create_and_open()
+{
+  const std::string name = semaphore_name("CreateAndOpen");
+
+  CHECK(Testing::ErrorThrownBy([&]() { Semaphore::Open(name); }) == error_file_not_found);
+  CHECK(Testing::ErrorThrownBy([&]() { Semaphore::Create(name, 3, 2); }) == error_invalid_parameter);
+  CHECK(Testing::ErrorThrownBy([&]() { Semaphore::Create(name, 0, 0); }) == error_invalid_parameter);
+
+  Semaphore created = Semaphore::Create(name, 1, 3);
+  CHECK(created.Created());
+  CHECK(created.GetName() == name);
+  CHECK(created.GetCount() == 1);
+  CHECK(created.GetMaximumCount() == 3);
+  CHECK(Testing::ErrorThrownBy([&]() { Semaphore::Create(name, 0, 1); }) == error_already_exists);
+
+  // the counts are those of the existing semaphore
+  Semaphore opened = Semaphore::Open(name);
+  CHECK(!opened.Created());
+  CHECK(opened.GetMaximumCount() == 3);
+  Semaphore other{ name, 0, 1 };
+  CHECK(!other.Created());
+  CHECK(other.GetCount() == 1);
+
+  // the count is shared
+  CHECK(opened.TryAcquire());
+  CHECK(!created.TryAcquire());
+  CHECK(other.Release(3));
+  CHECK(!created.Release());
+  CHECK(created.GetCount() == 3);
+
+  Semaphore null;
+  CHECK(null.IsNull());
+  CHECK(!null.Acquire());
+  CHECK(!null.Release());
+}
+
+void acquire_for()
+{
+  Semaphore semaphore = Semaphore::Create(semaphore_name("AcquireFor"), 0, 10);
+
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(!semaphore.AcquireFor(std::chrono::milliseconds(50)));
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+  CHECK(!semaphore.AcquireFor(std::chrono::milliseconds(-1)));
+  CHECK(!semaphore.Release(0));
+
+  std::thread releaser{ [&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    semaphore.Release(2);
+  } };
+
+  CHECK(semaphore.AcquireFor(std::chrono::seconds(10)));
+  CHECK(semaphore.AcquireFor(std::chrono::seconds(10)));
+  CHECK(semaphore.GetCount() == 0);
+  releaser.join();
+}
+
+// threads that time out and releases that find waiters must not leave wake-ups
+// behind: a thread waiting on an empty semaphore must block
+void no_stale_wakeup()
+{
+  Semaphore semaphore = Semaphore::Create(semaphore_name("Stale"), 0, 1000);
+  constexpr int thread_count = 4;
+  std::vector<std::thread> threads;
+
+  for (int round(0); round < 50; ++round)
+  {
+    for (int t(0); t < thread_count; ++t) {
+      threads.emplace_back([&]() { semaphore.AcquireFor(std::chrono::milliseconds(2)); });
+    }
+
+    semaphore.Release(thread_count);
+
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    threads.clear();
+
+    while (semaphore.TryAcquire()) {
+    }
+  }
+
+  CHECK(semaphore.GetCount() == 0);
+  CHECK(!semaphore.AcquireFor(std::chrono::milliseconds(20)));
+}
+
+void producers_and_consumers()
+{
+  Semaphore semaphore = Semaphore::Create(semaphore_name("Consumers"), 0, 1 << 20);
+  constexpr int thread_count = 4;
+  constexpr int items = 20000;
+  std::atomic<int> consumed{ 0 };
+  std::vector<std::thread> threads;
+
+  for (int t(0); t < thread_count; ++t)
+  {
+    threads.emplace_back([&, t]() {
+      Semaphore s = Semaphore::Open(semaphore.GetName());
+      s.SetSpinCount(t % 2 == 0 ? 0 : 1000);
+
+      for (int i(0); i < items; ++i)
+      {
+        if (s.AcquireFor(std::chrono::seconds(10))) {
+          ++consumed;
+        }
+      }
+    });
+
+    threads.emplace_back([&]() {
+      for (int i(0); i < items; ++i) {
+        semaphore.Release();
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(consumed == thread_count * items);
+  CHECK(semaphore.GetCount() == 0);
+}
+
+#ifndef _WIN32
+
+void shared_between_processes()
+{
+  const std::string name = semaphore_name("Processes");
+  Semaphore semaphore = Semaphore::Create(name, 0, 10);
+
+  const pid_t child = ::fork();
+
+  if (child == 0)
+  {
+    Semaphore s = Semaphore::Open(name);
+    ::_exit(s.AcquireFor(std::chrono::seconds(10)) && s.AcquireFor(std::chrono::seconds(10)) ? 0 : 1);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  semaphore.Release();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  semaphore.Release();
+
+  int status = 0;
+  ::waitpid(child, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  CHECK(semaphore.GetCount() == 0);
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  RUN_TEST(create_and_open);
+  RUN_TEST(acquire_for);
+  RUN_TEST(no_stale_wakeup);
+  RUN_TEST(producers_and_consumers);
+#ifndef _WIN32
+  RUN_TEST(shared_between_processes);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace Win32;
+
+void one_shot()
+{
+  Timer timer;
+
+  // a timer that is not started is never signaled
+  CHECK(!timer.WaitFor(std::chrono::milliseconds(10)));
+
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(timer.Start(std::chrono::milliseconds(30)));
+  CHECK(!timer.WaitFor(std::chrono::milliseconds(0)));
+  CHECK(timer.WaitFor(std::chrono::seconds(10)));
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(30));
+
+  // the timer was reset by the wait, and is signaled once
+  CHECK(!timer.WaitFor(std::chrono::milliseconds(50)));
+
+  // a zero due time signals the timer immediately
+  CHECK(timer.Start(std::chrono::nanoseconds(0)));
+  CHECK(timer.WaitFor(std::chrono::seconds(10)));
+}
+
+void periodic()
+{
+  Timer timer;
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(timer.Start(std::chrono::milliseconds(10), std::chrono::milliseconds(10)));
+
+  bool signaled = true;
+
+  for (int i(0); i < 5; ++i) {
+    signaled = signaled && timer.WaitFor(std::chrono::seconds(10));
+  }
+
+  CHECK(signaled);
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50));
+
+  // a stopped timer is no longer signaled
+  CHECK(timer.Stop());
+  timer.WaitFor(std::chrono::milliseconds(0));
+  CHECK(!timer.WaitFor(std::chrono::milliseconds(30)));
+
+  // and can be started again
+  CHECK(timer.Start(std::chrono::milliseconds(5)));
+  CHECK(timer.Wait());
+}
+
+// a single thread is released each time the timer is signaled
+void released_once()
+{
+  Timer timer;
+  std::atomic<int> released{ 0 };
+  std::vector<std::thread> threads;
+
+  for (int t(0); t < 4; ++t)
+  {
+    threads.emplace_back([&]() {
+      if (timer.WaitFor(std::chrono::milliseconds(200))) {
+        ++released;
+      }
+    });
+  }
+
+  CHECK(timer.Start(std::chrono::milliseconds(20)));
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(released == 1);
+
+  Timer moved = std::move(timer);
+  CHECK(!timer.Start(std::chrono::milliseconds(0)));
+  CHECK(!timer.Wait());
+  CHECK(moved.Start(std::chrono::milliseconds(0)));
+  CHECK(moved.Wait());
+}
+
+int main()
+{
+  RUN_TEST(one_shot);
+  RUN_TEST(periodic);
+  RUN_TEST(released_once);
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,229 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#include "testing.h"
+
+#include "WinAPI/Event.h"
+#include "WinAPI/Timer.h"
+#include "WinAPI/WaitSet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace Win32;
+
+// error codes, as defined in WinError.h
+constexpr long error_already_exists = 183;
+
+// collects the ids reported by the set until count of them were reported
+std::vector<WaitSet::Id> wait_for_count(WaitSet& set, size_t count)
+{
+  std::vector<WaitSet::Id> result;
+  std::vector<WaitSet::Id> ready;
+
+  while (result.size() < count && set.WaitFor(ready, std::chrono::seconds(10))) {
+    result.insert(result.end(), ready.begin(), ready.end());
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void events()
+{
+  WaitSet set;
+  Event auto_reset{ std::string(), Event::AutoReset };
+  Event manual_reset{ std::string(), Event::ManualReset };
+  const WaitSet::Id auto_id = set.Add(auto_reset);
+  const WaitSet::Id manual_id = set.Add(manual_reset);
+  CHECK(auto_id != 0 && manual_id != 0 && auto_id != manual_id);
+  CHECK(set.Size() == 2);
+
+  std::vector<WaitSet::Id> ready;
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(10)));
+  CHECK(ready.empty());
+
+  // waiting resets the auto-reset event, not the manual-reset one
+  auto_reset.Set();
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ auto_id });
+  CHECK(!auto_reset.WaitFor(std::chrono::milliseconds(0)));
+
+  manual_reset.Set();
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ manual_id });
+  CHECK(manual_reset.WaitFor(std::chrono::milliseconds(0)));
+
+  // a registration fires once until it is rearmed
+  auto_reset.Set();
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(20)));
+  CHECK(set.Rearm(auto_id) && set.Rearm(manual_id));
+  CHECK(wait_for_count(set, 2) == (std::vector<WaitSet::Id>{ (std::min)(auto_id, manual_id), (std::max)(auto_id, manual_id) }));
+
+  // a pulse releases the set
+  manual_reset.Reset();
+  CHECK(set.Rearm(manual_id));
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(20)));
+  manual_reset.Pulse();
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ manual_id });
+}
+
+void timers()
+{
+  WaitSet set;
+  Timer timer;
+  const WaitSet::Id id = set.Add(timer);
+
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(timer.Start(std::chrono::milliseconds(20), std::chrono::milliseconds(10)));
+
+  std::vector<WaitSet::Id> ready;
+  bool signaled = true;
+
+  for (int i(0); i < 5; ++i)
+  {
+    signaled = signaled && set.WaitFor(ready, std::chrono::seconds(10)) && ready == std::vector<WaitSet::Id>{ id };
+    set.Rearm(id);
+  }
+
+  CHECK(signaled);
+  CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(60));
+
+  // a stopped timer is no longer reported
+  CHECK(timer.Stop());
+  set.WaitFor(ready, std::chrono::milliseconds(0));
+  set.Rearm(id);
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(30)));
+
+  // waiting for the timer through the set resets it
+  CHECK(timer.Start(std::chrono::milliseconds(5)));
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ id });
+  CHECK(!timer.WaitFor(std::chrono::milliseconds(0)));
+}
+
+void removed_objects()
+{
+  WaitSet set;
+  Event ev{ std::string(), Event::ManualReset };
+  const WaitSet::Id id = set.Add(ev);
+
+  // a removed object is never reported, even if it was signaled before
+  ev.Set();
+  CHECK(set.Remove(id));
+  CHECK(set.Size() == 0);
+  std::vector<WaitSet::Id> ready;
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(20)));
+
+  CHECK(!set.Remove(id));
+  CHECK(!set.Rearm(id));
+
+  // the slot is reused with another id
+  const WaitSet::Id other = set.Add(ev);
+  CHECK(other != id);
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ other });
+}
+
+// more events than a single wait can handle
+void many_events()
+{
+  constexpr int event_count = 1000;
+  WaitSet set;
+  std::vector<std::unique_ptr<Event>> events;
+  std::vector<WaitSet::Id> ids;
+
+  for (int i(0); i < event_count; ++i)
+  {
+    events.push_back(std::make_unique<Event>(std::string(), Event::AutoReset));
+    ids.push_back(set.Add(*events.back()));
+  }
+
+  CHECK(set.Size() == event_count);
+
+  std::thread setter{ [&]() {
+    for (int i(event_count - 1); i >= 0; --i) {
+      events[i]->Set();
+    }
+  } };
+
+  std::sort(ids.begin(), ids.end());
+  CHECK(wait_for_count(set, event_count) == ids);
+  setter.join();
+
+  // every other event is removed, the others are rearmed
+  for (int i(0); i < event_count; ++i)
+  {
+    if (i % 2) {
+      set.Remove(ids[i]);
+    } else {
+      set.Rearm(ids[i]);
+    }
+  }
+
+  for (const std::unique_ptr<Event>& ev : events) {
+    ev->Set();
+  }
+
+  std::vector<WaitSet::Id> rearmed;
+
+  for (int i(0); i < event_count; i += 2) {
+    rearmed.push_back(ids[i]);
+  }
+
+  CHECK(wait_for_count(set, rearmed.size()) == rearmed);
+  std::vector<WaitSet::Id> ready;
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(20)));
+}
+
+#ifndef _WIN32
+
+void file_descriptors()
+{
+  WaitSet set;
+  int fds[2];
+  CHECK(::pipe(fds) == 0);
+  const WaitSet::Id id = set.Add(fds[0]);
+  CHECK(Testing::ErrorThrownBy([&]() { set.Add(fds[0]); }) == error_already_exists);
+
+  std::vector<WaitSet::Id> ready;
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(10)));
+
+  CHECK(::write(fds[1], "x", 1) == 1);
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ id });
+
+  // the file descriptor is not read, and is reported again once rearmed
+  CHECK(!set.WaitFor(ready, std::chrono::milliseconds(10)));
+  CHECK(set.Rearm(id));
+  CHECK(set.WaitFor(ready, std::chrono::seconds(10)));
+  CHECK(ready == std::vector<WaitSet::Id>{ id });
+
+  CHECK(set.Remove(id));
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+#endif // !_WIN32
+
+int main()
+{
+  RUN_TEST(events);
+  RUN_TEST(timers);
+  RUN_TEST(removed_objects);
+  RUN_TEST(many_events);
+#ifndef _WIN32
+  RUN_TEST(file_descriptors);
+#endif // !_WIN32
+  return Testing::Result();
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+// Copyright (C) 2024 Vincent Chambrin
+// This file is part of the WinAPI project.
+// For conditions of distribution and use, see copyright notice in LICENSE.
+
+#ifndef WINAPI_TESTS_TESTING_H
+#define WINAPI_TESTS_TESTING_H
+
+#include "WinAPI/Exception.h"
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+
+// A minimal test harness: each test program runs its test functions with
+// RUN_TEST() and returns Testing::Result(), which is non-zero if a check failed.
+
+namespace Testing
+{
+
+inline int& FailureCount()
+{
+  static int count = 0;
+  return count;
+}
+
+inline void Check(bool ok, const char* expr, const char* file, int line)
+{
+  if (!ok)
+  {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    ++FailureCount();
+  }
+}
+
+template<typename F>
+void Run(const char* name, F&& test)
+{
+  const int failures = FailureCount();
+
+  try
+  {
+    test();
+  }
+  catch (const std::exception& ex)
+  {
+    std::fprintf(stderr, "%s: unexpected exception: %s\n", name, ex.what());
+    ++FailureCount();
+  }
+
+  std::printf("%s %s\n", FailureCount() == failures ? "[ OK ]" : "[FAIL]", name);
+}
+
+// returns the error code of the Win32::Exception thrown by f, or -1 if
+// f did not throw
+template<typename F>
+long ErrorThrownBy(F&& f)
+{
+  try
+  {
+    f();
+  }
+  catch (const Win32::Exception& ex)
+  {
+    return ex.GetErrorCode().Value();
+  }
+
+  return -1;
+}
+
+inline int Result()
+{
+  return FailureCount() == 0 ? 0 : 1;
+}
+
+// a file in the working directory of the test, removed when the object is destroyed
+class TemporaryFile
+{
+public:
+  explicit TemporaryFile(std::string name)
+    : m_path(std::move(name))
+  {
+    std::remove(m_path.c_str());
+  }
+
+  TemporaryFile(const TemporaryFile&) = delete;
+
+  ~TemporaryFile()
+  {
+    std::remove(m_path.c_str());
+  }
+
+  const std::string& Path() const
+  {
+    return m_path;
+  }
+
+  void Write(const std::string& content) const
+  {
+    std::ofstream file{ m_path, std::ios::binary | std::ios::trunc };
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+  }
+
+  std::string Read() const
+  {
+    std::ifstream file{ m_path, std::ios::binary };
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+private:
+  std::string m_path;
+};
+
+} // namespace Testing
+
+#define CHECK(expr) Testing::Check(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+#define RUN_TEST(test) Testing::Run(#test, test)
+
+#endif // WINAPI_TESTS_TESTING_H
\ No newline at end of file